@@ -0,0 +1,73 @@
+#include "adc_scale.h"
+#include "adc_tables.h"
+
+/*
+ * Перетворення кодів АЦП для дисплея без плаваючої крапки: таблиці
+ * adc_height_table і adc_mv_table генерує tools/adc_tables.py під час
+ * збірки (у флеші, по ADC_CODES записів), а числа форматуються
+ * цілочисельно, без printf. RP2040 не має FPU, а ці функції викликаються
+ * на кожне клацання енкодера і для кожного стовпчика графіка.
+ */
+
+/**
+ * Висота стовпчика графіка для значення АЦП: 1 на рівні тиші і нижче,
+ * далі на одиницю за кожну сьому частину ADC_GRAPH_SPAN над рівнем.
+ *
+ * @param value Значення АЦП (середнє або максимум слайсу).
+ * @param level Рівень тиші.
+ * @return int Висота, 1 і більше.
+ */
+int adc_bar_height(uint32_t value, uint16_t level) {
+    if (value < level) return 1;
+    uint32_t delta = value - level;
+    return adc_height_table[delta < ADC_CODES ? delta : ADC_CODES - 1];
+}
+
+/**
+ * Код АЦП у мілівольтах, округлено до найближчого.
+ */
+uint16_t adc_code_to_mv(uint32_t code) {
+    return adc_mv_table[code < ADC_CODES ? code : ADC_CODES - 1];
+}
+
+/**
+ * Записує число десятковими цифрами, як "%*u" у printf: додатна width
+ * доповнює пробілами зліва, від'ємна — справа.
+ *
+ * @return char* Кінець рядка (символ '\0'), щоб продовжити запис.
+ */
+char *format_uint(char *out, uint32_t value, int width) {
+    char digits[10];
+    int count = 0;
+    do {
+        digits[count++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value);
+    int pad = (width < 0 ? -width : width) - count;
+    if (width > 0) for (; pad > 0; pad--) *out++ = ' ';
+    while (count) *out++ = digits[--count];
+    for (; pad > 0; pad--) *out++ = ' ';
+    *out = '\0';
+    return out;
+}
+
+/**
+ * Записує число з фіксованою крапкою: value — у одиницях 10^-decimals,
+ * наприклад 1234 мВ з decimals = 3 — "1.234", як "%.3f" для вольт.
+ *
+ * @return char* Кінець рядка (символ '\0').
+ */
+char *format_fixed(char *out, uint32_t value, int decimals) {
+    uint32_t scale = 1;
+    for (int i = 0; i < decimals; i++) scale *= 10;
+    out = format_uint(out, value / scale, 0);
+    if (decimals == 0) return out;
+    *out++ = '.';
+    uint32_t fraction = value % scale;
+    for (scale /= 10; scale > 0; scale /= 10) {
+        *out++ = (char)('0' + fraction / scale);
+        fraction %= scale;
+    }
+    *out = '\0';
+    return out;
+}
@@ -0,0 +1,14 @@
+// adc_scale.h
+#ifndef ADC_SCALE_H
+#define ADC_SCALE_H
+
+#include "pico/stdlib.h"
+
+#define ADC_CODES 4096 // Кодів 12-бітного АЦП і записів у таблицях перетворення
+
+int adc_bar_height(uint32_t value, uint16_t level);
+uint16_t adc_code_to_mv(uint32_t code);
+char *format_uint(char *out, uint32_t value, int width);
+char *format_fixed(char *out, uint32_t value, int decimals);
+
+#endif // ADC_SCALE_H
@@ -0,0 +1,57 @@
+#include "arena.h"
+
+/**
+ * Розміщує арену в наданій пам'яті.
+ *
+ * @param arena Арена.
+ * @param memory Пам'ять, вирівняна на ARENA_ALIGN.
+ * @param size Розмір пам'яті в байтах.
+ */
+void arena_init(arena_t *arena, void *memory, size_t size) {
+    arena->base = (uint8_t *)memory;
+    arena->size = size;
+    arena->used = 0;
+    arena->peak = 0;
+}
+
+/**
+ * Виділяє bytes байтів (з округленням до ARENA_ALIGN). Пам'ять не
+ * обнуляється.
+ *
+ * @return void* Виділений блок або NULL, якщо місця не вистачає.
+ */
+void *arena_alloc(arena_t *arena, size_t bytes) {
+    bytes = (bytes + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    if (bytes > arena->size - arena->used) return NULL;
+    void *block = arena->base + arena->used;
+    arena->used += bytes;
+    if (arena->used > arena->peak) arena->peak = arena->used;
+    return block;
+}
+
+/**
+ * Поточна позначка: усе, виділене після неї, звільняє arena_release().
+ */
+size_t arena_mark(const arena_t *arena) {
+    return arena->used;
+}
+
+/**
+ * Звільняє всі виділення, зроблені після позначки. Позначка за межами
+ * зайнятої частини (регіон уже звільнено ширшим відкатом) ігнорується.
+ */
+void arena_release(arena_t *arena, size_t mark) {
+    if (mark < arena->used) arena->used = mark;
+}
+
+size_t arena_used(const arena_t *arena) {
+    return arena->used;
+}
+
+size_t arena_free(const arena_t *arena) {
+    return arena->size - arena->used;
+}
+
+size_t arena_peak(const arena_t *arena) {
+    return arena->peak;
+}
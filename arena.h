@@ -0,0 +1,29 @@
+// arena.h
+#ifndef ARENA_H
+#define ARENA_H
+
+#include "pico/stdlib.h"
+
+#define ARENA_ALIGN 4 // Вирівнювання кожного виділення (uint32_t, slice_bucket_t)
+
+/**
+ * Арена пам'яті з лінійним (bump) виділенням. Звільнення — лише відкатом
+ * до позначки (arena_mark()), тобто регіонами в порядку, зворотному до
+ * виділення. peak — найбільше заповнення арени від ініціалізації.
+ */
+typedef struct arena {
+    uint8_t *base;
+    size_t size;
+    size_t used;
+    size_t peak;
+} arena_t;
+
+void arena_init(arena_t *arena, void *memory, size_t size);
+void *arena_alloc(arena_t *arena, size_t bytes);
+size_t arena_mark(const arena_t *arena);
+void arena_release(arena_t *arena, size_t mark);
+size_t arena_used(const arena_t *arena);
+size_t arena_free(const arena_t *arena);
+size_t arena_peak(const arena_t *arena);
+
+#endif // ARENA_H
@@ -0,0 +1,160 @@
+#include <math.h>
+#include <malloc.h>
+#include <stdio.h>
+#include "bench.h"
+#if PICO_ON_DEVICE
+#include "hardware/clocks.h"
+#endif
+
+/*
+ * Режим вимірювання гарячих шляхів аналізу. Синтетичні записи генеруються
+ * вікно за вікном у переданий буфер: на Pico це буфер розміру запису
+ * пристрою, тому навіть запис на мільйон зразків не потребує пам'яті понад
+ * один буфер. На Linux-хості (snd_bench) буфер має BENCH_HOST_SAMPLES
+ * зразків, і кожен запис обробляється одним викликом, як довгий запис.
+ * Генерація вікна в час вимірювання не входить.
+ */
+
+#define BENCH_SILENCE 2080 // Рівень тиші, як ADC_NOISE
+
+typedef enum {
+    SIGNAL_SILENCE,
+    SIGNAL_CLIPPED_TONE,
+    SIGNAL_BURSTS,
+    SIGNAL_NOISE,
+    SIGNAL_COUNT
+} bench_signal_t;
+
+static const char *const signal_names[SIGNAL_COUNT] = {
+    "silence", "clipped_tone", "bursts", "noise"
+};
+
+static const int capture_sizes[] = { 4000, 65536, BENCH_HOST_SAMPLES };
+
+static uint32_t noise_state;
+
+/**
+ * Синтетичний зразок номер index при частоті 1000 Гц: тиша з ледь помітним
+ * шумом, тон 110 Гц із перевантаженням, сплески 50 Гц по 200 мс через 300 мс
+ * тиші або широкосмуговий шум.
+ */
+static uint16_t signal_sample(bench_signal_t signal, int index) {
+    switch (signal) {
+    case SIGNAL_SILENCE:
+        return BENCH_SILENCE + (bench_random(&noise_state) & 3);
+    case SIGNAL_CLIPPED_TONE:
+        return bench_clamp_adc(BENCH_SILENCE + (int32_t)(3000.0f * sinf(2.0f * (float)M_PI * 110 * index / 1000)));
+    case SIGNAL_BURSTS:
+        if (index % 500 >= 200) return BENCH_SILENCE + (bench_random(&noise_state) & 15);
+        return bench_clamp_adc(BENCH_SILENCE + (int32_t)(1500.0f * sinf(2.0f * (float)M_PI * 50 * index / 1000)));
+    default:
+        return bench_clamp_adc(BENCH_SILENCE + (int32_t)(bench_random(&noise_state) % 1201) - 600);
+    }
+}
+
+static void fill_window(bench_signal_t signal, uint16_t *window, int first, int count) {
+    for (int i = 0; i < count; i++) window[i] = signal_sample(signal, first + i);
+}
+
+/**
+ * Байти купи, зайняті зараз. Аналіз не повинен виділяти пам'ять, тож
+ * різниця до і після випадку має бути нульовою.
+ */
+static size_t heap_in_use(void) {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+    return mallinfo2().uordblks;
+#else
+    return (size_t)mallinfo().uordblks;
+#endif
+}
+
+/**
+ * Тактів процесора за наносекунду: на Pico — за частотою clk_sys, на
+ * хості такти не рахуються (0).
+ */
+static double cycles_per_ns(void) {
+#if PICO_ON_DEVICE
+    return clock_get_hz(clk_sys) / 1e9;
+#else
+    return 0.0;
+#endif
+}
+
+/**
+ * Проганяє один випадок над записом заданого розміру стільки разів, щоб
+ * сумарний час був не менший за BENCH_MIN_US.
+ */
+static void run_case(const bench_case_t *bench, bench_signal_t signal, int size,
+                     uint16_t *window, int window_size, bool json, bool first) {
+    uint64_t elapsed_us = 0;
+    uint64_t samples = 0;
+    uint32_t calls = 0;
+    size_t heap_before = heap_in_use();
+    long heap_growth = 0;
+
+    // Запис, що вміщується у вікно, генерується й готується один раз
+    bool whole = size <= window_size;
+    noise_state = 1;
+    if (whole) {
+        fill_window(signal, window, 0, size);
+        if (bench->prepare) bench->prepare(window, size);
+    }
+    while (elapsed_us < BENCH_MIN_US) {
+        for (int first_sample = 0; first_sample < size; first_sample += window_size) {
+            int count = size - first_sample < window_size ? size - first_sample : window_size;
+            if (!whole) {
+                fill_window(signal, window, first_sample, count);
+                if (bench->prepare) bench->prepare(window, count);
+            }
+            uint64_t start = time_us_64();
+            bench->run(window, count);
+            elapsed_us += time_us_64() - start;
+            samples += count;
+            calls++;
+        }
+    }
+    heap_growth = (long)(heap_in_use() - heap_before);
+
+    double ns_per_sample = (double)elapsed_us * 1000.0 / (double)samples;
+    double ns_per_call = (double)elapsed_us * 1000.0 / calls;
+    double cycles_per_sample = ns_per_sample * cycles_per_ns();
+    if (json) {
+        printf("%s\n  {\"case\": \"%s\", \"signal\": \"%s\", \"samples\": %d, "
+               "\"calls\": %u, \"ns_per_sample\": %.2f, \"cycles_per_sample\": %.1f, "
+               "\"ns_per_call\": %.0f, \"heap_bytes\": %ld}",
+               first ? "" : ",", bench->name, signal_names[signal], size,
+               (unsigned)calls, ns_per_sample, cycles_per_sample, ns_per_call, heap_growth);
+    } else {
+        printf("%-24s %-13s %8d %10.2f %10.1f %12.0f %6ld\n", bench->name, signal_names[signal], size,
+               ns_per_sample, cycles_per_sample, ns_per_call, heap_growth);
+    }
+}
+
+/**
+ * Вимірює всі випадки на всіх синтетичних записах (тиша, тон із
+ * перевантаженням, сплески, шум) розміром 4k, 64k і 1M зразків.
+ *
+ * @param cases Випадки вимірювання.
+ * @param case_count Кількість випадків.
+ * @param window Буфер вікна, в якому функції очікують зразки (adc_values).
+ * @param window_size Розмір буфера.
+ * @param json true — вивести результати масивом JSON для порівняння між комітами.
+ */
+void bench_run(const bench_case_t *cases, int case_count, uint16_t *window, int window_size,
+               bool json) {
+    bool first = true;
+    if (json) printf("[");
+    else printf("%-24s %-13s %8s %10s %10s %12s %6s\n", "case", "signal", "samples", "ns/sample",
+                "cyc/sample", "ns/call", "heap");
+
+    for (int c = 0; c < case_count; c++) {
+        for (int signal = 0; signal < SIGNAL_COUNT; signal++) {
+            for (unsigned s = 0; s < sizeof(capture_sizes) / sizeof(capture_sizes[0]); s++) {
+                run_case(&cases[c], (bench_signal_t)signal, capture_sizes[s], window, window_size,
+                         json, first);
+                first = false;
+            }
+        }
+    }
+    if (json) printf("\n]\n");
+}
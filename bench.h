@@ -0,0 +1,43 @@
+// bench.h
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "pico/stdlib.h"
+
+#ifndef BENCH_MIN_US
+#define BENCH_MIN_US 20000 // Кожен випадок повторюється щонайменше стільки мікросекунд
+#endif
+
+#define BENCH_HOST_SAMPLES 1048576 // Найдовший синтетичний запис; на хості — розмір вікна
+
+/**
+ * Псевдовипадкові числа синтетичних записів: лінійний конгруентний
+ * генератор, 16 старших бітів стану. Той самий ряд на Pico і на хості,
+ * тож записи відтворювані; хостові тести беруть його через test_random().
+ */
+static inline uint32_t bench_random(uint32_t *state) {
+    *state = *state * 1664525u + 1013904223u;
+    return *state >> 16;
+}
+
+static inline uint16_t bench_clamp_adc(int32_t value) {
+    if (value < 0) return 0;
+    if (value > 4095) return 4095;
+    return (uint16_t)value;
+}
+
+/**
+ * Випадок вимірювання: функція обробляє вікно зразків. Вікно вже лежить у
+ * буфері, переданому bench_run(), — для функцій, що працюють із adc_values.
+ * prepare (може бути NULL) готує вхідні дані і в час вимірювання не входить.
+ */
+typedef struct bench_case {
+    const char *name;
+    void (*prepare)(const uint16_t *window, int count);
+    void (*run)(const uint16_t *window, int count);
+} bench_case_t;
+
+void bench_run(const bench_case_t *cases, int case_count, uint16_t *window, int window_size,
+               bool json);
+
+#endif // BENCH_H
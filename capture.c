@@ -0,0 +1,830 @@
+#include <stdio.h>
+#include "capture.h"
+#include "decimate.h"
+
+#if PICO_ON_DEVICE
+#include "hardware/sync.h"
+#define CAPTURE_WAKE() __sev() // Будить основний цикл у event_wait()
+#else
+#define CAPTURE_WAKE() ((void)0)
+#endif
+
+static const capture_source_t *capture_source = NULL;
+static capture_complete_callback_t capture_on_complete = NULL;
+static volatile bool capture_active = false;
+static bool stream_active = false;
+static int stream_block_count = 0;
+static volatile uint32_t stream_blocks_written = 0;
+static uint32_t stream_blocks_read = 0;
+static uint32_t stream_overruns = 0;
+
+static uint16_t *capture_deltas = NULL; // Інтервал перед кожним зразком, мкс
+static int capture_deltas_length = 0;
+static int capture_stamp_wrap = 0;      // Довжина кільця, по якому йдуть індекси позначок; 0 — без повтору
+static uint32_t capture_rate_hz = 1000;   // Частота аналізу (після децимації)
+static uint32_t capture_interval_us = 1000;
+static uint64_t capture_last_stamp_us = 0;
+static capture_timing_t timing;
+
+// Передискретизація або упакований запис: джерело безперервно пише сирі
+// блоки в capture_raw, переривання лише публікує номер заповненого блоку,
+// а через дециматор у буфер запису або в сховище блоки проводить
+// capture_poll() з основного циклу
+static uint16_t capture_raw[CAPTURE_RAW_BLOCKS * CAPTURE_RAW_BLOCK_SIZE];
+static decimator_t capture_decimator;
+static int capture_factor = 1;
+static volatile uint32_t source_blocks_done = 0; // Блоки, заповнені джерелом
+static uint32_t raw_blocks_processed = 0;        // Блоки, уже проведені через дециматор
+static uint32_t raw_overruns = 0;                // Сирі блоки, перезаписані джерелом до обробки
+static uint16_t *output_buffer = NULL;
+static int output_length = 0;
+static int output_block_length = 0;
+static volatile int output_written = 0;
+static sample_store_t *output_store = NULL;
+
+/**
+ * Завершує запис, коли буфер заповнено. Викликається джерелом один раз
+ * за запис; повторні виклики (наприклад, після capture_stop()) ігноруються.
+ *
+ * @param sample_count Кількість записаних зразків.
+ */
+static void capture_complete(int sample_count) {
+    if (!capture_active) return;
+    capture_active = false;
+    if (capture_on_complete) capture_on_complete(sample_count);
+}
+
+/**
+ * Дописує зразки в сховище і завершує запис, щойно воно заповниться.
+ */
+static void capture_store_samples(const uint16_t *samples, int count) {
+    bool accepted = sample_store_append(output_store, samples, count);
+    output_written = sample_store_length(output_store);
+    if (accepted && !sample_store_full(output_store)) return;
+    capture_source->stop();
+    sample_store_finish(output_store);
+    output_written = sample_store_length(output_store);
+    capture_complete(output_written);
+}
+
+/**
+ * Проводить сирий блок (або його заповнену частину після зупинки) через
+ * дециматор і дописує результат у сховище чи в буфер запису (у потоковому
+ * режимі — по колу, з обліком заповнених блоків). Одноразовий запис
+ * завершується, щойно буфер заповнено.
+ */
+static void capture_process_block(const uint16_t *raw, int raw_count) {
+    uint16_t decimated[CAPTURE_RAW_BLOCK_SIZE];
+    const uint16_t *samples = raw;
+    int count = raw_count;
+    if (capture_factor > 1) {
+        count = decimator_process(&capture_decimator, raw, raw_count, decimated);
+        samples = decimated;
+    }
+    if (output_store) {
+        capture_store_samples(samples, count);
+        return;
+    }
+    for (int i = 0; i < count; i++) {
+        if (!stream_active && output_written == output_length) break;
+        output_buffer[output_written % output_length] = samples[i];
+        output_written++;
+        if (stream_active && output_written % output_block_length == 0) stream_blocks_written++;
+    }
+    if (!stream_active && output_written == output_length) {
+        capture_source->stop();
+        capture_complete(output_length);
+    }
+}
+
+static bool capture_uses_raw_ring(void) {
+    return capture_factor > 1 || output_store != NULL;
+}
+
+static const uint16_t *raw_block(uint32_t block) {
+    return capture_raw + (block % CAPTURE_RAW_BLOCKS) * CAPTURE_RAW_BLOCK_SIZE;
+}
+
+/**
+ * Позначає черговий блок кільця джерела як заповнений (потоковий режим
+ * або сирі блоки передискретизації чи упакованого запису). Викликається
+ * з переривання, тож лише публікує номер блоку: децимація й пакування
+ * відбуваються в capture_process_raw().
+ */
+static void capture_block_done(void) {
+    source_blocks_done++;
+    if (!capture_uses_raw_ring()) {
+        stream_blocks_written++;
+        return;
+    }
+    CAPTURE_WAKE();
+}
+
+/**
+ * Проводить через дециматор сирі блоки до блоку done (не включно) у
+ * порядку заповнення. Блоки, які джерело вже почало перезаписувати,
+ * пропускаються і рахуються в capture_raw_overruns().
+ *
+ * @param done Кількість заповнених блоків від початку запису.
+ */
+static void capture_process_raw(uint32_t done) {
+    uint32_t max_lag = CAPTURE_RAW_BLOCKS - 2; // Два блоки можуть бути в роботі DMA
+    if (done - raw_blocks_processed > max_lag) {
+        raw_overruns += done - raw_blocks_processed - max_lag;
+        raw_blocks_processed = done - max_lag;
+    }
+    while (capture_active && raw_blocks_processed != done) {
+        capture_process_block(raw_block(raw_blocks_processed), CAPTURE_RAW_BLOCK_SIZE);
+        raw_blocks_processed++;
+    }
+}
+
+static int jitter_bucket(uint32_t jitter_us) {
+    int bucket = 0;
+    while (jitter_us && bucket < CAPTURE_JITTER_BUCKETS - 1) {
+        jitter_us >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+/**
+ * Фіксує час зразка: зберігає інтервал від попереднього зразка поруч зі
+ * зразком і враховує його в статистиці точності. Для першого зразка запису
+ * попереднього немає, його інтервал вважається номінальним.
+ *
+ * @param sample Номер зразка від початку запису.
+ * @param now_us Момент перетворення.
+ */
+static void capture_stamp(int sample, uint64_t now_us) {
+    if (!capture_deltas || capture_factor > 1) return; // Сирі зразки не відповідають буферу запису
+    int index = capture_stamp_wrap > 0 ? sample % capture_stamp_wrap : sample;
+    if (index >= capture_deltas_length) return;
+    uint32_t delta = timing.samples == 0 ? capture_interval_us : (uint32_t)(now_us - capture_last_stamp_us);
+    capture_last_stamp_us = now_us;
+    capture_deltas[index] = delta > UINT16_MAX ? UINT16_MAX : (uint16_t)delta;
+
+    uint32_t jitter = delta > capture_interval_us ? delta - capture_interval_us : capture_interval_us - delta;
+    timing.samples++;
+    if (jitter > timing.max_jitter_us) timing.max_jitter_us = jitter;
+    if (delta >= capture_interval_us + capture_interval_us / 2) timing.missed++;
+    timing.histogram[jitter_bucket(jitter)]++;
+}
+
+#if PICO_ON_DEVICE
+#include "hardware/adc.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+
+#define ADC_CLOCK_HZ 48000000.0f // Тактова частота АЦП (clk_adc)
+
+static int dma_channels[2] = {-1, -1};
+static dma_channel_config dma_config;
+static int dma_length = 0;
+static bool dma_streaming = false;
+static uint16_t *dma_ring = NULL;
+static int dma_block_length = 0;
+static int dma_block_count = 0;
+
+/**
+ * Обробник переривання DMA. В одноразовому режимі буфер заповнено — зупиняємо АЦП.
+ * У потоковому режимі канал, що завершив блок, одразу перенацілюється на блок
+ * через один, поки інший канал (запущений ланцюжком) пише наступний блок.
+ */
+static void dma_capture_irq_handler(void) {
+    if (dma_streaming) {
+        for (int i = 0; i < 2; i++) {
+            int ch = dma_channels[(source_blocks_done + i) & 1];
+            if (!dma_channel_get_irq0_status(ch)) continue;
+            dma_channel_acknowledge_irq0(ch);
+            uint32_t next = (source_blocks_done + 2) % dma_block_count;
+            dma_channel_set_write_addr(ch, dma_ring + next * dma_block_length, false);
+            dma_channel_set_trans_count(ch, dma_block_length, false);
+            capture_block_done();
+        }
+        return;
+    }
+    if (dma_channels[0] < 0 || !dma_channel_get_irq0_status(dma_channels[0])) return;
+    dma_channel_acknowledge_irq0(dma_channels[0]);
+    adc_run(false);
+    adc_fifo_drain();
+    capture_complete(dma_length);
+}
+
+static bool dma_source_set_rate(uint32_t sample_rate_hz) {
+    if (sample_rate_hz == 0 || sample_rate_hz > CAPTURE_MAX_ADC_RATE_HZ) return false;
+    // Одне перетворення триває (clkdiv + 1) тактів АЦП, але не менше 96
+    adc_set_clkdiv(ADC_CLOCK_HZ / sample_rate_hz - 1.0f);
+    return true;
+}
+
+/**
+ * Налаштовує АЦП у режимі вільного запуску з FIFO і два канали DMA, які
+ * переносять кожне перетворення з FIFO у буфер без участі процесора.
+ *
+ * @param sample_rate_hz Частота дискретизації в Гц.
+ * @return bool True, якщо вдалося отримати канали DMA.
+ */
+static bool dma_source_init(uint32_t sample_rate_hz) {
+    // FIFO увімкнено, DREQ після кожного зразка, без біта помилки, без зсуву до 8 біт
+    adc_fifo_setup(true, true, 1, false, false);
+    if (!dma_source_set_rate(sample_rate_hz)) return false;
+
+    for (int i = 0; i < 2; i++) {
+        dma_channels[i] = dma_claim_unused_channel(false);
+        if (dma_channels[i] < 0) return false;
+    }
+
+    dma_config = dma_channel_get_default_config(dma_channels[0]);
+    channel_config_set_transfer_data_size(&dma_config, DMA_SIZE_16);
+    channel_config_set_read_increment(&dma_config, false);
+    channel_config_set_write_increment(&dma_config, true);
+    channel_config_set_dreq(&dma_config, DREQ_ADC);
+
+    for (int i = 0; i < 2; i++) dma_channel_set_irq0_enabled(dma_channels[i], true);
+    irq_add_shared_handler(DMA_IRQ_0, dma_capture_irq_handler,
+                           PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+    irq_set_enabled(DMA_IRQ_0, true);
+    return true;
+}
+
+static bool dma_source_start(uint16_t *buffer, int length) {
+    adc_run(false);
+    adc_fifo_drain();
+    dma_length = length;
+    dma_streaming = false;
+    dma_channel_configure(dma_channels[0], &dma_config, buffer, &adc_hw->fifo, length, true);
+    adc_run(true);
+    return true;
+}
+
+static bool dma_source_start_stream(uint16_t *ring, int block_length, int block_count) {
+    adc_run(false);
+    adc_fifo_drain();
+    dma_ring = ring;
+    dma_block_length = block_length;
+    dma_block_count = block_count;
+    dma_streaming = true;
+    // Канали з'єднані ланцюжком один на одного: кінець блоку одного запускає інший
+    for (int i = 0; i < 2; i++) {
+        dma_channel_config config = dma_config;
+        channel_config_set_chain_to(&config, dma_channels[i ^ 1]);
+        dma_channel_configure(dma_channels[i], &config, ring + i * block_length,
+                              &adc_hw->fifo, block_length, false);
+    }
+    dma_channel_start(dma_channels[0]);
+    adc_run(true);
+    return true;
+}
+
+static int dma_remaining(int channel) {
+    return (int)dma_channel_hw_addr(channel)->transfer_count;
+}
+
+static int dma_source_position(void) {
+    if (!dma_streaming) return dma_length - dma_remaining(dma_channels[0]);
+    uint32_t written = source_blocks_done;
+    int active = dma_channels[written & 1];
+    if (dma_remaining(active) == 0) {
+        // Блок завершено, але переривання ще не оброблено — пише вже інший канал
+        written++;
+        active = dma_channels[written & 1];
+    }
+    return (int)written * dma_block_length + dma_block_length - dma_remaining(active);
+}
+
+static int dma_source_stop(void) {
+    adc_run(false);
+    int count = dma_source_position();
+    // Переривання вимикаємо на час abort, інакше воно може спрацювати хибно (RP2040-E13)
+    for (int i = 0; i < 2; i++) {
+        dma_channel_set_irq0_enabled(dma_channels[i], false);
+        dma_channel_abort(dma_channels[i]);
+        dma_channel_acknowledge_irq0(dma_channels[i]);
+        dma_channel_set_irq0_enabled(dma_channels[i], true);
+    }
+    adc_fifo_drain();
+    return count;
+}
+
+const capture_source_t capture_dma_source = {
+    .name = "adc-dma",
+    .init = dma_source_init,
+    .set_rate = dma_source_set_rate,
+    .start = dma_source_start,
+    .start_stream = dma_source_start_stream,
+    .position = dma_source_position,
+    .stop = dma_source_stop,
+};
+
+// Джерело з таймером: одне перетворення АЦП на кожне спрацювання таймера
+static repeating_timer_t sample_timer;
+static uint16_t *timer_buffer = NULL;
+static int timer_length = 0;
+static int timer_block_length = 0;
+static volatile int timer_written = 0;
+
+static bool timer_sample_callback(repeating_timer_t *rt) {
+    int index = timer_written % timer_length;
+    timer_buffer[index] = adc_read();
+    capture_stamp(timer_written, time_us_64());
+    timer_written++;
+    if (timer_block_length > 0) {
+        if (timer_written % timer_block_length == 0) capture_block_done();
+        return capture_active; // Одноразовий запис зупиняє capture_poll(), коли буфер заповнено
+    }
+    if (timer_written < timer_length) return true;
+    capture_complete(timer_length);
+    return false;
+}
+
+static uint32_t timer_interval_us = 1000;
+
+static bool timer_source_set_rate(uint32_t sample_rate_hz) {
+    if (sample_rate_hz == 0 || sample_rate_hz > CAPTURE_MAX_TIMER_RATE_HZ) return false;
+    timer_interval_us = 1000000 / sample_rate_hz;
+    return true;
+}
+
+static bool timer_source_init(uint32_t sample_rate_hz) {
+    return timer_source_set_rate(sample_rate_hz); // АЦП вже налаштовано, FIFO не потрібен
+}
+
+static bool timer_source_start(uint16_t *buffer, int length) {
+    timer_buffer = buffer;
+    timer_length = length;
+    timer_block_length = 0;
+    timer_written = 0;
+    // Від'ємний період: інтервал рахується між початками викликів, а не від кінця попереднього
+    return add_repeating_timer_us(-(int64_t)timer_interval_us, timer_sample_callback, NULL, &sample_timer);
+}
+
+static bool timer_source_start_stream(uint16_t *ring, int block_length, int block_count) {
+    if (!timer_source_start(ring, block_length * block_count)) return false;
+    timer_block_length = block_length;
+    return true;
+}
+
+static int timer_source_position(void) {
+    return timer_written;
+}
+
+static int timer_source_stop(void) {
+    cancel_repeating_timer(&sample_timer);
+    return timer_written;
+}
+
+const capture_source_t capture_timer_source = {
+    .name = "adc-timer",
+    .init = timer_source_init,
+    .set_rate = timer_source_set_rate,
+    .start = timer_source_start,
+    .start_stream = timer_source_start_stream,
+    .position = timer_source_position,
+    .stop = timer_source_stop,
+};
+
+#else // Хост: симульований АЦП
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SIM_ADC_BIAS 2048       // Середня точка мікрофонного підсилювача
+#define SIM_NOISE_AMPLITUDE 20  // Амплітуда шуму в кодах АЦП
+#define SIM_TONE_HZ 50          // Частота тону в пачках
+#define SIM_TONE_AMPLITUDE 900  // Амплітуда тону в кодах АЦП
+
+static uint16_t *sim_buffer = NULL;
+static int sim_length = 0;
+static int sim_block_length = 0;
+static int sim_written = 0;
+static uint64_t sim_start_us = 0;
+static uint32_t sim_rate_hz = 1000;
+static uint32_t sim_noise_state = 1;
+
+static FILE *sim_wav = NULL;
+static long sim_wav_data_offset = 0;
+static int sim_wav_channels = 1;
+
+/**
+ * Відкриває WAV-файл (PCM, 16 біт) із шляху в змінній середовища SREADER_WAV.
+ * Якщо змінна не задана або формат не підтримується, використовується синтетичний сигнал.
+ */
+static void sim_open_wav(void) {
+    const char *path = getenv("SREADER_WAV");
+    if (!path) return;
+
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        printf("Cannot open WAV %s, using synthetic signal\n", path);
+        return;
+    }
+
+    char id[4];
+    uint32_t size;
+    uint16_t format = 0, channels = 0, bits = 0;
+    fseek(f, 12, SEEK_SET); // Пропускаємо "RIFF", розмір і "WAVE"
+    while (fread(id, 1, 4, f) == 4 && fread(&size, 4, 1, f) == 1) {
+        if (memcmp(id, "fmt ", 4) == 0) {
+            long next = ftell(f) + size;
+            if (fread(&format, 2, 1, f) != 1 || fread(&channels, 2, 1, f) != 1) break;
+            fseek(f, 10, SEEK_CUR); // Частота, байтрейт, вирівнювання
+            if (fread(&bits, 2, 1, f) != 1) break;
+            fseek(f, next, SEEK_SET);
+        } else if (memcmp(id, "data", 4) == 0) {
+            if (format == 1 && bits == 16 && channels > 0) {
+                sim_wav = f;
+                sim_wav_data_offset = ftell(f);
+                sim_wav_channels = channels;
+                printf("Simulated ADC: WAV %s, %u channel(s)\n", path, channels);
+                return;
+            }
+            break;
+        } else {
+            fseek(f, size + (size & 1), SEEK_CUR);
+        }
+    }
+    printf("Unsupported WAV %s, using synthetic signal\n", path);
+    fclose(f);
+}
+
+/**
+ * Генерує наступний зразок: шум навколо SIM_ADC_BIAS і пачки тону
+ * тривалістю 0.3 с на початку кожної секунди. Для WAV 16-бітний зразок
+ * переводиться у 12-бітний код АЦП навколо середньої точки.
+ */
+static uint16_t sim_next_sample(int n) {
+    int value;
+    if (sim_wav) {
+        int16_t frame[8] = {0};
+        int channels = sim_wav_channels < 8 ? sim_wav_channels : 8;
+        if (fread(frame, sizeof(int16_t), channels, sim_wav) != (size_t)channels) {
+            fseek(sim_wav, sim_wav_data_offset, SEEK_SET); // Зациклюємо файл
+        }
+        fseek(sim_wav, (long)(sim_wav_channels - channels) * 2, SEEK_CUR);
+        value = SIM_ADC_BIAS + frame[0] / 16;
+    } else {
+        sim_noise_state = sim_noise_state * 1103515245u + 12345u;
+        value = SIM_ADC_BIAS + (int)((sim_noise_state >> 16) % (2 * SIM_NOISE_AMPLITUDE + 1))
+                - SIM_NOISE_AMPLITUDE;
+        if ((uint32_t)n % sim_rate_hz < sim_rate_hz * 3 / 10) {
+            value += (int)(SIM_TONE_AMPLITUDE * sinf(2.0f * (float)M_PI * SIM_TONE_HZ * n / sim_rate_hz));
+        }
+    }
+    if (value < 0) value = 0;
+    if (value > 4095) value = 4095;
+    return (uint16_t)value;
+}
+
+static bool sim_source_set_rate(uint32_t sample_rate_hz) {
+    if (sample_rate_hz == 0 || sample_rate_hz > CAPTURE_MAX_ADC_RATE_HZ) return false;
+    sim_rate_hz = sample_rate_hz;
+    return true;
+}
+
+static bool sim_source_init(uint32_t sample_rate_hz) {
+    sim_open_wav();
+    return sim_source_set_rate(sample_rate_hz);
+}
+
+static bool sim_source_start(uint16_t *buffer, int length) {
+    sim_buffer = buffer;
+    sim_length = length;
+    sim_block_length = 0;
+    sim_written = 0;
+    sim_start_us = time_us_64();
+    if (sim_wav) fseek(sim_wav, sim_wav_data_offset, SEEK_SET);
+    return true;
+}
+
+static bool sim_source_start_stream(uint16_t *ring, int block_length, int block_count) {
+    sim_source_start(ring, block_length * block_count);
+    sim_block_length = block_length;
+    return true;
+}
+
+/**
+ * Момент перетворення симульованого зразка: "АЦП" тактується ідеально.
+ */
+static uint64_t sim_sample_time_us(int n) {
+    return sim_start_us + (uint64_t)n * 1000000 / sim_rate_hz;
+}
+
+/**
+ * Дописує у буфер стільки зразків, скільки "АЦП" встиг би перетворити
+ * з моменту старту, і завершує запис, коли буфер заповнено.
+ * У потоковому режимі буфер заповнюється по колу поблоково.
+ */
+static int sim_source_position(void) {
+    uint64_t due = (time_us_64() - sim_start_us) * sim_rate_hz / 1000000;
+    if (sim_block_length > 0) {
+        while (sim_written < (int)due) {
+            sim_buffer[sim_written % sim_length] = sim_next_sample(sim_written);
+            capture_stamp(sim_written, sim_sample_time_us(sim_written));
+            sim_written++;
+            if (sim_written % sim_block_length == 0) capture_block_done();
+        }
+        return sim_written;
+    }
+    if (due > (uint64_t)sim_length) due = sim_length;
+    while (sim_written < (int)due) {
+        sim_buffer[sim_written] = sim_next_sample(sim_written);
+        capture_stamp(sim_written, sim_sample_time_us(sim_written));
+        sim_written++;
+    }
+    if (sim_written == sim_length) capture_complete(sim_length);
+    return sim_written;
+}
+
+static int sim_source_stop(void) {
+    return sim_written;
+}
+
+const capture_source_t capture_sim_source = {
+    .name = "adc-sim",
+    .init = sim_source_init,
+    .set_rate = sim_source_set_rate,
+    .start = sim_source_start,
+    .start_stream = sim_source_start_stream,
+    .position = sim_source_position,
+    .stop = sim_source_stop,
+};
+#endif
+
+/**
+ * Ініціалізує рушій захоплення з обраним джерелом вибірок.
+ *
+ * @param source Джерело вибірок (CAPTURE_DEFAULT_SOURCE для поточної платформи).
+ * @param sample_rate_hz Частота дискретизації в Гц.
+ * @param on_complete Функція, яку буде викликано після заповнення буфера.
+ * @return bool True, якщо джерело успішно ініціалізовано.
+ */
+bool capture_init(const capture_source_t *source, uint32_t sample_rate_hz,
+                  capture_complete_callback_t on_complete) {
+    capture_source = source;
+    capture_on_complete = on_complete;
+    if (!source->init(sample_rate_hz)) {
+        printf("Capture source %s init failed\n", source->name);
+        return false;
+    }
+    return capture_set_rate(sample_rate_hz, 1);
+}
+
+/**
+ * Задає частоту аналізу і передискретизацію: джерело працює на частоті
+ * sample_rate_hz * decimation, а зразки зменшуються до sample_rate_hz
+ * дециматором (CIC + компенсуючий КІХ, див. decimate.c). Викликається,
+ * коли запис не триває.
+ *
+ * @param sample_rate_hz Частота зразків у буфері запису.
+ * @param decimation Коефіцієнт передискретизації, 1 — без децимації.
+ * @return bool False, якщо джерело не підтримує таку частоту.
+ */
+bool capture_set_rate(uint32_t sample_rate_hz, int decimation) {
+    if (capture_active || sample_rate_hz == 0 || decimation < 1 || decimation > DECIMATE_MAX_FACTOR) return false;
+    if (!capture_source->set_rate(sample_rate_hz * (uint32_t)decimation)) {
+        printf("Capture source %s: %u Hz x %d not supported\n", capture_source->name,
+               (unsigned)sample_rate_hz, decimation);
+        return false;
+    }
+    capture_rate_hz = sample_rate_hz;
+    capture_interval_us = 1000000 / sample_rate_hz;
+    capture_factor = decimation;
+    decimator_init(&capture_decimator, decimation);
+    printf("Capture source: %s, %u Hz x %d\n", capture_source->name, (unsigned)sample_rate_hz, decimation);
+    return true;
+}
+
+/**
+ * Частота зразків у буфері запису (після децимації).
+ */
+uint32_t capture_sample_rate(void) {
+    return capture_rate_hz;
+}
+
+int capture_decimation(void) {
+    return capture_factor;
+}
+
+/**
+ * Запускає джерело: напряму в буфер користувача або, з передискретизацією
+ * чи в сховище, у кільце сирих блоків, з якого зразки переносяться далі.
+ */
+static bool capture_source_start(uint16_t *buffer, int length, int block_length, int block_count) {
+    source_blocks_done = 0;
+    raw_blocks_processed = 0;
+    raw_overruns = 0;
+    capture_stamp_wrap = output_store ? 0 : length;
+    if (!capture_uses_raw_ring()) {
+        if (block_length == 0) return capture_source->start(buffer, length);
+        return capture_source->start_stream(buffer, block_length, block_count);
+    }
+    output_buffer = buffer;
+    output_length = length;
+    output_block_length = block_length;
+    output_written = 0;
+    decimator_reset(&capture_decimator);
+    return capture_source->start_stream(capture_raw, CAPTURE_RAW_BLOCK_SIZE, CAPTURE_RAW_BLOCKS);
+}
+
+/**
+ * Запускає запис length зразків у buffer.
+ */
+bool capture_start(uint16_t *buffer, int length) {
+    timing = (capture_timing_t){ 0 };
+    output_store = NULL;
+    stream_active = false;
+    capture_active = true;
+    if (!capture_source_start(buffer, length, 0, 0)) {
+        capture_active = false;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Запускає безперервний запис у кільце з block_count блоків по block_length зразків.
+ * Потрібно щонайменше 3 блоки: два зайняті DMA, решта доступні для аналізу.
+ */
+bool capture_start_stream(uint16_t *ring, int block_length, int block_count) {
+    if (block_count < 3) return false;
+    stream_block_count = block_count;
+    stream_blocks_written = 0;
+    stream_blocks_read = 0;
+    stream_overruns = 0;
+    timing = (capture_timing_t){ 0 };
+    output_store = NULL;
+    stream_active = true;
+    capture_active = true;
+    if (!capture_source_start(ring, block_length * block_count, block_length, block_count)) {
+        stream_active = false;
+        capture_active = false;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Запускає упакований запис у сховище (див. sample_store.h): зразки
+ * пакуються поблоково в capture_poll(), тож довжина запису
+ * обмежена пам'яттю сховища, а не буфером uint16_t. Запис завершується
+ * викликом on_complete, коли сховище заповниться, або capture_stop().
+ * Сховище має бути очищене (sample_store_reset()).
+ */
+bool capture_start_store(sample_store_t *store) {
+    timing = (capture_timing_t){ 0 };
+    output_store = store;
+    stream_active = false;
+    capture_active = true;
+    if (!capture_source_start(NULL, 0, 0, 0)) {
+        capture_active = false;
+        output_store = NULL;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Зупиняє запис достроково.
+ *
+ * @return int Кількість зразків, записаних до зупинки (у потоковому режимі —
+ *             від початку потоку, включно з уже перезаписаними).
+ */
+int capture_stop(void) {
+    if (!capture_uses_raw_ring()) {
+        capture_active = false;
+        int count = capture_source->stop();
+        stream_active = false;
+        return count;
+    }
+    int count = capture_source->stop();
+    stream_active = false;
+    if (capture_active) {
+        // Спершу повні блоки, які ще не оброблено (переривання останнього
+        // могло не встигнути до зупинки), потім заповнена частина поточного
+        uint32_t full = (uint32_t)count / CAPTURE_RAW_BLOCK_SIZE;
+        if (full < source_blocks_done) full = source_blocks_done;
+        capture_process_raw(full);
+        int partial = count - (int)full * CAPTURE_RAW_BLOCK_SIZE;
+        if (capture_active && partial > 0) capture_process_block(raw_block(full), partial);
+    }
+    capture_active = false;
+    if (output_store) {
+        sample_store_finish(output_store);
+        output_written = sample_store_length(output_store);
+    }
+    return output_written;
+}
+
+/**
+ * Повертає поточну кількість записаних зразків. З передискретизацією чи
+ * в сховище цей виклик також проводить заповнені сирі блоки через
+ * дециматор і пакування, а симульованому джерелу потрібен для просування
+ * часу, тому його слід робити з основного циклу.
+ */
+int capture_poll(void) {
+    if (!capture_active) return 0;
+    int position = capture_source->position();
+    if (!capture_uses_raw_ring()) return position;
+    capture_process_raw(source_blocks_done);
+    return output_written;
+}
+
+/**
+ * Чи є заповнені сирі блоки, які ще чекають на capture_poll().
+ */
+bool capture_pending(void) {
+    return capture_active && capture_uses_raw_ring() && raw_blocks_processed != source_blocks_done;
+}
+
+/**
+ * Кількість сирих блоків, які джерело перезаписало раніше, ніж основний
+ * цикл провів їх через дециматор (у запис вони не потрапили).
+ */
+uint32_t capture_raw_overruns(void) {
+    return raw_overruns;
+}
+
+bool capture_running(void) {
+    return capture_active;
+}
+
+bool capture_streaming(void) {
+    return stream_active;
+}
+
+/**
+ * Повертає індекс наступного заповненого блоку кільця або -1, якщо нових
+ * блоків немає. Блоки, які DMA вже почав перезаписувати, пропускаються
+ * і додаються до лічильника переповнень.
+ */
+int capture_next_block(void) {
+    if (!stream_active) return -1;
+    uint32_t written = stream_blocks_written;
+    if (written == stream_blocks_read) return -1;
+
+    uint32_t max_lag = stream_block_count - 2; // Два блоки зараз у роботі DMA
+    if (written - stream_blocks_read > max_lag) {
+        stream_overruns += written - stream_blocks_read - max_lag;
+        stream_blocks_read = written - max_lag;
+    }
+    return stream_blocks_read++ % stream_block_count;
+}
+
+/**
+ * Кількість блоків, пропущених через те, що аналіз не встигав за потоком.
+ */
+uint32_t capture_overruns(void) {
+    return stream_overruns;
+}
+
+/**
+ * Задає буфер позначок часу: для кожного зразка запису джерело зберігає
+ * інтервал від попереднього зразка в мікросекундах. Позначки є для перших
+ * length зразків (у потоковому режимі — по колу кільця); NULL вимикає їх.
+ */
+void capture_set_timestamps(uint16_t *deltas, int length) {
+    capture_deltas = deltas;
+    capture_deltas_length = length;
+}
+
+/**
+ * Статистика інтервалів між зразками останнього запису.
+ */
+const capture_timing_t *capture_timing(void) {
+    return &timing;
+}
+
+/**
+ * Реальна тривалість count зразків, починаючи із зразка first: сума
+ * інтервалів перед кожним наступним зразком плюс один період на сам
+ * перший зразок. Без позначок часу — count номінальних періодів.
+ */
+uint32_t capture_elapsed_us(int first, int count) {
+    if (count <= 0) return 0;
+    if (!capture_deltas || capture_factor > 1 || first + count > capture_deltas_length) {
+        return (uint32_t)((uint64_t)count * 1000000 / capture_rate_hz);
+    }
+    uint32_t elapsed = capture_interval_us;
+    for (int i = first + 1; i < first + count; i++) elapsed += capture_deltas[i];
+    return elapsed;
+}
+
+/**
+ * Виводить у термінал точність інтервалів між зразками останнього запису:
+ * найбільше відхилення, пропущені терміни та гістограму відхилень.
+ */
+void capture_print_timing(void) {
+    if (!capture_deltas || timing.samples == 0) return;
+    printf("Sample timing: %u samples, nominal %u us, max jitter %u us, missed %u\n",
+           (unsigned)timing.samples, (unsigned)capture_interval_us,
+           (unsigned)timing.max_jitter_us, (unsigned)timing.missed);
+    printf(" jitter histogram:");
+    for (int bucket = 0; bucket < CAPTURE_JITTER_BUCKETS; bucket++) {
+        if (timing.histogram[bucket] == 0) continue;
+        if (bucket < CAPTURE_JITTER_BUCKETS - 1) printf(" <%u:", 1u << bucket);
+        else printf(" >=%u:", 1u << (bucket - 1));
+        printf("%u", (unsigned)timing.histogram[bucket]);
+    }
+    printf("\n");
+}
@@ -0,0 +1,93 @@
+// capture.h
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include "pico/stdlib.h"
+#include "sample_store.h"
+
+/**
+ * Джерело вибірок АЦП. Рушій захоплення працює лише через цей інтерфейс,
+ * тому той самий код збирається і для Pico (АЦП у режимі FIFO + DMA), і для
+ * Linux-хоста (симульований АЦП із синтетичним сигналом або WAV-файлом).
+ */
+typedef struct capture_source {
+    const char *name;
+    bool (*init)(uint32_t sample_rate_hz);
+    bool (*set_rate)(uint32_t sample_rate_hz);
+    bool (*start)(uint16_t *buffer, int length);
+    bool (*start_stream)(uint16_t *ring, int block_length, int block_count);
+    int (*position)(void);  // Кількість уже записаних зразків
+    int (*stop)(void);      // Зупиняє запис і повертає кількість зразків
+} capture_source_t;
+
+/**
+ * Потоковий режим: джерело безперервно заповнює кільце з block_count блоків
+ * по block_length зразків. На Pico два канали DMA по черзі (ping-pong) пишуть
+ * сусідні блоки, тому між блоками немає пропусків. Готові блоки забирає
+ * capture_next_block(); якщо аналіз відстає настільки, що DMA наздоганяє
+ * непрочитаний блок, такі блоки пропускаються і рахуються в capture_overruns().
+ */
+
+#define CAPTURE_MAX_ADC_RATE_HZ 500000 // 48 МГц / 96 тактів на перетворення
+#define CAPTURE_MAX_TIMER_RATE_HZ 20000 // Джерело з таймером: переривання на кожен зразок
+#define CAPTURE_RAW_BLOCK_SIZE 256      // Сирий блок передискретизації й упакованого запису
+#define CAPTURE_RAW_BLOCKS 8           // Основний цикл може відставати на 6 блоків (3 мс на 500 кГц)
+#define CAPTURE_JITTER_BUCKETS 12 // Кошик k: відхилення інтервалу менше 2^k мкс
+
+/**
+ * Точність інтервалів між зразками за останній запис. Заповнюється лише
+ * тоді, коли задано буфер позначок часу (capture_set_timestamps()).
+ */
+typedef struct capture_timing {
+    uint32_t samples;
+    uint32_t max_jitter_us;  // Найбільше відхилення інтервалу від номінального
+    uint32_t missed;         // Інтервали, довші за півтора номінальних
+    uint32_t histogram[CAPTURE_JITTER_BUCKETS];
+} capture_timing_t;
+
+/**
+ * Викликається, коли буфер заповнено повністю. Якщо зразки йдуть через
+ * сирі блоки (децимація або запис у сховище) — з capture_poll() чи
+ * capture_stop(), тобто з основного циклу; інакше — з переривання
+ * джерела (DMA, таймер).
+ */
+typedef void (*capture_complete_callback_t)(int sample_count);
+
+/**
+ * Джерело з позначками часу: на Pico — окреме перетворення АЦП за
+ * апаратним таймером (як до DMA), тож інтервали залежать від затримок
+ * переривань і їх є що вимірювати. DMA-джерело тактується самим АЦП.
+ */
+#if PICO_ON_DEVICE
+extern const capture_source_t capture_dma_source;
+extern const capture_source_t capture_timer_source;
+#define CAPTURE_DEFAULT_SOURCE (&capture_dma_source)
+#define CAPTURE_TIMESTAMPED_SOURCE (&capture_timer_source)
+#else
+extern const capture_source_t capture_sim_source;
+#define CAPTURE_DEFAULT_SOURCE (&capture_sim_source)
+#define CAPTURE_TIMESTAMPED_SOURCE (&capture_sim_source)
+#endif
+
+bool capture_init(const capture_source_t *source, uint32_t sample_rate_hz,
+                  capture_complete_callback_t on_complete);
+bool capture_set_rate(uint32_t sample_rate_hz, int decimation);
+uint32_t capture_sample_rate(void);
+int capture_decimation(void);
+bool capture_start(uint16_t *buffer, int length);
+bool capture_start_stream(uint16_t *ring, int block_length, int block_count);
+bool capture_start_store(sample_store_t *store);
+int capture_stop(void);
+int capture_poll(void);
+bool capture_pending(void);
+uint32_t capture_raw_overruns(void);
+bool capture_running(void);
+bool capture_streaming(void);
+int capture_next_block(void);
+uint32_t capture_overruns(void);
+void capture_set_timestamps(uint16_t *deltas, int length);
+const capture_timing_t *capture_timing(void);
+uint32_t capture_elapsed_us(int first, int count);
+void capture_print_timing(void);
+
+#endif // CAPTURE_H
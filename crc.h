@@ -0,0 +1,9 @@
+// crc.h
+#ifndef CRC_H
+#define CRC_H
+
+#include "pico/stdlib.h"
+
+uint32_t crc32_update(uint32_t crc, const uint8_t *data, uint32_t bytes);
+
+#endif // CRC_H
@@ -0,0 +1,28 @@
+// decimate.h
+#ifndef DECIMATE_H
+#define DECIMATE_H
+
+#include "pico/stdlib.h"
+
+#define DECIMATE_MAX_FACTOR 512 // 12 біт * 512^2 ще вміщується в 32-бітні інтегратори CIC
+#define DECIMATE_FIR_TAPS 5
+
+/**
+ * Стан дециматора: CIC другого порядку, що зменшує частоту в factor разів,
+ * і симетричний КІХ-фільтр, що вирівнює спад АЧХ CIC у смузі пропускання.
+ */
+typedef struct decimator {
+    int factor;
+    int phase;                  // Вхідних зразків від останнього вихідного
+    int warmup;                 // Вихідні зразки, що ще відкидаються після скидання
+    uint32_t integrator[2];     // Переповнення за модулем 2^32 компенсується гребенями
+    uint32_t comb[2];
+    uint32_t scale;             // 2^24 / factor^2: нормування підсилення CIC
+    int32_t history[DECIMATE_FIR_TAPS];
+} decimator_t;
+
+void decimator_init(decimator_t *decimator, int factor);
+void decimator_reset(decimator_t *decimator);
+int decimator_process(decimator_t *decimator, const uint16_t *input, int count, uint16_t *output);
+
+#endif // DECIMATE_H
@@ -0,0 +1,59 @@
+#include "encoder.h"
+
+/*
+ * Крок переходу за індексом (попередній стан << 2 | новий стан): +1 —
+ * вправо (CLK змінюється раніше за DT), -1 — вліво, 0 — стан не змінився
+ * або змінилися обидва піни (такі переходи рахуються в invalid).
+ */
+static const int8_t encoder_transitions[16] = {
+     0, -1,  1,  0,
+     1,  0,  0, -1,
+    -1,  0,  0,  1,
+     0,  1, -1,  0,
+};
+
+void encoder_init(encoder_t *encoder, uint8_t pins) {
+    encoder->state = pins & 3;
+    encoder->quarter = 0;
+    encoder->last_detent_us = 0;
+    encoder->detents = 0;
+    encoder->invalid = 0;
+}
+
+/**
+ * Кроків за клацання: що коротший інтервал від попереднього клацання,
+ * то більше, від 1 до ENCODER_ACCEL_MAX.
+ */
+static int encoder_acceleration(uint64_t interval_us) {
+    if (interval_us >= ENCODER_ACCEL_US) return 1;
+    if (interval_us * ENCODER_ACCEL_MAX <= ENCODER_ACCEL_US) return ENCODER_ACCEL_MAX;
+    return (int)(ENCODER_ACCEL_US / interval_us);
+}
+
+/**
+ * Обробляє новий стан пінів. Викликається з переривання на будь-якому
+ * фронті CLK або DT; на хості — з записаної послідовності станів.
+ *
+ * @param pins Стан пінів: CLK << 1 | DT.
+ * @param time_us Час події в мікросекундах (для прискорення).
+ * @return int Кроки з прискоренням, якщо цей перехід завершив клацання
+ *         (додатні — вправо), інакше 0.
+ */
+int encoder_feed(encoder_t *encoder, uint8_t pins, uint64_t time_us) {
+    pins &= 3;
+    if (pins == encoder->state) return 0;
+    int8_t step = encoder_transitions[encoder->state << 2 | pins];
+    if (step == 0) encoder->invalid++;
+    encoder->quarter += step;
+    encoder->state = pins;
+    if (pins != ENCODER_REST_STATE) return 0;
+
+    // Фіксоване положення: клацання, якщо пройдено хоча б пів циклу
+    int direction = encoder->quarter >= 2 ? 1 : encoder->quarter <= -2 ? -1 : 0;
+    encoder->quarter = 0;
+    if (direction == 0) return 0;
+    int steps = encoder->detents ? encoder_acceleration(time_us - encoder->last_detent_us) : 1;
+    encoder->last_detent_us = time_us;
+    encoder->detents++;
+    return direction * steps;
+}
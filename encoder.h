@@ -0,0 +1,35 @@
+// encoder.h
+#ifndef ENCODER_H
+#define ENCODER_H
+
+#include "pico/stdlib.h"
+
+#define ENCODER_REST_STATE 3    // CLK і DT підтягнуті: обидва 1 у фіксованому положенні
+#ifndef ENCODER_ACCEL_US
+#define ENCODER_ACCEL_US 60000  // Клацання частіше за це прискорюються: крок = ENCODER_ACCEL_US / інтервал
+#endif
+#ifndef ENCODER_ACCEL_MAX
+#define ENCODER_ACCEL_MAX 8     // Найбільше прискорення, кроків за клацання
+#endif
+
+/**
+ * Декодер квадратурного енкодера: стан пінів (CLK << 1 | DT) проходить
+ * таблицю переходів коду Грея. Переходи, де змінилися обидва піни,
+ * неможливі і лише рахуються. Клацання — повний цикл із чотирьох переходів
+ * від ENCODER_REST_STATE до нього ж.
+ *
+ * Стан декодера змінює лише encoder_feed() (з переривання); кроки
+ * клацання переривання передає основному циклу подією (events.h).
+ */
+typedef struct encoder {
+    uint8_t state;              // Останній стан пінів
+    int8_t quarter;             // Переходи від останнього фіксованого положення
+    uint64_t last_detent_us;
+    uint32_t detents;
+    uint32_t invalid;           // Відкинуті переходи (дребезг, пропущене переривання)
+} encoder_t;
+
+void encoder_init(encoder_t *encoder, uint8_t pins);
+int encoder_feed(encoder_t *encoder, uint8_t pins, uint64_t time_us);
+
+#endif // ENCODER_H
@@ -0,0 +1,155 @@
+#include <stdio.h>
+#include <string.h>
+#include "events.h"
+
+/*
+ * Черга подій від переривань до основного циклу. Виробник пише слот і
+ * лише потім публікує його, зсуваючи head (release); споживач читає head
+ * (acquire), копіює слоти і звільняє їх, зсуваючи tail. Повна черга
+ * відкидає нову подію й рахує її в dropped: переривання не чекає.
+ * Після публікації виробник будить споживача: на Pico — __sev() для
+ * __wfe() в event_wait(), на хості — семафором.
+ */
+
+#if PICO_ON_DEVICE
+#include "hardware/sync.h"
+#define EVENT_WAKE(queue) __sev()
+#else
+#include <errno.h>
+#include <time.h>
+#define EVENT_WAKE(queue) sem_post(&(queue)->wakeup)
+#endif
+
+void event_queue_init(event_queue_t *queue) {
+    memset(queue, 0, sizeof(*queue));
+#if !PICO_ON_DEVICE
+    sem_init(&queue->wakeup, 0, 0);
+#endif
+}
+
+/**
+ * Додає подію в чергу. Викликається лише виробником (з переривання).
+ *
+ * @param type Тип події (event_type_t).
+ * @param value Значення, що залежить від типу.
+ * @param time_us Час події, нижні 32 біти мікросекунд.
+ * @return bool False, якщо черга заповнена і подію відкинуто.
+ */
+bool event_post(event_queue_t *queue, uint8_t type, int32_t value, uint32_t time_us) {
+    uint32_t head = queue->head;
+    uint32_t tail = __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE);
+    if (head - tail >= EVENT_QUEUE_SIZE) {
+        queue->dropped++;
+        return false;
+    }
+    event_t *slot = &queue->slots[head & (EVENT_QUEUE_SIZE - 1)];
+    slot->type = type;
+    slot->value = value;
+    slot->time_us = time_us;
+    __atomic_store_n(&queue->head, head + 1, __ATOMIC_RELEASE);
+    queue->posted++;
+    EVENT_WAKE(queue);
+    return true;
+}
+
+/**
+ * Додає подію з основного циклу. Переривання-виробник могло б перебити
+ * event_post() між читанням head і його публікацією, і обидві події
+ * лягли б в один слот, тож на Pico переривання на цей час вимикаються.
+ * Можна викликати й з переривання, якщо контекст виклику заздалегідь
+ * невідомий.
+ */
+bool event_post_from_thread(event_queue_t *queue, uint8_t type, int32_t value, uint32_t time_us) {
+#if PICO_ON_DEVICE
+    uint32_t irq = save_and_disable_interrupts();
+    bool posted = event_post(queue, type, value, time_us);
+    restore_interrupts(irq);
+    return posted;
+#else
+    return event_post(queue, type, value, time_us);
+#endif
+}
+
+bool event_pending(const event_queue_t *queue) {
+    return __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE) != queue->tail;
+}
+
+/**
+ * Забирає до max подій у порядку надходження. Викликається лише
+ * споживачем (основним циклом).
+ *
+ * @return int Кількість забраних подій.
+ */
+int event_take(event_queue_t *queue, event_t *out, int max) {
+    uint32_t tail = queue->tail;
+    uint32_t head = __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE);
+    int count = 0;
+    while (tail != head && count < max) {
+        out[count++] = queue->slots[tail & (EVENT_QUEUE_SIZE - 1)];
+        tail++;
+    }
+    __atomic_store_n(&queue->tail, tail, __ATOMIC_RELEASE);
+    if ((uint32_t)count > queue->max_batch) queue->max_batch = count;
+    return count;
+}
+
+/**
+ * Присипляє споживача до нової події або на timeout_us. Подія, додана
+ * між перевіркою черги і сном, не губиться: на Pico __sev() лишає
+ * прапорець події, і __wfe() одразу повертається, на хості лишається
+ * значення семафора. На Pico будить і будь-яке інше переривання (блоки
+ * DMA, таймер USB), тому виклик може повернутися раніше.
+ */
+void event_wait(event_queue_t *queue, uint32_t timeout_us) {
+    if (event_pending(queue)) return;
+#if PICO_ON_DEVICE
+    best_effort_wfe_or_timeout(make_timeout_time_us(timeout_us));
+#else
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_nsec += (long)(timeout_us % 1000000) * 1000;
+    deadline.tv_sec += timeout_us / 1000000 + deadline.tv_nsec / 1000000000;
+    deadline.tv_nsec %= 1000000000;
+    while (sem_timedwait(&queue->wakeup, &deadline) < 0 && errno == EINTR) {}
+#endif
+}
+
+static int latency_bucket(uint32_t latency_us) {
+    int bucket = 0;
+    while (latency_us && bucket < EVENT_LATENCY_BUCKETS - 1) {
+        latency_us >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+/**
+ * Рахує оброблені події і затримку кожної від переривання до now_us —
+ * моменту, коли зміни, які вона спричинила, дійшли до дисплея.
+ */
+void event_record_latency(event_queue_t *queue, const event_t *events, int count, uint32_t now_us) {
+    for (int i = 0; i < count; i++) {
+        uint32_t latency_us = now_us - events[i].time_us;
+        if (latency_us > queue->max_latency_us) queue->max_latency_us = latency_us;
+        queue->latency_histogram[latency_bucket(latency_us)]++;
+    }
+    queue->handled += count;
+}
+
+/**
+ * Виводить лічильники черги і ненульові кошики гістограми затримки
+ * ("<2^k:кількість", мкс) — у форматі статистики траси.
+ */
+void event_print_stats(const event_queue_t *queue) {
+    printf("Events: posted %u handled %u dropped %u max batch %u max latency %u us |",
+           (unsigned)queue->posted, (unsigned)queue->handled, (unsigned)queue->dropped,
+           (unsigned)queue->max_batch, (unsigned)queue->max_latency_us);
+    for (int bucket = 0; bucket < EVENT_LATENCY_BUCKETS; bucket++) {
+        if (queue->latency_histogram[bucket] == 0) continue;
+        if (bucket < EVENT_LATENCY_BUCKETS - 1) printf(" <%u:", 1u << bucket);
+        else printf(" >=%u:", 1u << (bucket - 1));
+        printf("%u", (unsigned)queue->latency_histogram[bucket]);
+    }
+    printf("\n");
+}
+
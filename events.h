@@ -0,0 +1,65 @@
+// events.h
+#ifndef EVENTS_H
+#define EVENTS_H
+
+#include "pico/stdlib.h"
+#if !PICO_ON_DEVICE
+#include <semaphore.h>
+#endif
+
+#define EVENT_QUEUE_SIZE 32         // Степінь двійки
+#define EVENT_BATCH 8               // Подій за один прохід основного циклу
+#define EVENT_LATENCY_BUCKETS 16    // Кошик k: затримка менше 2^k мкс
+
+/**
+ * Події від переривань до основного циклу. value залежить від типу.
+ */
+typedef enum {
+    EVENT_MEASURE_PRESS = 1,  // Кнопка вимірювання натиснута
+    EVENT_MEASURE_RELEASE,    // і відпущена
+    EVENT_ENCODER_STEPS,      // value — кроки енкодера з прискоренням, додатні — вправо
+    EVENT_SWITCH_PRESS,       // Кнопка енкодера натиснута
+    EVENT_SWITCH_RELEASE,     // і відпущена
+    EVENT_NEXT_PEAK,          // Кнопка NEXT_PEAK_PIN
+    EVENT_CAPTURE_COMPLETE,   // value — кількість записаних зразків
+} event_type_t;
+
+typedef struct event {
+    uint8_t type;
+    int32_t value;
+    uint32_t time_us;  // Нижні 32 біти time_us_64() у момент події
+} event_t;
+
+/**
+ * Кільце подій без блокувань для одного виробника й одного споживача:
+ * head пише лише виробник, tail — лише споживач. На Pico всі виробники —
+ * переривання ядра 0 з однаковим пріоритетом, які не перебивають одне
+ * одного, тож для кільця вони — один виробник. Подію з основного циклу
+ * додає event_post_from_thread(), що на цей час вимикає переривання.
+ * Споживач — основний цикл.
+ */
+typedef struct event_queue {
+    event_t slots[EVENT_QUEUE_SIZE];
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    uint32_t posted;      // Лічильники виробника
+    uint32_t dropped;
+    uint32_t handled;     // Лічильники споживача
+    uint32_t max_batch;
+    uint32_t max_latency_us;
+    uint32_t latency_histogram[EVENT_LATENCY_BUCKETS]; // Від події до кінця передавання змін на дисплей
+#if !PICO_ON_DEVICE
+    sem_t wakeup; // На хості виробник — потік, споживач чекає на семафорі
+#endif
+} event_queue_t;
+
+void event_queue_init(event_queue_t *queue);
+bool event_post(event_queue_t *queue, uint8_t type, int32_t value, uint32_t time_us);
+bool event_post_from_thread(event_queue_t *queue, uint8_t type, int32_t value, uint32_t time_us);
+bool event_pending(const event_queue_t *queue);
+int event_take(event_queue_t *queue, event_t *out, int max);
+void event_wait(event_queue_t *queue, uint32_t timeout_us);
+void event_record_latency(event_queue_t *queue, const event_t *events, int count, uint32_t now_us);
+void event_print_stats(const event_queue_t *queue);
+
+#endif // EVENTS_H
@@ -0,0 +1,213 @@
+#include "fft.h"
+#include "fft_tables.h"
+
+/*
+ * Дійсне ШПФ у форматі Q15 для RP2040 (без FPU). Дійсний сигнал із FFT_SIZE
+ * точок розглядається як комплексний довжиною FFT_SIZE/2 (парні зразки —
+ * дійсна частина, непарні — уявна), перетворюється на місці ядрами radix-4
+ * (два злиті етапи radix-2, вдвічі менше проходів по пам'яті) і одним етапом
+ * radix-2, а потім розділяється на спектр дійсного сигналу.
+ * Кожен етап radix-2 ділить результат на 2, тому переповнень немає, а
+ * вихід масштабовано на 1/(розмір перетворення).
+ * Менші перетворення (кадри спектрограми) беруть ту саму таблицю синуса з
+ * кроком FFT_SIZE/size, тож розмір задається під час виклику. Таблицю
+ * чверті періоду (fft_sine_table, Q15) генерує під час збірки
+ * tools/fft_tables.py, тож вона константна й лежить у флеші.
+ */
+
+#define FFT_HALF (FFT_SIZE / 2)
+#define FFT_QUARTER (FFT_SIZE / 4)
+
+typedef struct {
+    int32_t re;
+    int32_t im;
+} cpx_t;
+
+static int32_t sin_q15(int i) {
+    i &= FFT_SIZE - 1;
+    if (i < FFT_QUARTER) return fft_sine_table[i];
+    if (i < FFT_HALF) return fft_sine_table[FFT_HALF - i];
+    if (i < FFT_HALF + FFT_QUARTER) return -fft_sine_table[i - FFT_HALF];
+    return -fft_sine_table[FFT_SIZE - i];
+}
+
+static int32_t cos_q15(int i) {
+    return sin_q15(i + FFT_QUARTER);
+}
+
+/**
+ * Поворотний множник W = exp(-2πj·i/FFT_SIZE) у Q15.
+ */
+static cpx_t twiddle(int i) {
+    cpx_t w = { cos_q15(i), -sin_q15(i) };
+    return w;
+}
+
+static cpx_t cmul(cpx_t a, cpx_t b) {
+    cpx_t r = {
+        (a.re * b.re - a.im * b.im + (1 << 14)) >> 15,
+        (a.re * b.im + a.im * b.re + (1 << 14)) >> 15,
+    };
+    return r;
+}
+
+static cpx_t load(const int16_t *buffer, int k) {
+    cpx_t c = { buffer[2 * k], buffer[2 * k + 1] };
+    return c;
+}
+
+static void store(int16_t *buffer, int k, cpx_t c) {
+    buffer[2 * k] = (int16_t)c.re;
+    buffer[2 * k + 1] = (int16_t)c.im;
+}
+
+/**
+ * Половинна сума і різниця метелика: (a + t)/2, (a - t)/2.
+ */
+static void butterfly(cpx_t a, cpx_t t, cpx_t *sum, cpx_t *diff) {
+    sum->re = (a.re + t.re) >> 1;
+    sum->im = (a.im + t.im) >> 1;
+    diff->re = (a.re - t.re) >> 1;
+    diff->im = (a.im - t.im) >> 1;
+}
+
+static void bit_reverse(int16_t *buffer, int half) {
+    for (int i = 1, j = 0; i < half; i++) {
+        int bit = half >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j |= bit;
+        if (i < j) {
+            cpx_t a = load(buffer, i);
+            store(buffer, i, load(buffer, j));
+            store(buffer, j, a);
+        }
+    }
+}
+
+/**
+ * Два злиті етапи radix-2 (розміри 2L і 4L) за один прохід.
+ *
+ * @param half L — половина розміру першого етапу.
+ * @param length Довжина комплексного перетворення (size/2).
+ */
+static void radix4_pass(int16_t *buffer, int half, int length) {
+    int step1 = FFT_SIZE / (2 * half); // Крок таблиці для W_{2L}
+    int step2 = step1 / 2;             // Крок таблиці для W_{4L}
+    for (int group = 0; group < length; group += 4 * half) {
+        for (int k = 0; k < half; k++) {
+            int i0 = group + k, i1 = i0 + half, i2 = i1 + half, i3 = i2 + half;
+            cpx_t w1 = twiddle(k * step1);
+            cpx_t w2 = twiddle(k * step2);
+            cpx_t a, b, c, d;
+            butterfly(load(buffer, i0), cmul(w1, load(buffer, i1)), &a, &b);
+            butterfly(load(buffer, i2), cmul(w1, load(buffer, i3)), &c, &d);
+
+            cpx_t x0, x1, x2, x3;
+            cpx_t w3 = { w2.im, -w2.re }; // W_{4L}^{k+L} = -j·W_{4L}^k
+            butterfly(a, cmul(w2, c), &x0, &x2);
+            butterfly(b, cmul(w3, d), &x1, &x3);
+            store(buffer, i0, x0);
+            store(buffer, i1, x1);
+            store(buffer, i2, x2);
+            store(buffer, i3, x3);
+        }
+    }
+}
+
+static void radix2_pass(int16_t *buffer, int half, int length) {
+    int step = FFT_SIZE / (2 * half);
+    for (int group = 0; group < length; group += 2 * half) {
+        for (int k = 0; k < half; k++) {
+            cpx_t x0, x1;
+            butterfly(load(buffer, group + k),
+                      cmul(twiddle(k * step), load(buffer, group + k + half)), &x0, &x1);
+            store(buffer, group + k, x0);
+            store(buffer, group + k + half, x1);
+        }
+    }
+}
+
+/**
+ * Готує буфер ШПФ із запису АЦП: віднімає постійну складову, переводить
+ * 12-бітні коди в Q15 із запасом (множення на 4, щоб модуль комплексної
+ * пари не перевищив 32767), накладає вікно Ганна на count
+ * зразків і доповнює решту буфера нулями.
+ *
+ * @param buffer Буфер на size значень.
+ * @param samples Зразки АЦП; можуть лежати в тому самому buffer (перетворення на місці).
+ * @param count Кількість зразків (обрізається до size).
+ * @param size Розмір перетворення: степінь двійки від 8 до FFT_SIZE.
+ */
+void fft_load_q15(int16_t *buffer, const uint16_t *samples, int count, int size) {
+    if (count > size) count = size;
+    uint32_t sum = 0;
+    for (int i = 0; i < count; i++) sum += samples[i];
+    int32_t mean = count > 0 ? (int32_t)(sum / count) : 0;
+
+    for (int i = 0; i < count; i++) {
+        // Вікно Ганна: (1 - cos(2πi/count)) / 2, аргумент переводиться в індекс таблиці
+        int32_t window = (32768 - cos_q15((int)((int64_t)i * FFT_SIZE / count))) >> 1;
+        int32_t value = ((int32_t)samples[i] - mean) * 4;
+        buffer[i] = (int16_t)((value * window) >> 15);
+    }
+    for (int i = count; i < size; i++) buffer[i] = 0;
+}
+
+/**
+ * Дійсне ШПФ на місці. На виході buffer містить пари (re, im) для бінів
+ * 0..size/2-1; уявна частина біна 0 містить дійсний бін Найквіста.
+ *
+ * @param size Розмір перетворення: степінь двійки від 8 до FFT_SIZE.
+ */
+void fft_real_q15(int16_t *buffer, int size) {
+    int length = size / 2;
+    int stride = FFT_SIZE / size; // Крок таблиці для W_size
+    bit_reverse(buffer, length);
+    int half = 1;
+    for (; half * 4 <= length; half *= 4) radix4_pass(buffer, half, length);
+    if (half * 2 <= length) radix2_pass(buffer, half, length);
+
+    // Розділення: X[k] = Fe[k] + W^k·Fo[k], X[N/2-k] = conj(Fe[k] - W^k·Fo[k])
+    cpx_t z0 = load(buffer, 0);
+    cpx_t dc_nyquist = { (z0.re + z0.im) >> 1, (z0.re - z0.im) >> 1 };
+    store(buffer, 0, dc_nyquist);
+    for (int k = 1; k <= length / 2; k++) {
+        cpx_t zk = load(buffer, k);
+        cpx_t zm = load(buffer, length - k);
+        cpx_t fe = { (zk.re + zm.re) >> 1, (zk.im - zm.im) >> 1 };
+        cpx_t fo = { (zk.im + zm.im) >> 1, (zm.re - zk.re) >> 1 };
+        cpx_t t = cmul(twiddle(k * stride), fo);
+        cpx_t xk, xm;
+        butterfly(fe, t, &xk, &xm);
+        xm.im = -xm.im;
+        store(buffer, k, xk);
+        store(buffer, length - k, xm);
+    }
+}
+
+static uint32_t isqrt(uint32_t value) {
+    uint32_t root = 0;
+    for (uint32_t bit = 1u << 30; bit; bit >>= 2) {
+        if (value >= root + bit) {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+    }
+    return root;
+}
+
+/**
+ * Перетворює результат fft_real_q15() на амплітуди на місці: після виклику
+ * ((uint16_t *)buffer)[k] — модуль біна k, k = 0..size/2-1.
+ */
+void fft_magnitude_q15(int16_t *buffer, int size) {
+    uint16_t *magnitudes = (uint16_t *)buffer;
+    magnitudes[0] = (uint16_t)(buffer[0] < 0 ? -buffer[0] : buffer[0]);
+    for (int k = 1; k < size / 2; k++) {
+        int32_t re = buffer[2 * k];
+        int32_t im = buffer[2 * k + 1];
+        magnitudes[k] = (uint16_t)isqrt((uint32_t)(re * re + im * im));
+    }
+}
@@ -0,0 +1,15 @@
+// fft.h
+#ifndef FFT_H
+#define FFT_H
+
+#include "pico/stdlib.h"
+
+#define FFT_LOG2_SIZE 12                 // 4096 точок: запис 4000 зразків доповнюється нулями
+#define FFT_SIZE (1 << FFT_LOG2_SIZE)
+#define FFT_BINS (FFT_SIZE / 2)          // Корисні частотні біни 0..FFT_SIZE/2-1
+
+void fft_load_q15(int16_t *buffer, const uint16_t *samples, int count, int size);
+void fft_real_q15(int16_t *buffer, int size);
+void fft_magnitude_q15(int16_t *buffer, int size);
+
+#endif // FFT_H
@@ -0,0 +1,378 @@
+#include <stdio.h>
+#include <string.h>
+#include "flash_log.h"
+#include "crc.h"
+
+/*
+ * Журнал записів у флеші. Записи лежать підряд у кільці секторів, кожен
+ * починається з нового сектора: сторінка заголовка, потім вміст. Новий
+ * запис стирає сектори перед собою, тож найстаріші записи зникають
+ * першими. Індекс у RAM відновлюється при монтуванні переглядом початків
+ * секторів: запис дійсний, якщо має заголовок і його CRC збігається.
+ *
+ * Кожна операція з флешем (стирання сектора або програмування сторінки)
+ * виконується окремим викликом flash_log_step(), тож той, хто викликає,
+ * сам вирішує, коли флеш можна займати, і ніколи не чекає на весь запис.
+ */
+
+static uint32_t record_span(const flash_log_t *log, uint32_t length) {
+    uint32_t sector = log->device->sector_size;
+    return (log->device->page_size + length + sector - 1) / sector * sector;
+}
+
+/**
+ * Вказівник на байт журналу за зміщенням pos (за модулем розміру) і
+ * кількість байтів, що лежать за ним підряд до кінця кільця.
+ */
+static const uint8_t *region_map(const flash_log_t *log, uint32_t pos, uint32_t *contiguous) {
+    pos %= log->size;
+    *contiguous = log->size - pos;
+    return log->device->map(log->base + pos);
+}
+
+static uint32_t region_crc(const flash_log_t *log, uint32_t pos, uint32_t bytes) {
+    uint32_t crc = 0;
+    while (bytes > 0) {
+        uint32_t run;
+        const uint8_t *data = region_map(log, pos, &run);
+        if (run > bytes) run = bytes;
+        crc = crc32_update(crc, data, run);
+        pos += run;
+        bytes -= run;
+    }
+    return crc;
+}
+
+/**
+ * Додає запис в індекс, зберігаючи порядок за номером. Якщо індекс
+ * заповнено, найстаріший запис випадає з нього (у флеші він лишається
+ * до перезапису).
+ */
+static void index_insert(flash_log_t *log, const flash_log_record_t *record) {
+    if (log->count == FLASH_LOG_MAX_RECORDS) {
+        if (record->sequence < log->records[0].sequence) return;
+        memmove(log->records, log->records + 1, (log->count - 1) * sizeof(flash_log_record_t));
+        log->count--;
+    }
+    int i = log->count;
+    while (i > 0 && log->records[i - 1].sequence > record->sequence) {
+        log->records[i] = log->records[i - 1];
+        i--;
+    }
+    log->records[i] = *record;
+    log->count++;
+}
+
+/**
+ * Підключає журнал і відновлює індекс із флешу.
+ *
+ * @param log Журнал.
+ * @param device Флеш-пам'ять.
+ * @param base Зміщення журналу, кратне сектору.
+ * @param size Розмір журналу, кратний сектору.
+ * @return bool False, якщо область не підходить для пристрою.
+ */
+bool flash_log_mount(flash_log_t *log, const flash_device_t *device, uint32_t base, uint32_t size) {
+    memset(log, 0, sizeof(*log));
+    log->device = device;
+    log->base = base;
+    log->size = size;
+    if (device->page_size > FLASH_LOG_MAX_PAGE || base % device->sector_size ||
+        size % device->sector_size || size < 2 * device->sector_size ||
+        base + size > device->size || !device->init()) {
+        printf("Flash log: bad region %u+%u on %s\n", (unsigned)base, (unsigned)size, device->name);
+        log->size = 0;
+        return false;
+    }
+
+    for (uint32_t start = 0; start < size; start += device->sector_size) {
+        flash_log_header_t header;
+        memcpy(&header, device->map(base + start), sizeof(header));
+        if (header.magic != FLASH_LOG_MAGIC || header.length > size - device->page_size ||
+            record_span(log, header.length) > size) continue;
+        if (region_crc(log, start + device->page_size, header.length) != header.crc) continue;
+        flash_log_record_t record = { header.sequence, start, header.length, header.crc };
+        index_insert(log, &record);
+    }
+    if (log->count > 0) {
+        const flash_log_record_t *newest = &log->records[log->count - 1];
+        log->head = (newest->start + record_span(log, newest->length)) % size;
+        log->sequence = newest->sequence + 1;
+    }
+    printf("Flash log: %d records, %u KB at %u on %s\n", log->count, (unsigned)(size / 1024),
+           (unsigned)base, device->name);
+    return true;
+}
+
+/**
+ * Починає новий запис. Записи, чиї сектори він займе, одразу вилучаються
+ * з індексу. Вміст читається з source по сторінці під час flash_log_step().
+ *
+ * @param log Журнал.
+ * @param length Довжина вмісту в байтах.
+ * @param source Джерело вмісту; дані мають лишатися незмінними до кінця запису.
+ * @return bool False, якщо вже йде запис або вміст не вміщується в журнал.
+ */
+bool flash_log_begin(flash_log_t *log, uint32_t length, flash_log_source_t source) {
+    if (log->size == 0 || log->writing) return false;
+    uint32_t span = record_span(log, length);
+    if (span > log->size) return false;
+
+    int kept = 0;
+    for (int i = 0; i < log->count; i++) {
+        uint32_t distance = (log->records[i].start + log->size - log->head) % log->size;
+        if (distance < span) continue; // Буде стерто
+        log->records[kept++] = log->records[i];
+    }
+    log->count = kept;
+
+    log->writing = true;
+    log->source = source;
+    log->length = length;
+    log->cursor = log->device->page_size; // Заголовок — останнім
+    log->erased = 0;
+    log->crc = 0;
+    return true;
+}
+
+static bool program_page(flash_log_t *log, uint32_t offset) {
+    log->programs++;
+    return log->device->program(log->base + (log->head + offset) % log->size, log->page,
+                                log->device->page_size);
+}
+
+/**
+ * Виконує одну операцію з флешем для поточного запису: стирає наступний
+ * сектор, програмує наступну сторінку вмісту або, наприкінці, сторінку
+ * заголовка, після чого запис з'являється в індексі.
+ *
+ * @return bool False, якщо флеш повернув помилку (запис скасовано).
+ */
+bool flash_log_step(flash_log_t *log) {
+    if (!log->writing) return true;
+    const flash_device_t *device = log->device;
+    uint32_t page = device->page_size;
+    uint32_t total = page + log->length;
+    uint32_t target = log->cursor < total ? log->cursor : 0; // Сторінка, яку треба записати
+
+    if (target >= log->erased) {
+        log->erases++;
+        if (!device->erase(log->base + (log->head + log->erased) % log->size, device->sector_size)) {
+            flash_log_abort(log);
+            return false;
+        }
+        log->erased += device->sector_size;
+        return true;
+    }
+
+    if (log->cursor < total) {
+        uint32_t offset = log->cursor - page;
+        uint32_t bytes = log->length - offset < page ? log->length - offset : page;
+        memset(log->page, 0xFF, page);
+        log->source(offset, log->page, bytes);
+        log->crc = crc32_update(log->crc, log->page, bytes);
+        if (!program_page(log, log->cursor)) {
+            flash_log_abort(log);
+            return false;
+        }
+        log->cursor += page;
+        return true;
+    }
+
+    flash_log_header_t header = { FLASH_LOG_MAGIC, log->sequence, log->length, log->crc };
+    memset(log->page, 0xFF, page);
+    memcpy(log->page, &header, sizeof(header));
+    if (!program_page(log, 0)) {
+        flash_log_abort(log);
+        return false;
+    }
+    flash_log_record_t record = { log->sequence, log->head, log->length, log->crc };
+    index_insert(log, &record);
+    log->head = (log->head + record_span(log, log->length)) % log->size;
+    log->sequence++;
+    log->writing = false;
+    return true;
+}
+
+/**
+ * Скасовує поточний запис. Його сектори без заголовка не вважаються
+ * записом і будуть стерті наступним.
+ */
+void flash_log_abort(flash_log_t *log) {
+    log->writing = false;
+}
+
+bool flash_log_busy(const flash_log_t *log) {
+    return log->writing;
+}
+
+int flash_log_count(const flash_log_t *log) {
+    return log->count;
+}
+
+/**
+ * Запис за номером в індексі: 0 — найстаріший, flash_log_count() - 1 — найновіший.
+ */
+const flash_log_record_t *flash_log_record(const flash_log_t *log, int index) {
+    if (index < 0 || index >= log->count) return NULL;
+    return &log->records[index];
+}
+
+/**
+ * Найдовший шматок вмісту запису, що лежить у флеші підряд, починаючи з
+ * offset. Для швидкого вивантаження без копіювання (на Pico — прямо з XIP).
+ *
+ * @param bytes Повертає довжину шматка (0 — вміст закінчився).
+ * @return const uint8_t* Вказівник на шматок.
+ */
+const uint8_t *flash_log_chunk(const flash_log_t *log, int index, uint32_t offset, uint32_t *bytes) {
+    const flash_log_record_t *record = flash_log_record(log, index);
+    *bytes = 0;
+    if (!record || offset >= record->length) return NULL;
+    const uint8_t *data = region_map(log, record->start + log->device->page_size + offset, bytes);
+    if (*bytes > record->length - offset) *bytes = record->length - offset;
+    return data;
+}
+
+/**
+ * Копіює частину вмісту запису.
+ *
+ * @return uint32_t Кількість скопійованих байтів.
+ */
+uint32_t flash_log_read(const flash_log_t *log, int index, uint32_t offset, uint8_t *out, uint32_t bytes) {
+    uint32_t copied = 0;
+    while (copied < bytes) {
+        uint32_t run;
+        const uint8_t *data = flash_log_chunk(log, index, offset + copied, &run);
+        if (run == 0) break;
+        if (run > bytes - copied) run = bytes - copied;
+        memcpy(out + copied, data, run);
+        copied += run;
+    }
+    return copied;
+}
+
+#if PICO_ON_DEVICE
+#include "hardware/flash.h"
+#include "hardware/sync.h"
+
+/*
+ * Під час стирання і програмування XIP недоступний: код із флешу не
+ * виконується. Тому на цьому ядрі вимикаються переривання, а ядро 1 має
+ * чекати в RAM (див. pipeline_park()). DMA працює далі.
+ */
+
+static bool pico_flash_init(void) {
+    return true;
+}
+
+static bool pico_flash_erase(uint32_t offset, uint32_t bytes) {
+    uint32_t irq = save_and_disable_interrupts();
+    flash_range_erase(offset, bytes);
+    restore_interrupts(irq);
+    return true;
+}
+
+static bool pico_flash_program(uint32_t offset, const uint8_t *data, uint32_t bytes) {
+    uint32_t irq = save_and_disable_interrupts();
+    flash_range_program(offset, data, bytes);
+    restore_interrupts(irq);
+    return true;
+}
+
+static const uint8_t *pico_flash_map(uint32_t offset) {
+    return (const uint8_t *)(uintptr_t)(XIP_BASE + offset);
+}
+
+const flash_device_t flash_pico_device = {
+    .name = "flash",
+    .size = PICO_FLASH_SIZE_BYTES,
+    .sector_size = FLASH_SECTOR_SIZE,
+    .page_size = FLASH_PAGE_SIZE,
+    .init = pico_flash_init,
+    .erase = pico_flash_erase,
+    .program = pico_flash_program,
+    .map = pico_flash_map,
+};
+
+#else
+#include <stdlib.h>
+
+/*
+ * Симульований флеш для Linux-хоста: 2 МБ у пам'яті, за потреби —
+ * у файлі зі змінної середовища SREADER_FLASH, щоб журнал переживав
+ * перезапуск. Порушення правил флешу (невирівняне стирання чи
+ * програмування, запис у нестерті біти) повертає помилку.
+ */
+
+#define SIM_FLASH_SIZE (2 * 1024 * 1024)
+#define SIM_FLASH_SECTOR 4096
+#define SIM_FLASH_PAGE 256
+
+static uint8_t sim_flash[SIM_FLASH_SIZE];
+static FILE *sim_flash_file = NULL;
+
+static void sim_flash_sync(uint32_t offset, uint32_t bytes) {
+    if (!sim_flash_file) return;
+    fseek(sim_flash_file, offset, SEEK_SET);
+    fwrite(sim_flash + offset, 1, bytes, sim_flash_file);
+    fflush(sim_flash_file);
+}
+
+static bool sim_flash_init(void) {
+    memset(sim_flash, 0xFF, sizeof(sim_flash));
+    const char *path = getenv("SREADER_FLASH");
+    if (!path) return true;
+    sim_flash_file = fopen(path, "r+b");
+    if (sim_flash_file) {
+        size_t loaded = fread(sim_flash, 1, sizeof(sim_flash), sim_flash_file);
+        printf("Simulated flash: %s, %u bytes loaded\n", path, (unsigned)loaded);
+    } else if ((sim_flash_file = fopen(path, "w+b")) != NULL) {
+        sim_flash_sync(0, sizeof(sim_flash));
+    } else {
+        printf("Cannot open simulated flash %s\n", path);
+    }
+    return true;
+}
+
+static bool sim_flash_erase(uint32_t offset, uint32_t bytes) {
+    if (offset % SIM_FLASH_SECTOR || bytes % SIM_FLASH_SECTOR || offset + bytes > SIM_FLASH_SIZE) {
+        printf("Simulated flash: unaligned erase %u+%u\n", (unsigned)offset, (unsigned)bytes);
+        return false;
+    }
+    memset(sim_flash + offset, 0xFF, bytes);
+    sim_flash_sync(offset, bytes);
+    return true;
+}
+
+static bool sim_flash_program(uint32_t offset, const uint8_t *data, uint32_t bytes) {
+    if (offset % SIM_FLASH_PAGE || bytes % SIM_FLASH_PAGE || offset + bytes > SIM_FLASH_SIZE) {
+        printf("Simulated flash: unaligned program %u+%u\n", (unsigned)offset, (unsigned)bytes);
+        return false;
+    }
+    for (uint32_t i = 0; i < bytes; i++) {
+        if (data[i] & ~sim_flash[offset + i]) {
+            printf("Simulated flash: program over unerased byte at %u\n", (unsigned)(offset + i));
+            return false;
+        }
+    }
+    for (uint32_t i = 0; i < bytes; i++) sim_flash[offset + i] &= data[i];
+    sim_flash_sync(offset, bytes);
+    return true;
+}
+
+static const uint8_t *sim_flash_map(uint32_t offset) {
+    return sim_flash + offset;
+}
+
+const flash_device_t flash_sim_device = {
+    .name = "flash-sim",
+    .size = SIM_FLASH_SIZE,
+    .sector_size = SIM_FLASH_SECTOR,
+    .page_size = SIM_FLASH_PAGE,
+    .init = sim_flash_init,
+    .erase = sim_flash_erase,
+    .program = sim_flash_program,
+    .map = sim_flash_map,
+};
+#endif
@@ -0,0 +1,100 @@
+// flash_log.h
+#ifndef FLASH_LOG_H
+#define FLASH_LOG_H
+
+#include "pico/stdlib.h"
+
+/**
+ * Флеш-пам'ять, у якій живе журнал. Стирання — лише цілими секторами,
+ * програмування — цілими сторінками і лише в стерті байти (біти можна
+ * тільки скидати в 0). Читання — прямим вказівником (на Pico — через XIP).
+ * На Linux-хості той самий журнал працює на симуляторі, що перевіряє ці правила.
+ */
+typedef struct flash_device {
+    const char *name;
+    uint32_t size;
+    uint32_t sector_size;
+    uint32_t page_size;
+    bool (*init)(void);
+    bool (*erase)(uint32_t offset, uint32_t bytes);
+    bool (*program)(uint32_t offset, const uint8_t *data, uint32_t bytes);
+    const uint8_t *(*map)(uint32_t offset);
+} flash_device_t;
+
+#if PICO_ON_DEVICE
+extern const flash_device_t flash_pico_device;
+#define FLASH_DEFAULT_DEVICE (&flash_pico_device)
+#else
+extern const flash_device_t flash_sim_device;
+#define FLASH_DEFAULT_DEVICE (&flash_sim_device)
+#endif
+
+#define FLASH_LOG_MAGIC 0x474F4C53u  // "SLOG"
+#define FLASH_LOG_MAX_PAGE 256       // Найбільша підтримувана сторінка
+#define FLASH_LOG_MAX_RECORDS 32     // Розмір індексу в RAM
+
+/**
+ * Заголовок запису журналу — перші байти першої сторінки запису. Вміст
+ * іде з наступної сторінки. Заголовок програмується останнім, тож
+ * перерваний запис заголовка не має і при монтуванні пропускається.
+ */
+typedef struct flash_log_header {
+    uint32_t magic;
+    uint32_t sequence;
+    uint32_t length;  // Байтів вмісту
+    uint32_t crc;     // CRC-32 вмісту
+} flash_log_header_t;
+
+/**
+ * Запис в індексі: start — зміщення першого сектора від початку журналу.
+ */
+typedef struct flash_log_record {
+    uint32_t sequence;
+    uint32_t start;
+    uint32_t length;
+    uint32_t crc;
+} flash_log_record_t;
+
+/**
+ * Джерело вмісту запису: копіює bytes байтів із зміщення offset.
+ */
+typedef void (*flash_log_source_t)(uint32_t offset, uint8_t *out, uint32_t bytes);
+
+/**
+ * Журнал: кільце секторів, у яке записи дописуються по черзі, стираючи
+ * найстаріші. Кожен сектор стирається раз за оберт кільця — це і є
+ * вирівнювання зношування.
+ */
+typedef struct flash_log {
+    const flash_device_t *device;
+    uint32_t base;                // Зміщення журналу у флеші
+    uint32_t size;                // Розмір журналу, ціле число секторів
+    flash_log_record_t records[FLASH_LOG_MAX_RECORDS]; // Від найстарішого
+    int count;
+    uint32_t head;                // Де почнеться наступний запис
+    uint32_t sequence;            // Номер наступного запису
+
+    // Поточний запис, що пишеться покроково
+    bool writing;
+    flash_log_source_t source;
+    uint32_t length;
+    uint32_t cursor;              // Наступна сторінка від початку запису
+    uint32_t erased;              // Скільки байтів від початку запису вже стерто
+    uint32_t crc;
+    uint8_t page[FLASH_LOG_MAX_PAGE];
+
+    uint32_t erases;
+    uint32_t programs;
+} flash_log_t;
+
+bool flash_log_mount(flash_log_t *log, const flash_device_t *device, uint32_t base, uint32_t size);
+bool flash_log_begin(flash_log_t *log, uint32_t length, flash_log_source_t source);
+bool flash_log_step(flash_log_t *log);
+void flash_log_abort(flash_log_t *log);
+bool flash_log_busy(const flash_log_t *log);
+int flash_log_count(const flash_log_t *log);
+const flash_log_record_t *flash_log_record(const flash_log_t *log, int index);
+const uint8_t *flash_log_chunk(const flash_log_t *log, int index, uint32_t offset, uint32_t *bytes);
+uint32_t flash_log_read(const flash_log_t *log, int index, uint32_t offset, uint8_t *out, uint32_t bytes);
+
+#endif // FLASH_LOG_H
@@ -0,0 +1,218 @@
+#include <string.h>
+#include "frame.h"
+#include "crc.h"
+
+/*
+ * Кадри двійкового протоколу (формат — у frame.h). Пакет збирається
+ * прямо в статичному буфері, кодується COBS в другий і передається
+ * виводу одним викликом. Надсилає лише ядро 0, тож блокувань немає.
+ */
+
+static frame_writer_t frame_writer = NULL;
+static uint8_t frame_packet[FRAME_MAX_PACKET];
+static uint8_t frame_encoded[FRAME_MAX_ENCODED];
+static uint16_t frame_sequence = 0;
+static frame_stats_t frame_counters;
+
+#define FRAME_PAYLOAD (frame_packet + 3)
+
+static uint8_t *put_u16(uint8_t *out, uint16_t value) {
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+    return out + 2;
+}
+
+static uint8_t *put_u32(uint8_t *out, uint32_t value) {
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+    out[2] = (uint8_t)(value >> 16);
+    out[3] = (uint8_t)(value >> 24);
+    return out + 4;
+}
+
+void frame_init(frame_writer_t writer) {
+    frame_writer = writer;
+    frame_reset_stats();
+}
+
+/**
+ * Кодує length байтів COBS: у результаті немає нулів, кожен нуль
+ * замінено відстанню до наступного. Довжина результату — не більше
+ * length + length / 254 + 1.
+ *
+ * @return int Довжина закодованих даних.
+ */
+int cobs_encode(const uint8_t *in, int length, uint8_t *out) {
+    int code_at = 0, written = 1;
+    uint8_t code = 1;
+    for (int i = 0; i < length; i++) {
+        if (in[i] != 0) {
+            out[written++] = in[i];
+            code++;
+        }
+        if (in[i] == 0 || code == 0xFF) {
+            out[code_at] = code;
+            code = 1;
+            code_at = written++;
+        }
+    }
+    out[code_at] = code;
+    return written;
+}
+
+/**
+ * Декодує COBS (без обрамлювальних нулів).
+ *
+ * @return int Довжина декодованих даних або -1, якщо дані пошкоджені.
+ */
+int cobs_decode(const uint8_t *in, int length, uint8_t *out) {
+    int read = 0, written = 0;
+    while (read < length) {
+        uint8_t code = in[read++];
+        if (code == 0 || read + code - 1 > length) return -1;
+        for (int i = 1; i < code; i++) out[written++] = in[read++];
+        if (code < 0xFF && read < length) out[written++] = 0;
+    }
+    return written;
+}
+
+/**
+ * Дописує до пакета з уже заповненим вмістом тип, номер і CRC, кодує й надсилає.
+ */
+static bool frame_finish(frame_type_t type, int bytes) {
+    uint64_t start_time = time_us_64();
+    frame_packet[0] = (uint8_t)type;
+    put_u16(frame_packet + 1, frame_sequence++);
+    int length = 3 + bytes;
+    put_u32(frame_packet + length, crc32_update(0, frame_packet, length));
+    length += 4;
+
+    frame_encoded[0] = 0;
+    int encoded = 1 + cobs_encode(frame_packet, length, frame_encoded + 1);
+    frame_encoded[encoded++] = 0;
+    bool sent = frame_writer && frame_writer(frame_encoded, encoded);
+    if (sent) {
+        frame_counters.frames++;
+        frame_counters.bytes += encoded;
+    } else {
+        frame_counters.dropped++;
+    }
+    frame_counters.busy_us += time_us_64() - start_time;
+    return sent;
+}
+
+/**
+ * Надсилає кадр із довільним вмістом.
+ *
+ * @return bool False, якщо вміст задовгий або кадр не надіслано.
+ */
+bool frame_send(frame_type_t type, const uint8_t *payload, int bytes) {
+    if (bytes < 0 || bytes > FRAME_MAX_PAYLOAD) return false;
+    memcpy(FRAME_PAYLOAD, payload, bytes);
+    return frame_finish(type, bytes);
+}
+
+bool frame_send_info(uint32_t sample_rate, int decimation, int block_size) {
+    uint8_t *out = put_u32(FRAME_PAYLOAD, sample_rate);
+    out = put_u16(out, (uint16_t)decimation);
+    out = put_u16(out, (uint16_t)block_size);
+    *out++ = FRAME_VERSION;
+    return frame_finish(FRAME_INFO, (int)(out - FRAME_PAYLOAD));
+}
+
+/**
+ * Надсилає зразки; довгий діапазон ділиться на кадри по FRAME_MAX_SAMPLES.
+ *
+ * @param first Номер першого зразка від початку запису чи потоку.
+ */
+bool frame_send_samples(uint32_t first, const uint16_t *samples, int count) {
+    bool sent = true;
+    while (count > 0) {
+        int part = count < FRAME_MAX_SAMPLES ? count : FRAME_MAX_SAMPLES;
+        uint8_t *out = put_u32(FRAME_PAYLOAD, first);
+        for (int i = 0; i < part; i++) out = put_u16(out, samples[i]);
+        sent &= frame_finish(FRAME_SAMPLES, (int)(out - FRAME_PAYLOAD));
+        first += part;
+        samples += part;
+        count -= part;
+    }
+    return sent;
+}
+
+bool frame_send_slices(const uint32_t *averages, const uint32_t *maximums, int count, int slice_length) {
+    const int max_count = (FRAME_MAX_PAYLOAD - 6) / 8;
+    if (count > max_count) count = max_count;
+    uint8_t *out = put_u16(FRAME_PAYLOAD, (uint16_t)count);
+    out = put_u32(out, (uint32_t)slice_length);
+    for (int i = 0; i < count; i++) {
+        out = put_u32(out, averages[i]);
+        out = put_u32(out, maximums[i]);
+    }
+    return frame_finish(FRAME_SLICES, (int)(out - FRAME_PAYLOAD));
+}
+
+/**
+ * Надсилає події піків (за потреби кількома кадрами). Нуль подій — один
+ * порожній кадр, щоб приймач знав, що пошук завершено.
+ */
+bool frame_send_peaks(const peak_event_t *events, int count) {
+    const int per_frame = (FRAME_MAX_PAYLOAD - 2) / 14;
+    bool sent = true;
+    do {
+        int part = count < per_frame ? count : per_frame;
+        uint8_t *out = put_u16(FRAME_PAYLOAD, (uint16_t)part);
+        for (int i = 0; i < part; i++) {
+            out = put_u32(out, (uint32_t)events[i].start);
+            out = put_u32(out, (uint32_t)events[i].end);
+            out = put_u16(out, events[i].max);
+            out = put_u32(out, events[i].area);
+        }
+        sent &= frame_finish(FRAME_PEAKS, (int)(out - FRAME_PAYLOAD));
+        events += part;
+        count -= part;
+    } while (count > 0);
+    return sent;
+}
+
+bool frame_send_trace(const trace_record_t *records, int count) {
+    const int per_frame = (FRAME_MAX_PAYLOAD - 2) / 10;
+    bool sent = true;
+    while (count > 0) {
+        int part = count < per_frame ? count : per_frame;
+        uint8_t *out = put_u16(FRAME_PAYLOAD, (uint16_t)part);
+        for (int i = 0; i < part; i++) {
+            *out++ = records[i].stage;
+            *out++ = records[i].core;
+            out = put_u32(out, records[i].start_us);
+            out = put_u32(out, records[i].duration_us);
+        }
+        sent &= frame_finish(FRAME_TRACE, (int)(out - FRAME_PAYLOAD));
+        records += part;
+        count -= part;
+    }
+    return sent;
+}
+
+/**
+ * Надсилає лічильники каналу. Сам цей кадр у них ще не врахований.
+ *
+ * @param overruns Переповнення захоплення за той самий час.
+ */
+bool frame_send_stats(uint32_t overruns) {
+    uint8_t *out = put_u32(FRAME_PAYLOAD, frame_counters.frames);
+    out = put_u32(out, frame_counters.bytes);
+    out = put_u32(out, (uint32_t)frame_counters.busy_us);
+    out = put_u32(out, (uint32_t)(time_us_64() - frame_counters.started_us));
+    out = put_u32(out, frame_counters.dropped);
+    out = put_u32(out, overruns);
+    return frame_finish(FRAME_STATS, (int)(out - FRAME_PAYLOAD));
+}
+
+void frame_reset_stats(void) {
+    memset(&frame_counters, 0, sizeof(frame_counters));
+    frame_counters.started_us = time_us_64();
+}
+
+const frame_stats_t *frame_stats(void) {
+    return &frame_counters;
+}
@@ -0,0 +1,64 @@
+// frame.h
+#ifndef FRAME_H
+#define FRAME_H
+
+#include "pico/stdlib.h"
+#include "peaks.h"
+#include "trace.h"
+
+/**
+ * Двійковий протокол виводу. Кожне повідомлення — пакет
+ * [тип][номер, 2 байти][вміст][CRC-32 типу, номера і вмісту, 4 байти],
+ * закодований COBS і обрамлений нулями з обох боків. Нуль перед пакетом
+ * відокремлює його від тексту printf, що міг надійти раніше тим самим
+ * каналом, тож декодер (tools/frame_decode.py) просто пропускає текст
+ * як пошкоджені кадри. Числа — little-endian. Номер зростає на 1 з кожним
+ * кадром, пропуски в ньому — втрачені кадри.
+ */
+typedef enum {
+    FRAME_INFO = 1,  // u32 частота, u16 децимація, u16 зразків у блоці потоку, u8 версія протоколу
+    FRAME_SAMPLES,   // u32 номер першого зразка, далі u16 зразки
+    FRAME_SLICES,    // u16 кількість, u32 довжина слайсу, далі по u32 середнє, u32 максимум
+    FRAME_PEAKS,     // u16 кількість, далі по u32 початок, u32 кінець, u16 максимум, u32 площа
+    FRAME_TRACE,     // u16 кількість, далі по u8 етап, u8 ядро, u32 початок, u32 тривалість (мкс)
+    FRAME_STATS,     // u32 кадри, u32 байти, u32 зайнято мкс, u32 минуло мкс, u32 втрачено, u32 переповнення
+} frame_type_t;
+
+#define FRAME_VERSION 1
+#define FRAME_MAX_PAYLOAD 1024
+#define FRAME_MAX_PACKET (FRAME_MAX_PAYLOAD + 7) // Тип, номер, CRC
+#define FRAME_MAX_ENCODED (FRAME_MAX_PACKET + FRAME_MAX_PACKET / 254 + 3) // COBS і два нулі
+#define FRAME_MAX_SAMPLES ((FRAME_MAX_PAYLOAD - 4) / 2)
+
+/**
+ * Вивід закодованих кадрів. Повертає false, якщо кадр не надіслано
+ * (наприклад, USB не підключено) — кадр рахується втраченим.
+ */
+typedef bool (*frame_writer_t)(const uint8_t *data, uint32_t bytes);
+
+/**
+ * Лічильники каналу: скільки часу займає кодування й надсилання порівняно
+ * з часом від frame_reset_stats() — запас пропускної здатності.
+ */
+typedef struct frame_stats {
+    uint32_t frames;
+    uint32_t bytes;
+    uint32_t dropped;
+    uint64_t busy_us;
+    uint64_t started_us;
+} frame_stats_t;
+
+void frame_init(frame_writer_t writer);
+int cobs_encode(const uint8_t *in, int length, uint8_t *out);
+int cobs_decode(const uint8_t *in, int length, uint8_t *out);
+bool frame_send(frame_type_t type, const uint8_t *payload, int bytes);
+bool frame_send_info(uint32_t sample_rate, int decimation, int block_size);
+bool frame_send_samples(uint32_t first, const uint16_t *samples, int count);
+bool frame_send_slices(const uint32_t *averages, const uint32_t *maximums, int count, int slice_length);
+bool frame_send_peaks(const peak_event_t *events, int count);
+bool frame_send_trace(const trace_record_t *records, int count);
+bool frame_send_stats(uint32_t overruns);
+void frame_reset_stats(void);
+const frame_stats_t *frame_stats(void);
+
+#endif // FRAME_H
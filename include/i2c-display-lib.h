@@ -3,12 +3,27 @@
 // Original by raspberrypi/pico-examples/i2c/lcd_1602_i2c
 
 #include <stdio.h>
+#include <string.h>
 #include "pico/stdlib.h"
 #include "hardware/i2c.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
 #include "pico/binary_info.h"
 #include "i2c-display-lib.h"
 
 #define I2C_PORT i2c0
+#ifndef LCD_I2C_BAUD
+#define LCD_I2C_BAUD (100 * 1000) // 400 * 1000 — швидкий режим I2C
+#endif
+
+#define LCD_ROWS 2
+#define LCD_COLS 16
+#define LCD_CGRAM_SLOTS 8
+#define LCD_MERGE_GAP 1 // Незмінні клітинки, які дешевше переслати, ніж почати нову транзакцію
+#define LCD_TX_BYTES_PER_CHAR 6 // Дві тетради по три записи PCF8574: дані, E=1, E=0
+#ifndef LCD_I2C_CLEAR
+#define LCD_I2C_CLEAR(hw, reg) ((void)(hw)->reg) // Регістри IC_CLR_* скидають переривання читанням
+#endif
 
 //
 // Variables
@@ -53,6 +68,47 @@ const int LCD_COMMAND = 0;
 
 static int lcd_addr = 0x27;
 
+// Тіньовий буфер: що має бути на екрані, і що на ньому зараз
+static uint8_t lcd_fb[LCD_ROWS][LCD_COLS];
+static uint8_t lcd_panel[LCD_ROWS][LCD_COLS];
+static uint8_t lcd_cursor_line = 0;
+static uint8_t lcd_cursor_pos = 0;
+
+// Тінь CGRAM: задані символи і ті, що завантажені в дисплей
+static uint8_t lcd_cgram[LCD_CGRAM_SLOTS][8];
+static uint8_t lcd_cgram_panel[LCD_CGRAM_SLOTS][8];
+static bool lcd_cgram_defined[LCD_CGRAM_SLOTS];
+static bool lcd_cgram_loaded[LCD_CGRAM_SLOTS];
+
+// Буфер однієї транзакції: команда адреси + до 8 символів CGRAM по 8 байт.
+// Слова у форматі регістра IC_DATA_CMD, DMA пише їх прямо в TX FIFO I2C
+static uint32_t lcd_tx[LCD_TX_BYTES_PER_CHAR * (1 + LCD_CGRAM_SLOTS * 8)];
+static int lcd_tx_len = 0;
+
+// Черга оновлень — це різниця між lcd_fb/lcd_cgram і тим, що вже на панелі.
+// Новий запис у клітинку чи символ, що ще чекає відправки, просто замінює
+// старий, тому черга не переповнюється і обмежена розміром екрана
+static int lcd_dma_channel = -1;
+static volatile bool lcd_tx_busy = false;
+static bool lcd_resync = false; // Перерване передавання могло збити тетради 4-бітного режиму
+static volatile uint32_t lcd_idle_us = 0; // time_us_32() останнього STOP, після якого нічого не лишилося
+
+static uint32_t lcd_i2c_transactions = 0;
+static uint32_t lcd_i2c_bytes = 0;
+static uint32_t lcd_i2c_errors = 0;
+static uint32_t lcd_queue_high_water = 0;  // Найбільше оновлень, що одночасно чекали відправки
+static uint32_t lcd_updates_superseded = 0; // Оновлення, замінені новішими до відправки
+
+// Кеш символів: слоти CGRAM розподіляються за вмістом, однакові бітмапи
+// ділять один слот, тож дисплей показує більше 8 клітинок графіка
+static uint32_t lcd_glyph_hash[LCD_CGRAM_SLOTS];
+static uint32_t lcd_glyph_used[LCD_CGRAM_SLOTS]; // Час останнього використання для LRU
+static uint32_t lcd_glyph_clock = 0;
+static uint32_t lcd_glyph_hits = 0;      // Завантаження, яких вдалося уникнути
+static uint32_t lcd_glyph_uploads = 0;
+static uint32_t lcd_glyph_evictions = 0;
+static uint32_t lcd_glyph_blanks = 0;    // Клітинки, показані порожніми: усі слоти зайняті іншими клітинками
+
 //
 // Functions
 //
@@ -60,6 +116,8 @@ static int lcd_addr = 0x27;
 /* Quick helper function for single byte transfers */
 void i2c_write_byte(uint8_t val) {
     i2c_write_blocking(I2C_PORT, lcd_addr, &val, 1, false);
+    lcd_i2c_transactions++;
+    lcd_i2c_bytes++;
 }
 
 void lcd_setAddr(uint8_t addr)
@@ -99,19 +157,62 @@ void lcd_send_byte(uint8_t val, uint8_t mode, uint8_t backlight) {
     lcd_toggle_enable(low);
 }
 
+//
+// Framebuffer: the functions below only touch the shadow copies,
+// lcd_flush() sends the differences to the panel in the background:
+// each transaction goes to the I2C TX FIFO by DMA and the STOP_DET
+// interrupt starts the next one until the panel matches the shadows
+//
+
+// Appends one nibble (the high four bits of val) with an enable pulse to the transaction
+void lcd_tx_nibble(uint8_t val, uint8_t mode) {
+    uint8_t out = mode | (val & 0xF0) | LCD_BACKLIGHT;
+    lcd_tx[lcd_tx_len++] = out;
+    lcd_tx[lcd_tx_len++] = (uint8_t)(out | LCD_ENABLE_BIT);
+    lcd_tx[lcd_tx_len++] = (uint8_t)(out & ~LCD_ENABLE_BIT);
+}
+
+// Appends one HD44780 byte (two nibbles with an enable pulse each) to the transaction
+void lcd_tx_byte(uint8_t val, uint8_t mode) {
+    lcd_tx_nibble(val, mode);
+    lcd_tx_nibble((uint8_t)(val << 4), mode);
+}
+
+// Starts sending the accumulated bytes as a single I2C transaction and returns
+// at once; STOP goes with the last byte. Each byte on the bus takes longer
+// than the 37 us an HD44780 command needs, so no extra delays
+void lcd_tx_send(void) {
+    if (lcd_tx_len == 0) return;
+    lcd_tx[lcd_tx_len - 1] |= I2C_IC_DATA_CMD_STOP_BITS;
+    lcd_tx_busy = true;
+    dma_channel_set_read_addr(lcd_dma_channel, lcd_tx, false);
+    dma_channel_set_trans_count(lcd_dma_channel, lcd_tx_len, true);
+    lcd_i2c_transactions++;
+    lcd_i2c_bytes += lcd_tx_len;
+    lcd_tx_len = 0;
+}
+
 void lcd_clear(void) {
-    lcd_send_byte(LCD_CLEARDISPLAY, LCD_COMMAND, 1);
+    memset(lcd_fb, ' ', sizeof(lcd_fb));
+    lcd_cursor_line = 0;
+    lcd_cursor_pos = 0;
 }
 
 // go to location on LCD
 void lcd_setCursor(uint8_t line, uint8_t position) {
-    uint8_t line_offsets[] = { 0x00, 0x40, 0x14, 0x54 };
-    uint8_t val = 0x80 + line_offsets[line] + position;
-    lcd_send_byte(val, LCD_COMMAND, 1);
+    lcd_cursor_line = line;
+    lcd_cursor_pos = position;
 }
 
 void lcd_write(char val) {
-    lcd_send_byte(val, LCD_CHARACTER, 1);
+    if (lcd_cursor_line < LCD_ROWS && lcd_cursor_pos < LCD_COLS) {
+        uint8_t *cell = &lcd_fb[lcd_cursor_line][lcd_cursor_pos];
+        if (*cell != (uint8_t)val && *cell != lcd_panel[lcd_cursor_line][lcd_cursor_pos]) {
+            lcd_updates_superseded++;
+        }
+        *cell = (uint8_t)val;
+    }
+    lcd_cursor_pos++;
 }
 
 void lcd_print(const char *s) {
@@ -120,18 +221,226 @@ void lcd_print(const char *s) {
     }
 }
 
+static bool lcd_cgram_dirty(int slot) {
+    return lcd_cgram_defined[slot] &&
+           (!lcd_cgram_loaded[slot] || memcmp(lcd_cgram[slot], lcd_cgram_panel[slot], 8) != 0);
+}
+
+static uint32_t lcd_glyph_hash_of(const uint8_t bitmap[8]) {
+    uint32_t hash = 2166136261u; // FNV-1a
+    for (int i = 0; i < 8; i++) hash = (hash ^ bitmap[i]) * 16777619u;
+    return hash;
+}
+
 void lcd_createChar(uint8_t location, uint8_t charmap[]) {
     location &= 0x7; // we only have 8 locations 0-7
-    lcd_send_byte(LCD_SETCGRAMADDR | (location << 3), LCD_COMMAND, 1);
-    for (int i=0; i<8; i++) {
-        lcd_send_byte(charmap[i], 1, 0);
+    if (lcd_cgram_dirty(location) && memcmp(lcd_cgram[location], charmap, 8) != 0) {
+        lcd_updates_superseded++;
+    }
+    memcpy(lcd_cgram[location], charmap, 8);
+    lcd_cgram_defined[location] = true;
+    lcd_glyph_hash[location] = lcd_glyph_hash_of(charmap);
+    lcd_glyph_used[location] = ++lcd_glyph_clock;
+}
+
+// Bit mask of the CGRAM slots the cells refer to, except the cursor cell
+static uint8_t lcd_glyph_refs(uint8_t cells[LCD_ROWS][LCD_COLS]) {
+    uint8_t refs = 0;
+    for (int line = 0; line < LCD_ROWS; line++) {
+        for (int col = 0; col < LCD_COLS; col++) {
+            if (line == lcd_cursor_line && col == lcd_cursor_pos) continue;
+            if (cells[line][col] < LCD_CGRAM_SLOTS) refs |= 1 << cells[line][col];
+        }
     }
+    return refs;
+}
+
+// Returns the character code that shows the bitmap in the cursor cell: a space
+// for an empty bitmap, a slot that already holds it, or a slot the glyph is
+// uploaded to. Free slots go first, then the least recently used one that no
+// other cell shows, neither in the framebuffer nor on the panel yet. When every
+// slot is still shown by another framebuffer cell (more than 8 distinct glyphs
+// on screen), the cell is left blank instead of changing those cells
+static uint8_t lcd_glyph(const uint8_t bitmap[8]) {
+    static const uint8_t empty[8] = { 0 };
+    if (memcmp(bitmap, empty, 8) == 0) {
+        lcd_glyph_hits++;
+        return ' ';
+    }
+
+    uint32_t hash = lcd_glyph_hash_of(bitmap);
+    for (int slot = 0; slot < LCD_CGRAM_SLOTS; slot++) {
+        if (lcd_cgram_defined[slot] && lcd_glyph_hash[slot] == hash &&
+            memcmp(lcd_cgram[slot], bitmap, 8) == 0) {
+            lcd_glyph_used[slot] = ++lcd_glyph_clock;
+            lcd_glyph_hits++;
+            return (uint8_t)slot;
+        }
+    }
+
+    uint8_t in_fb = lcd_glyph_refs(lcd_fb);
+    uint8_t in_panel = lcd_glyph_refs(lcd_panel);
+    int victim = -1, victim_rank = 0;
+    for (int slot = 0; slot < LCD_CGRAM_SLOTS; slot++) {
+        if (!lcd_cgram_defined[slot]) {
+            victim = slot;
+            break;
+        }
+        int rank = ((in_fb >> slot) & 1) * 2 + ((in_panel >> slot) & 1);
+        if (victim < 0 || rank < victim_rank ||
+            (rank == victim_rank && lcd_glyph_used[slot] < lcd_glyph_used[victim])) {
+            victim = slot;
+            victim_rank = rank;
+        }
+    }
+    if (victim_rank >= 2) {
+        lcd_glyph_blanks++;
+        return ' ';
+    }
+    if (lcd_cgram_defined[victim]) lcd_glyph_evictions++;
+    lcd_glyph_uploads++;
+    lcd_createChar((uint8_t)victim, (uint8_t *)bitmap);
+    return (uint8_t)victim;
+}
+
+// Writes a bitmap to the cursor cell through the glyph cache
+void lcd_write_glyph(const uint8_t bitmap[8]) {
+    lcd_write((char)lcd_glyph(bitmap));
+}
+
+// Builds one transaction with the first run of changed CGRAM glyphs;
+// consecutive changed slots share it
+static bool lcd_next_cgram(void) {
+    int slot = 0;
+    while (slot < LCD_CGRAM_SLOTS && !lcd_cgram_dirty(slot)) slot++;
+    if (slot == LCD_CGRAM_SLOTS) return false;
+
+    lcd_tx_byte(LCD_SETCGRAMADDR | (slot << 3), LCD_COMMAND);
+    for (; slot < LCD_CGRAM_SLOTS && lcd_cgram_dirty(slot); slot++) {
+        // The panel copy records exactly what is sent, so a glyph changed
+        // while it is being copied gets resent by the next diff
+        memcpy(lcd_cgram_panel[slot], lcd_cgram[slot], 8);
+        lcd_cgram_loaded[slot] = true;
+        for (int i = 0; i < 8; i++) lcd_tx_byte(lcd_cgram_panel[slot][i], LCD_CHARACTER);
+    }
+    return true;
+}
+
+// Builds one transaction with the first changed run of a row; runs separated
+// by at most LCD_MERGE_GAP unchanged cells are merged
+static bool lcd_next_row(int line) {
+    static const uint8_t line_offsets[] = { 0x00, 0x40 };
+    int col = 0;
+    while (col < LCD_COLS && lcd_fb[line][col] == lcd_panel[line][col]) col++;
+    if (col == LCD_COLS) return false;
+
+    int end = col + 1;
+    for (int j = end; j < LCD_COLS; j++) {
+        if (lcd_fb[line][j] != lcd_panel[line][j]) end = j + 1;
+        else if (j - end >= LCD_MERGE_GAP) break;
+    }
+    lcd_tx_byte(LCD_SETDDRAMADDR + line_offsets[line] + col, LCD_COMMAND);
+    for (; col < end; col++) {
+        lcd_panel[line][col] = lcd_fb[line][col];
+        lcd_tx_byte(lcd_panel[line][col], LCD_CHARACTER);
+    }
+    return true;
+}
+
+// An aborted transaction may stop between the two nibbles of a byte. Three
+// 8-bit function sets and a 4-bit one bring the panel back in step from
+// either half, as at power-on; a stray byte they may complete first is
+// at worst a cursor move or a line mode, and the last command sets that
+static bool lcd_next_resync(void) {
+    if (!lcd_resync) return false;
+    lcd_resync = false;
+    for (int i = 0; i < 3; i++) lcd_tx_nibble(LCD_FUNCTIONSET | LCD_8BITMODE, LCD_COMMAND);
+    lcd_tx_nibble(LCD_FUNCTIONSET, LCD_COMMAND);
+    lcd_tx_byte(LCD_FUNCTIONSET | LCD_2LINE, LCD_COMMAND);
+    return true;
+}
+
+// Starts the next pending transaction. Returns false when the panel is up to date
+static bool lcd_send_next(void) {
+    bool pending = lcd_next_resync();
+    if (!pending) pending = lcd_next_cgram();
+    for (int line = 0; !pending && line < LCD_ROWS; line++) pending = lcd_next_row(line);
+    if (pending) lcd_tx_send();
+    return pending;
+}
+
+// The transaction has ended on the bus (STOP), not just left the TX FIFO, so
+// an abort is known before the next transaction is queued. After an abort
+// the controller flushes the FIFO and drops writes until TX_ABRT is cleared:
+// the DMA channel is stopped first so that the rest of the transaction does
+// not go out as a new one
+static void lcd_i2c_irq_handler(void) {
+    i2c_hw_t *hw = i2c_get_hw(I2C_PORT);
+    uint32_t status = hw->raw_intr_stat;
+    if (!(status & (I2C_IC_RAW_INTR_STAT_STOP_DET_BITS | I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS))) return;
+    LCD_I2C_CLEAR(hw, clr_stop_det);
+
+    if (status & I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS) {
+        // NACK or lost arbitration: the panel state is unknown, redraw everything
+        dma_channel_abort(lcd_dma_channel);
+        LCD_I2C_CLEAR(hw, clr_tx_abrt);
+        lcd_i2c_errors++;
+        lcd_resync = true;
+        memset(lcd_panel, 0xFF, sizeof(lcd_panel));
+        memset(lcd_cgram_loaded, 0, sizeof(lcd_cgram_loaded));
+    }
+    lcd_tx_busy = lcd_send_next();
+    if (!lcd_tx_busy) lcd_idle_us = time_us_32();
+}
+
+static uint32_t lcd_pending_updates(void) {
+    uint32_t pending = 0;
+    for (int slot = 0; slot < LCD_CGRAM_SLOTS; slot++) pending += lcd_cgram_dirty(slot);
+    for (int line = 0; line < LCD_ROWS; line++) {
+        for (int col = 0; col < LCD_COLS; col++) pending += lcd_fb[line][col] != lcd_panel[line][col];
+    }
+    return pending;
+}
+
+// Starts bringing the panel in line with the shadow buffers and returns at
+// once; the rest is sent from the I2C interrupt. Does nothing while a
+// transfer is in flight: the interrupt picks up the newer changes itself.
+// Returns the number of cells and glyphs waiting to be sent
+int lcd_flush(void) {
+    uint32_t pending = lcd_pending_updates();
+    if (pending > lcd_queue_high_water) lcd_queue_high_water = pending;
+    if (pending == 0 || lcd_tx_busy) return (int)pending;
+
+    irq_set_enabled(I2C0_IRQ, false);
+    if (!lcd_tx_busy) lcd_tx_busy = lcd_send_next();
+    irq_set_enabled(I2C0_IRQ, true);
+    return (int)pending;
+}
+
+// True while transactions are still being sent to the panel
+bool lcd_busy(void) {
+    return lcd_tx_busy;
+}
+
+// When the last transfer ended on the bus, in time_us_32() units
+uint32_t lcd_idle_time_us(void) {
+    return lcd_idle_us;
+}
+
+void lcd_print_stats(void) {
+    printf("LCD I2C: %u transactions, %u bytes, %u errors\n",
+           (unsigned)lcd_i2c_transactions, (unsigned)lcd_i2c_bytes, (unsigned)lcd_i2c_errors);
+    printf("LCD queue: high water %u, superseded %u\n",
+           (unsigned)lcd_queue_high_water, (unsigned)lcd_updates_superseded);
+    printf("LCD glyphs: %u uploads, %u reused, %u evicted, %u blank\n",
+           (unsigned)lcd_glyph_uploads, (unsigned)lcd_glyph_hits, (unsigned)lcd_glyph_evictions,
+           (unsigned)lcd_glyph_blanks);
 }
 
 void lcd_home() {lcd_setCursor(0,0);}
 
 void lcd_init(uint8_t sda, uint8_t scl) {
-    i2c_init(I2C_PORT, 100 * 1000);
+    i2c_init(I2C_PORT, LCD_I2C_BAUD);
     gpio_set_function(sda, GPIO_FUNC_I2C);
     gpio_set_function(scl, GPIO_FUNC_I2C);
     gpio_pull_up(sda);
@@ -148,7 +457,33 @@ void lcd_init(uint8_t sda, uint8_t scl) {
     lcd_send_byte(LCD_ENTRYMODESET | LCD_ENTRYLEFT, LCD_COMMAND, 1);
     lcd_send_byte(LCD_FUNCTIONSET | LCD_2LINE, LCD_COMMAND, 1);
     lcd_send_byte(LCD_DISPLAYCONTROL | LCD_DISPLAYON, LCD_COMMAND, 1);
+    lcd_send_byte(LCD_CLEARDISPLAY, LCD_COMMAND, 1);
+    sleep_ms(2); // Очищення дисплея триває до 1.52 мс
+
     lcd_clear();
+    memset(lcd_panel, ' ', sizeof(lcd_panel));
+
+    // From here on the panel is written only by DMA: 32-bit IC_DATA_CMD words
+    // paced by the I2C TX DREQ
+    i2c_get_hw(I2C_PORT)->enable = 0;
+    i2c_get_hw(I2C_PORT)->tar = lcd_addr;
+    i2c_get_hw(I2C_PORT)->enable = 1;
+
+    lcd_dma_channel = dma_claim_unused_channel(true);
+    dma_channel_config config = dma_channel_get_default_config(lcd_dma_channel);
+    channel_config_set_transfer_data_size(&config, DMA_SIZE_32);
+    channel_config_set_read_increment(&config, true);
+    channel_config_set_write_increment(&config, false);
+    channel_config_set_dreq(&config, i2c_get_dreq(I2C_PORT, true));
+    dma_channel_configure(lcd_dma_channel, &config, &i2c_get_hw(I2C_PORT)->data_cmd,
+                          lcd_tx, 0, false);
+
+    i2c_hw_t *hw = i2c_get_hw(I2C_PORT);
+    LCD_I2C_CLEAR(hw, clr_stop_det);
+    LCD_I2C_CLEAR(hw, clr_tx_abrt);
+    hw->intr_mask = I2C_IC_INTR_MASK_M_STOP_DET_BITS | I2C_IC_INTR_MASK_M_TX_ABRT_BITS;
+    irq_set_exclusive_handler(I2C0_IRQ, lcd_i2c_irq_handler);
+    irq_set_enabled(I2C0_IRQ, true);
 }
 
 #endif
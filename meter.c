@@ -0,0 +1,251 @@
+#include <math.h>
+#include "meter.h"
+
+/*
+ * Вимірювач рівня звуку. Середнє й максимум кодів АЦП залежать від
+ * підсилення і рівня тиші, тож прилади між собою не порівняти; рівень у
+ * dBFS (і в дБ після калібрування) — порівнюється. Зразок спершу
+ * звільняється від постійної складової (зміщення мікрофонного
+ * підсилювача), потім за потреби проходить A-зважування — три ланки
+ * другого порядку, отримані білінійним перетворенням аналогового
+ * прототипу IEC 61672 і нормовані на 0 дБ на 1 кГц. Квадрат сигналу
+ * сумується для слайсу і згладжується сталими FAST і SLOW; децибели
+ * рахуються лише на межі слайсу, через цілий log2.
+ */
+
+#define DC_FRACTION_BITS 16       // Дробові біти постійної складової
+#define FILTER_FRACTION_BITS 12   // Дробові біти сигналу у фільтрі
+#define LEVEL_FRACTION_BITS 4     // Дробові біти сигналу, що підноситься до квадрата
+#define MEAN_FRACTION_BITS 16     // Дробові біти експоненційних середніх
+#define COEFFICIENT_BITS 28       // Коефіцієнти ланок, Q28
+
+#define LEVEL_MAX 65535           // Модуль сигналу, квадрат якого ще вміщується в 32 біти
+#define FULL_SCALE_LOG2 29        // log2 квадрата синуса на весь діапазон: (2048 << 4)^2 / 2
+#define PEAK_LOG2 30              // log2 квадрата його амплітуди
+#define DB10_PER_LOG2_Q32 1972830 // 100·log10(2) / 2^16, Q32: з log2 у Q16 у десяті дБ
+
+// Полюси аналогового A-фільтра (IEC 61672-1), Гц
+static const double a_weighting_poles_hz[4] = { 20.598997, 107.65265, 737.86223, 12194.217 };
+
+static const char *const weighting_names[METER_WEIGHTINGS] = { "Z", "A" };
+
+/**
+ * Стала часу в зразках як степінь двійки, найближча до заданої. Частоти
+ * аналізу — 1000·2^k, тож для сталих у мс похибка не більша за 2.4%.
+ */
+static int time_shift(uint32_t sample_rate, uint32_t time_ms) {
+    uint32_t samples = sample_rate * time_ms / 1000;
+    int shift = 0;
+    while (shift < 20 && (3u << shift) < 2 * samples) shift++;
+    return shift;
+}
+
+static int32_t to_q28(double value) {
+    return (int32_t)lround(value * (1 << COEFFICIENT_BITS));
+}
+
+/**
+ * Ланка з білінійного перетворення s = c·(1 - z^-1)/(1 + z^-1) для
+ * чисельника scale·(1 + zero·z^-1 + z^-2) і полюсів на кутових частотах
+ * w1 і w2; знаменник нормується до a0 = 1.
+ */
+static void design_section(meter_biquad_t *section, double c, double w1, double w2,
+                           double scale, int zero) {
+    double a0 = (c + w1) * (c + w2);
+    double a1 = -(c + w1) * (c - w2) - (c - w1) * (c + w2);
+    double a2 = (c - w1) * (c - w2);
+    section->gain = to_q28(scale / a0);
+    section->a1 = to_q28(a1 / a0);
+    section->a2 = to_q28(a2 / a0);
+    section->zero = zero;
+}
+
+/**
+ * Модуль передавальної функції ланки на частоті omega (рад/зразок).
+ */
+static double section_response(const meter_biquad_t *section, double omega) {
+    double one = 1 << COEFFICIENT_BITS;
+    double gain = section->gain / one, a1 = section->a1 / one, a2 = section->a2 / one;
+    double num_re = gain * (1 + section->zero * cos(omega) + cos(2 * omega));
+    double num_im = -gain * (section->zero * sin(omega) + sin(2 * omega));
+    double den_re = 1 + a1 * cos(omega) + a2 * cos(2 * omega);
+    double den_im = -(a1 * sin(omega) + a2 * sin(2 * omega));
+    return sqrt((num_re * num_re + num_im * num_im) / (den_re * den_re + den_im * den_im));
+}
+
+/**
+ * Три ланки A-зважування: подвійний ФВЧ на 20.6 Гц, ФВЧ на 107.7 і
+ * 737.9 Гц, подвійний ФНЧ на 12.2 кГц. Посилення останньої ланки
+ * підбирається так, щоб на 1 кГц було 0 дБ після квантування коефіцієнтів.
+ */
+static void design_a_weighting(meter_t *meter, uint32_t sample_rate) {
+    double c = 2.0 * sample_rate;
+    double w[4];
+    for (int i = 0; i < 4; i++) w[i] = 2.0 * M_PI * a_weighting_poles_hz[i];
+    design_section(&meter->sections[0], c, w[0], w[0], c * c, -2);
+    design_section(&meter->sections[1], c, w[1], w[2], c * c, -2);
+    design_section(&meter->sections[2], c, w[3], w[3], w[3] * w[3], 2);
+
+    double omega = 2.0 * M_PI * 1000 / sample_rate;
+    double response = 1.0;
+    for (int i = 0; i < METER_SECTIONS; i++) response *= section_response(&meter->sections[i], omega);
+    meter->sections[2].gain = to_q28(meter->sections[2].gain / (double)(1 << COEFFICIENT_BITS) / response);
+}
+
+/**
+ * Налаштовує вимірювач на частоту аналізу. A-зважування вмикається лише
+ * від METER_A_WEIGHTING_MIN_HZ; викликати, коли вимірювач не працює (між
+ * записами), далі — meter_reset() перед кожним записом. Коефіцієнти
+ * фільтра залежать від частоти аналізу, тож рахуються тут у double
+ * (програмна плаваюча крапка на RP2040) — лише під час налаштування;
+ * meter_feed() і meter_end_slice() цілочисельні.
+ *
+ * @param meter Стан вимірювача.
+ * @param sample_rate Частота аналізу, Гц.
+ * @param weighting Бажане зважування (meter_weighting_t).
+ */
+void meter_init(meter_t *meter, uint32_t sample_rate, meter_weighting_t weighting) {
+    if (sample_rate < METER_A_WEIGHTING_MIN_HZ) weighting = METER_Z_WEIGHTING;
+    meter->weighting = weighting;
+    meter->dc_shift = time_shift(sample_rate, METER_DC_MS);
+    meter->fast_shift = time_shift(sample_rate, METER_FAST_MS);
+    meter->slow_shift = time_shift(sample_rate, METER_SLOW_MS);
+    if (weighting == METER_A_WEIGHTING) design_a_weighting(meter, sample_rate);
+    meter_reset(meter, 0);
+}
+
+/**
+ * Готує вимірювач до нового запису.
+ *
+ * @param dc_level Початкова постійна складова в кодах АЦП (рівень тиші),
+ *        щоб перший слайс не міряв перехідний процес фільтра.
+ */
+void meter_reset(meter_t *meter, uint16_t dc_level) {
+    meter->dc = (int32_t)dc_level << DC_FRACTION_BITS;
+    for (int i = 0; i < METER_SECTIONS; i++) {
+        meter_biquad_t *section = &meter->sections[i];
+        section->x1 = section->x2 = section->y1 = section->y2 = section->error = 0;
+    }
+    meter->fast = meter->slow = meter->hold = 0;
+    meter->total_energy = meter->total_count = 0;
+    meter->energy = 0;
+    meter->count = 0;
+    meter->fast_max = 0;
+    meter->peak = 0;
+}
+
+static inline int32_t biquad_step(meter_biquad_t *section, int32_t x) {
+    int64_t acc = (int64_t)section->gain * (x + section->zero * section->x1 + section->x2)
+                - (int64_t)section->a1 * section->y1 - (int64_t)section->a2 * section->y2
+                + section->error;
+    int32_t y = (int32_t)(acc >> COEFFICIENT_BITS);
+    section->error = (int32_t)(acc - ((int64_t)y << COEFFICIENT_BITS));
+    section->x2 = section->x1;
+    section->x1 = x;
+    section->y2 = section->y1;
+    section->y1 = y;
+    return y;
+}
+
+/**
+ * Обробляє наступні зразки запису (по порядку, без пропусків).
+ */
+void meter_feed(meter_t *meter, const uint16_t *samples, int count) {
+    int32_t dc = meter->dc;
+    int dc_shift = meter->dc_shift, fast_shift = meter->fast_shift, slow_shift = meter->slow_shift;
+    int sections = meter->weighting == METER_A_WEIGHTING ? METER_SECTIONS : 0;
+    int64_t fast = meter->fast, slow = meter->slow, fast_max = meter->fast_max;
+    uint64_t energy = 0;
+    uint32_t peak = meter->peak;
+
+    for (int i = 0; i < count; i++) {
+        int32_t value = ((int32_t)samples[i] << DC_FRACTION_BITS) - dc;
+        dc += value >> dc_shift;
+        value >>= DC_FRACTION_BITS - FILTER_FRACTION_BITS;
+        for (int s = 0; s < sections; s++) value = biquad_step(&meter->sections[s], value);
+        value >>= FILTER_FRACTION_BITS - LEVEL_FRACTION_BITS;
+
+        uint32_t magnitude = (uint32_t)(value < 0 ? -value : value);
+        if (magnitude > LEVEL_MAX) magnitude = LEVEL_MAX;
+        uint32_t square = magnitude * magnitude;
+        energy += square;
+        if (magnitude > peak) peak = magnitude;
+        int64_t mean = (int64_t)square << MEAN_FRACTION_BITS;
+        fast += (mean - fast) >> fast_shift;
+        slow += (mean - slow) >> slow_shift;
+        if (fast > fast_max) fast_max = fast;
+    }
+
+    meter->dc = dc;
+    meter->fast = fast;
+    meter->slow = slow;
+    meter->fast_max = fast_max;
+    meter->peak = peak;
+    meter->energy += energy;
+    meter->count += count;
+    meter->total_energy += energy;
+    meter->total_count += count;
+}
+
+/**
+ * log2(value) у Q16 (value > 0): ціла частина — номер старшого біта,
+ * дробова — 16 послідовних піднесень мантиси до квадрата.
+ */
+static int32_t log2_q16(uint64_t value) {
+    int exponent = 63 - __builtin_clzll(value);
+    uint64_t mantissa = exponent >= 31 ? value >> (exponent - 31) : value << (31 - exponent);
+    int32_t result = exponent << 16;
+    for (int bit = 15; bit >= 0; bit--) {
+        mantissa = (mantissa * mantissa) >> 31;
+        if (mantissa >= (1ull << 32)) {
+            mantissa >>= 1;
+            result |= 1 << bit;
+        }
+    }
+    return result;
+}
+
+/**
+ * Десяті дБ для відношення sum / 2^(fraction_bits) / count до 2^reference_log2.
+ */
+static int16_t ratio_db10(uint64_t sum, int fraction_bits, uint64_t count, int reference_log2) {
+    if (sum == 0 || count == 0) return METER_SILENCE_DB10;
+    int32_t ratio_log2 = log2_q16(sum) - log2_q16(count) - ((fraction_bits + reference_log2) << 16);
+    int32_t db10 = (int32_t)(((int64_t)ratio_log2 * DB10_PER_LOG2_Q32 + (1ll << 31)) >> 32);
+    return db10 < METER_SILENCE_DB10 ? METER_SILENCE_DB10 : (int16_t)db10;
+}
+
+/**
+ * Закриває слайс: записує його рівні й починає наступний. FAST і SLOW
+ * продовжуються через межу слайсу.
+ */
+void meter_end_slice(meter_t *meter, meter_reading_t *reading) {
+    reading->rms_db10 = ratio_db10(meter->energy, 0, meter->count, FULL_SCALE_LOG2);
+    reading->fast_db10 = ratio_db10((uint64_t)meter->fast_max, MEAN_FRACTION_BITS, 1, FULL_SCALE_LOG2);
+    reading->slow_db10 = ratio_db10((uint64_t)meter->slow, MEAN_FRACTION_BITS, 1, FULL_SCALE_LOG2);
+    reading->peak_db10 = ratio_db10((uint64_t)meter->peak * meter->peak, 0, 1, PEAK_LOG2);
+    if (meter->fast_max > meter->hold) meter->hold = meter->fast_max;
+    meter->energy = 0;
+    meter->count = 0;
+    meter->fast_max = meter->fast;
+    meter->peak = 0;
+}
+
+/**
+ * Середньоквадратичний рівень усього, що оброблено від meter_reset, dBFS·10.
+ */
+int16_t meter_leq_db10(const meter_t *meter) {
+    return ratio_db10(meter->total_energy, 0, meter->total_count, FULL_SCALE_LOG2);
+}
+
+/**
+ * Утримання піку: найбільший рівень FAST від meter_reset, dBFS·10.
+ */
+int16_t meter_hold_db10(const meter_t *meter) {
+    int64_t hold = meter->fast_max > meter->hold ? meter->fast_max : meter->hold;
+    return ratio_db10((uint64_t)hold, MEAN_FRACTION_BITS, 1, FULL_SCALE_LOG2);
+}
+
+const char *meter_weighting_name(uint8_t weighting) {
+    return weighting < METER_WEIGHTINGS ? weighting_names[weighting] : "?";
+}
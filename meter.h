@@ -0,0 +1,78 @@
+// meter.h
+#ifndef METER_H
+#define METER_H
+
+#include "pico/stdlib.h"
+
+#define METER_FAST_MS 125          // Стала часу FAST, як у шумоміра
+#define METER_SLOW_MS 1000         // Стала часу SLOW
+#define METER_DC_MS 100            // Стала часу оцінки постійної складової (зріз близько 1.6 Гц)
+#define METER_A_WEIGHTING_MIN_HZ 4000 // Нижче цієї частоти 1 кГц надто близько до Найквіста: без зважування
+#define METER_SECTIONS 3           // Ланок фільтра A-зважування
+#define METER_SILENCE_DB10 (-1000) // Рівень нульового сигналу, десяті дБ
+
+typedef enum {
+    METER_Z_WEIGHTING,  // Без частотного зважування
+    METER_A_WEIGHTING,  // A-зважування (IEC 61672)
+    METER_WEIGHTINGS
+} meter_weighting_t;
+
+/**
+ * Ланка БІХ-фільтра другого порядку з нулями в z = ±1 (пряма форма I):
+ * y = gain·(x + zero·x1 + x2) - a1·y1 - a2·y2, коефіцієнти Q28. Відкинуті
+ * дробові біти додаються до наступного зразка, тож помилка округлення не
+ * підсилюється полюсами поблизу z = 1.
+ */
+typedef struct meter_biquad {
+    int32_t gain;
+    int32_t a1;
+    int32_t a2;
+    int32_t zero;      // -2 — подвійний нуль у z = 1 (ФВЧ), 2 — у z = -1 (ФНЧ)
+    int32_t x1, x2;
+    int32_t y1, y2;
+    int32_t error;     // Відкинуті дробові біти попереднього виходу
+} meter_biquad_t;
+
+/**
+ * Рівні одного слайсу в десятих dBFS; 0 dBFS — синус на весь діапазон АЦП.
+ */
+typedef struct meter_reading {
+    int16_t rms_db10;   // Середньоквадратичний рівень слайсу (Leq)
+    int16_t fast_db10;  // Найбільший рівень FAST у слайсі
+    int16_t slow_db10;  // Рівень SLOW у кінці слайсу
+    int16_t peak_db10;  // Найбільший модуль зразка (0 dBFS — амплітуда синуса на весь діапазон)
+} meter_reading_t;
+
+/**
+ * Потоковий вимірювач рівня. Зразок проходить через фільтр постійної
+ * складової і (необов'язково) A-зважування, його квадрат накопичується для
+ * слайсу і двох експоненційних середніх. Усе — цілі числа: коди АЦП з
+ * чотирма дробовими бітами, квадрати — 32 біти, середні — 64.
+ */
+typedef struct meter {
+    uint8_t weighting;        // Фактичне зважування (meter_weighting_t)
+    int dc_shift;             // Сталі часу: 2^shift зразків
+    int fast_shift;
+    int slow_shift;
+    int32_t dc;               // Постійна складова, 16 дробових бітів
+    meter_biquad_t sections[METER_SECTIONS];
+    int64_t fast;             // Експоненційні середні квадрата, 16 дробових бітів
+    int64_t slow;
+    int64_t hold;             // Найбільший FAST від meter_reset (утримання піку)
+    uint64_t total_energy;    // Сума квадратів і кількість зразків від meter_reset
+    uint64_t total_count;
+    uint64_t energy;          // Те саме для поточного слайсу
+    uint32_t count;
+    int64_t fast_max;
+    uint32_t peak;
+} meter_t;
+
+void meter_init(meter_t *meter, uint32_t sample_rate, meter_weighting_t weighting);
+void meter_reset(meter_t *meter, uint16_t dc_level);
+void meter_feed(meter_t *meter, const uint16_t *samples, int count);
+void meter_end_slice(meter_t *meter, meter_reading_t *reading);
+int16_t meter_leq_db10(const meter_t *meter);
+int16_t meter_hold_db10(const meter_t *meter);
+const char *meter_weighting_name(uint8_t weighting);
+
+#endif // METER_H
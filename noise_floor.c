@@ -0,0 +1,83 @@
+#include "noise_floor.h"
+
+/*
+ * Відстеження рівня тиші. Зміщення мікрофонного підсилювача повільно
+ * пливе з температурою і живленням, тому фіксований поріг шуму або
+ * відрізає корисний сигнал, або пропускає шум. Звук має нульове середнє,
+ * тож повільне експоненційне середнє зразків дає саме зміщення. Розмах
+ * шуму — середнє модуля відхилення від рівня, але лише за зразками в
+ * межах NOISE_FLOOR_WINDOW поточних відхилень: гучні ділянки його майже
+ * не піднімають. Зразки поза вікном лише повільно підтягують оцінку
+ * вгору, щоб вона могла вирости, якщо шуму стало більше.
+ */
+
+#define ONE (1 << NOISE_FLOOR_FRACTION_BITS)
+
+/**
+ * Готує оцінювач із початковими значеннями.
+ *
+ * @param floor Стан оцінювача.
+ * @param level Початковий рівень тиші в кодах АЦП.
+ * @param deviation Початкове відхилення шуму в кодах АЦП (не нуль, інакше вікно порожнє).
+ * @param time_constant Стала часу в зразках.
+ */
+void noise_floor_init(noise_floor_t *floor, uint16_t level, uint16_t deviation, uint32_t time_constant) {
+    floor->level = (int32_t)level << NOISE_FLOOR_FRACTION_BITS;
+    floor->deviation = (int32_t)deviation << NOISE_FLOOR_FRACTION_BITS;
+    noise_floor_set_time_constant(floor, time_constant);
+}
+
+/**
+ * Задає сталу часу, округлену вниз до степеня двійки (не менше 2 зразків).
+ * Накопичену оцінку не змінює, тому викликається і при зміні частоти запису.
+ */
+void noise_floor_set_time_constant(noise_floor_t *floor, uint32_t time_constant) {
+    int shift = 1;
+    while (shift < 15 && (2u << shift) <= time_constant) shift++;
+    floor->shift = shift;
+}
+
+/**
+ * Оновлює оцінку новими зразками.
+ */
+void noise_floor_feed(noise_floor_t *floor, const uint16_t *samples, int count) {
+    int32_t level = floor->level;
+    int32_t deviation = floor->deviation;
+    int shift = floor->shift;
+    for (int i = 0; i < count; i++) {
+        int32_t value = (int32_t)samples[i] << NOISE_FLOOR_FRACTION_BITS;
+        int32_t distance = value - level;
+        level += distance >> shift;
+        if (distance < 0) distance = -distance;
+        if (distance <= NOISE_FLOOR_WINDOW * deviation) deviation += (distance - deviation) >> shift;
+        else deviation += (distance - deviation) >> (shift + NOISE_FLOOR_RISE_SHIFT);
+    }
+    floor->level = level;
+    floor->deviation = deviation;
+}
+
+/**
+ * Рівень тиші в кодах АЦП (з округленням).
+ */
+uint16_t noise_floor_level(const noise_floor_t *floor) {
+    return (uint16_t)((floor->level + ONE / 2) >> NOISE_FLOOR_FRACTION_BITS);
+}
+
+uint16_t noise_floor_deviation(const noise_floor_t *floor) {
+    return (uint16_t)((floor->deviation + ONE / 2) >> NOISE_FLOOR_FRACTION_BITS);
+}
+
+/**
+ * Поріг, нижче якого зразок вважається шумом: рівень тиші плюс
+ * NOISE_FLOOR_GATE_FACTOR відхилень, але не менше min_margin.
+ *
+ * @param floor Стан оцінювача.
+ * @param min_margin Найменший відступ від рівня тиші в кодах АЦП.
+ * @return uint16_t Поріг у кодах АЦП.
+ */
+uint16_t noise_floor_gate(const noise_floor_t *floor, uint16_t min_margin) {
+    uint32_t margin = (uint32_t)noise_floor_deviation(floor) * NOISE_FLOOR_GATE_FACTOR;
+    if (margin < min_margin) margin = min_margin;
+    uint32_t gate = noise_floor_level(floor) + margin;
+    return (uint16_t)(gate > 4095 ? 4095 : gate);
+}
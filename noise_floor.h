@@ -0,0 +1,30 @@
+// noise_floor.h
+#ifndef NOISE_FLOOR_H
+#define NOISE_FLOOR_H
+
+#include "pico/stdlib.h"
+
+#define NOISE_FLOOR_FRACTION_BITS 16 // Дробові біти рівнів: менше коду АЦП навіть при сталій 2^15 зразків
+#define NOISE_FLOOR_WINDOW 4         // Зразки далі за стільки відхилень вважаються сигналом
+#define NOISE_FLOOR_RISE_SHIFT 6     // Сигнал піднімає оцінку шуму в 64 рази повільніше
+#define NOISE_FLOOR_GATE_FACTOR 4    // Поріг шуму — рівень плюс стільки відхилень
+
+/**
+ * Оцінка рівня тиші (зміщення мікрофонного підсилювача) і розмаху шуму
+ * навколо нього. Обидві величини — експоненційні середні з фіксованою
+ * крапкою, тому оновлення коштує кілька додавань і зсувів на зразок.
+ */
+typedef struct noise_floor {
+    int32_t level;      // Постійна складова, NOISE_FLOOR_FRACTION_BITS дробових бітів
+    int32_t deviation;  // Типове відхилення від рівня, стільки ж дробових бітів
+    int shift;          // Стала часу: 2^shift зразків
+} noise_floor_t;
+
+void noise_floor_init(noise_floor_t *floor, uint16_t level, uint16_t deviation, uint32_t time_constant);
+void noise_floor_set_time_constant(noise_floor_t *floor, uint32_t time_constant);
+void noise_floor_feed(noise_floor_t *floor, const uint16_t *samples, int count);
+uint16_t noise_floor_level(const noise_floor_t *floor);
+uint16_t noise_floor_deviation(const noise_floor_t *floor);
+uint16_t noise_floor_gate(const noise_floor_t *floor, uint16_t min_margin);
+
+#endif // NOISE_FLOOR_H
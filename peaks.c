@@ -0,0 +1,131 @@
+#include "peaks.h"
+
+/*
+ * Сегментація піків за один прохід по сирих зразках. Гістерезис (окремі
+ * пороги входу й виходу) не дає шуму біля порогу дробити пік, а короткі
+ * провали між півперіодами сигналу зливаються в одну подію. Кожен зразок
+ * переглядається рівно один раз, тому час роботи — O(n) незалежно від
+ * кількості й довжини піків.
+ */
+
+static void emit_event(peak_detector_t *detector) {
+    const peak_event_t *event = &detector->event;
+    if (event->end - event->start + 1 < detector->config.min_duration) return;
+    if (detector->found < detector->max_events) detector->events[detector->found++] = *event;
+}
+
+/**
+ * Починає пошук піків у новому записі.
+ *
+ * @param detector Стан детектора.
+ * @param config Пороги та обмеження детектора.
+ * @param events Масив для подій.
+ * @param max_events Розмір масиву; події понад нього відкидаються.
+ */
+void peaks_begin(peak_detector_t *detector, const peak_config_t *config,
+                 peak_event_t *events, int max_events) {
+    detector->config = *config;
+    detector->events = events;
+    detector->max_events = max_events;
+    detector->found = 0;
+    detector->position = 0;
+    detector->active = false;
+    detector->event = (peak_event_t){ 0 };
+    detector->area = 0;
+}
+
+/**
+ * Продовжує пошук у наступному шматку потоку з новими порогами і новим
+ * масивом подій. Пік, відкритий у попередньому шматку, лишається відкритим
+ * і потрапить у новий масив, коли закінчиться.
+ *
+ * @param detector Стан детектора.
+ * @param config Пороги та обмеження детектора (можуть стежити за рівнем тиші).
+ * @param events Масив для подій, що закінчаться далі.
+ * @param max_events Розмір масиву; події понад нього відкидаються.
+ */
+void peaks_continue(peak_detector_t *detector, const peak_config_t *config,
+                    peak_event_t *events, int max_events) {
+    detector->config = *config;
+    detector->events = events;
+    detector->max_events = max_events;
+    detector->found = 0;
+}
+
+/**
+ * Переходить до зразка position, якщо в потоці розрив (пропущені блоки):
+ * відкритий пік закінчується на останньому отриманому зразку.
+ */
+void peaks_skip(peak_detector_t *detector, int position) {
+    if (position == detector->position) return;
+    if (detector->active) emit_event(detector);
+    detector->active = false;
+    detector->position = position;
+}
+
+/**
+ * Обробляє наступний шматок запису. Межі подій рахуються від початку
+ * запису, а не шматка.
+ */
+void peaks_feed(peak_detector_t *detector, const uint16_t *samples, int sample_count) {
+    const peak_config_t *config = &detector->config;
+    peak_event_t *event = &detector->event;
+    bool active = detector->active;
+    uint32_t area = detector->area;
+    int i = detector->position;
+
+    for (const uint16_t *end = samples + sample_count; samples < end; samples++, i++) {
+        uint16_t value = *samples;
+        if (!active) {
+            if (value <= config->enter) continue;
+            active = true;
+            event->start = i;
+            event->max = value;
+            area = 0;
+        }
+        if (value > config->baseline) area += value - config->baseline;
+
+        if (value >= config->exit) {
+            // Площа фіксується лише до останнього зразка над порогом виходу,
+            // хвіст провалу після нього до події не входить
+            event->end = i;
+            event->area = area;
+            if (value > event->max) event->max = value;
+        } else if (i - event->end > config->merge_gap) {
+            emit_event(detector);
+            active = false;
+        }
+    }
+    detector->active = active;
+    detector->area = area;
+    detector->position = i;
+}
+
+/**
+ * Завершує запис: незакритий пік теж стає подією.
+ *
+ * @return int Кількість записаних подій.
+ */
+int peaks_end(peak_detector_t *detector) {
+    if (detector->active) emit_event(detector);
+    detector->active = false;
+    return detector->found;
+}
+
+/**
+ * Знаходить піки в записі, що лежить в одному масиві.
+ *
+ * @param config Пороги та обмеження детектора.
+ * @param samples Зразки АЦП.
+ * @param sample_count Кількість зразків.
+ * @param events Масив для подій.
+ * @param max_events Розмір масиву; події понад нього відкидаються.
+ * @return Кількість записаних подій.
+ */
+int peaks_detect(const peak_config_t *config, const uint16_t *samples, int sample_count,
+                 peak_event_t *events, int max_events) {
+    peak_detector_t detector;
+    peaks_begin(&detector, config, events, max_events);
+    peaks_feed(&detector, samples, sample_count);
+    return peaks_end(&detector);
+}
@@ -0,0 +1,55 @@
+// peaks.h
+#ifndef PEAKS_H
+#define PEAKS_H
+
+#include "pico/stdlib.h"
+
+/**
+ * Параметри детектора піків. Усі пороги — у кодах АЦП, тривалості — у
+ * зразках, тому прохід по запису не потребує обчислень із рухомою комою.
+ */
+typedef struct peak_config {
+    uint16_t enter;    // Пік починається, коли зразок перевищує цей поріг
+    uint16_t exit;     // і триває, доки зразки не впадуть нижче цього (exit <= enter)
+    uint16_t baseline; // Рівень, від якого рахується площа піку
+    int merge_gap;     // Провали нижче exit, не довші за merge_gap зразків, не розривають пік
+    int min_duration;  // Коротші події відкидаються
+} peak_config_t;
+
+/**
+ * Подія піку: межі в зразках, максимум і площа над baseline.
+ */
+typedef struct peak_event {
+    int start;     // Перший зразок вище порогу входу
+    int end;       // Останній зразок не нижче порогу виходу
+    uint16_t max;
+    uint32_t area; // Сума (value - baseline) по зразках події, що вищі за baseline
+} peak_event_t;
+
+/**
+ * Стан детектора між шматками запису: дозволяє шукати піки в записі,
+ * який читається частинами (див. sample_span_t), з тим самим результатом,
+ * що й за один виклик peaks_detect().
+ */
+typedef struct peak_detector {
+    peak_config_t config;
+    peak_event_t *events;
+    int max_events;
+    int found;
+    int position;      // Номер наступного зразка від початку запису
+    bool active;
+    peak_event_t event;
+    uint32_t area;
+} peak_detector_t;
+
+void peaks_begin(peak_detector_t *detector, const peak_config_t *config,
+                 peak_event_t *events, int max_events);
+void peaks_continue(peak_detector_t *detector, const peak_config_t *config,
+                    peak_event_t *events, int max_events);
+void peaks_skip(peak_detector_t *detector, int position);
+void peaks_feed(peak_detector_t *detector, const uint16_t *samples, int sample_count);
+int peaks_end(peak_detector_t *detector);
+int peaks_detect(const peak_config_t *config, const uint16_t *samples, int sample_count,
+                 peak_event_t *events, int max_events);
+
+#endif // PEAKS_H
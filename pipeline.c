@@ -0,0 +1,303 @@
+#include <stdio.h>
+#include "pipeline.h"
+
+/*
+ * Конвеєр аналізу. На Pico завдання виконуються на ядрі 1, а індекси слотів
+ * із дескрипторами передаються міжядерним FIFO в обидва боки. На Linux-хості
+ * ядро 1 замінює окремий потік, а FIFO — черги під м'ютексом. Слоти
+ * виділяє і звільняє лише ядро 0, тому вони не потребують блокувань.
+ */
+
+typedef struct pipeline_stage_stats {
+    uint32_t jobs;
+    uint64_t samples;
+    uint64_t busy_us;
+    uint32_t max_us;
+} pipeline_stage_stats_t;
+
+static pipeline_handler_t pipeline_handler = NULL;
+static const char *const *pipeline_stage_names = NULL;
+static int pipeline_stage_count = 0;
+static pipeline_stage_stats_t pipeline_stats[PIPELINE_MAX_STAGES];
+
+static pipeline_job_t pipeline_jobs[PIPELINE_QUEUE_SIZE];
+static bool pipeline_slot_used[PIPELINE_QUEUE_SIZE];
+static int pipeline_slots_used = 0;
+
+/**
+ * Враховує виконання етапу в статистиці пропускної здатності.
+ *
+ * @param stage Номер етапу.
+ * @param samples Кількість оброблених зразків.
+ * @param elapsed_us Час виконання в мікросекундах.
+ */
+void pipeline_stage_record(int stage, uint32_t samples, uint32_t elapsed_us) {
+    if (stage < 0 || stage >= PIPELINE_MAX_STAGES) return;
+    pipeline_stage_stats_t *stats = &pipeline_stats[stage];
+    stats->jobs++;
+    stats->samples += samples;
+    stats->busy_us += elapsed_us;
+    if (elapsed_us > stats->max_us) stats->max_us = elapsed_us;
+}
+
+static void pipeline_run(int slot) {
+    pipeline_job_t *job = &pipeline_jobs[slot];
+    uint64_t start_time = time_us_64();
+    pipeline_handler(job);
+    uint32_t samples = job->end > job->start ? (uint32_t)(job->end - job->start) : 0;
+    pipeline_stage_record(job->type, samples, (uint32_t)(time_us_64() - start_time));
+}
+
+#if PIPELINE_DUAL_CORE && PICO_ON_DEVICE
+#include "pico/multicore.h"
+
+#define PIPELINE_PARK 0xFFFFFFFFu // Не індекс слота: ядро 1 має зупинитися в RAM
+static volatile bool pipeline_parked = false;
+
+/**
+ * Очікування ядра 1, поки ядро 0 працює з флешем: XIP вимкнено, тому
+ * і функція, і все, що вона викликає, мають бути в RAM.
+ */
+static void __not_in_flash_func(pipeline_park_worker)(void) {
+    multicore_fifo_push_blocking_inline(PIPELINE_PARK);
+    while (pipeline_parked) __wfe();
+}
+
+static void pipeline_worker(void) {
+    while (1) {
+        uint32_t slot = multicore_fifo_pop_blocking();
+        if (slot == PIPELINE_PARK) {
+            pipeline_park_worker();
+            continue;
+        }
+        pipeline_run((int)slot);
+        multicore_fifo_push_blocking(slot);
+    }
+}
+
+static void pipeline_start_worker(void) {
+    multicore_launch_core1(pipeline_worker);
+}
+
+// Слотів не більше, ніж місць у FIFO, тому запис ніколи не блокується надовго
+static void pipeline_post(int slot) {
+    multicore_fifo_push_blocking((uint32_t)slot);
+}
+
+static int pipeline_take_done(void) {
+    if (!multicore_fifo_rvalid()) return -1;
+    return (int)multicore_fifo_pop_blocking();
+}
+
+static bool pipeline_done_ready(void) {
+    return multicore_fifo_rvalid();
+}
+
+static void pipeline_park_core1(void) {
+    pipeline_parked = true;
+    multicore_fifo_push_blocking(PIPELINE_PARK);
+    multicore_fifo_pop_blocking(); // Ядро 1 вже виконується з RAM
+}
+
+static void pipeline_unpark_core1(void) {
+    pipeline_parked = false;
+    __sev();
+}
+
+#else
+
+/**
+ * Кільце індексів слотів (черга між "ядрами" на хості або черга готових
+ * результатів у режимі без другого ядра).
+ */
+typedef struct slot_ring {
+    int slots[PIPELINE_QUEUE_SIZE + 1];
+    int head;
+    int tail;
+} slot_ring_t;
+
+static slot_ring_t pipeline_done;
+
+static void ring_push(slot_ring_t *ring, int slot) {
+    ring->slots[ring->head] = slot;
+    ring->head = (ring->head + 1) % (PIPELINE_QUEUE_SIZE + 1);
+}
+
+static int ring_pop(slot_ring_t *ring) {
+    if (ring->head == ring->tail) return -1;
+    int slot = ring->slots[ring->tail];
+    ring->tail = (ring->tail + 1) % (PIPELINE_QUEUE_SIZE + 1);
+    return slot;
+}
+
+#if PIPELINE_DUAL_CORE // Хост: друге ядро замінює потік
+#include <pthread.h>
+
+static slot_ring_t pipeline_todo;
+static pthread_mutex_t pipeline_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pipeline_wakeup = PTHREAD_COND_INITIALIZER;
+static pthread_t pipeline_thread;
+
+static void *pipeline_worker(void *arg) {
+    (void)arg;
+    while (1) {
+        pthread_mutex_lock(&pipeline_lock);
+        int slot;
+        while ((slot = ring_pop(&pipeline_todo)) < 0) pthread_cond_wait(&pipeline_wakeup, &pipeline_lock);
+        pthread_mutex_unlock(&pipeline_lock);
+
+        pipeline_run(slot);
+
+        pthread_mutex_lock(&pipeline_lock);
+        ring_push(&pipeline_done, slot);
+        pthread_mutex_unlock(&pipeline_lock);
+    }
+    return NULL;
+}
+
+static void pipeline_start_worker(void) {
+    pthread_create(&pipeline_thread, NULL, pipeline_worker, NULL);
+}
+
+static void pipeline_post(int slot) {
+    pthread_mutex_lock(&pipeline_lock);
+    ring_push(&pipeline_todo, slot);
+    pthread_cond_signal(&pipeline_wakeup);
+    pthread_mutex_unlock(&pipeline_lock);
+}
+
+static int pipeline_take_done(void) {
+    pthread_mutex_lock(&pipeline_lock);
+    int slot = ring_pop(&pipeline_done);
+    pthread_mutex_unlock(&pipeline_lock);
+    return slot;
+}
+
+static bool pipeline_done_ready(void) {
+    pthread_mutex_lock(&pipeline_lock);
+    bool ready = pipeline_done.head != pipeline_done.tail;
+    pthread_mutex_unlock(&pipeline_lock);
+    return ready;
+}
+
+// На хості флеш симульований, потоку аналізу зупинятися не треба
+static void pipeline_park_core1(void) {}
+
+static void pipeline_unpark_core1(void) {}
+
+#else // Одне ядро: завдання виконується одразу під час подання
+
+static void pipeline_start_worker(void) {}
+
+static void pipeline_park_core1(void) {}
+
+static void pipeline_unpark_core1(void) {}
+
+static void pipeline_post(int slot) {
+    pipeline_run(slot);
+    ring_push(&pipeline_done, slot);
+}
+
+static int pipeline_take_done(void) {
+    return ring_pop(&pipeline_done);
+}
+
+static bool pipeline_done_ready(void) {
+    return pipeline_done.head != pipeline_done.tail;
+}
+#endif
+#endif
+
+/**
+ * Запускає виконавця завдань (ядро 1 на Pico, потік на хості).
+ *
+ * @param handler Обробник завдань, виконується на стороні аналізу.
+ * @param stage_names Назви етапів для статистики (індекс = тип завдання).
+ * @param stage_count Кількість назв.
+ */
+void pipeline_init(pipeline_handler_t handler, const char *const *stage_names, int stage_count) {
+    pipeline_handler = handler;
+    pipeline_stage_names = stage_names;
+    pipeline_stage_count = stage_count < PIPELINE_MAX_STAGES ? stage_count : PIPELINE_MAX_STAGES;
+    pipeline_start_worker();
+}
+
+/**
+ * Передає завдання на сторону аналізу.
+ *
+ * @return bool False, якщо всі слоти зайняті (завдання не подано).
+ */
+bool pipeline_submit(const pipeline_job_t *job) {
+    for (int slot = 0; slot < PIPELINE_QUEUE_SIZE; slot++) {
+        if (pipeline_slot_used[slot]) continue;
+        pipeline_slot_used[slot] = true;
+        pipeline_slots_used++;
+        pipeline_jobs[slot] = *job;
+        pipeline_post(slot);
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Забирає наступне виконане завдання, якщо воно є. Результати повертаються
+ * в порядку подання.
+ */
+bool pipeline_take_result(pipeline_job_t *job) {
+    int slot = pipeline_take_done();
+    if (slot < 0) return false;
+    *job = pipeline_jobs[slot];
+    pipeline_slot_used[slot] = false;
+    pipeline_slots_used--;
+    return true;
+}
+
+/**
+ * Чи є виконане завдання, яке можна забрати, не забираючи його. На Pico
+ * ядро 1 після запису у FIFO виконує __sev(), тож основний цикл, що
+ * спить у __wfe(), прокидається сам.
+ */
+bool pipeline_result_ready(void) {
+    return pipeline_done_ready();
+}
+
+int pipeline_free_slots(void) {
+    return PIPELINE_QUEUE_SIZE - pipeline_slots_used;
+}
+
+bool pipeline_busy(void) {
+    return pipeline_slots_used > 0;
+}
+
+/**
+ * Зупиняє сторону аналізу на час операції з флешем: на Pico ядро 1
+ * чекає в RAM, доки не буде викликано pipeline_unpark(). Можливо лише
+ * тоді, коли конвеєр порожній.
+ *
+ * @return bool False, якщо в конвеєрі є завдання.
+ */
+bool pipeline_park(void) {
+    if (pipeline_busy()) return false;
+    pipeline_park_core1();
+    return true;
+}
+
+void pipeline_unpark(void) {
+    pipeline_unpark_core1();
+}
+
+/**
+ * Виводить у термінал пропускну здатність кожного етапу: кількість завдань,
+ * оброблені зразки, сумарний і максимальний час та тисячі зразків за секунду.
+ */
+void pipeline_print_stats(void) {
+    printf("Pipeline (%s):\n", PIPELINE_DUAL_CORE ? "dual core" : "single core");
+    for (int stage = 0; stage < pipeline_stage_count; stage++) {
+        const pipeline_stage_stats_t *stats = &pipeline_stats[stage];
+        if (stats->jobs == 0) continue;
+        uint32_t ksps = stats->busy_us ? (uint32_t)(stats->samples * 1000 / stats->busy_us) : 0;
+        printf(" %-9s jobs %u samples %u busy %u us max %u us -> %u ksps\n",
+               pipeline_stage_names[stage], (unsigned)stats->jobs, (unsigned)stats->samples,
+               (unsigned)stats->busy_us, (unsigned)stats->max_us, (unsigned)ksps);
+    }
+}
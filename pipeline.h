@@ -0,0 +1,45 @@
+// pipeline.h
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "pico/stdlib.h"
+
+#ifndef PIPELINE_DUAL_CORE
+#define PIPELINE_DUAL_CORE 1 // 0 — виконувати завдання на місці, в основному циклі
+#endif
+#define PIPELINE_QUEUE_SIZE 8 // Не більше глибини міжядерного FIFO RP2040
+#define PIPELINE_MAX_STAGES 8
+#define PIPELINE_PAYLOAD_BYTES 112 // Дані завдання, що повертаються разом із дескриптором
+
+/**
+ * Дескриптор завдання аналізу. Ядро 0 (захоплення та UI) передає дескриптор
+ * на ядро 1, обробник заповнює result, і дескриптор повертається назад.
+ * Дані, на які посилається дескриптор (діапазон зразків, слайс), до
+ * повернення дескриптора належать ядру 1. Результати, що не вміщуються в
+ * result, обробник пише в payload (формат задає тип завдання, копіювати
+ * через memcpy), а не в змінні, які тим часом читає ядро 0.
+ */
+typedef struct pipeline_job {
+    uint8_t type;      // Тип завдання, він же номер етапу в статистиці
+    int slice;         // Слайс (блок потоку)
+    int start;         // Перший зразок діапазону
+    int end;           // Індекс після останнього зразка
+    int slice_length;  // Довжина слайсу
+    int result;        // Результат обробника
+    uint8_t payload[PIPELINE_PAYLOAD_BYTES]; // Вхідні дані й результати завдання
+} pipeline_job_t;
+
+typedef void (*pipeline_handler_t)(pipeline_job_t *job);
+
+void pipeline_init(pipeline_handler_t handler, const char *const *stage_names, int stage_count);
+bool pipeline_submit(const pipeline_job_t *job);
+bool pipeline_take_result(pipeline_job_t *job);
+bool pipeline_result_ready(void);
+int pipeline_free_slots(void);
+bool pipeline_busy(void);
+bool pipeline_park(void);
+void pipeline_unpark(void);
+void pipeline_stage_record(int stage, uint32_t samples, uint32_t elapsed_us);
+void pipeline_print_stats(void);
+
+#endif // PIPELINE_H
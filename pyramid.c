@@ -0,0 +1,157 @@
+#include "pyramid.h"
+
+/*
+ * Піраміда мінімумів, максимумів і сум для масштабування графіка. Рівень 0
+ * накопичується під час запису так само, як кошики slice_stats.c: коли
+ * запис у них не вміщується, сусідні вузли зливаються попарно, а їх
+ * розмір подвоюється. Після запису pyramid_finish() будує решту рівнів, і
+ * будь-який діапазон відповідає одному-трьом вузлам рівня, вузли якого
+ * не довші за діапазон. Вікно з N стовпчиків коштує O(N) незалежно від
+ * довжини запису.
+ */
+
+static const pyramid_node_t empty_node = { 0, 0, UINT16_MAX, 0 };
+
+static void merge_node(pyramid_node_t *into, const pyramid_node_t *node) {
+    into->sum += node->sum;
+    into->count += node->count;
+    if (node->min < into->min) into->min = node->min;
+    if (node->max > into->max) into->max = node->max;
+}
+
+/**
+ * Задає пам'ять під вузли: половина — рівень 0, решта — вищі рівні.
+ */
+void pyramid_init(pyramid_t *pyramid, pyramid_node_t *nodes, int node_count) {
+    pyramid->nodes = nodes;
+    pyramid->base_capacity = node_count / 2;
+    pyramid_reset(pyramid, 0);
+}
+
+/**
+ * Готує піраміду до нового запису.
+ *
+ * @param noise_gate Значення, нижче якого зразок не входить у суму.
+ */
+void pyramid_reset(pyramid_t *pyramid, uint16_t noise_gate) {
+    pyramid->base_size = PYRAMID_BASE_SIZE;
+    pyramid->samples = 0;
+    pyramid->noise_gate = noise_gate;
+    pyramid->levels = 0;
+}
+
+static void merge_base(pyramid_t *pyramid) {
+    int used = (pyramid->samples + pyramid->base_size - 1) / pyramid->base_size;
+    for (int i = 0; 2 * i < used; i++) {
+        pyramid_node_t merged = pyramid->nodes[2 * i];
+        if (2 * i + 1 < used) merge_node(&merged, &pyramid->nodes[2 * i + 1]);
+        pyramid->nodes[i] = merged;
+    }
+    pyramid->base_size *= 2;
+}
+
+/**
+ * Додає до рівня 0 наступні зразки запису.
+ */
+void pyramid_feed(pyramid_t *pyramid, const uint16_t *samples, int count) {
+    const uint16_t *end = samples + count;
+    uint16_t gate = pyramid->noise_gate;
+    while (samples < end) {
+        int index = pyramid->samples / pyramid->base_size;
+        if (index >= pyramid->base_capacity) {
+            merge_base(pyramid);
+            continue;
+        }
+        int offset = pyramid->samples - index * pyramid->base_size;
+        pyramid_node_t *node = &pyramid->nodes[index];
+        if (offset == 0) *node = empty_node;
+
+        int take = pyramid->base_size - offset;
+        if (take > end - samples) take = (int)(end - samples);
+        for (int j = 0; j < take; j++) {
+            uint16_t value = samples[j];
+            if (value < node->min) node->min = value;
+            if (value > node->max) node->max = value;
+            if (value < gate) continue;
+            node->sum += value;
+            node->count++;
+        }
+        samples += take;
+        pyramid->samples += take;
+    }
+}
+
+/**
+ * Будує рівні над рівнем 0: кожен вузол — злиття двох вузлів рівнем нижче.
+ * Після цього піраміду можна лише читати.
+ */
+void pyramid_finish(pyramid_t *pyramid) {
+    int count = (pyramid->samples + pyramid->base_size - 1) / pyramid->base_size;
+    pyramid->level_start[0] = 0;
+    pyramid->level_count[0] = count;
+    pyramid->levels = 1;
+    int next = pyramid->base_capacity;
+    while (count > 1 && pyramid->levels < PYRAMID_MAX_LEVELS) {
+        const pyramid_node_t *below = &pyramid->nodes[pyramid->level_start[pyramid->levels - 1]];
+        pyramid_node_t *level = &pyramid->nodes[next];
+        int level_count = (count + 1) / 2;
+        for (int i = 0; i < level_count; i++) {
+            level[i] = below[2 * i];
+            if (2 * i + 1 < count) merge_node(&level[i], &below[2 * i + 1]);
+        }
+        pyramid->level_start[pyramid->levels] = next;
+        pyramid->level_count[pyramid->levels] = level_count;
+        pyramid->levels++;
+        next += level_count;
+        count = level_count;
+    }
+}
+
+int pyramid_samples(const pyramid_t *pyramid) {
+    return pyramid->samples;
+}
+
+/**
+ * Найбільше наближення, за якого кожен із columns стовпчиків ще не вужчий
+ * за вузол рівня 0: вікно — samples >> zoom зразків.
+ */
+int pyramid_max_zoom(const pyramid_t *pyramid, int columns) {
+    int zoom = 0;
+    while ((pyramid->samples >> (zoom + 1)) >= columns * pyramid->base_size) zoom++;
+    return zoom;
+}
+
+/**
+ * Зведення діапазону зразків [from, to) за вузлами найдетальнішого рівня,
+ * вузли якого ще не довші за діапазон. Межі округлюються до меж вузлів,
+ * тож діапазон, коротший за вузол рівня 0, отримує цілий вузол.
+ */
+pyramid_node_t pyramid_query(const pyramid_t *pyramid, int from, int to) {
+    pyramid_node_t result = empty_node;
+    if (pyramid->levels == 0 || from >= to) return result;
+    int level = 0;
+    while (level + 1 < pyramid->levels && (pyramid->base_size << (level + 1)) <= to - from) level++;
+
+    int size = pyramid->base_size << level;
+    const pyramid_node_t *nodes = &pyramid->nodes[pyramid->level_start[level]];
+    int last = (to - 1) / size;
+    if (last >= pyramid->level_count[level]) last = pyramid->level_count[level] - 1;
+    for (int i = from / size; i <= last; i++) merge_node(&result, &nodes[i]);
+    return result;
+}
+
+/**
+ * Ділить діапазон [from, to) на columns рівних стовпчиків і повертає для
+ * кожного середнє значень, що не є шумом, і максимум — як слайси графіка.
+ */
+void pyramid_columns(const pyramid_t *pyramid, int from, int to, int columns,
+                     uint32_t *averages, uint32_t *maximums) {
+    int span = to - from;
+    for (int i = 0; i < columns; i++) {
+        int start = from + (int)((int64_t)span * i / columns);
+        int end = from + (int)((int64_t)span * (i + 1) / columns);
+        pyramid_node_t node = pyramid_query(pyramid, start, end > start ? end : start + 1);
+        averages[i] = node.count ? node.sum / node.count : 0;
+        maximums[i] = node.max;
+    }
+}
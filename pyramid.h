@@ -0,0 +1,49 @@
+// pyramid.h
+#ifndef PYRAMID_H
+#define PYRAMID_H
+
+#include "pico/stdlib.h"
+
+#ifndef PYRAMID_BASE_SIZE
+#define PYRAMID_BASE_SIZE 8   // Зразків у вузлі нижнього рівня на початку запису
+#endif
+#define PYRAMID_MAX_LEVELS 20
+
+/**
+ * Вузол піраміди: мінімум і максимум усіх зразків вузла, сума й кількість
+ * тих, що не є шумом (value >= noise_gate), — як у слайсах графіка.
+ */
+typedef struct pyramid_node {
+    uint32_t sum;
+    uint32_t count;
+    uint16_t min;
+    uint16_t max;
+} pyramid_node_t;
+
+/**
+ * Піраміда роздільностей запису: рівень 0 — вузли по base_size зразків,
+ * кожен наступний рівень удвічі грубший, верхній — один вузол на весь
+ * запис. Перша половина nodes — рівень 0, далі решта рівнів підряд.
+ */
+typedef struct pyramid {
+    pyramid_node_t *nodes;
+    int base_capacity;            // Вузлів рівня 0, половина пам'яті
+    int base_size;                // Зразків у вузлі рівня 0 (подвоюється для довгих записів)
+    int samples;                  // Скільки зразків враховано
+    uint16_t noise_gate;
+    int levels;                   // Рівнів після pyramid_finish(), 0 — ще не побудовано
+    int level_start[PYRAMID_MAX_LEVELS];
+    int level_count[PYRAMID_MAX_LEVELS];
+} pyramid_t;
+
+void pyramid_init(pyramid_t *pyramid, pyramid_node_t *nodes, int node_count);
+void pyramid_reset(pyramid_t *pyramid, uint16_t noise_gate);
+void pyramid_feed(pyramid_t *pyramid, const uint16_t *samples, int count);
+void pyramid_finish(pyramid_t *pyramid);
+int pyramid_samples(const pyramid_t *pyramid);
+int pyramid_max_zoom(const pyramid_t *pyramid, int columns);
+pyramid_node_t pyramid_query(const pyramid_t *pyramid, int from, int to);
+void pyramid_columns(const pyramid_t *pyramid, int from, int to, int columns,
+                     uint32_t *averages, uint32_t *maximums);
+
+#endif // PYRAMID_H
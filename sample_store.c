@@ -0,0 +1,300 @@
+#include <string.h>
+#include "sample_store.h"
+
+/*
+ * Упаковане сховище запису. АЦП дає 12-бітні коди, тож у uint16_t
+ * чверть пам'яті порожня: щільний блок зберігає два зразки у трьох
+ * байтах. Тиша і повільні ділянки ще компактніші в дельтах: різниця
+ * сусідніх зразків переводиться в zigzag (0, -1, 1, -2, ... → 0, 1, 2, 3, ...)
+ * і пакується найменшою шириною, якої вистачає для всього блоку.
+ * Заголовок блоку — один байт: 0..11 — ширина дельт, 12 — щільний блок.
+ */
+
+static int raw_bytes(int count) {
+    return (count * 3 + 1) / 2;
+}
+
+static int delta_bytes(int count, int width) {
+    return 2 + ((count - 1) * width + 7) / 8;
+}
+
+static void pack_raw(const uint16_t *samples, int count, uint8_t *out) {
+    int i = 0;
+    for (; i + 1 < count; i += 2, out += 3) {
+        uint16_t a = samples[i] & 0x0FFF, b = samples[i + 1] & 0x0FFF;
+        out[0] = (uint8_t)a;
+        out[1] = (uint8_t)((a >> 8) | (b << 4));
+        out[2] = (uint8_t)(b >> 4);
+    }
+    if (i < count) {
+        out[0] = (uint8_t)samples[i];
+        out[1] = (uint8_t)((samples[i] >> 8) & 0x0F);
+    }
+}
+
+static void unpack_raw(const uint8_t *in, int count, uint16_t *samples) {
+    int i = 0;
+    for (; i + 1 < count; i += 2, in += 3) {
+        samples[i] = (uint16_t)(in[0] | ((in[1] & 0x0F) << 8));
+        samples[i + 1] = (uint16_t)((in[1] >> 4) | (in[2] << 4));
+    }
+    if (i < count) samples[i] = (uint16_t)(in[0] | ((in[1] & 0x0F) << 8));
+}
+
+static uint32_t zigzag(int32_t delta) {
+    return ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31);
+}
+
+static int32_t unzigzag(uint32_t value) {
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+static void pack_delta(const uint16_t *samples, int count, int width, uint8_t *out) {
+    *out++ = (uint8_t)samples[0];
+    *out++ = (uint8_t)(samples[0] >> 8);
+    uint32_t bits = 0;
+    int filled = 0;
+    for (int i = 1; i < count; i++) {
+        bits |= zigzag((int32_t)samples[i] - samples[i - 1]) << filled;
+        for (filled += width; filled >= 8; filled -= 8, bits >>= 8) *out++ = (uint8_t)bits;
+    }
+    if (filled > 0) *out = (uint8_t)bits;
+}
+
+static void unpack_delta(const uint8_t *in, int count, int width, uint16_t *samples) {
+    int32_t value = in[0] | (in[1] << 8);
+    in += 2;
+    samples[0] = (uint16_t)value;
+    uint32_t mask = (1u << width) - 1;
+    uint32_t bits = 0;
+    int filled = 0;
+    for (int i = 1; i < count; i++) {
+        for (; filled < width; filled += 8) bits |= (uint32_t)*in++ << filled;
+        value += unzigzag(bits & mask);
+        bits >>= width;
+        filled -= width;
+        samples[i] = (uint16_t)value;
+    }
+}
+
+/**
+ * Пакує блок у найкоротшому з двох форматів.
+ *
+ * @return int Розмір упакованого блоку в байтах разом із заголовком.
+ */
+static int pack_block(const uint16_t *samples, int count, bool delta, uint8_t *out) {
+    int width = SAMPLE_STORE_RAW_WIDTH;
+    if (delta) {
+        uint32_t widest = 0;
+        for (int i = 1; i < count; i++) widest |= zigzag((int32_t)samples[i] - samples[i - 1]);
+        for (width = 0; widest >> width; width++);
+        if (width >= SAMPLE_STORE_RAW_WIDTH || delta_bytes(count, width) >= raw_bytes(count)) {
+            width = SAMPLE_STORE_RAW_WIDTH;
+        }
+    }
+    out[0] = (uint8_t)width;
+    if (width == SAMPLE_STORE_RAW_WIDTH) {
+        pack_raw(samples, count, out + 1);
+        return 1 + raw_bytes(count);
+    }
+    pack_delta(samples, count, width, out + 1);
+    return 1 + delta_bytes(count, width);
+}
+
+static bool store_full(const sample_store_t *store) {
+    return store->blocks == store->max_blocks ||
+           store->used + SAMPLE_STORE_MAX_BLOCK_BYTES > store->capacity;
+}
+
+static void pack_pending(sample_store_t *store) {
+    store->offsets[store->blocks] = store->used;
+    store->used += pack_block(store->pending, store->pending_count, store->delta,
+                              store->data + store->used);
+    store->blocks++;
+    store->length += store->pending_count;
+    store->pending_count = 0;
+}
+
+/**
+ * Розміщує сховище в наданій пам'яті: на початку — таблиця зміщень для
+ * max_samples зразків, решта — під упаковані блоки.
+ *
+ * @param store Сховище.
+ * @param memory Пам'ять, вирівняна на 4 байти.
+ * @param bytes Розмір пам'яті.
+ * @param max_samples Найбільша кількість зразків (визначає розмір таблиці зміщень).
+ * @param delta Дозволити дельта-кодування тихих блоків.
+ * @return bool False, якщо пам'яті не вистачає навіть на таблицю й один блок.
+ */
+bool sample_store_init(sample_store_t *store, void *memory, size_t bytes, int max_samples, bool delta) {
+    int max_blocks = (max_samples + SAMPLE_STORE_BLOCK - 1) / SAMPLE_STORE_BLOCK;
+    size_t table = (size_t)max_blocks * sizeof(uint32_t);
+    if (bytes < table + SAMPLE_STORE_MAX_BLOCK_BYTES) return false;
+    store->offsets = (uint32_t *)memory;
+    store->max_blocks = max_blocks;
+    store->data = (uint8_t *)memory + table;
+    store->capacity = (uint32_t)(bytes - table);
+    store->delta = delta;
+    sample_store_reset(store);
+    return true;
+}
+
+/**
+ * Очищає сховище перед новим записом.
+ */
+void sample_store_reset(sample_store_t *store) {
+    store->used = 0;
+    store->blocks = 0;
+    store->length = 0;
+    store->pending_count = 0;
+    store->finished = false;
+}
+
+/**
+ * Дописує зразки. Кожен заповнений блок одразу пакується.
+ *
+ * @param store Сховище.
+ * @param samples Зразки АЦП.
+ * @param count Кількість зразків.
+ * @return bool False, якщо сховище заповнилося і частину зразків не прийнято.
+ */
+bool sample_store_append(sample_store_t *store, const uint16_t *samples, int count) {
+    while (count > 0) {
+        if (store->finished || (store->pending_count == 0 && store_full(store))) return false;
+        int take = SAMPLE_STORE_BLOCK - store->pending_count;
+        if (take > count) take = count;
+        memcpy(store->pending + store->pending_count, samples, take * sizeof(uint16_t));
+        store->pending_count += take;
+        samples += take;
+        count -= take;
+        if (store->pending_count == SAMPLE_STORE_BLOCK) pack_pending(store);
+    }
+    return true;
+}
+
+/**
+ * Пакує неповний останній блок. Після цього дописувати не можна до
+ * наступного sample_store_reset().
+ */
+void sample_store_finish(sample_store_t *store) {
+    if (store->finished) return;
+    if (store->pending_count > 0) pack_pending(store);
+    store->finished = true;
+}
+
+/**
+ * Сховище заповнене: наступні зразки вже не буде прийнято.
+ */
+bool sample_store_full(const sample_store_t *store) {
+    return store->finished || (store->pending_count == 0 && store_full(store));
+}
+
+/**
+ * Кількість зразків в упакованих блоках (доступних для читання).
+ */
+int sample_store_length(const sample_store_t *store) {
+    return store->length;
+}
+
+/**
+ * Скільки зразків гарантовано вміститься без дельта-кодування.
+ */
+int sample_store_capacity(const sample_store_t *store) {
+    int blocks = (int)(store->capacity / SAMPLE_STORE_MAX_BLOCK_BYTES);
+    if (blocks > store->max_blocks) blocks = store->max_blocks;
+    return blocks * SAMPLE_STORE_BLOCK;
+}
+
+uint32_t sample_store_bytes(const sample_store_t *store) {
+    return store->used;
+}
+
+/**
+ * Упаковані блоки підряд (sample_store_bytes() байтів). Кожен блок
+ * самоописний: за байтом заголовка і кількістю зразків (SAMPLE_STORE_BLOCK,
+ * в останньому — решта) визначається його довжина, тож для вивантаження
+ * таблиця зміщень не потрібна.
+ */
+const uint8_t *sample_store_packed(const sample_store_t *store) {
+    return store->data;
+}
+
+/**
+ * Розпаковує один блок.
+ *
+ * @param store Сховище.
+ * @param block Номер блоку.
+ * @param samples Буфер на SAMPLE_STORE_BLOCK зразків.
+ * @return int Кількість зразків у блоці (0, якщо блок ще не упаковано).
+ */
+int sample_store_unpack_block(const sample_store_t *store, int block, uint16_t *samples) {
+    int first = block * SAMPLE_STORE_BLOCK;
+    int count = store->length - first;
+    if (count <= 0) return 0;
+    if (count > SAMPLE_STORE_BLOCK) count = SAMPLE_STORE_BLOCK;
+    const uint8_t *in = store->data + store->offsets[block];
+    if (in[0] == SAMPLE_STORE_RAW_WIDTH) unpack_raw(in + 1, count, samples);
+    else unpack_delta(in + 1, count, in[0], samples);
+    return count;
+}
+
+/**
+ * Читає довільний діапазон зразків.
+ *
+ * @return int Кількість прочитаних зразків (менше count, якщо запис коротший).
+ */
+int sample_store_read(const sample_store_t *store, int first, uint16_t *samples, int count) {
+    sample_span_t span;
+    int copied = 0;
+    sample_span_store(&span, store, first, first + count);
+    while (sample_span_next(&span)) {
+        memcpy(samples + copied, span.samples, span.count * sizeof(uint16_t));
+        copied += span.count;
+    }
+    return copied;
+}
+
+/**
+ * Починає читання зразків [from, to) зі сховища.
+ */
+void sample_span_store(sample_span_t *span, const sample_store_t *store, int from, int to) {
+    int length = sample_store_length(store);
+    span->store = store;
+    span->array = NULL;
+    span->position = from;
+    span->end = to < length ? to : length;
+    span->count = 0;
+}
+
+/**
+ * Починає читання зразків [from, to) зі звичайного масиву.
+ */
+void sample_span_array(sample_span_t *span, const uint16_t *array, int from, int to) {
+    span->store = NULL;
+    span->array = array;
+    span->position = from;
+    span->end = to;
+    span->count = 0;
+}
+
+/**
+ * Переходить до наступного шматка.
+ *
+ * @return bool False, коли діапазон вичерпано.
+ */
+bool sample_span_next(sample_span_t *span) {
+    if (span->position >= span->end) return false;
+    if (!span->store) {
+        span->samples = span->array + span->position;
+        span->count = span->end - span->position;
+    } else {
+        int block = span->position / SAMPLE_STORE_BLOCK;
+        int offset = span->position - block * SAMPLE_STORE_BLOCK;
+        sample_store_unpack_block(span->store, block, span->buffer);
+        span->samples = span->buffer + offset;
+        span->count = SAMPLE_STORE_BLOCK - offset;
+        if (span->count > span->end - span->position) span->count = span->end - span->position;
+    }
+    span->position += span->count;
+    return true;
+}
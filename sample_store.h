@@ -0,0 +1,68 @@
+// sample_store.h
+#ifndef SAMPLE_STORE_H
+#define SAMPLE_STORE_H
+
+#include <stddef.h>
+#include "pico/stdlib.h"
+
+#define SAMPLE_STORE_BLOCK 128 // Зразків в одному упакованому блоці
+#define SAMPLE_STORE_RAW_WIDTH 12
+// Найбільший блок: байт заголовка і по два зразки у трьох байтах
+#define SAMPLE_STORE_MAX_BLOCK_BYTES (1 + (SAMPLE_STORE_BLOCK * 3 + 1) / 2)
+
+/**
+ * Сховище 12-бітних зразків: запис ділиться на блоки по SAMPLE_STORE_BLOCK
+ * зразків, кожен пакується або щільно (два зразки у трьох байтах), або, для
+ * тихих ділянок, дельтами в zigzag-кодуванні змінної ширини — що коротше.
+ * Таблиця зміщень дає довільний доступ з точністю до блоку.
+ *
+ * Дописувати може один виробник (capture_poll() в основному циклі), а
+ * читати одночасно інше ядро: length збільшується лише після того, як блок
+ * повністю упаковано.
+ */
+typedef struct sample_store {
+    uint8_t *data;
+    uint32_t capacity;          // Байтів під блоки
+    uint32_t *offsets;          // Початок кожного блоку в data
+    int max_blocks;
+    bool delta;                 // Дозволено дельта-кодування
+    bool finished;              // Останній блок неповний, дописування заборонене
+    uint32_t used;              // Зайнято байтів
+    volatile int blocks;
+    volatile int length;        // Зразків в упакованих блоках
+    int pending_count;
+    uint16_t pending[SAMPLE_STORE_BLOCK];
+} sample_store_t;
+
+/**
+ * Послідовне читання діапазону зразків шматками: із масиву — одним
+ * шматком, зі сховища — розпакованими блоками. Після кожного успішного
+ * sample_span_next() шматок лежить у samples[0..count).
+ */
+typedef struct sample_span {
+    const sample_store_t *store; // NULL — читання зі звичайного масиву
+    const uint16_t *array;
+    int position;
+    int end;
+    const uint16_t *samples;
+    int count;
+    uint16_t buffer[SAMPLE_STORE_BLOCK];
+} sample_span_t;
+
+bool sample_store_init(sample_store_t *store, void *memory, size_t bytes, int max_samples, bool delta);
+void sample_store_reset(sample_store_t *store);
+bool sample_store_append(sample_store_t *store, const uint16_t *samples, int count);
+void sample_store_finish(sample_store_t *store);
+bool sample_store_full(const sample_store_t *store);
+int sample_store_length(const sample_store_t *store);
+int sample_store_capacity(const sample_store_t *store);
+uint32_t sample_store_bytes(const sample_store_t *store);
+const uint8_t *sample_store_packed(const sample_store_t *store);
+int sample_store_unpack_block(const sample_store_t *store, int block, uint16_t *samples);
+int sample_store_read(const sample_store_t *store, int first, uint16_t *samples, int count);
+
+void sample_span_store(sample_span_t *span, const sample_store_t *store, int from, int to);
+void sample_span_array(sample_span_t *span, const uint16_t *array, int from, int to);
+bool sample_span_next(sample_span_t *span);
+
+#endif // SAMPLE_STORE_H
@@ -0,0 +1,172 @@
+#include "slice_stats.h"
+
+/*
+ * Онлайн-накопичувач статистики слайсів. Поки триває запис, кожен новий
+ * зразок додається до дрібного кошика (сума, кількість і максимум значень,
+ * що не є шумом). Довжина слайсу відома лише після зупинки запису, тому
+ * слайси потім збираються з цілих кошиків, а неповні кошики на межах
+ * слайсу дочитуються із запису — результат точно збігається з пакетним
+ * calculate_slice_averages(). Коли довгий запис не вміщується в кошики,
+ * сусідні кошики зливаються попарно, а їх розмір подвоюється.
+ */
+
+static slice_bucket_t *stats_buckets = NULL;
+static int stats_bucket_count = 0;
+static int stats_bucket_size = SLICE_STATS_BUCKET_SIZE;
+static int stats_fed = 0;
+static uint16_t stats_noise_gate = 0;
+
+/**
+ * Задає пам'ять під кошики. Записи, довші за
+ * bucket_count * SLICE_STATS_BUCKET_SIZE зразків, укрупнюють кошики.
+ */
+void slice_stats_init(slice_bucket_t *buckets, int bucket_count) {
+    stats_buckets = buckets;
+    stats_bucket_count = bucket_count;
+    stats_fed = 0;
+}
+
+/**
+ * Готує накопичувач до нового запису.
+ *
+ * @param noise_gate Значення, нижче якого зразок вважається шумом.
+ */
+void slice_stats_reset(uint16_t noise_gate) {
+    stats_noise_gate = noise_gate;
+    stats_bucket_size = SLICE_STATS_BUCKET_SIZE;
+    stats_fed = 0;
+}
+
+/**
+ * Сума, кількість і максимум для слайсу. На відміну від кошика, лічильник
+ * 32-бітний, бо слайс довгого запису може містити понад 65535 зразків.
+ */
+typedef struct slice_acc {
+    uint32_t sum;
+    uint32_t count;
+    uint32_t max;
+} slice_acc_t;
+
+static void fold_sample(slice_bucket_t *bucket, uint16_t value) {
+    if (value < stats_noise_gate) return;
+    bucket->sum += value;
+    bucket->count++;
+    if (value > bucket->max) bucket->max = value;
+}
+
+static void fold_raw(slice_acc_t *acc, const sample_store_t *store, int from, int to) {
+    sample_span_t span;
+    sample_span_store(&span, store, from, to);
+    while (sample_span_next(&span)) {
+        for (int j = 0; j < span.count; j++) {
+            uint16_t value = span.samples[j];
+            if (value < stats_noise_gate) continue;
+            acc->sum += value;
+            acc->count++;
+            if (value > acc->max) acc->max = value;
+        }
+    }
+}
+
+static void fold_bucket(slice_acc_t *acc, const slice_bucket_t *bucket) {
+    acc->sum += bucket->sum;
+    acc->count += bucket->count;
+    if (bucket->max > acc->max) acc->max = bucket->max;
+}
+
+/**
+ * Зливає кошики попарно й подвоює їх розмір.
+ *
+ * @return bool False, якщо кошик більшого розміру переповнив би лічильник.
+ */
+static bool merge_buckets(void) {
+    if (stats_bucket_size * 2 > UINT16_MAX) return false;
+    int used = (stats_fed + stats_bucket_size - 1) / stats_bucket_size;
+    for (int i = 0; 2 * i < used; i++) {
+        slice_bucket_t merged = stats_buckets[2 * i];
+        if (2 * i + 1 < used) {
+            const slice_bucket_t *next = &stats_buckets[2 * i + 1];
+            merged.sum += next->sum;
+            merged.count += next->count;
+            if (next->max > merged.max) merged.max = next->max;
+        }
+        stats_buckets[i] = merged;
+    }
+    stats_bucket_size *= 2;
+    return true;
+}
+
+/**
+ * Додає до кошиків наступний шматок запису (зразки, що йдуть одразу за
+ * вже врахованими). Викликається в міру просування запису.
+ *
+ * @param samples Нові зразки.
+ * @param sample_count Їх кількість.
+ */
+void slice_stats_feed(const uint16_t *samples, int sample_count) {
+    const uint16_t *end = samples + sample_count;
+    while (samples < end) {
+        int bucket_index = stats_fed / stats_bucket_size;
+        if (bucket_index >= stats_bucket_count) {
+            if (!merge_buckets()) return; // Решта запису дочитується в slice_stats_compute
+            continue;
+        }
+        int offset = stats_fed - bucket_index * stats_bucket_size;
+        slice_bucket_t *bucket = &stats_buckets[bucket_index];
+        if (offset == 0) *bucket = (slice_bucket_t){0, 0, 0};
+
+        int take = stats_bucket_size - offset;
+        if (take > end - samples) take = (int)(end - samples);
+        for (int j = 0; j < take; j++) fold_sample(bucket, samples[j]);
+        samples += take;
+        stats_fed += take;
+    }
+}
+
+int slice_stats_fed(void) {
+    return stats_fed;
+}
+
+/**
+ * Збирає статистику слайсів із кошиків. Зразки, які ще не були враховані,
+ * спершу дочитуються, тож функція коректна і без попередніх викликів feed.
+ *
+ * @param store Запис.
+ * @param effective_samples Кількість записаних зразків.
+ * @param slice_length Кількість зразків у слайсі.
+ * @param slice_count Кількість слайсів.
+ * @param averages Вихідний масив середніх значень слайсів.
+ * @param maximums Вихідний масив максимумів слайсів.
+ */
+void slice_stats_compute(const sample_store_t *store, int effective_samples, int slice_length,
+                         int slice_count, uint32_t *averages, uint32_t *maximums) {
+    if (stats_fed < effective_samples) {
+        sample_span_t span;
+        sample_span_store(&span, store, stats_fed, effective_samples);
+        while (sample_span_next(&span)) slice_stats_feed(span.samples, span.count);
+    }
+
+    int size = stats_bucket_size;
+    for (int i = 0; i < slice_count; i++) {
+        int start_idx = i * slice_length;
+        int end_idx = start_idx + slice_length;
+        if (end_idx > effective_samples) end_idx = effective_samples;
+        if (start_idx > end_idx) start_idx = end_idx;
+
+        slice_acc_t acc = {0, 0, 0};
+        int first_bucket = (start_idx + size - 1) / size;
+        int last_bucket = end_idx / size;
+
+        if (first_bucket < last_bucket && end_idx <= stats_fed) {
+            // Неповний кошик на початку, цілі кошики, неповний кошик у кінці
+            fold_raw(&acc, store, start_idx, first_bucket * size);
+            for (int b = first_bucket; b < last_bucket; b++) fold_bucket(&acc, &stats_buckets[b]);
+            fold_raw(&acc, store, last_bucket * size, end_idx);
+        } else {
+            fold_raw(&acc, store, start_idx, end_idx);
+        }
+
+        averages[i] = (acc.count > 0) ? (acc.sum / acc.count) : 0;
+        maximums[i] = acc.max;
+    }
+}
@@ -0,0 +1,30 @@
+// slice_stats.h
+#ifndef SLICE_STATS_H
+#define SLICE_STATS_H
+
+#include "pico/stdlib.h"
+#include "sample_store.h"
+
+#ifndef SLICE_STATS_BUCKET_SIZE
+#define SLICE_STATS_BUCKET_SIZE 10 // Зразків у дрібному кошику накопичувача (на початку запису)
+#endif
+
+/**
+ * Часткові суми для кошика послідовних зразків (SLICE_STATS_BUCKET_SIZE,
+ * для довгих записів — більше).
+ * Враховуються лише значення, що не є шумом (value >= noise_gate).
+ */
+typedef struct slice_bucket {
+    uint32_t sum;
+    uint16_t count;
+    uint16_t max;
+} slice_bucket_t;
+
+void slice_stats_init(slice_bucket_t *buckets, int bucket_count);
+void slice_stats_reset(uint16_t noise_gate);
+void slice_stats_feed(const uint16_t *samples, int sample_count);
+int slice_stats_fed(void);
+void slice_stats_compute(const sample_store_t *store, int effective_samples, int slice_length,
+                         int slice_count, uint32_t *averages, uint32_t *maximums);
+
+#endif // SLICE_STATS_H
@@ -1,26 +1,109 @@
 #include "snd_analizer.h"
+#if PICO_ON_DEVICE
+#include "pico/stdio_usb.h"
+#else
+#include <stdlib.h>
+#endif
 
-const uint16_t ADC_NOISE = 2080;
+const uint16_t ADC_NOISE = 2080; // Рівень тиші до першої оцінки noise_floor
 const int SAMPLE_SLICE = SAMPLE_ARRAY_SIZE / GRAPH_LENGTH;
-const float CONVERSION_FACTOR = 3.27f / (1 << 12);
 
-uint16_t adc_values[SAMPLE_ARRAY_SIZE];
+// Уся велика пам'ять аналізатора — одна арена (див. init_memory_layout)
+static uint32_t arena_memory[ARENA_BYTES / sizeof(uint32_t)];
+arena_t arena;
+size_t analysis_mark;             // Початок регіону аналізу одного запису
+size_t spectrum_mark;             // Початок буфера ШПФ, поки спектр рахується
+
+uint16_t *adc_values;             // Кільце потокового режиму, SAMPLE_ARRAY_SIZE зразків
+#ifdef SAMPLE_TIMESTAMPS
+uint16_t *adc_deltas; // Інтервал перед кожним зразком (перші SAMPLE_ARRAY_SIZE зразків), мкс
+#endif
+void *recording_memory;           // Пам'ять упакованого запису: усе, що лишилося в арені
+size_t recording_bytes;
+sample_store_t recording;         // Запис: 12-бітні зразки, упаковані поблоково
 int sample_index = 0;
 bool collecting_data = false;
 bool data_collection_complete = false;
-struct repeating_timer timer;
-uint32_t saved_slices_averages[TOTAL_SLICES];
-uint32_t saved_slices_maximums[TOTAL_SLICES];
-int encoder_slice_index = 0;
+uint32_t *saved_slices_averages;  // Результати аналізу запису: регіон аналізу
+uint32_t *saved_slices_maximums;
+meter_reading_t *slice_levels;    // Рівні слайсів (meter.c), поруч із середніми
+encoder_t encoder;                // Декодер енкодера, стан змінює лише переривання
+event_queue_t input_events;       // Події переривань для основного циклу (events.c)
+int encoder_slice_index = 0;      // Змінюються лише в основному циклі
 bool encoder_active = false;
 bool encoder_update_needed = false;
 
-int peak_slices[TOTAL_SLICES]; // Індекси слайсів із максимумами
+noise_floor_t noise_floor;        // Оцінка рівня тиші і шуму, оновлюється на ядрі 1
+uint16_t noise_level;             // Рівень тиші для поточного запису (update_noise_gate)
+uint16_t noise_gate;              // Нижче цього значення зразок — шум
+
+int *peak_slices;              // Індекси слайсів із максимумами
 int peak_count = 0;            // Кількість максимумів
 int current_peak_index = -1;   // Поточний індекс у peak_slices
 
 int prev_encoder_slice_index;
-int peak_durations[TOTAL_SLICES]; // Тривалості піків у мс
+int *peak_durations;           // Тривалості піків у мс
+peak_event_t *peak_events;     // Події піків: межі, максимум і площа
+recording_summary_t *recording_summary; // Підсумок запису для журналу у флеші
+
+flash_log_t flash_log;         // Збережені записи (див. flash_log.c)
+
+bool binary_output = false;    // Результати й зразки — кадрами frame.c замість тексту
+bool recording_streamed = false; // Зразки запису вже надіслано під час потоку
+uint32_t stream_blocks_taken = 0; // Блоків потоку забрано з кільця
+uint32_t trace_sent = 0;       // Курсор траси для кадрів FRAME_TRACE
+
+// Дрібні кошики онлайн-накопичувача статистики слайсів (див. slice_stats.c)
+#define SLICE_BUCKET_COUNT ((SAMPLE_ARRAY_SIZE + SLICE_STATS_BUCKET_SIZE - 1) / SLICE_STATS_BUCKET_SIZE)
+slice_bucket_t *slice_buckets;
+
+pyramid_t pyramid;                     // Піраміда роздільностей запису для масштабування
+pyramid_node_t *pyramid_nodes;         // Вузли піраміди: регіон аналізу
+int zoom_level = 0;                    // 0 — увесь запис, кожен рівень — удвічі ближче
+int zoom_first = 0;                    // Перший зразок вікна графіка
+int zoom_target = -1;                  // Запитаний рівень (довге натискання, перехід до піку)
+int zoom_center = -1;                  // Зразок у центрі нового вікна; -1 — під вказівником
+uint32_t zoom_averages[TOTAL_SLICES];  // Стовпчики наближеного вікна з піраміди
+uint32_t zoom_maximums[TOTAL_SLICES];
+uint32_t *graph_averages;              // Стовпчики на графіку: слайси або zoom_*
+uint32_t *graph_maximums;
+uint32_t switch_press_time = 0;        // Час натискання кнопки енкодера з події; 0 — не натиснута
+
+view_mode_t view_mode = VIEW_GRAPH;   // Що показує графік: слайси, спектр чи спектрограму
+bool graph_wide = false;               // Графік займає весь рядок 0 (GRAPH_WIDE_CELLS символів)
+bool spectrum_valid = false;           // Спектр поточного запису вже обчислено
+int16_t *fft_buffer;                   // Буфер ШПФ (FFT_SIZE), позичається з арени на час обчислення
+uint32_t spectrum_bands[TOTAL_SLICES]; // Максимальна амплітуда в кожній смузі спектра
+int spectrum_peak_bins[TOTAL_SLICES];  // Бін із максимальною амплітудою в кожній смузі
+uint8_t spectrum_heights[TOTAL_SLICES]; // Висоти стовпчиків спектра (0–7)
+stft_t stft;                           // Кадри спектрограми поточного запису (stft.c)
+uint8_t spectrogram_columns[TOTAL_SLICES][STFT_BANDS]; // Видиме вікно матриці: стовпчик — кадр
+int spectrogram_first = 0;             // Кадр першого стовпчика вікна
+int spectrogram_target = -1;           // Запитаний перший кадр вікна; -1 — вікно актуальне
+
+meter_t meter;                         // Вимірювач рівня, працює на ядрі 1
+peak_detector_t stream_peaks;          // Детектор піків потоку: між блоками його стан на ядрі 1
+uint8_t meter_weighting = METER_WEIGHTING; // Бажане зважування (команда w)
+int16_t meter_calibration_db10 = METER_CALIBRATION_DB10; // дБ на 0 dBFS (команда k)
+graph_quantity_t graph_quantity = GRAPH_AVERAGES; // Що показує графік слайсів (команда m)
+
+// Назви етапів конвеєра для статистики (індекс = analysis_job_type_t)
+const char *const analysis_stage_names[ANALYSIS_STAGES] = {
+    "feed", "block", "recording", "spectrum", "spectrogram", "lcd"
+};
+int feed_posted = 0; // До якого зразка вже подано завдання накопичення
+
+uint32_t measure_press_time = 0;       // Час натискання кнопки вимірювання з події
+uint32_t stream_blocks_processed = 0;  // Кількість оброблених блоків потоку
+
+trigger_t trigger;                     // Тригер режиму очікування (trigger.c)
+uint8_t trigger_mode = TRIGGER_RISING; // Умова для наступного очікування (команда g)
+bool trigger_armed = false;            // Потік у кільце adc_values до спрацювання тригера
+int trigger_detect_lag = 0;            // Зразків від спрацювання до його виявлення в основному циклі
+
+#if TRIGGER_PRE_SAMPLES + TRIGGER_POST_SAMPLES > SAMPLE_ARRAY_SIZE - 4 * STREAM_BLOCK_SIZE
+#error "Trigger window must leave 4 stream blocks of the ring free"
+#endif
 
 uint8_t lcd_segment[8] = {
                   0b00000,
@@ -34,29 +117,48 @@ uint8_t lcd_segment[8] = {
 };
 
 /**
- * Обробник переривань таймера
+ * Обробник завершення запису: сховище recording заповнено повністю.
+ * Викликається рушієм захоплення: з capture_poll() чи capture_stop() в
+ * основному циклі, коли зразки йдуть через сирі блоки (децимація,
+ * сховище), інакше — з переривання джерела. Тому подія додається через
+ * event_post_from_thread(), безпечний в обох контекстах, і далі її
+ * обробляє handle_capture_complete.
+ *
+ * @param sample_count Кількість записаних зразків.
  */
-bool repeating_timer_callback(struct repeating_timer *t) {
-if (!collecting_data) {
-        cancel_repeating_timer(t);
-        return false; // Якщо не збираємо дані, не виконуємо функцію
-    }
+void capture_complete_handler(int sample_count) {
+    TRACE_END(TRACE_CAPTURE);
+    TRACE_BEGIN(TRACE_RELEASE_TO_GRAPH);
+    event_post_from_thread(&input_events, EVENT_CAPTURE_COMPLETE, sample_count, time_us_32());
+}
 
-    if (sample_index < SAMPLE_ARRAY_SIZE) { // Зчитування значення з АЦП
-        adc_values[sample_index++] = adc_read();
-    } else {
-        collecting_data = false;
-        data_collection_complete = true;
-        cancel_repeating_timer(t);
-    }
-    return true; // Продовжуємо таймер (він буде зупинений в основному циклі)
+/**
+ * Завершує запис за подією EVENT_CAPTURE_COMPLETE. Якщо запис уже
+ * зупинила кнопка (timer_stop), подію пропускаємо.
+ *
+ * @param sample_count Кількість записаних зразків.
+ */
+void handle_capture_complete(int sample_count) {
+    if (!collecting_data || capture_streaming()) return;
+    sample_index = sample_count;
+    collecting_data = false;
+    data_collection_complete = true;
 }
 
 /**
- * Обробник переривання для кнопки вимірювання
+ * Обробляє натискання кнопки вимірювання (з основного циклу).
+ *
+ * @param time_us Час натискання з події.
  */
-void measure_pin_pressed() {
-    if (!collecting_data) {
+void measure_pin_pressed(uint32_t time_us) {
+    if (trigger_armed) {
+        trigger_disarm();
+    } else if (capture_streaming()) {
+        stream_stop();
+    } else if (pipeline_busy()) {
+        printf("Analysis in progress, ignoring press\n");
+    } else if (!collecting_data) {
+        measure_press_time = time_us;
         timer_start();
     } else {
         printf("Timer already running, ignoring press\n");
@@ -64,13 +166,20 @@ void measure_pin_pressed() {
 }
 
 /**
- * Обробник відпускання кнопки вимірювання
+ * Обробник відпускання кнопки вимірювання. Коротке натискання (менше за
+ * STREAM_TAP_US) перемикає пристрій у потоковий режим.
+ *
+ * @param time_us Час відпускання з події.
  */
-void measure_pin_released() {
+void measure_pin_released(uint32_t time_us) {
+    if (capture_streaming()) return; // Потік зупиняється наступним натисканням
     if (collecting_data) {
-        collecting_data = false;
-        data_collection_complete = true;
         timer_stop();
+        if (time_us - measure_press_time < STREAM_TAP_US) {
+            stream_start();
+            return;
+        }
+        data_collection_complete = true;
         printf("Button released, timer stopped\n");
     } else {
         printf("No data collection to stop\n");
@@ -84,28 +193,496 @@ void clear_adc_array() {
 }
 
 /**
- * Функція для запуску таймера
+ * Запускає запис: АЦП працює у режимі вільного запуску, DMA переносить
+ * зразки з FIFO у кільце рушія захоплення, а звідти вони поблоково
+ * пакуються в recording (див. capture.c, sample_store.c).
  */
 void timer_start() {
   collecting_data = true;
   sample_index = 0; // Скидаємо індекс
-  clear_adc_array();
-  if (!add_repeating_timer_ms(-SAMPLE_INTERVAL_MS, repeating_timer_callback, NULL, &timer)) {
-    printf("Failed to start timer!\n");
-  } else
+  recording_streamed = false;
+  begin_analysis_region();
+  sample_store_reset(&recording);
+  update_noise_gate();
+  slice_stats_reset(noise_gate);
+  pyramid_reset(&pyramid, noise_gate);
+  feed_posted = 0;
+  if (!capture_start_store(&recording)) {
+    collecting_data = false;
+    printf("Failed to start capture!\n");
+  } else {
+    TRACE_BEGIN(TRACE_CAPTURE);
     printf("Data collection started.\n");
+  }
 }
 
 /**
- * Функція для зупинки таймера
+ * Зупиняє запис і фіксує кількість записаних зразків у sample_index.
  */
 void timer_stop() {
-  cancel_repeating_timer(&timer);
+  sample_index = capture_stop();
+  if (capture_raw_overruns() > 0) printf("Capture: %u raw blocks lost\n", (unsigned)capture_raw_overruns());
+  TRACE_END(TRACE_CAPTURE);
+  TRACE_BEGIN(TRACE_RELEASE_TO_GRAPH);
   collecting_data = false;
-  // sample_index = 0; // Опціонально, якщо хочете скинути індекс
   printf("Timer stopped.\n");
 }
 
+/**
+ * Запускає потоковий режим: adc_values стає кільцем із STREAM_BLOCK_COUNT блоків,
+ * кожен блок — один слайс графіка. Тут лише запуск захоплення; дисплей
+ * готує process_stream_blocks().
+ */
+void stream_start() {
+  collecting_data = true;
+  sample_index = 0;
+  stream_blocks_processed = 0;
+  encoder_active = false;
+  view_mode = VIEW_GRAPH;
+  graph_wide = false; // Блоки потоку малюються по одному слайсу у вузькому графіку
+  clear_adc_array();
+  update_noise_gate();
+  meter_reset(&meter, noise_level);
+  const peak_config_t peak_config = peak_detector_config();
+  peaks_begin(&stream_peaks, &peak_config, NULL, 0); // Масив подій дає кожен блок
+  begin_analysis_region();
+  stream_blocks_taken = 0;
+  recording_streamed = binary_output;
+  if (binary_output) {
+    frame_reset_stats();
+    frame_send_info(capture_sample_rate(), capture_decimation(), STREAM_BLOCK_SIZE);
+  }
+  if (!capture_start_stream(adc_values, STREAM_BLOCK_SIZE, STREAM_BLOCK_COUNT)) {
+    collecting_data = false;
+    printf("Failed to start streaming!\n");
+  } else
+    printf("Streaming started.\n");
+}
+
+/**
+ * Зупиняє потоковий режим. Кільце розгортається так, щоб adc_values
+ * містив зразки в хронологічному порядку, пакується в recording, після
+ * чого запис обробляється так само, як одноразовий.
+ */
+void stream_stop() {
+  int total = capture_stop();
+  collecting_data = false;
+  // Блоки, що ще аналізуються, читають кільце: дочекатися їх до розгортання
+  while (pipeline_busy()) handle_analysis_results();
+  int length = total;
+  if (total >= SAMPLE_ARRAY_SIZE) {
+    rotate_adc_values(total % SAMPLE_ARRAY_SIZE);
+    length = SAMPLE_ARRAY_SIZE;
+  }
+  sample_store_reset(&recording);
+  sample_store_append(&recording, adc_values, length);
+  sample_store_finish(&recording);
+  sample_index = sample_store_length(&recording);
+  slice_stats_reset(noise_gate); // Кільце розгорнуто, кошики недійсні
+  pyramid_reset(&pyramid, noise_gate);
+  printf("Streaming stopped: %d samples, %u overruns\n", total, capture_overruns());
+  data_collection_complete = true;
+}
+
+/**
+ * Параметри тригера в кодах АЦП для поточної умови. Пороги, як і пороги
+ * піків, задано для рівня тиші ADC_NOISE і зсуваються разом із ним.
+ */
+trigger_config_t trigger_detector_config() {
+  int drift = (int)noise_level - ADC_NOISE;
+  trigger_config_t config = {
+    .mode = trigger_mode,
+    .level = (uint16_t)(MV_TO_ADC(TRIGGER_LEVEL_MV) + drift),
+    .hysteresis = MV_TO_ADC(TRIGGER_HYSTERESIS_MV),
+    .slope = MV_TO_ADC(TRIGGER_SLOPE_MV),
+  };
+  return config;
+}
+
+/**
+ * Вмикає очікування: АЦП безперервно пише в кільце adc_values (як у
+ * потоковому режимі), а кожен блок перевіряє тригер
+ * (process_trigger_blocks). Після спрацювання кільце заморожується з
+ * TRIGGER_PRE_SAMPLES зразків до і TRIGGER_POST_SAMPLES після.
+ */
+void trigger_arm() {
+  if (collecting_data || pipeline_busy()) {
+    printf("Trigger not armed: busy\n");
+    return;
+  }
+  update_noise_gate();
+  trigger_config_t config = trigger_detector_config();
+  collecting_data = true;
+  sample_index = 0;
+  encoder_active = false;
+  view_mode = VIEW_GRAPH;
+  begin_analysis_region();
+  stream_blocks_taken = 0;
+  recording_streamed = false;
+  trigger_begin(&trigger, &config, 0);
+  if (!capture_start_stream(adc_values, STREAM_BLOCK_SIZE, STREAM_BLOCK_COUNT)) {
+    collecting_data = false;
+    printf("Failed to arm trigger!\n");
+    return;
+  }
+  trigger_armed = true;
+  printf("Trigger armed: %s, level %u, hysteresis %u, slope %u\n", trigger_mode_name(config.mode),
+         config.level, config.hysteresis, config.slope);
+  display_trigger_armed();
+}
+
+/**
+ * Вимикає очікування без запису (кнопка вимірювання або команда a).
+ */
+void trigger_disarm() {
+  capture_stop();
+  trigger_armed = false;
+  collecting_data = false;
+  printf("Trigger disarmed, %u overruns\n", capture_overruns());
+  lcd_clear();
+  lcd_hello();
+}
+
+/**
+ * Перевіряє тригер на кожному новому блоці кільця і заморожує кільце,
+ * коли після спрацювання записано TRIGGER_POST_SAMPLES зразків.
+ * Викликається з основного циклу, доки тригер очікує.
+ */
+void process_trigger_blocks() {
+  int block;
+  while ((block = capture_next_block()) >= 0) {
+    // Пропущені через переповнення блоки — розрив у номерах зразків
+    int first = (int)(stream_blocks_taken + capture_overruns()) * STREAM_BLOCK_SIZE;
+    stream_blocks_taken++;
+    trigger_skip(&trigger, first);
+    if (trigger_feed(&trigger, adc_values + block * STREAM_BLOCK_SIZE, STREAM_BLOCK_SIZE) >= 0) {
+      trigger_detect_lag = capture_poll() - trigger.fired_at;
+    }
+    if (trigger.fired_at >= 0 && first + STREAM_BLOCK_SIZE >= trigger.fired_at + TRIGGER_POST_SAMPLES) {
+      trigger_freeze();
+      return;
+    }
+  }
+}
+
+static uint32_t samples_to_us(int count) {
+  return count > 0 ? (uint32_t)((uint64_t)count * 1000000 / capture_sample_rate()) : 0;
+}
+
+/**
+ * Зупиняє захоплення і переносить вікно навколо спрацювання на початок
+ * adc_values у хронологічному порядку, пакує його в recording, після
+ * чого запис аналізується так само, як одноразовий. Якщо потік коротший
+ * за передісторію (тригер спрацював одразу), вікно починається з
+ * першого зразка.
+ */
+void trigger_freeze() {
+  int total = capture_stop();
+  trigger_armed = false;
+  collecting_data = false;
+  int oldest = total > SAMPLE_ARRAY_SIZE ? total - SAMPLE_ARRAY_SIZE : 0;
+  if (total >= SAMPLE_ARRAY_SIZE) rotate_adc_values(total % SAMPLE_ARRAY_SIZE);
+  int start = trigger.fired_at - TRIGGER_PRE_SAMPLES;
+  if (start < oldest) start = oldest;
+  int end = trigger.fired_at + TRIGGER_POST_SAMPLES;
+  if (end > total) end = total;
+  int length = end - start;
+  memmove(adc_values, adc_values + (start - oldest), length * sizeof(adc_values[0]));
+#ifdef SAMPLE_TIMESTAMPS
+  memmove(adc_deltas, adc_deltas + (start - oldest), length * sizeof(adc_deltas[0]));
+#endif
+  sample_store_reset(&recording);
+  sample_store_append(&recording, adc_values, length);
+  sample_store_finish(&recording);
+  sample_index = sample_store_length(&recording);
+  slice_stats_reset(noise_gate); // Вікно зсунуто, кошики недійсні
+  pyramid_reset(&pyramid, noise_gate);
+  printf("Trigger %s at sample %d: %d pre + %d post samples, detected after %u us, "
+         "frozen %u us after trigger (%u us past the window), %u overruns\n",
+         trigger_mode_name(trigger.config.mode), trigger.fired_at, trigger.fired_at - start,
+         end - trigger.fired_at, samples_to_us(trigger_detect_lag), samples_to_us(total - trigger.fired_at),
+         samples_to_us(total - end), capture_overruns());
+  data_collection_complete = true;
+}
+
+/**
+ * Показує на LCD, що тригер очікує, і його умову.
+ */
+void display_trigger_armed() {
+  lcd_segment_clear();
+  lcd_clear();
+  lcd_setCursor(0, 0);
+  lcd_print("Armed: ");
+  lcd_print(trigger_mode_name(trigger_mode));
+}
+
+static void reverse_values(uint16_t *values, int from, int to) {
+  for (to--; from < to; from++, to--) {
+    uint16_t tmp = values[from];
+    values[from] = values[to];
+    values[to] = tmp;
+  }
+}
+
+static void rotate_values(uint16_t *values, int shift) {
+  reverse_values(values, 0, shift);
+  reverse_values(values, shift, SAMPLE_ARRAY_SIZE);
+  reverse_values(values, 0, SAMPLE_ARRAY_SIZE);
+}
+
+/**
+ * Циклічно зсуває adc_values (і позначки часу, якщо вони є) вліво на shift
+ * позицій (три розвороти, без додаткової пам'яті).
+ */
+void rotate_adc_values(int shift) {
+  if (shift <= 0 || shift >= SAMPLE_ARRAY_SIZE) return;
+  rotate_values(adc_values, shift);
+#ifdef SAMPLE_TIMESTAMPS
+  rotate_values(adc_deltas, shift);
+#endif
+}
+
+/**
+ * Передає всі заповнені блоки потоку на аналіз (ядро 1), поки в конвеєрі
+ * є вільні слоти. Якщо аналіз не встигає, блоки лишаються в кільці, і
+ * capture_next_block() зарахує їх до переповнень.
+ */
+void process_stream_blocks() {
+  int block;
+  while (pipeline_free_slots() > 0 && (block = capture_next_block()) >= 0) {
+    // Пропущені через переповнення блоки лишають дірку в номерах зразків
+    int first = (int)(stream_blocks_taken + capture_overruns()) * STREAM_BLOCK_SIZE;
+    if (binary_output) {
+      frame_send_samples(first, adc_values + block * STREAM_BLOCK_SIZE, STREAM_BLOCK_SIZE);
+    }
+    stream_blocks_taken++;
+    pipeline_job_t job = {
+      .type = ANALYSIS_BLOCK,
+      .slice = block,
+      .start = block * STREAM_BLOCK_SIZE,
+      .end = (block + 1) * STREAM_BLOCK_SIZE,
+      .slice_length = STREAM_BLOCK_SIZE,
+    };
+    const stream_block_result_t input = { .first = first };
+    memcpy(job.payload, &input, sizeof(input));
+    pipeline_submit(&job);
+  }
+}
+
+/**
+ * Аналізує блок потоку (ядро 1): рівень тиші, середнє й максимум, рівні
+ * слайсу і піки. Пише лише в стан, що належить ядру 1 (noise_floor, meter,
+ * stream_peaks), і в результат у дескрипторі; у глобальні змінні його
+ * переносить ядро 0 (apply_stream_block). Детектор піків тримає відкритий
+ * пік між блоками, тож читаються лише зразки цього блоку, а не кільце,
+ * яке DMA тим часом перезаписує.
+ *
+ * @param job Завдання ANALYSIS_BLOCK; payload — stream_block_result_t.
+ */
+void analyze_stream_block(pipeline_job_t *job) {
+  stream_block_result_t result;
+  memcpy(&result, job->payload, sizeof(result)); // first задало ядро 0
+  const uint16_t *samples = adc_values + job->start;
+  int count = job->end - job->start;
+  sample_span_t span;
+
+  // У потоці поріг і масштаб стежать за рівнем тиші безперервно
+  noise_floor_feed(&noise_floor, samples, count);
+  result.noise_level = noise_floor_level(&noise_floor);
+  result.noise_gate = noise_floor_gate(&noise_floor, ADC_NOISE_THRESHOLD);
+  sample_span_array(&span, adc_values, job->start, job->end);
+  span_average_max(&span, result.noise_gate, &result.average, &result.maximum);
+  meter_feed(&meter, samples, count);
+  meter_end_slice(&meter, &result.level);
+
+  const peak_config_t config = peak_detector_config_for(result.noise_level);
+  peaks_continue(&stream_peaks, &config, result.peaks, STREAM_BLOCK_MAX_PEAKS);
+  peaks_skip(&stream_peaks, result.first); // Розрив після переповнення закриває пік
+  peaks_feed(&stream_peaks, samples, count);
+  result.peak_count = stream_peaks.found;
+  memcpy(job->payload, &result, sizeof(result));
+}
+
+/**
+ * Переносить результат блоку потоку в масиви графіка, рівень тиші і
+ * список піків (ядро 0). Список — піки в межах кільця: ті, що почалися
+ * раніше найстарішого зразка в ньому, відкидаються, а нові додаються в
+ * кінець.
+ *
+ * @param job Виконане завдання ANALYSIS_BLOCK; result стає кількістю піків у кільці.
+ */
+void apply_stream_block(pipeline_job_t *job) {
+  stream_block_result_t result;
+  memcpy(&result, job->payload, sizeof(result));
+  saved_slices_averages[job->slice] = result.average;
+  saved_slices_maximums[job->slice] = result.maximum;
+  slice_levels[job->slice] = result.level;
+  noise_level = result.noise_level;
+  noise_gate = result.noise_gate;
+
+  int oldest = result.first + STREAM_BLOCK_SIZE - SAMPLE_ARRAY_SIZE;
+  int kept = 0;
+  for (int j = 0; j < peak_count; j++) {
+    if (peak_events[j].start >= oldest) peak_events[kept++] = peak_events[j];
+  }
+  for (int j = 0; j < result.peak_count; j++) {
+    if (kept == TOTAL_SLICES) {
+      memmove(peak_events, peak_events + 1, (TOTAL_SLICES - 1) * sizeof(peak_event_t));
+      kept--;
+    }
+    peak_events[kept++] = result.peaks[j];
+  }
+  for (int j = 0; j < kept; j++) {
+    const peak_event_t *event = &peak_events[j];
+    peak_slices[j] = (event->start / STREAM_BLOCK_SIZE) % STREAM_BLOCK_COUNT;
+    peak_durations[j] = capture_elapsed_us(event->start % SAMPLE_ARRAY_SIZE,
+                                           event->end - event->start + 1) / 1000;
+    if (j >= kept - result.peak_count) {
+      printf("Peak at slice %d: max %u mV, area %u, duration %d ms\n", peak_slices[j],
+             (unsigned)ADC_TO_MV(event->max), (unsigned)event->area, peak_durations[j]);
+    }
+  }
+  peak_count = kept;
+  job->result = peak_count;
+}
+
+/**
+ * Оновлює дисплей за результатом аналізу блоку потоку: символ графіка
+ * зі слайсом блоку, кількість піків і переповнень (лише коли вони змінюються).
+ *
+ * @param job Виконане завдання ANALYSIS_BLOCK; result — кількість піків.
+ */
+void draw_stream_block(const pipeline_job_t *job) {
+  static int shown_peak_count = -1;
+  static uint32_t shown_overruns = UINT32_MAX;
+
+  if (stream_blocks_processed++ == 0) {
+    lcd_segment_clear();
+    lcd_clear();
+    shown_peak_count = -1;
+    shown_overruns = UINT32_MAX;
+  }
+
+  update_slice_column(job->slice, -1);
+
+  char buffer[11];
+  if (job->result != shown_peak_count) {
+    shown_peak_count = job->result;
+    format_uint(buffer, (uint32_t)job->result, -2);
+    lcd_setCursor(1, 0);
+    lcd_print(buffer);
+  }
+  if (capture_overruns() != shown_overruns) {
+    shown_overruns = capture_overruns();
+    // Шість цифр до кінця рядка: більші значення показуються як 999999
+    buffer[0] = 'O';
+    buffer[1] = ':';
+    format_uint(buffer + 2, shown_overruns > 999999u ? 999999u : shown_overruns, -6);
+    lcd_setCursor(1, 8);
+    lcd_print(buffer);
+  }
+}
+
+/**
+ * Під час одноразового запису передає на ядро 1 нові зразки для онлайн-
+ * накопичувача статистики слайсів порціями не менше STREAM_BLOCK_SIZE.
+ *
+ * @param captured Кількість уже записаних зразків.
+ */
+void feed_slice_stats(int captured) {
+  if (captured - feed_posted < STREAM_BLOCK_SIZE || pipeline_free_slots() == 0) return;
+  pipeline_job_t job = { .type = ANALYSIS_FEED, .start = feed_posted, .end = captured };
+  if (pipeline_submit(&job)) feed_posted = captured;
+}
+
+/**
+ * Передає нові упаковані зразки запису [start, end) оцінювачу рівня тиші,
+ * накопичувачу статистики слайсів і піраміді.
+ */
+void feed_recording(int start, int end) {
+  sample_span_t span;
+  sample_span_store(&span, &recording, start, end);
+  while (sample_span_next(&span)) {
+    noise_floor_feed(&noise_floor, span.samples, span.count);
+    slice_stats_feed(span.samples, span.count);
+    pyramid_feed(&pyramid, span.samples, span.count);
+  }
+}
+
+/**
+ * Обробник завдань конвеєра. Виконується на ядрі 1 і працює лише з
+ * даними, на які вказує дескриптор; дисплей не чіпає.
+ *
+ * @param job Завдання аналізу.
+ */
+void run_analysis_job(pipeline_job_t *job) {
+  switch (job->type) {
+  case ANALYSIS_FEED:
+    feed_recording(job->start, job->end);
+    break;
+  case ANALYSIS_BLOCK:
+    analyze_stream_block(job);
+    break;
+  case ANALYSIS_RECORDING:
+    analyze_recording(job->end, job->slice_length);
+    job->result = peak_count;
+    break;
+  case ANALYSIS_SPECTRUM:
+    calculate_spectrum();
+    break;
+  case ANALYSIS_SPECTROGRAM:
+    calculate_spectrogram_window(job);
+    break;
+  }
+}
+
+/**
+ * Забирає результати з конвеєра і виводить їх на дисплей (ядро 0).
+ * Час виведення разом із надсиланням на дисплей враховується як етап "lcd".
+ */
+void handle_analysis_results() {
+  pipeline_job_t job;
+  while (pipeline_take_result(&job)) {
+    uint64_t start_time = time_us_64();
+    switch (job.type) {
+    case ANALYSIS_BLOCK:
+      if (!capture_streaming()) continue; // Потік уже зупинено, запис перемальовується повністю
+      apply_stream_block(&job);
+      draw_stream_block(&job);
+      break;
+    case ANALYSIS_RECORDING:
+      draw_graph_on_lcd();
+      TRACE_END(TRACE_RELEASE_TO_GRAPH);
+      capture_print_timing();
+      print_noise_floor();
+      print_arena_usage();
+      if (binary_output) send_recording_frames();
+      save_recording();
+      lcd_print_stats();
+      pipeline_print_stats();
+      break;
+    case ANALYSIS_SPECTRUM:
+      return_fft_buffer();
+      if (view_mode != VIEW_SPECTRUM) continue;
+      display_spectrum();
+      encoder_update_needed = true;
+      break;
+    case ANALYSIS_SPECTROGRAM:
+      return_fft_buffer();
+      print_spectrogram_rate(&job);
+      if (view_mode != VIEW_SPECTROGRAM) continue;
+      spectrogram_first = job.slice;
+      display_spectrogram();
+      encoder_update_needed = true;
+      break;
+    default:
+      continue;
+    }
+    lcd_flush();
+    pipeline_stage_record(ANALYSIS_LCD, job.end - job.start, (uint32_t)(time_us_64() - start_time));
+  }
+}
+
 /**
  * Функція для виводу даних
  */
@@ -116,7 +693,16 @@ void print_data() {
   /*   float voltage = adc_values[i] * CONVERSION_FACTOR; */
   /*   printf("Voltage at moment %d: %f %u\n", i, voltage, adc_values[i]); */
   /* } */
-  draw_graph_on_lcd();
+  view_mode = VIEW_GRAPH;
+  spectrum_valid = false;
+  // Аналіз виконується на ядрі 1, графік виводиться з handle_analysis_results()
+  pipeline_job_t job = {
+    .type = ANALYSIS_RECORDING,
+    .start = 0,
+    .end = sample_index,
+    .slice_length = recording_slice_length(),
+  };
+  if (!pipeline_submit(&job)) return; // Черга заповнена, повторимо в наступному циклі
   data_collection_complete = false; // Скидаємо флаг для наступного циклу збору даних
 }
 
@@ -146,9 +732,18 @@ void init_encoder() {
     gpio_init(ENCODER_CLK_PIN);
     gpio_set_dir(ENCODER_CLK_PIN, GPIO_IN);
     gpio_pull_up(ENCODER_CLK_PIN);
-    gpio_set_irq_enabled(ENCODER_CLK_PIN, 
-                         GPIO_IRQ_EDGE_FALL | GPIO_IRQ_EDGE_RISE, 
-                         true); // Не перезаписуємо callback, лише вмикаємо переривання
+    sleep_us(10); // Підтяжка встановлюється до першого читання
+    encoder_init(&encoder, encoder_pins());
+    // Не перезаписуємо callback, лише вмикаємо переривання на обох пінах
+    gpio_set_irq_enabled(ENCODER_CLK_PIN, GPIO_IRQ_EDGE_FALL | GPIO_IRQ_EDGE_RISE, true);
+    gpio_set_irq_enabled(ENCODER_DT_PIN, GPIO_IRQ_EDGE_FALL | GPIO_IRQ_EDGE_RISE, true);
+}
+
+void init_encoder_switch() {
+    gpio_init(ENCODER_SW_PIN);
+    gpio_set_dir(ENCODER_SW_PIN, GPIO_IN);
+    gpio_pull_up(ENCODER_SW_PIN);
+    gpio_set_irq_enabled(ENCODER_SW_PIN, GPIO_IRQ_EDGE_FALL | GPIO_IRQ_EDGE_RISE, true);
 }
 
 /**
@@ -169,45 +764,91 @@ bool debounce_check(uint64_t current_time, uint64_t* last_event_time, uint32_t d
 }
 
 /**
- * Перевіряє, чи переривання викликане енкодером і чи дозволена його обробка.
+ * Перевіряє, чи переривання викликане енкодером. Декодер стежить за
+ * пінами завжди, щоб не втратити стан; кроки без активного графіка
+ * відкидає handle_encoder_steps().
  * 
  * @param gpio Номер GPIO, який викликав переривання.
- * @return bool True, якщо це енкодер і його можна обробляти, false інакше.
+ * @return bool True, якщо це CLK або DT енкодера.
  */
 bool is_encoder_event(uint gpio) {
-    return (gpio == ENCODER_CLK_PIN && encoder_active && !collecting_data);
+    return gpio == ENCODER_CLK_PIN || gpio == ENCODER_DT_PIN;
 }
 
 /**
- * Визначає напрямок обертання енкодера на основі стану CLK і DT.
- * 
- * @param clk_state Стан піна CLK енкодера.
- * @param dt_state Стан піна DT енкодера.
- * @return bool True, якщо поворот вправо, false, якщо вліво.
+ * Стан пінів енкодера для декодера: CLK << 1 | DT, обидва за одне читання.
  */
-bool is_encoder_rotation_right(bool clk_state, bool dt_state) {
-    return (dt_state != clk_state);
+uint8_t encoder_pins() {
+    uint32_t pins = gpio_get_all();
+    return (uint8_t)(((pins >> ENCODER_CLK_PIN) & 1) << 1 | ((pins >> ENCODER_DT_PIN) & 1));
 }
 
 /**
- * Обробляє поворот енкодера, оновлюючи індекс слайсу та сигналізуючи про потребу 
- * оновлення дисплея. Збільшує або зменшує encoder_slice_index залежно від напрямку 
- * обертання, визначеного станом CLK і DT.
- * 
- * @param events Події переривання (перевіряється GPIO_IRQ_EDGE_FALL).
+ * Кількість позицій вказівника в поточному вигляді: слайси графіка, смуги
+ * спектра або кадри вікна спектрограми (короткий запис має їх менше).
  */
-void handle_encoder_rotation(uint32_t events) {
-    bool clk_state = gpio_get(ENCODER_CLK_PIN);
-    bool dt_state = gpio_get(ENCODER_DT_PIN);
+int view_columns() {
+    if (view_mode == VIEW_SPECTROGRAM && stft.frames < TOTAL_SLICES) return stft.frames;
+    return TOTAL_SLICES;
+}
 
-    if (events & GPIO_IRQ_EDGE_FALL) {
-        if (is_encoder_rotation_right(clk_state, dt_state)) {
-            if (encoder_slice_index < 39) encoder_slice_index++;
-        } else {
-            if (encoder_slice_index > 0) encoder_slice_index--;
-        }
-        encoder_update_needed = true;
-        /* printf("Encoder slice %d\n", encoder_slice_index); */
+/**
+ * Застосовує кроки енкодера (уже з прискоренням) до поточного вигляду:
+ * рухає вказівник у межах view_columns(), а в наближеному графіку і
+ * спектрограмі прокручує вікно в межах запису.
+ *
+ * @param steps Кроки з подій EVENT_ENCODER_STEPS: додатні — вправо.
+ */
+void handle_encoder_steps(int steps) {
+    if (steps == 0 || !encoder_active || collecting_data) return;
+    if (view_mode == VIEW_GRAPH && zoom_level > 0) {
+        pan_zoom(steps);
+        return;
+    }
+    if (view_mode == VIEW_SPECTROGRAM) {
+        scroll_spectrogram(steps);
+        return;
+    }
+    int index = encoder_slice_index + steps;
+    if (index >= view_columns()) index = view_columns() - 1;
+    if (index < 0) index = 0;
+    if (index == encoder_slice_index) return;
+    encoder_slice_index = index;
+    encoder_update_needed = true;
+}
+
+/**
+ * Перевіряє, чи натиснуто або відпущено кнопку енкодера.
+ *
+ * @param gpio Номер GPIO, який викликав переривання.
+ * @param events Події переривання.
+ * @return bool True, якщо це фронт кнопки енкодера.
+ */
+bool is_encoder_switch_event(uint gpio, uint32_t events) {
+    return gpio == ENCODER_SW_PIN && (events & (GPIO_IRQ_EDGE_FALL | GPIO_IRQ_EDGE_RISE));
+}
+
+/**
+ * Обробляє подію кнопки енкодера (з основного циклу). Дія — при
+ * відпусканні і лише тоді, коли є запис: коротке натискання перемикає
+ * по колу графік, спектр і спектрограму, довге (від ENCODER_LONG_PRESS_US) наближає графік на
+ * рівень, а з найбільшого наближення повертає весь запис.
+ *
+ * @param event EVENT_SWITCH_PRESS або EVENT_SWITCH_RELEASE.
+ */
+void handle_encoder_switch(const event_t *event) {
+    if (event->type == EVENT_SWITCH_PRESS) {
+        switch_press_time = event->time_us;
+        return;
+    }
+    if (switch_press_time == 0) return; // Відпускання без зафіксованого натискання
+    uint32_t held = event->time_us - switch_press_time;
+    switch_press_time = 0;
+    if (!encoder_active || collecting_data) return;
+    if (held < ENCODER_LONG_PRESS_US) {
+        toggle_view();
+    } else if (view_mode == VIEW_GRAPH) {
+        zoom_target = zoom_level + 1; // Після найбільшого наближення apply_zoom() поверне рівень 0
     }
 }
 
@@ -222,156 +863,720 @@ bool is_measure_pin_event(uint gpio) {
 }
 
 /**
- * Обробляє подію кнопки з антидребезгом, виводячи стан і викликаючи відповідні дії.
- * Якщо антидребезг відхиляє подію, обробка припиняється. Інакше визначається, чи це 
- * натискання (FALL) чи відпускання (RISE), і викликається відповідна функція.
- * 
- * @param current_time Поточний час у мікросекундах.
- * @param last_event_time Час останньої події (змінна для оновлення).
- * @param events Події переривання (FALL або RISE).
- */
-void handle_measure_pin_event(uint64_t current_time, uint64_t* last_event_time, uint32_t events) {
-    /* if (debounce_check(current_time, last_event_time, BUTTON_DEBOUNCE_US)) { return; } */
-    printf("Event: %s, Time diff: %u\n", 
-           (events & GPIO_IRQ_EDGE_FALL) ? "FALL" : "RISE", 
-           (uint32_t)(current_time - *last_event_time));
-    if (events & GPIO_IRQ_EDGE_FALL) {
+ * Обробляє подію кнопки вимірювання (з основного циклу): виводить фронт
+ * та інтервал від попередньої події і викликає відповідну дію.
+ *
+ * @param event EVENT_MEASURE_PRESS (FALL) або EVENT_MEASURE_RELEASE (RISE).
+ */
+void handle_measure_pin_event(const event_t *event) {
+    static uint32_t last_event_time = 0;
+    bool pressed = event->type == EVENT_MEASURE_PRESS;
+    printf("Event: %s, Time diff: %u\n", pressed ? "FALL" : "RISE",
+           (unsigned)(event->time_us - last_event_time));
+    last_event_time = event->time_us;
+    if (pressed) {
         printf("Calling measure_pin_pressed()\n");
-        measure_pin_pressed();
-    } else if (events & GPIO_IRQ_EDGE_RISE) {
+        measure_pin_pressed(event->time_us);
+    } else {
         printf("Calling measure_pin_released()\n");
-        measure_pin_released();
+        measure_pin_released(event->time_us);
     }
 }
 
 /**
- * Обробляє переривання від GPIO, розподіляючи їх між кнопкою та енкодером.
- * Для кнопки перевіряється антидребезг і викликається відповідна логіка.
- * Для енкодера обробляється поворот без антидребезгу, оновлюється індекс слайсу.
- * 
+ * Обробляє переривання від GPIO: лише антидребезг кнопки енкодера і
+ * декодування енкодера, а все інше передає подіями в основний цикл
+ * (handle_events). Якщо в одному перериванні прийшли обидва фронти
+ * кнопки, стан кнопки енкодера читається з піна.
+ *
  * @param gpio Номер GPIO, який викликав переривання.
  * @param events Тип події (FALL або RISE).
  */
 void gpio_interrupt_handler(uint gpio, uint32_t events) {
-    static uint64_t last_button_event_time = 0;
+    static uint64_t last_switch_event_time = 0;
     uint64_t current_time = time_us_64();
+    uint32_t event_time = (uint32_t)current_time;
 
     if (is_measure_pin_event(gpio)) {
-        handle_measure_pin_event(current_time, &last_button_event_time, events);
+        if (events & GPIO_IRQ_EDGE_FALL) {
+            event_post(&input_events, EVENT_MEASURE_PRESS, 0, event_time);
+        } else if (events & GPIO_IRQ_EDGE_RISE) {
+            event_post(&input_events, EVENT_MEASURE_RELEASE, 0, event_time);
+        }
     }
 
     if (is_encoder_event(gpio)) {
-        handle_encoder_rotation(events);
+        int steps = encoder_feed(&encoder, encoder_pins(), current_time);
+        if (steps != 0) event_post(&input_events, EVENT_ENCODER_STEPS, steps, event_time);
     }
 
     if (gpio == NEXT_PEAK_PIN && (events & GPIO_IRQ_EDGE_FALL)) {
-        move_to_next_peak();
+        event_post(&input_events, EVENT_NEXT_PEAK, 0, event_time);
+    }
+
+    if (is_encoder_switch_event(gpio, events) &&
+        !debounce_check(current_time, &last_switch_event_time, BUTTON_DEBOUNCE_US)) {
+        uint8_t type = gpio_get(ENCODER_SW_PIN) ? EVENT_SWITCH_RELEASE : EVENT_SWITCH_PRESS;
+        event_post(&input_events, type, 0, event_time);
     }
 }
 
 /**
- * Функція для ініціалізації всіх систем
+ * Обробляє пакет подій з переривань у порядку надходження. Кроки
+ * енкодера підряд сумуються, тож швидке обертання перемальовує графік
+ * один раз за пакет, а не на кожне клацання.
+ *
+ * @param batch Події з event_take().
+ * @param count Кількість подій.
  */
-void init_system() {
-  stdio_init_all();
-  init_adc();
-  measure_pin_init();
-  init_encoder();
-  init_next_peak_pin();
-  lcd_init(LCD_SDA_PIN, LCD_SCL_PIN);
+void handle_events(const event_t *batch, int count) {
+    int steps = 0;
+    for (int i = 0; i < count; i++) {
+        const event_t *event = &batch[i];
+        if (event->type == EVENT_ENCODER_STEPS) {
+            steps += event->value;
+            continue;
+        }
+        handle_encoder_steps(steps);
+        steps = 0;
+        switch (event->type) {
+        case EVENT_MEASURE_PRESS:
+        case EVENT_MEASURE_RELEASE:
+            handle_measure_pin_event(event);
+            break;
+        case EVENT_SWITCH_PRESS:
+        case EVENT_SWITCH_RELEASE:
+            handle_encoder_switch(event);
+            break;
+        case EVENT_NEXT_PEAK:
+            move_to_next_peak();
+            break;
+        case EVENT_CAPTURE_COMPLETE:
+            handle_capture_complete(event->value);
+            break;
+        }
+    }
+    handle_encoder_steps(steps);
 }
 
-void lcd_segment_clear() {
-  for (int i=0; i<8; i++) lcd_segment[i] = 0;
-}
+static event_t displaying_events[EVENT_QUEUE_SIZE]; // Пачки, чиї зміни ще йдуть на дисплей
+static int displaying_count = 0;
 
 /**
- * Перевіряє, чи є значення АЦП шумом.
- * 
- * @param value Значення АЦП.
- * @return 1 (true), якщо значення вважається шумом, інакше 0 (false).
+ * Рахує затримку подій до моменту, коли їхні зміни дійшли до панелі.
+ * lcd_flush() лише запускає фонове передавання, тому пачка, після якої
+ * дисплей зайнятий, чекає, доки ланцюжок STOP_DET не зупиниться, і
+ * рахується до останнього STOP (lcd_idle_time_us). Пачка, що нічого не
+ * змінила на екрані, рахується одразу. Якщо передавання триває так
+ * довго, що відкладені події не вміщаються, решта рахується одразу.
+ *
+ * @param batch Події, оброблені перед lcd_flush().
+ * @param count Кількість подій.
  */
-int is_noise(uint32_t value) {
-  return (value < ADC_NOISE + ADC_NOISE_THRESHOLD);
+void record_display_latency(const event_t *batch, int count) {
+    if (displaying_count > 0 && !lcd_busy()) {
+        event_record_latency(&input_events, displaying_events, displaying_count, lcd_idle_time_us());
+        displaying_count = 0;
+    }
+    if (!lcd_busy()) {
+        event_record_latency(&input_events, batch, count, time_us_32());
+        return;
+    }
+    int deferred = count;
+    if (deferred > EVENT_QUEUE_SIZE - displaying_count) deferred = EVENT_QUEUE_SIZE - displaying_count;
+    memcpy(&displaying_events[displaying_count], batch, deferred * sizeof(event_t));
+    displaying_count += deferred;
+    event_record_latency(&input_events, batch + deferred, count - deferred, time_us_32());
 }
 
 /**
- * Масштабує середнє значення АЦП у діапазон 1-8.
- * 
- * @param average Середнє значення АЦП.
- * @return Масштабоване значення в діапазоні 1-8.
+ * Чи може основний цикл заснути до наступної події: немає необроблених
+ * подій, сирих блоків захоплення для дециматора (capture_pending),
+ * результатів ядра 1, незавершеного аналізу запису чи запису у
+ * флеш. На Pico решту роботи (блоки DMA, термінал USB, дисплей) приносять
+ * переривання, які й так будять ядро. На хості захоплення симулюється в
+ * capture_poll(), а потік аналізу не будить основний цикл, тому під час
+ * запису й аналізу цикл не спить.
  */
-int scale_adc_value(uint32_t average) {
-    int max_value = 3200; // 4096
-    if (average < ADC_NOISE) return 1;
-    return ((average - ADC_NOISE) * 7 + (max_value - ADC_NOISE) / 2) / (max_value - ADC_NOISE) + 1;
+bool main_loop_idle() {
+#if !PICO_ON_DEVICE
+    if (capture_running() || pipeline_busy()) return false;
+#endif
+    return !event_pending(&input_events) && !capture_pending() && !pipeline_result_ready() &&
+           !data_collection_complete && !flash_log_busy(&flash_log) &&
+           zoom_target < 0 && (spectrogram_target < 0 || pipeline_busy()) && !should_update_encoder_display();
 }
 
 /**
- * Обробляє піксель-вказівник для стовпчика на LCD.
- * @param bit_position Позиція біта в байті (0–4), що відповідає стовпчику.
- * @param value Висота стовпчика (0–7).
+ * Розкладає арену при старті. Спершу постійні буфери (кільце потоку,
+ * позначки часу, кошики статистики), потім запис — усе, що лишилося
+ * після резерву ANALYSIS_SCRATCH_BYTES, а резерв займає регіон аналізу:
+ * результати запису й буфер ШПФ. Довжину запису можна подовжити за
+ * рахунок резерву, якщо пікове заповнення арени (print_arena_usage) це дозволяє.
  */
-void handle_pointer_pixel(int bit_position, int value) {
-#if POINTER_POSITION == 7
-    // Вимикаємо нижній піксель, рядок 7, якщо він був увімкнений
-    if (value > 0) {
-        lcd_segment[7] &= ~(1 << bit_position);
-    }
-#elif POINTER_POSITION == 0
-    // Вмикаємо верхній піксель, рядок 0
-    lcd_segment[0] |= (1 << bit_position);
-#else
-#error "POINTER_POSITION must be 7 (bottom) or 0 (top)"
+void init_memory_layout() {
+  arena_init(&arena, arena_memory, sizeof(arena_memory));
+  adc_values = arena_alloc(&arena, SAMPLE_ARRAY_SIZE * sizeof(uint16_t));
+#ifdef SAMPLE_TIMESTAMPS
+  adc_deltas = arena_alloc(&arena, SAMPLE_ARRAY_SIZE * sizeof(uint16_t));
 #endif
+  slice_buckets = arena_alloc(&arena, SLICE_BUCKET_COUNT * sizeof(slice_bucket_t));
+
+  size_t free_bytes = arena_free(&arena);
+  recording_bytes = free_bytes > ANALYSIS_SCRATCH_BYTES ? free_bytes - ANALYSIS_SCRATCH_BYTES : 0;
+  recording_memory = arena_alloc(&arena, recording_bytes);
+  if (!recording_memory ||
+      !sample_store_init(&recording, recording_memory, recording_bytes,
+                         RECORDING_MAX_SAMPLES, RECORDING_DELTA_ENCODING)) {
+    printf("Arena too small for recording!\n");
+  }
+  analysis_mark = arena_mark(&arena);
+
+  // Пробне виділення всього регіону аналізу: резерв має його вміщувати
+  begin_analysis_region();
+  if (!borrow_fft_buffer()) printf("ANALYSIS_SCRATCH_BYTES too small for FFT!\n");
+  return_fft_buffer();
+  printf("Arena: %u bytes, recording %u bytes (at least %d samples), analysis %u bytes\n",
+         (unsigned)sizeof(arena_memory), (unsigned)recording_bytes,
+         sample_store_capacity(&recording), (unsigned)(arena_peak(&arena) - analysis_mark));
 }
 
 /**
- * Малює вертикальний стовпчик на LCD-екрані.
- * @param pos Позиція стовпчика (0–4).
- * @param value Висота стовпчика (0–7).
- * @param enable_pointer Чи вмикати/вимикати піксель-вказівник (залежно від POINTER_POSITION).
+ * Починає регіон аналізу нового запису: звільняє все, що позичив
+ * попередній запис, і виділяє та обнуляє масиви результатів.
+ * Викликається, коли ядро 1 вільне (новий запис не стартує під час аналізу).
  */
-void set_lcd_segment_row(int pos, int value, bool enable_pointer) {
-    if (pos < 0) pos = 0;
-    if (pos > 4) pos = 4;
-    if (value > 7) value = 7;  // Максимальна висота — 7, а не 8
-    if (value < 0) value = 0;
-
-    int bit_position = 4 - pos; // Позиція біта в байті (зліва направо)
-    int start_row = 8 - value;  // Початок малювання стовпчика
-
-    for (int i = 7; i >= start_row; i--) { // Заповнюємо стовпчик відповідно до висоти
-        lcd_segment[i] |= (1 << bit_position); // Увімкнемо біт
-    }
-
-    if (enable_pointer) {
-        handle_pointer_pixel(bit_position, value);
-    }
+void begin_analysis_region() {
+  if (flash_log_busy(&flash_log)) {
+    // Запис і його підсумок зараз буде перезаписано
+    flash_log_abort(&flash_log);
+    printf("Recording not saved: new capture started\n");
+  }
+  arena_release(&arena, analysis_mark);
+  fft_buffer = NULL;
+  saved_slices_averages = arena_alloc(&arena, TOTAL_SLICES * sizeof(uint32_t));
+  saved_slices_maximums = arena_alloc(&arena, TOTAL_SLICES * sizeof(uint32_t));
+  slice_levels = arena_alloc(&arena, TOTAL_SLICES * sizeof(meter_reading_t));
+  peak_slices = arena_alloc(&arena, TOTAL_SLICES * sizeof(int));
+  peak_durations = arena_alloc(&arena, TOTAL_SLICES * sizeof(int));
+  peak_events = arena_alloc(&arena, TOTAL_SLICES * sizeof(peak_event_t));
+  recording_summary = arena_alloc(&arena, sizeof(recording_summary_t));
+  pyramid_nodes = arena_alloc(&arena, PYRAMID_NODES * sizeof(pyramid_node_t));
+  pyramid_init(&pyramid, pyramid_nodes, PYRAMID_NODES);
+  // Розмір регіону перевірено в init_memory_layout, тож NULL тут неможливий
+  memset(saved_slices_averages, 0, TOTAL_SLICES * sizeof(uint32_t));
+  memset(saved_slices_maximums, 0, TOTAL_SLICES * sizeof(uint32_t));
+  for (int i = 0; i < TOTAL_SLICES; i++) {
+    slice_levels[i] = (meter_reading_t){ METER_SILENCE_DB10, METER_SILENCE_DB10,
+                                         METER_SILENCE_DB10, METER_SILENCE_DB10 };
+  }
+  peak_count = 0;
+  current_peak_index = -1;
+  zoom_level = 0;
+  zoom_target = -1;
+  zoom_center = -1;
+  spectrogram_target = -1;
+  graph_averages = saved_slices_averages;
+  graph_maximums = saved_slices_maximums;
 }
 
 /**
- * Записує поточний вміст масиву lcd_segment на екран LCD.
+ * Позичає буфер ШПФ у регіоні аналізу до return_fft_buffer().
  *
- * Ця функція створює користувацький символ на LCD на основі даних, збережених у масиві 
- * lcd_segment. Потім встановлює курсор у вказану позицію на екрані та виводить створений 
- * символ.
- *
- * @param cursor_position Вертикальна позиція (рядок) на LCD, куди буде записано символ.
+ * @return bool False, якщо місця в арені не вистачає.
  */
-void lcd_segment_write(int cursor_position) {
-  lcd_createChar(cursor_position, lcd_segment);
-  lcd_setCursor(0, cursor_position);
-  lcd_write(cursor_position);
+bool borrow_fft_buffer() {
+  spectrum_mark = arena_mark(&arena);
+  fft_buffer = arena_alloc(&arena, FFT_SIZE * sizeof(int16_t));
+  return fft_buffer != NULL;
 }
 
-uint32_t calculate_average(int from, int to) {
-    uint32_t sum = 0;
-    int count = 0;
-    for (int i = from; i < to; i++) {
-        if (is_noise(adc_values[i])) continue;
-        sum += adc_values[i];
-        count++;
+void return_fft_buffer() {
+  arena_release(&arena, spectrum_mark);
+  fft_buffer = NULL;
+}
+
+void print_arena_usage() {
+  printf("Arena: used %u of %u bytes, peak %u; recording %u of %u bytes\n",
+         (unsigned)arena_used(&arena), (unsigned)sizeof(arena_memory), (unsigned)arena_peak(&arena),
+         (unsigned)sample_store_bytes(&recording), (unsigned)recording_bytes);
+}
+
+/**
+ * Заповнює підсумок запису (частота, рівень тиші, слайси, піки) і ставить
+ * запис у чергу на збереження у флеш. Самі операції з флешем виконує
+ * service_flash_log() між записами.
+ */
+void save_recording() {
+  recording_summary_t *summary = recording_summary;
+  memset(summary, 0, sizeof(*summary));
+  summary->version = RECORDING_SUMMARY_VERSION;
+  summary->sample_rate = capture_sample_rate();
+  summary->sample_count = sample_index;
+  summary->slice_length = recording_slice_length();
+  summary->noise_level = noise_level;
+  summary->noise_gate = noise_gate;
+  summary->peak_count = peak_count;
+  summary->packed_bytes = sample_store_bytes(&recording);
+  memcpy(summary->averages, saved_slices_averages, sizeof(summary->averages));
+  memcpy(summary->maximums, saved_slices_maximums, sizeof(summary->maximums));
+  memcpy(summary->peaks, peak_events, peak_count * sizeof(peak_event_t));
+  if (!flash_log_begin(&flash_log, sizeof(*summary) + summary->packed_bytes, read_saved_recording)) {
+    printf("Recording not saved: flash log unavailable\n");
+  }
+}
+
+/**
+ * Джерело вмісту запису журналу: підсумок, за ним упаковані зразки.
+ */
+void read_saved_recording(uint32_t offset, uint8_t *out, uint32_t bytes) {
+  const uint32_t summary_bytes = sizeof(recording_summary_t);
+  if (offset < summary_bytes) {
+    uint32_t part = summary_bytes - offset < bytes ? summary_bytes - offset : bytes;
+    memcpy(out, (const uint8_t *)recording_summary + offset, part);
+    offset += part;
+    out += part;
+    bytes -= part;
+  }
+  if (bytes > 0) memcpy(out, sample_store_packed(&recording) + (offset - summary_bytes), bytes);
+}
+
+/**
+ * Просуває збереження запису у флеш. Флеш займається лише між записами і
+ * коли конвеєр порожній: на час операцій ядро 1 чекає в RAM, переривання
+ * ядра 0 вимкнені, тож під час запису захоплення флеш не чіпається взагалі.
+ * За один виклик — операції протягом FLASH_LOG_SLICE_US (стирання сектора
+ * завжди ціле).
+ */
+void service_flash_log() {
+  if (!flash_log_busy(&flash_log) || collecting_data || !pipeline_park()) return;
+  uint64_t start_time = time_us_64();
+  bool ok = true;
+  while (ok && flash_log_busy(&flash_log) && time_us_64() - start_time < FLASH_LOG_SLICE_US) {
+    ok = flash_log_step(&flash_log);
+  }
+  pipeline_unpark();
+  if (!ok) {
+    printf("Recording not saved: flash error\n");
+  } else if (!flash_log_busy(&flash_log)) {
+    const flash_log_record_t *record = flash_log_record(&flash_log, flash_log_count(&flash_log) - 1);
+    printf("Recording saved: #%u, %u bytes (%u erases, %u programs total)\n",
+           (unsigned)record->sequence, (unsigned)record->length,
+           (unsigned)flash_log.erases, (unsigned)flash_log.programs);
+  }
+}
+
+/**
+ * Виводить у термінал збережені записи (команда l), найновіший — останнім.
+ */
+void list_saved_recordings() {
+  printf("Saved recordings: %d\n", flash_log_count(&flash_log));
+  for (int i = 0; i < flash_log_count(&flash_log); i++) {
+    const flash_log_record_t *record = flash_log_record(&flash_log, i);
+    recording_summary_t head; // Лише поля до масивів, решта не читається
+    flash_log_read(&flash_log, i, 0, (uint8_t *)&head, offsetof(recording_summary_t, averages));
+    printf(" #%u: %u bytes, %u samples at %u Hz, %u peaks\n", (unsigned)record->sequence,
+           (unsigned)record->length, (unsigned)head.sample_count, (unsigned)head.sample_rate,
+           (unsigned)head.peak_count);
+  }
+}
+
+/**
+ * Надсилає байти без перетворення кінців рядків. На Pico — лише в USB:
+ * UART на 115200 бод сповільнив би вивантаження в сотню разів.
+ */
+void write_raw(const uint8_t *data, uint32_t bytes) {
+#if PICO_ON_DEVICE
+  stdio_usb.out_chars((const char *)data, (int)bytes);
+#else
+  fwrite(data, 1, bytes, stdout);
+#endif
+}
+
+/**
+ * Вивід кадрів протоколу (frame_writer_t). Без підключеного USB кадр
+ * відкидається одразу, а не чекає тайм-ауту stdio.
+ */
+bool write_frame(const uint8_t *data, uint32_t bytes) {
+#if PICO_ON_DEVICE
+  if (!stdio_usb_connected()) return false;
+#endif
+  write_raw(data, bytes);
+  return true;
+}
+
+/**
+ * Вмикає або вимикає двійковий вивід (команда b). Текст printf
+ * лишається, але декодер його пропускає.
+ */
+void toggle_binary_output() {
+  binary_output = !binary_output;
+  printf("Binary output %s\n", binary_output ? "on" : "off");
+  stdio_flush();
+  if (binary_output) {
+    frame_reset_stats();
+    frame_send_info(capture_sample_rate(), capture_decimation(), STREAM_BLOCK_SIZE);
+  }
+}
+
+/**
+ * Надсилає кадрами результат запису: зразки (якщо їх не надіслано під час
+ * потоку), слайси, піки, нові записи траси і лічильники каналу.
+ */
+void send_recording_frames() {
+  if (!recording_streamed) {
+    sample_span_t span;
+    frame_reset_stats();
+    frame_send_info(capture_sample_rate(), capture_decimation(), STREAM_BLOCK_SIZE);
+    sample_span_store(&span, &recording, 0, sample_index);
+    for (uint32_t first = 0; sample_span_next(&span); first += span.count) {
+      frame_send_samples(first, span.samples, span.count);
+    }
+  }
+  frame_send_slices(saved_slices_averages, saved_slices_maximums, TOTAL_SLICES, recording_slice_length());
+  frame_send_peaks(peak_events, peak_count);
+  trace_record_t records[16];
+  int count;
+  while ((count = TRACE_READ(&trace_sent, records, 16)) > 0) frame_send_trace(records, count);
+  print_frame_stats();
+  frame_send_stats(capture_overruns());
+}
+
+/**
+ * Виводить завантаження каналу кадрів: частку часу, витрачену на
+ * кодування й надсилання, і запас до повного завантаження.
+ */
+void print_frame_stats() {
+  const frame_stats_t *stats = frame_stats();
+  uint64_t elapsed_us = time_us_64() - stats->started_us;
+  uint32_t busy_permille = elapsed_us ? (uint32_t)(stats->busy_us * 1000 / elapsed_us) : 0;
+  stdio_flush();
+  printf("\nFrames: %u sent, %u dropped, %u bytes, busy %u of %u ms, headroom %u.%u%%\n",
+         (unsigned)stats->frames, (unsigned)stats->dropped, (unsigned)stats->bytes,
+         (unsigned)(stats->busy_us / 1000), (unsigned)(elapsed_us / 1000),
+         (unsigned)(1000 - busy_permille) / 10, (unsigned)(1000 - busy_permille) % 10);
+}
+
+/**
+ * Вивантажує збережений запис (команда d — найновіший): рядок
+ * "#FL <номер> <байтів>", сирий вміст прямо з флешу і рядок "#FE".
+ *
+ * @param index Номер в індексі журналу.
+ */
+void dump_saved_recording(int index) {
+  const flash_log_record_t *record = flash_log_record(&flash_log, index);
+  if (!record) {
+    printf("No saved recordings\n");
+    return;
+  }
+  printf("#FL %u %u\n", (unsigned)record->sequence, (unsigned)record->length);
+  stdio_flush();
+  uint32_t offset = 0, bytes;
+  const uint8_t *chunk;
+  while ((chunk = flash_log_chunk(&flash_log, index, offset, &bytes)) != NULL) {
+    write_raw(chunk, bytes);
+    offset += bytes;
+  }
+  stdio_flush();
+  printf("\n#FE\n");
+}
+
+/**
+ * Функція для ініціалізації всіх систем
+ */
+void init_system() {
+  stdio_init_all();
+  TRACE_INIT();
+  init_adc();
+  init_memory_layout();
+  event_queue_init(&input_events);
+#ifdef SAMPLE_TIMESTAMPS
+  capture_set_timestamps(adc_deltas, SAMPLE_ARRAY_SIZE);
+  capture_init(CAPTURE_TIMESTAMPED_SOURCE, SAMPLE_RATE_HZ, capture_complete_handler);
+#else
+  capture_init(CAPTURE_DEFAULT_SOURCE, SAMPLE_RATE_HZ, capture_complete_handler);
+#endif
+  noise_floor_init(&noise_floor, ADC_NOISE, ADC_NOISE_THRESHOLD / NOISE_FLOOR_GATE_FACTOR,
+                   SAMPLE_RATE_HZ * NOISE_FLOOR_TAU_MS / 1000);
+  update_noise_gate();
+  select_sample_rate(0);
+  slice_stats_init(slice_buckets, SLICE_BUCKET_COUNT);
+  frame_init(write_frame);
+  flash_log_mount(&flash_log, FLASH_DEFAULT_DEVICE, FLASH_DEFAULT_DEVICE->size - FLASH_LOG_BYTES,
+                  FLASH_LOG_BYTES);
+  measure_pin_init();
+  init_encoder();
+  init_encoder_switch();
+  init_next_peak_pin();
+  pipeline_init(run_analysis_job, analysis_stage_names, ANALYSIS_STAGES);
+  lcd_init(LCD_SDA_PIN, LCD_SCL_PIN);
+}
+
+// Частоти аналізу, між якими перемикає команда f
+static const uint32_t sample_rate_presets[] = {1000, 4000, 8000, 16000};
+#define SAMPLE_RATE_PRESETS (int)(sizeof(sample_rate_presets) / sizeof(sample_rate_presets[0]))
+static int sample_rate_preset = 0;
+
+/**
+ * Задає частоту аналізу з набору пресетів. АЦП працює з найбільшою
+ * передискретизацією, яку дозволяють джерело і дециматор; якщо джерело
+ * не тягне такої частоти (наприклад, запис за таймером), — без неї.
+ *
+ * @param preset Індекс у sample_rate_presets.
+ * @return bool False, якщо запис триває або частота недоступна.
+ */
+bool select_sample_rate(int preset) {
+  uint32_t rate = sample_rate_presets[preset];
+  int decimation = CAPTURE_MAX_ADC_RATE_HZ / rate;
+  if (decimation > DECIMATE_MAX_FACTOR) decimation = DECIMATE_MAX_FACTOR;
+  if (!capture_set_rate(rate, decimation) && !capture_set_rate(rate, 1)) return false;
+  sample_rate_preset = preset;
+  noise_floor_set_time_constant(&noise_floor, rate * NOISE_FLOOR_TAU_MS / 1000);
+  meter_init(&meter, rate, meter_weighting);
+  return true;
+}
+
+/**
+ * Задає зважування рівня для наступних записів. A-зважування діє лише від
+ * METER_A_WEIGHTING_MIN_HZ, на нижчих частотах вимірювач працює без нього.
+ *
+ * @param weighting Бажане зважування (meter_weighting_t).
+ */
+void select_meter_weighting(uint8_t weighting) {
+  if (collecting_data || pipeline_busy()) {
+    printf("Level weighting unchanged: %s\n", meter_weighting_name(meter.weighting));
+    return;
+  }
+  meter_weighting = weighting;
+  meter_init(&meter, capture_sample_rate(), meter_weighting);
+  printf("Level weighting: %s%s\n", meter_weighting_name(meter.weighting),
+         meter.weighting != meter_weighting ? " (A needs 4 kHz)" : "");
+}
+
+/**
+ * Калібрує рівень за останнім записом: мікрофон у калібраторі, і весь
+ * запис має рівень METER_CALIBRATOR_DB10. Поправка діє до перезапуску.
+ */
+void calibrate_meter() {
+  int16_t leq = meter_leq_db10(&meter);
+  if (collecting_data || pipeline_busy() || leq == METER_SILENCE_DB10) {
+    printf("Calibration refused: no finished recording\n");
+    return;
+  }
+  meter_calibration_db10 = METER_CALIBRATOR_DB10 - leq;
+  char buffer[8];
+  format_db10(buffer, meter_calibration_db10);
+  printf("Level calibration: 0 dBFS = %s dB\n", buffer);
+}
+
+/**
+ * Читає команди з терміналу без очікування. Єдине місце, яке забирає
+ * символи зі stdin: f — наступна частота аналізу, решта передається трасі.
+ */
+void handle_terminal_commands() {
+  int command = getchar_timeout_us(0);
+  if (command < 0) return;
+  if (command == 'b') {
+    toggle_binary_output();
+    return;
+  }
+  if (command == 'a') {
+    if (trigger_armed) trigger_disarm();
+    else trigger_arm();
+    return;
+  }
+  if (command == 'g') {
+    trigger_mode = (trigger_mode + 1) % TRIGGER_MODES;
+    printf("Trigger mode: %s%s\n", trigger_mode_name(trigger_mode), trigger_armed ? " (next arm)" : "");
+    return;
+  }
+  if (command == 'e') {
+    event_print_stats(&input_events);
+    return;
+  }
+  if (command == 'm') {
+    toggle_graph_quantity();
+    return;
+  }
+  if (command == 'w') {
+    select_meter_weighting((meter_weighting + 1) % METER_WEIGHTINGS);
+    return;
+  }
+  if (command == 'k') {
+    calibrate_meter();
+    return;
+  }
+  if (command == 'p') {
+    print_spectrogram();
+    return;
+  }
+  if (command == 'l') {
+    list_saved_recordings();
+    return;
+  }
+  if (command == 'd') {
+    if (collecting_data) printf("Dump refused while recording\n");
+    else dump_saved_recording(flash_log_count(&flash_log) - 1);
+    return;
+  }
+  if (command == 'f') {
+    if (collecting_data || !select_sample_rate((sample_rate_preset + 1) % SAMPLE_RATE_PRESETS)) {
+      printf("Sample rate unchanged: %u Hz\n", (unsigned)capture_sample_rate());
+    }
+    return;
+  }
+  TRACE_COMMAND(command);
+}
+
+void lcd_segment_clear() {
+  for (int i=0; i<8; i++) lcd_segment[i] = 0;
+}
+
+/**
+ * Перевіряє, чи є значення АЦП шумом.
+ * 
+ * @param value Значення АЦП.
+ * @return 1 (true), якщо значення вважається шумом, інакше 0 (false).
+ */
+int is_noise(uint32_t value) {
+  return (value < noise_gate);
+}
+
+/**
+ * Переносить поточну оцінку noise_floor у поріг шуму й рівень тиші, за
+ * якими працюють is_noise(), накопичувач слайсів, детектор піків і масштаб
+ * графіка. Викликається перед кожним записом і після кожного блоку потоку.
+ */
+void update_noise_gate() {
+  noise_level = noise_floor_level(&noise_floor);
+  noise_gate = noise_floor_gate(&noise_floor, ADC_NOISE_THRESHOLD);
+}
+
+void print_noise_floor() {
+  printf("Noise floor: level %u, deviation %u, gate %u (now %u)\n", noise_level,
+         noise_floor_deviation(&noise_floor), noise_gate, noise_floor_level(&noise_floor));
+}
+
+/**
+ * Масштабує середнє значення АЦП у діапазон 1-8. Шкала починається від
+ * рівня тиші і має висоту ADC_GRAPH_SPAN; висота береться з таблиці,
+ * згенерованої під час збірки (adc_scale.c), без ділення.
+ * 
+ * @param average Середнє значення АЦП.
+ * @return Масштабоване значення в діапазоні 1-8.
+ */
+int scale_adc_value(uint32_t average) {
+    return adc_bar_height(average, noise_level);
+}
+
+/**
+ * Висота стовпчика для рівня: 1 на METER_GRAPH_FLOOR_DB10 і нижче, далі
+ * на одиницю за кожну сьому частину відстані до 0 dBFS.
+ *
+ * @param db10 Рівень у десятих dBFS.
+ * @return int Висота в діапазоні 1-8.
+ */
+int level_height(int16_t db10) {
+    if (db10 <= METER_GRAPH_FLOOR_DB10) return 1;
+    int height = 1 + (db10 - METER_GRAPH_FLOOR_DB10) / (-METER_GRAPH_FLOOR_DB10 / 7);
+    return height > 8 ? 8 : height;
+}
+
+/**
+ * Висота стовпчика слайсу для величини graph_quantity. Рівні є лише для
+ * слайсів усього запису, тож наближений графік (zoom_averages) показує середні.
+ *
+ * @param slices_averages Середні значення стовпчиків графіка.
+ * @param slice Індекс слайсу (0–39).
+ */
+int graph_column_height(const uint32_t *slices_averages, int slice) {
+    if (graph_quantity == GRAPH_LEVELS && slices_averages == saved_slices_averages) {
+        return level_height(slice_levels[slice].rms_db10);
+    }
+    return scale_adc_value(slices_averages[slice]);
+}
+
+/**
+ * Записує рівень у десятих дБ як "-23.4", цілочисельно (format_fixed).
+ *
+ * @return char* Кінець рядка (символ '\0').
+ */
+char *format_db10(char *out, int32_t db10) {
+    if (db10 < 0) {
+        *out++ = '-';
+        db10 = -db10;
+    }
+    return format_fixed(out, (uint32_t)db10, 1);
+}
+
+/**
+ * Обробляє піксель-вказівник для стовпчика на LCD.
+ * @param bit_position Позиція біта в байті (0–4), що відповідає стовпчику.
+ * @param value Висота стовпчика (0–7).
+ */
+void handle_pointer_pixel(int bit_position, int value) {
+#if POINTER_POSITION == 7
+    // Вимикаємо нижній піксель, рядок 7, якщо він був увімкнений
+    if (value > 0) {
+        lcd_segment[7] &= ~(1 << bit_position);
+    }
+#elif POINTER_POSITION == 0
+    // Вмикаємо верхній піксель, рядок 0
+    lcd_segment[0] |= (1 << bit_position);
+#else
+#error "POINTER_POSITION must be 7 (bottom) or 0 (top)"
+#endif
+}
+
+/**
+ * Малює вертикальний стовпчик на LCD-екрані.
+ * @param pos Позиція стовпчика (0–4).
+ * @param value Висота стовпчика (0–7).
+ * @param enable_pointer Чи вмикати/вимикати піксель-вказівник (залежно від POINTER_POSITION).
+ */
+void set_lcd_segment_row(int pos, int value, bool enable_pointer) {
+    if (pos < 0) pos = 0;
+    if (pos > 4) pos = 4;
+    if (value > 7) value = 7;  // Максимальна висота — 7, а не 8
+    if (value < 0) value = 0;
+
+    int bit_position = 4 - pos; // Позиція біта в байті (зліва направо)
+    int start_row = 8 - value;  // Початок малювання стовпчика
+
+    for (int i = 7; i >= start_row; i--) { // Заповнюємо стовпчик відповідно до висоти
+        lcd_segment[i] |= (1 << bit_position); // Увімкнемо біт
+    }
+
+    if (enable_pointer) {
+        handle_pointer_pixel(bit_position, value);
+    }
+}
+
+/**
+ * Записує поточний вміст масиву lcd_segment на екран LCD.
+ *
+ * Символ береться з кешу символів за вмістом: однакові стовпчики (рівні
+ * або тихі ділянки) ділять один слот CGRAM, а завантаження відбувається
+ * лише для нового бітмапу. Потім символ виводиться у вказану позицію.
+ *
+ * @param cursor_position Вертикальна позиція (рядок) на LCD, куди буде записано символ.
+ */
+void lcd_segment_write(int cursor_position) {
+  lcd_setCursor(0, cursor_position);
+  lcd_write_glyph(lcd_segment);
+}
+
+uint32_t calculate_average(int from, int to) {
+    uint32_t sum = 0;
+    int count = 0;
+    sample_span_t span;
+    sample_span_store(&span, &recording, from, to);
+    while (sample_span_next(&span)) {
+        for (int i = 0; i < span.count; i++) {
+            if (is_noise(span.samples[i])) continue;
+            sum += span.samples[i];
+            count++;
+        }
     }
     if (count == 0) return 0; // Якщо немає допустимих значень, повертаємо 0
 
@@ -393,263 +1598,929 @@ void print_slices_averages(uint32_t slices_averages[], int slices_count) {
 }
 
 /**
- * Виводить кількість зібраних зразків (sample_count) і довжину слайсу (slice_length)
- * на LCD у рядку 0, починаючи з позиції 8. Якщо рядок коротший за 8 символів,
- * він зсувається максимально вправо так, щоб останній символ був на позиції 15.
- * Значення розділяються символом '/'.
+ * Виводить у термінал рівні кожного слайсу (rms/fast/peak, dBFS), рівень
+ * усього запису й утримання піку — в dBFS і в дБ після калібрування.
+ */
+void print_slice_levels() {
+    char rms[8], fast[8], peak[8];
+    const char *weighting = meter_weighting_name(meter.weighting);
+    printf("Levels, dB%s re full scale (rms/fast/peak):\n", weighting);
+    for (int i = 0; i < TOTAL_SLICES; i++) {
+        format_db10(rms, slice_levels[i].rms_db10);
+        format_db10(fast, slice_levels[i].fast_db10);
+        format_db10(peak, slice_levels[i].peak_db10);
+        printf(" %s/%s/%s", rms, fast, peak);
+        if ((i + 1) % 5 == 0) printf("\n");
+    }
+    int16_t leq = meter_leq_db10(&meter);
+    int16_t hold = meter_hold_db10(&meter);
+    format_db10(rms, leq);
+    format_db10(fast, leq + meter_calibration_db10);
+    printf("Leq %s dBFS = %s dB%s", rms, fast, weighting);
+    format_db10(rms, hold);
+    format_db10(fast, hold + meter_calibration_db10);
+    printf(", hold %s dBFS = %s dB%s\n", rms, fast, weighting);
+}
+
+/**
+ * Виводить кількість зібраних зразків (sample_count) і довжину слайсу (slice_length)
+ * на LCD у рядку 0, починаючи з позиції 8. Якщо рядок коротший за 8 символів,
+ * він зсувається максимально вправо так, щоб останній символ був на позиції 15.
+ * Значення розділяються символом '/'. Коли широкий графік займає весь рядок 0,
+ * значення виводяться лише в термінал.
+ *
+ * Довгі упаковані записи (від 10000 зразків) показуються в тисячах: "104k/2617".
+ *
+ * @param sample_count Кількість зібраних зразків.
+ * @param slice_length Довжина одного слайсу.
+ */
+void display_slice_info(int sample_count, int slice_length) {
+  printf("Effective samples count: %d; slice length %d\n", sample_count, slice_length);
+  if (graph_wide) return;
+
+  char buffer[24]; // На LCD іде не більше 8 символів, решта — запас на два числа
+  char *end;
+  if (sample_count >= 10000) {
+    end = format_uint(buffer, (uint32_t)sample_count / 1000, 0);
+    *end++ = 'k';
+  } else {
+    end = format_uint(buffer, (uint32_t)sample_count, 0);
+  }
+  *end++ = '/';
+  format_uint(end, (uint32_t)slice_length, 0);
+  buffer[8] = '\0';
+
+  int len = strlen(buffer);
+  int start_pos = (len < 8) ? (15 - len + 1) : 8; // Зсув до позиції 15, якщо<8
+
+  lcd_setCursor(0, start_pos);
+  lcd_print(buffer);
+}
+
+/**
+ * Обчислює середнє та максимум значень, що не є шумом (не нижче gate).
+ *
+ * @param span Зразки (з кільця потоку або із запису).
+ * @param gate Поріг шуму.
+ * @param average Середнє або 0, якщо всі зразки — шум.
+ * @param maximum Максимум або 0.
+ */
+void span_average_max(sample_span_t *span, uint16_t gate, uint32_t *average, uint32_t *maximum) {
+  uint32_t sum = 0;
+  uint32_t max = 0;
+  int count = 0;
+  while (sample_span_next(span)) {
+    for (int j = 0; j < span->count; j++) {
+      uint16_t value = span->samples[j];
+      if (value >= gate) {
+        sum += value;
+        if (value > max) max = value;
+        count++;
+      }
+    }
+  }
+  *average = (count > 0) ? (sum / count) : 0;
+  *maximum = max;
+}
+
+/**
+ * Обчислює середнє та максимум значень, що не є шумом, для одного слайсу
+ * і зберігає їх у saved_slices_averages і saved_slices_maximums.
+ *
+ * @param slice Індекс слайсу (0–TOTAL_SLICES-1).
+ * @param span Зразки слайсу (із запису).
+ */
+void calculate_slice_stats(int slice, sample_span_t *span) {
+  span_average_max(span, noise_gate, &saved_slices_averages[slice], &saved_slices_maximums[slice]);
+}
+
+void calculate_slice_averages(int effective_samples, int slice_length, 
+                              uint32_t* slices_averages, uint32_t* saved_slices_averages) {
+  for (int i = 0; i < TOTAL_SLICES; i++) {
+    int start_idx = i * slice_length;
+    int end_idx = (i + 1) * slice_length;
+    if (end_idx > effective_samples) end_idx = effective_samples;
+
+    sample_span_t span;
+    sample_span_store(&span, &recording, start_idx, end_idx);
+    calculate_slice_stats(i, &span);
+    slices_averages[i] = saved_slices_averages[i];
+  }
+}
+
+#ifdef SLICE_STATS_VERIFY
+/**
+ * Порівнює результат онлайн-накопичувача з пакетним calculate_slice_averages()
+ * і виводить у термінал слайси, що не збігаються.
+ */
+void verify_slice_stats(int effective_samples, int slice_length) {
+    uint32_t online_averages[TOTAL_SLICES];
+    uint32_t online_maximums[TOTAL_SLICES];
+    uint32_t batch_averages[TOTAL_SLICES];
+    memcpy(online_averages, saved_slices_averages, sizeof(online_averages));
+    memcpy(online_maximums, saved_slices_maximums, sizeof(online_maximums));
+
+    calculate_slice_averages(effective_samples, slice_length, batch_averages, saved_slices_averages);
+
+    int mismatches = 0;
+    for (int i = 0; i < TOTAL_SLICES; i++) {
+        if (online_averages[i] != batch_averages[i] || online_maximums[i] != saved_slices_maximums[i]) {
+            printf("Slice %d mismatch: online %u/%u, batch %u/%u\n", i,
+                   online_averages[i], online_maximums[i], batch_averages[i], saved_slices_maximums[i]);
+            mismatches++;
+        }
+    }
+    printf("Slice stats verify: %d mismatches\n", mismatches);
+}
+#endif
+
+/**
+ * Кількість символів графіка в рядку 0: GRAPH_WIDE_CELLS для широкого
+ * графіка, інакше GRAPH_LENGTH.
+ */
+int graph_cells() {
+    return graph_wide ? GRAPH_WIDE_CELLS : GRAPH_LENGTH;
+}
+
+/**
+ * Будує в lcd_segment символ cell графіка з cells символів. Стовпчик пікселів x
+ * показує слайс x * TOTAL_SLICES / (cells * GRAPH_SLICE_LENGTH): у вузькому
+ * графіку — один стовпчик на слайс, у широкому — два.
+ *
+ * @param cell Номер символу в рядку 0.
+ * @param cells Кількість символів графіка.
+ * @param slices_averages Стовпчики графіка або NULL — висота за поточним режимом (column_height).
+ * @param pointer_slice Слайс під вказівником або -1.
+ */
+void build_graph_cell(int cell, int cells, const uint32_t *slices_averages, int pointer_slice) {
+    lcd_segment_clear();
+    for (int pos = 0; pos < GRAPH_SLICE_LENGTH; pos++) {
+        int slice = (cell * GRAPH_SLICE_LENGTH + pos) * TOTAL_SLICES / (cells * GRAPH_SLICE_LENGTH);
+        if (slice >= TOTAL_SLICES) break;
+        int height = slices_averages ? graph_column_height(slices_averages, slice) : column_height(slice);
+        set_lcd_segment_row(pos, height, slice == pointer_slice);
+    }
+}
+
+/**
+ * Відображає графік на LCD, масштабуючи величину graph_quantity кожного слайсу і
+ * записуючи її у сегменти дисплея. Якщо графік на весь рядок 0 (по 2 стовпчики
+ * пікселів на слайс) складається не більше ніж з LCD_CGRAM_SLOTS - 2 різних
+ * символів — тиша, рівні ділянки, — малюється він: решта слотів лишається
+ * символам із вказівником. Інакше кожні 5 слайсів формують один символ у
+ * позиціях 0–7, а праворуч лишається місце для підписів.
+ *
+ * @param slices_averages Масив середніх значень слайсів для масштабування та відображення.
+ */
+void display_graph(uint32_t* slices_averages) {
+    TRACE_BEGIN(TRACE_GRAPH);
+    uint8_t bitmaps[GRAPH_WIDE_CELLS][8];
+    int distinct = 0;
+    for (int cell = 0; cell < GRAPH_WIDE_CELLS; cell++) {
+        build_graph_cell(cell, GRAPH_WIDE_CELLS, slices_averages, -1);
+        memcpy(bitmaps[cell], lcd_segment, 8);
+        bool repeated = true;
+        for (int i = 0; i < 8; i++) {
+            if (lcd_segment[i]) repeated = false; // Порожній символ — пробіл, слота не займає
+        }
+        for (int other = 0; other < cell && !repeated; other++) {
+            repeated = memcmp(bitmaps[other], lcd_segment, 8) == 0;
+        }
+        if (!repeated) distinct++;
+    }
+
+    bool was_wide = graph_wide;
+    graph_wide = distinct <= LCD_CGRAM_SLOTS - 2;
+    for (int cell = 0; cell < graph_cells(); cell++) {
+        if (graph_wide) memcpy(lcd_segment, bitmaps[cell], 8);
+        else build_graph_cell(cell, GRAPH_LENGTH, slices_averages, -1);
+        lcd_segment_write(cell);
+    }
+    lcd_segment_clear();
+    if (was_wide && !graph_wide) {
+        lcd_setCursor(0, GRAPH_LENGTH);
+        lcd_print("        ");
+    }
+    TRACE_END(TRACE_GRAPH);
+}
+
+/**
+ * Готує місце для підпису в рядку 0 праворуч (позиції 8–15), очищаючи його
+ * пробілами. Широкий графік займає весь рядок, тоді підпису немає.
+ *
+ * @return false, якщо підпис на LCD не виводиться.
+ */
+bool clear_graph_label() {
+    if (graph_wide) return false;
+    lcd_setCursor(0, GRAPH_LENGTH);
+    lcd_print("        ");
+    return true;
+}
+
+/**
+ * Відображає графік на LCD, використовуючи середні значення АЦП по слайсам.
+ */
+int recording_slice_length() {
+    int slice_length = sample_index / TOTAL_SLICES;
+    return slice_length < 1 ? 1 : slice_length;
+}
+
+/**
+ * Рівні слайсів запису (виконується на ядрі 1). Фільтри вимірювача залежать
+ * від попередніх зразків, а межі слайсів відомі лише після зупинки, тож
+ * одноразовий запис проходиться вимірювачем цілком, як і пошуком піків;
+ * у потоці рівень кожного блоку рахується одразу (ANALYSIS_BLOCK).
+ *
+ * @param effective_samples Кількість записаних зразків.
+ * @param slice_length Кількість зразків у слайсі.
+ */
+void calculate_slice_levels(int effective_samples, int slice_length) {
+    sample_span_t span;
+    meter_reset(&meter, noise_level);
+    for (int i = 0; i < TOTAL_SLICES; i++) {
+        int start = i * slice_length;
+        int end = start + slice_length;
+        if (end > effective_samples) end = effective_samples;
+        if (start < end) {
+            sample_span_store(&span, &recording, start, end);
+            while (sample_span_next(&span)) meter_feed(&meter, span.samples, span.count);
+        }
+        meter_end_slice(&meter, &slice_levels[i]);
+    }
+}
+
+/**
+ * Аналізує завершений запис (виконується на ядрі 1): збирає статистику
+ * і рівні слайсів, добудовує піраміду і шукає піки.
+ *
+ * @param effective_samples Кількість записаних зразків.
+ * @param slice_length Кількість зразків у слайсі.
+ */
+void analyze_recording(int effective_samples, int slice_length) {
+    // Кошики вже заповнені під час запису, лишається зібрати з них слайси
+    TRACE_BEGIN(TRACE_SLICE_STATS);
+    slice_stats_compute(&recording, effective_samples, slice_length, TOTAL_SLICES,
+                        saved_slices_averages, saved_slices_maximums);
+    TRACE_END(TRACE_SLICE_STATS);
+#ifdef SLICE_STATS_VERIFY
+    verify_slice_stats(effective_samples, slice_length);
+#endif
+    calculate_slice_levels(effective_samples, slice_length);
+    sample_span_t span;
+    if (pyramid_samples(&pyramid) < effective_samples) {
+        // Потік або черга, що не встигла: решта зразків — із запису
+        sample_span_store(&span, &recording, pyramid_samples(&pyramid), effective_samples);
+        while (sample_span_next(&span)) pyramid_feed(&pyramid, span.samples, span.count);
+    }
+    pyramid_finish(&pyramid);
+    sample_span_store(&span, &recording, 0, effective_samples);
+    analyze_peaks(&span, slice_length);
+}
+
+void draw_graph_on_lcd() {
+    int effective_samples = sample_index;
+    int slice_length = recording_slice_length();
+
+    lcd_segment_clear();
+    lcd_clear();
+
+    zoom_level = 0;
+    graph_averages = saved_slices_averages;
+    graph_maximums = saved_slices_maximums;
+    // Ядро 1 уже не пише в результати: копія на стеку не потрібна
+    display_graph(saved_slices_averages);
+    print_slices_averages(saved_slices_averages, TOTAL_SLICES);
+    print_slice_levels();
+    display_slice_info(effective_samples, slice_length);
+    
+    // Виведення кількості максимумів (2 символи)
+    char buffer[11];
+    format_uint(buffer, (uint32_t)peak_count, 0);
+    lcd_setCursor(1, 0);
+    lcd_print(buffer);
+    
+    encoder_active = true;
+    encoder_slice_index = 0;
+    prev_encoder_slice_index = -1; // Скидаємо попередній індекс
+    /* printf("Encoder activated. Initial slice: %d = %u (scaled: %u)\n",  */
+    /*        encoder_slice_index, saved_slices_averages[encoder_slice_index],  */
+    /*        scale_adc_value(saved_slices_averages[encoder_slice_index])); */
+}
+
+void lcd_hello() {
+  lcd_setCursor(0, 0);
+  lcd_print("Press button");
+}
+
+/**
+ * Повертає висоту стовпчика для слайсу в поточному режимі відображення:
+ * величину слайсу (graph_column_height), висоту смуги спектра або
+ * найгучнішу смугу кадру спектрограми.
+ *
+ * @param slice Індекс слайсу або смуги спектра (0–39).
+ * @return Висота стовпчика.
+ */
+int column_height(int slice) {
+    if (view_mode == VIEW_SPECTRUM) return spectrum_heights[slice];
+    if (view_mode == VIEW_SPECTROGRAM) return spectrogram_height(slice);
+    return graph_column_height(graph_averages, slice);
+}
+
+/**
+ * Перемальовує символи графіка, у які потрапляють стовпчики пікселів слайсу
+ * (у широкому графіку слайс може лежати на межі двох символів).
+ *
+ * @param slice Індекс слайсу (0–39).
+ * @param pointer_slice Слайс під вказівником або -1.
+ */
+void draw_slice_cells(int slice, int pointer_slice) {
+    int cells = graph_cells();
+    int first_x = slice * cells * GRAPH_SLICE_LENGTH / TOTAL_SLICES;
+    int last_x = (slice + 1) * cells * GRAPH_SLICE_LENGTH / TOTAL_SLICES - 1;
+    for (int cell = first_x / GRAPH_SLICE_LENGTH; cell <= last_x / GRAPH_SLICE_LENGTH; cell++) {
+        build_graph_cell(cell, cells, NULL, pointer_slice);
+        lcd_segment_write(cell);
+    }
+    lcd_segment_clear();
+}
+
+/**
+ * Оновлює символ на LCD, вимикаючи піксель-вказівник для поточного слайсу.
+ * Символи попереднього слайсу перемальовуються першими, щоб їхні слоти
+ * CGRAM звільнилися для символів із вказівником.
+ *
+ * @param slice_index Індекс поточного слайсу (0–39).
+ * @param prev_slice_index Індекс попереднього слайсу (для відновлення).
+ */
+void update_slice_column(int slice_index, int prev_slice_index) {
+    if (prev_slice_index >= 0) draw_slice_cells(prev_slice_index, slice_index);
+    draw_slice_cells(slice_index, slice_index);
+}
+
+/**
+ * Перевіряє, чи потрібно оновити значення енкодера на LCD. 
+ * Повертає true, якщо енкодер активний, вимірювання не проводиться, 
+ * і є запит на оновлення дисплея.
+ * 
+ * @return bool Чи потрібно оновити LCD.
+ */
+bool should_update_encoder_display() {
+    return encoder_update_needed && encoder_active && !collecting_data;
+}
+
+/**
+ * Оновлює відображення інформації про поточний слайс на LCD-дисплеї.
+ * Виводить номер слайсу (з додаванням 1 для зручності), середнє значення в вольтах
+ * та максимальне значення в вольтах у форматі "XX/Y.ZZZ/W.QQQ" у рядку 1, позиція (1, 2).
+ * Вольти — мілівольти з таблиці, відформатовані цілочисельно (adc_scale.c).
+ * Коли графік показує рівні (graph_quantity), замість вольт — рівень слайсу
+ * і найбільший FAST у дБ після калібрування: "XX/74.5/81.2".
+ * Викликає display_peak_info() для відображення даних про пік у рядку 0.
+ * Скидає прапорець оновлення енкодера та оновлює графічне відображення стовпчика слайсу.
+ */
+void update_encoder_display() {
+    if (view_mode == VIEW_SPECTRUM) {
+        update_spectrum_display();
+        return;
+    }
+    if (view_mode == VIEW_SPECTROGRAM) {
+        update_spectrogram_display();
+        return;
+    }
+    char buffer[24]; // "номер слайсу / середнє / максимум": 14 символів і '\0', рівні — з запасом
+    char *end = format_uint(buffer, encoder_slice_index + 1, 2);
+    *end++ = '/';
+    if (graph_quantity == GRAPH_LEVELS && graph_averages == saved_slices_averages) {
+        // "XX/74.5/81.2  ": рівень слайсу і найбільший FAST після калібрування, дБ
+        const meter_reading_t *level = &slice_levels[encoder_slice_index];
+        end = format_db10(end, level->rms_db10 + meter_calibration_db10);
+        *end++ = '/';
+        end = format_db10(end, level->fast_db10 + meter_calibration_db10);
+        while (end < buffer + 14) *end++ = ' ';
+        buffer[14] = '\0';
+    } else {
+        end = format_fixed(end, adc_code_to_mv(graph_averages[encoder_slice_index]), 3);
+        *end++ = '/';
+        format_fixed(end, adc_code_to_mv(graph_maximums[encoder_slice_index]), 3);
+    }
+    int start_pos = 2;
+    lcd_setCursor(1, start_pos);
+    lcd_print(buffer);
+    if (zoom_level > 0) display_zoom_info();
+    else display_peak_info();
+    encoder_update_needed = false;
+
+    // Оновлюємо стовпчик для поточного і попереднього слайсу
+    update_slice_column(encoder_slice_index, prev_encoder_slice_index);
+    prev_encoder_slice_index = encoder_slice_index; // Зберігаємо поточний індекс як попередній
+}
+
+/**
+ * Кількість зразків у вікні графіка на рівні наближення level.
+ */
+int zoom_width(int level) {
+    int width = sample_index >> level;
+    return width < TOTAL_SLICES ? TOTAL_SLICES : width;
+}
+
+/**
+ * Заповнює стовпчики наближеного вікна з піраміди: O(TOTAL_SLICES), без
+ * читання самого запису.
+ */
+void load_zoom_columns() {
+    pyramid_columns(&pyramid, zoom_first, zoom_first + zoom_width(zoom_level), TOTAL_SLICES,
+                    zoom_averages, zoom_maximums);
+    graph_averages = zoom_averages;
+    graph_maximums = zoom_maximums;
+}
+
+/**
+ * Перемальовує графік для нового вікна; вказівник домалює update_encoder_display().
+ */
+static void redraw_zoom() {
+    uint64_t start_time = time_us_64();
+    if (zoom_level > 0) {
+        load_zoom_columns();
+    } else {
+        graph_averages = saved_slices_averages;
+        graph_maximums = saved_slices_maximums;
+    }
+    uint32_t query_time = (uint32_t)(time_us_64() - start_time);
+    lcd_segment_clear();
+    display_graph(graph_averages);
+    prev_encoder_slice_index = -1;
+    encoder_update_needed = true;
+    printf("Zoom x%d: samples %d..%d, %d per column, query %u us\n", 1 << zoom_level, zoom_first,
+           zoom_first + zoom_width(zoom_level), zoom_width(zoom_level) / TOTAL_SLICES, query_time);
+}
+
+/**
+ * Переходить на рівень наближення zoom_target (довге натискання кнопки
+ * енкодера або перехід до піку). Центр нового вікна — zoom_center або
+ * стовпчик під вказівником, і вказівник лишається на ньому. Рівень, глибший
+ * за pyramid_max_zoom(), повертає весь запис.
+ */
+void apply_zoom() {
+    int level = zoom_target;
+    int center = zoom_center;
+    zoom_target = -1;
+    zoom_center = -1;
+    if (level > pyramid_max_zoom(&pyramid, TOTAL_SLICES)) level = 0;
+    if (center < 0) {
+        center = zoom_first + (int)((int64_t)(2 * encoder_slice_index + 1) * zoom_width(zoom_level) /
+                                    (2 * TOTAL_SLICES));
+    }
+
+    zoom_level = level;
+    int width = zoom_width(level);
+    zoom_first = center - width / 2;
+    if (zoom_first > sample_index - width) zoom_first = sample_index - width;
+    if (zoom_first < 0) zoom_first = 0;
+    encoder_slice_index = (int)((int64_t)(center - zoom_first) * TOTAL_SLICES / width);
+    if (encoder_slice_index >= TOTAL_SLICES) encoder_slice_index = TOTAL_SLICES - 1;
+    if (encoder_slice_index < 0) encoder_slice_index = 0;
+    redraw_zoom();
+}
+
+/**
+ * Прокручує наближене вікно: крок енкодера — один стовпчик.
  *
- * @param sample_count Кількість зібраних зразків (макс. 4000, 4 символи).
- * @param slice_length Довжина одного слайсу (макс. 100, 3 символи).
+ * @param steps Кроки енкодера, додатні — вправо.
  */
-void display_slice_info(int sample_count, int slice_length) {
-  printf("Effective samples count: %d; slice length %d\n", sample_count, slice_length);
-
-  char buffer[9]; // 8 символів + \0, для макс. "4000/100"
-  sprintf(buffer, "%d/%d", sample_count, slice_length);
-
-  int len = strlen(buffer);
-  int start_pos = (len < 8) ? (15 - len + 1) : 8; // Зсув до позиції 15, якщо<8
+void pan_zoom(int steps) {
+    if (steps == 0 || zoom_level == 0) return;
+    int width = zoom_width(zoom_level);
+    int first = zoom_first + steps * (width / TOTAL_SLICES);
+    if (first > sample_index - width) first = sample_index - width;
+    if (first < 0) first = 0;
+    if (first == zoom_first) return;
+    zoom_first = first;
+    redraw_zoom();
+}
 
-  lcd_setCursor(0, start_pos);
-  lcd_print(buffer);
+/**
+ * Виводить у рядку 0 праворуч наближення і довжину стовпчика в зразках:
+ * "x4/25". Рядок вирівнюється праворуч, як у display_slice_info().
+ */
+void display_zoom_info() {
+    if (!clear_graph_label()) return; // Наближення вже в терміналі (redraw_zoom)
+    char buffer[24];
+    buffer[0] = 'x';
+    char *end = format_uint(buffer + 1, 1u << zoom_level, 0);
+    *end++ = '/';
+    format_uint(end, (uint32_t)(zoom_width(zoom_level) / TOTAL_SLICES), 0);
+    buffer[8] = '\0';
+    lcd_setCursor(0, 16 - strlen(buffer));
+    lcd_print(buffer);
 }
 
-void calculate_slice_averages(int effective_samples, int slice_length, 
-                              uint32_t* slices_averages, uint32_t* saved_slices_averages) {
-  for (int i = 0; i < TOTAL_SLICES; i++) {
-    int start_idx = i * slice_length;
-    int end_idx = (i + 1) * slice_length;
-    if (end_idx > effective_samples) end_idx = effective_samples;
+/**
+ * Частота біна ШПФ у герцах.
+ */
+int bin_to_hz(int bin) {
+    return (int)((int64_t)bin * capture_sample_rate() / FFT_SIZE);
+}
 
-    uint32_t sum = 0;
-    uint32_t max = 0;
-    int count = 0;
-    for (int j = start_idx; j < end_idx; j++) {
-      if (!is_noise(adc_values[j])) {
-        sum += adc_values[j];
-        if (adc_values[j] > max) max = adc_values[j];
-        count++;
-      }
+/**
+ * Обчислює спектр поточного запису: ШПФ у фіксованій точці над першими
+ * FFT_SIZE зразками запису (коротший запис доповнюється нулями), розбиття бінів 1..FFT_BINS-1 на TOTAL_SLICES
+ * рівних смуг і масштабування максимумів смуг у висоти стовпчиків 0–7
+ * відносно найгучнішої смуги.
+ */
+void calculate_spectrum() {
+    uint64_t start_time = time_us_64();
+    // Зразки розпаковуються просто в буфер ШПФ, fft_load_q15 перетворює їх на місці
+    int fft_samples = sample_store_read(&recording, 0, (uint16_t *)fft_buffer, FFT_SIZE);
+    fft_load_q15(fft_buffer, (const uint16_t *)fft_buffer, fft_samples, FFT_SIZE);
+    fft_real_q15(fft_buffer, FFT_SIZE);
+    fft_magnitude_q15(fft_buffer, FFT_SIZE);
+    uint32_t fft_time = (uint32_t)(time_us_64() - start_time);
+
+    const uint16_t *magnitudes = (const uint16_t *)fft_buffer;
+    int bins_per_band = (FFT_BINS - 1) / TOTAL_SLICES;
+    uint32_t loudest = 0;
+    for (int band = 0; band < TOTAL_SLICES; band++) {
+        int first_bin = 1 + band * bins_per_band; // Бін 0 — постійна складова
+        spectrum_bands[band] = 0;
+        spectrum_peak_bins[band] = first_bin;
+        for (int bin = first_bin; bin < first_bin + bins_per_band; bin++) {
+            if (magnitudes[bin] > spectrum_bands[band]) {
+                spectrum_bands[band] = magnitudes[bin];
+                spectrum_peak_bins[band] = bin;
+            }
+        }
+        if (spectrum_bands[band] > loudest) loudest = spectrum_bands[band];
     }
-    slices_averages[i] = (count > 0) ? (sum / count) : 0;
-    saved_slices_averages[i] = slices_averages[i];
-    saved_slices_maximums[i] = max;
-  }
+    for (int band = 0; band < TOTAL_SLICES; band++) {
+        spectrum_heights[band] = loudest ? (spectrum_bands[band] * 7 + loudest / 2) / loudest : 0;
+    }
+    spectrum_valid = true;
+    printf("FFT %d points: %u us\n", FFT_SIZE, fft_time);
 }
 
 /**
- * Відображає графік на LCD, масштабуючи середні значення слайсів і записуючи їх
- * у сегменти дисплея. Кожні 5 слайсів формують один символ, який записується на дисплей.
- *
- * @param slices_averages Масив середніх значень слайсів для масштабування та відображення.
+ * Відображає спектр на LCD тим самим шляхом, що й графік слайсів: кожні
+ * GRAPH_SLICE_LENGTH смуг формують один символ. У рядку 0 праворуч
+ * виводиться частота найгучнішої смуги.
  */
-void display_graph(uint32_t* slices_averages) {
+void display_spectrum() {
+    lcd_segment_clear();
+    lcd_clear();
+    graph_wide = false;
+    int loudest_band = 0;
     for (int i = 0, cursor_position = 0; i < TOTAL_SLICES; i++) {
-        uint32_t scaled_value = scale_adc_value(slices_averages[i]);
-        int lcd_segment_position = i % GRAPH_SLICE_LENGTH;
-        set_lcd_segment_row(lcd_segment_position, scaled_value, false); // Без вимкнення
+        set_lcd_segment_row(i % GRAPH_SLICE_LENGTH, spectrum_heights[i], false);
         if ((i + 1) % GRAPH_SLICE_LENGTH == 0 || i == TOTAL_SLICES - 1) {
             lcd_segment_write(cursor_position++);
             lcd_segment_clear();
         }
+        if (spectrum_bands[i] > spectrum_bands[loudest_band]) loudest_band = i;
     }
+
+    char buffer[13];
+    char *end = format_uint(buffer, (uint32_t)bin_to_hz(spectrum_peak_bins[loudest_band]), 0);
+    end[0] = 'H';
+    end[1] = 'z';
+    end[2] = '\0';
+    lcd_setCursor(0, 16 - strlen(buffer));
+    lcd_print(buffer);
+    lcd_setCursor(1, 0);
+    lcd_print("F");
 }
 
 /**
- * Відображає графік на LCD, використовуючи середні значення АЦП по слайсам.
+ * Виводить у рядку 1 дані про смугу спектра під енкодером у форматі
+ * "XX/FFFHz/AAAAA": номер смуги, частота її найгучнішого біна, амплітуда.
  */
-void draw_graph_on_lcd() {
-    int effective_samples = sample_index;
-    int slice_length = effective_samples / TOTAL_SLICES;
-    if (slice_length < 1) slice_length = 1;
+void update_spectrum_display() {
+    char buffer[24]; // 14 символів, якщо частота й амплітуда не ширші за поле
+    char *end = format_uint(buffer, encoder_slice_index + 1, 2);
+    *end++ = '/';
+    end = format_uint(end, bin_to_hz(spectrum_peak_bins[encoder_slice_index]), 3);
+    *end++ = 'H';
+    *end++ = 'z';
+    *end++ = '/';
+    format_uint(end, spectrum_bands[encoder_slice_index], -5);
+    lcd_setCursor(1, 2);
+    lcd_print(buffer);
+    encoder_update_needed = false;
 
-    uint32_t slices_averages[TOTAL_SLICES];
+    update_slice_column(encoder_slice_index, prev_encoder_slice_index);
+    prev_encoder_slice_index = encoder_slice_index;
+}
 
-    lcd_segment_clear();
-    lcd_clear();
+/**
+ * Частота середини смуги спектрограми в герцах.
+ */
+int spectrogram_band_hz(int band) {
+    int bin = band * STFT_BINS_PER_BAND + STFT_BINS_PER_BAND / 2;
+    return (int)((int64_t)bin * capture_sample_rate() / STFT_SIZE);
+}
 
-    calculate_slice_averages(effective_samples, slice_length, slices_averages, saved_slices_averages);
-    display_graph(slices_averages);
-    print_slices_averages(slices_averages, TOTAL_SLICES);
-    display_slice_info(effective_samples, slice_length);
+/**
+ * Час середини кадру спектрограми від початку запису, мс.
+ */
+uint32_t spectrogram_frame_ms(int frame) {
+    uint64_t centre = (uint64_t)stft_frame_start(&stft, frame) + STFT_SIZE / 2;
+    return (uint32_t)(centre * 1000 / capture_sample_rate());
+}
 
-    analyze_peaks(slice_length);
-    
-    // Виведення кількості максимумів (2 символи)
-    char buffer[3];
-    sprintf(buffer, "%d", peak_count);
-    lcd_setCursor(1, 0);
-    lcd_print(buffer);
-    
-    encoder_active = true;
-    encoder_slice_index = 0;
-    prev_encoder_slice_index = -1; // Скидаємо попередній індекс
-    /* printf("Encoder activated. Initial slice: %d = %u (scaled: %u)\n",  */
-    /*        encoder_slice_index, saved_slices_averages[encoder_slice_index],  */
-    /*        scale_adc_value(saved_slices_averages[encoder_slice_index])); */
+/**
+ * Висота стовпчика спектрограми: найгучніша смуга кадру, від 1 (низькі
+ * частоти) до 8 (біля Найквіста); 0 — тиша або кадру немає.
+ *
+ * @param column Стовпчик вікна (0–39).
+ */
+int spectrogram_height(int column) {
+    if (spectrogram_first + column >= stft.frames) return 0;
+    int band = stft_dominant_band(spectrogram_columns[column], stft_level(STFT_MIN_AMPLITUDE));
+    return band < 0 ? 0 : 1 + band * 7 / (STFT_BANDS - 1);
 }
 
-void lcd_hello() {
-  lcd_setCursor(0, 0);
-  lcd_print("Press button");
+/**
+ * Обчислює вікно спектрограми (ядро 1): кадри від job->slice у
+ * spectrogram_columns, по одному в позиченому буфері ШПФ.
+ *
+ * @param job Завдання ANALYSIS_SPECTROGRAM; result — час обчислення, мкс.
+ */
+void calculate_spectrogram_window(pipeline_job_t *job) {
+    uint64_t start_time = time_us_64();
+    for (int column = 0; column < TOTAL_SLICES; column++) {
+        int frame = job->slice + column;
+        if (frame < stft.frames) stft_frame(&stft, frame, fft_buffer, spectrogram_columns[column]);
+        else memset(spectrogram_columns[column], 0, STFT_BANDS);
+    }
+    job->result = (int)(time_us_64() - start_time);
 }
 
 /**
- * Оновлює символ на LCD, вимикаючи піксель-вказівник для поточного слайсу.
- * @param slice_index Індекс поточного слайсу (0–39).
- * @param prev_slice_index Індекс попереднього слайсу (для відновлення).
+ * Подає на ядро 1 обчислення вікна з кадру spectrogram_target. Поки
+ * попереднє вікно рахується, запит чекає, тож швидке прокручування
+ * енкодером зливається в одне вікно.
  */
-void update_slice_column(int slice_index, int prev_slice_index) {
-    int cursor_position = slice_index / GRAPH_SLICE_LENGTH; // Номер символу (0–7)
-    int lcd_segment_position = slice_index % GRAPH_SLICE_LENGTH; // Позиція стовпчика (0–4)
+void request_spectrogram_window() {
+    if (pipeline_busy()) return;
+    int first = spectrogram_target;
+    int last = first + view_columns();
+    int end = stft_frame_start(&stft, last - 1) + STFT_SIZE;
+    pipeline_job_t job = { .type = ANALYSIS_SPECTROGRAM, .slice = first,
+                           .start = stft_frame_start(&stft, first),
+                           .end = end < sample_index ? end : sample_index };
+    if (!borrow_fft_buffer()) {
+        printf("No arena space for FFT\n");
+        spectrogram_target = -1;
+        return;
+    }
+    if (!pipeline_submit(&job)) {
+        return_fft_buffer();
+        return;
+    }
+    spectrogram_target = -1;
+}
 
-    lcd_segment_clear();
+/**
+ * Виводить у термінал час обчислення вікна спектрограми і швидкість у
+ * кадрах за секунду.
+ */
+void print_spectrogram_rate(const pipeline_job_t *job) {
+    int frames = stft.frames - job->slice < TOTAL_SLICES ? stft.frames - job->slice : TOTAL_SLICES;
+    uint32_t us = job->result > 0 ? (uint32_t)job->result : 1;
+    printf("Spectrogram frames %d-%d of %d (hop %d): %u us, %u frames/s\n",
+           job->slice, job->slice + frames - 1, stft.frames, stft.hop,
+           (unsigned)us, (unsigned)((uint64_t)frames * 1000000 / us));
+}
 
-    for (int i = 0; i < GRAPH_SLICE_LENGTH; i++) {
-        int current_slice = cursor_position * GRAPH_SLICE_LENGTH + i;
-        if (current_slice >= TOTAL_SLICES) break;
-        uint32_t height = scale_adc_value(saved_slices_averages[current_slice]);
-        // Вимикаємо піксель-вказівник тільки для активного слайсу
-        set_lcd_segment_row(i, height, i == lcd_segment_position);
+/**
+ * Відображає вікно спектрограми тим самим шляхом, що й спектр: висота
+ * стовпчика — найгучніша смуга кадру. У рядку 0 праворуч — час початку
+ * вікна, у рядку 1 ліворуч — позначка "S".
+ */
+void display_spectrogram() {
+    lcd_segment_clear();
+    lcd_clear();
+    graph_wide = false;
+    for (int i = 0, cursor_position = 0; i < TOTAL_SLICES; i++) {
+        set_lcd_segment_row(i % GRAPH_SLICE_LENGTH, spectrogram_height(i), false);
+        if ((i + 1) % GRAPH_SLICE_LENGTH == 0 || i == TOTAL_SLICES - 1) {
+            lcd_segment_write(cursor_position++);
+            lcd_segment_clear();
+        }
     }
 
-    lcd_segment_write(cursor_position);
+    char buffer[12];
+    char *end = format_fixed(buffer, spectrogram_frame_ms(spectrogram_first), 3);
+    *end++ = 's';
+    *end = '\0';
+    lcd_setCursor(0, 16 - strlen(buffer));
+    lcd_print(buffer);
+    lcd_setCursor(1, 0);
+    lcd_print("S");
+    prev_encoder_slice_index = -1;
+}
 
-    if (prev_slice_index >= 0 && (prev_slice_index / GRAPH_SLICE_LENGTH) != cursor_position) {
-        int prev_cursor_position = prev_slice_index / GRAPH_SLICE_LENGTH;
-        lcd_segment_clear();
-        for (int i = 0; i < GRAPH_SLICE_LENGTH; i++) {
-            int current_slice = prev_cursor_position * GRAPH_SLICE_LENGTH + i;
-            if (current_slice >= TOTAL_SLICES) break;
-            uint32_t height = scale_adc_value(saved_slices_averages[current_slice]);
-            set_lcd_segment_row(i, height, false); // Без вимкнення пікселя
-        }
-        lcd_segment_write(prev_cursor_position);
+/**
+ * Виводить у рядку 1 дані про кадр під енкодером у форматі "T.TTs/FFFFHz":
+ * час середини кадру і частота середини його найгучнішої смуги ("-" — тиша).
+ */
+void update_spectrogram_display() {
+    char buffer[24]; // 14 символів і '\0', з запасом на довгий запис
+    int band = stft_dominant_band(spectrogram_columns[encoder_slice_index], stft_level(STFT_MIN_AMPLITUDE));
+    char *end = format_fixed(buffer, spectrogram_frame_ms(spectrogram_first + encoder_slice_index) / 10, 2);
+    *end++ = 's';
+    *end++ = '/';
+    if (band < 0) {
+        *end++ = '-';
+    } else {
+        end = format_uint(end, spectrogram_band_hz(band), 0);
+        *end++ = 'H';
+        *end++ = 'z';
     }
+    while (end < buffer + 14) *end++ = ' ';
+    buffer[14] = '\0';
+    lcd_setCursor(1, 2);
+    lcd_print(buffer);
+    encoder_update_needed = false;
+
+    update_slice_column(encoder_slice_index, prev_encoder_slice_index);
+    prev_encoder_slice_index = encoder_slice_index;
 }
 
 /**
- * Перевіряє, чи потрібно оновити значення енкодера на LCD. 
- * Повертає true, якщо енкодер активний, вимірювання не проводиться, 
- * і є запит на оновлення дисплея.
- * 
- * @return bool Чи потрібно оновити LCD.
+ * Прокручує спектрограму енкодером: вказівник рухається по кадрах вікна,
+ * а за його краєм зсувається саме вікно, і нові кадри рахує ядро 1.
+ *
+ * @param steps Кроки енкодера: додатні — далі в часі.
  */
-bool should_update_encoder_display() {
-    return encoder_update_needed && encoder_active && !collecting_data;
+void scroll_spectrogram(int steps) {
+    int columns = view_columns();
+    int first = spectrogram_target >= 0 ? spectrogram_target : spectrogram_first;
+    int index = encoder_slice_index + steps;
+    if (index < 0) {
+        first += index;
+        index = 0;
+    } else if (index >= columns) {
+        first += index - (columns - 1);
+        index = columns - 1;
+    }
+    int last_first = stft.frames - columns;
+    if (first > last_first) first = last_first;
+    if (first < 0) first = 0;
+    if (first != spectrogram_first || pipeline_busy()) spectrogram_target = first;
+    encoder_slice_index = index;
+    encoder_update_needed = true;
 }
 
 /**
- * Оновлює відображення інформації про поточний слайс на LCD-дисплеї.
- * Виводить номер слайсу (з додаванням 1 для зручності), середнє значення в вольтах
- * та максимальне значення в вольтах у форматі "XX/Y.ZZZ/W.QQQ" у рядку 1, позиція (1, 2).
- * Викликає display_peak_info() для відображення даних про пік у рядку 0.
- * Скидає прапорець оновлення енкодера та оновлює графічне відображення стовпчика слайсу.
+ * Виводить у термінал усю спектрограму запису (команда p): рядок
+ * "#SG <кадрів> <крок> <частота> <смуг>", по рядку "#SF <кадр> <рівні>" на
+ * кадр (рівні stft_level шістнадцятковими байтами, від низьких частот) і
+ * "#SE <мкс> <кадрів/с>" — час лише обчислення, без виведення. Кадри
+ * рахуються по одному, тож матриця цілком у пам'яті не буває.
  */
-void update_encoder_display() {
-    float volts_value = adc_to_volt(saved_slices_averages[encoder_slice_index]);
-    float max_value = adc_to_volt(saved_slices_maximums[encoder_slice_index]);
+void print_spectrogram() {
+    if (collecting_data || pipeline_busy() || sample_index == 0) {
+        printf("Spectrogram refused: no finished recording\n");
+        return;
+    }
+    if (!borrow_fft_buffer()) {
+        printf("No arena space for FFT\n");
+        return;
+    }
+    stft_t frames;
+    stft_begin(&frames, &recording, sample_index, TOTAL_SLICES);
+    printf("#SG %d %d %u %d\n", frames.frames, frames.hop, (unsigned)capture_sample_rate(), STFT_BANDS);
+    uint64_t busy_us = 0;
+    for (int frame = 0; frame < frames.frames; frame++) {
+        uint8_t column[STFT_BANDS];
+        uint64_t start_time = time_us_64();
+        stft_frame(&frames, frame, fft_buffer, column);
+        busy_us += time_us_64() - start_time;
+        printf("#SF %d ", frame);
+        for (int band = 0; band < STFT_BANDS; band++) printf("%02x", column[band]);
+        printf("\n");
+    }
+    return_fft_buffer();
+    if (busy_us == 0) busy_us = 1;
+    printf("#SE %u %u\n", (unsigned)busy_us, (unsigned)((uint64_t)frames.frames * 1000000 / busy_us));
+}
 
-    char buffer[14]; // "номер слайсу / середнє / максимум"
-    sprintf(buffer, "%2d/%.3f/%.3f", encoder_slice_index + 1, volts_value, max_value);
-    int start_pos = 2;
-    lcd_setCursor(1, start_pos);
-    lcd_print(buffer);
-    display_peak_info();
-    encoder_update_needed = false;
+/**
+ * Перемикає режим відображення по колу: графік слайсів, спектр,
+ * спектрограма. Спектр обчислюється (на ядрі 1) лише під час першого
+ * перемикання для запису, вікно спектрограми — щоразу заново.
+ */
+void toggle_view() {
+    if (pipeline_busy()) return; // Спектр чи вікно ще рахуються: натискання пропускається
+    if (view_mode == VIEW_GRAPH) {
+        view_mode = VIEW_SPECTRUM;
+        zoom_level = 0; // Поворот енкодера знову рухає вказівник
+        encoder_slice_index = 0;
+        prev_encoder_slice_index = -1;
+        if (!spectrum_valid) {
+            // ШПФ рахує ядро 1, спектр виводиться з handle_analysis_results()
+            pipeline_job_t job = { .type = ANALYSIS_SPECTRUM, .start = 0, .end = sample_index };
+            if (!borrow_fft_buffer()) {
+                view_mode = VIEW_GRAPH;
+                printf("No arena space for FFT\n");
+                return;
+            }
+            if (!pipeline_submit(&job)) {
+                return_fft_buffer();
+                view_mode = VIEW_GRAPH;
+            }
+            return;
+        }
+        display_spectrum();
+    } else if (view_mode == VIEW_SPECTRUM) {
+        view_mode = VIEW_SPECTROGRAM;
+        encoder_slice_index = 0;
+        stft_begin(&stft, &recording, sample_index, TOTAL_SLICES);
+        spectrogram_first = 0;
+        spectrogram_target = 0; // Вікно рахує ядро 1, виводиться з handle_analysis_results()
+        return;
+    } else {
+        view_mode = VIEW_GRAPH;
+        draw_graph_on_lcd();
+    }
+    encoder_update_needed = true;
+}
 
-    // Оновлюємо стовпчик для поточного і попереднього слайсу
-    update_slice_column(encoder_slice_index, prev_encoder_slice_index);
-    prev_encoder_slice_index = encoder_slice_index; // Зберігаємо поточний індекс як попередній
+/**
+ * Перемикає величину графіка слайсів: середні значення або рівні, і
+ * перемальовує графік, якщо він на дисплеї.
+ */
+void toggle_graph_quantity() {
+    graph_quantity = graph_quantity == GRAPH_AVERAGES ? GRAPH_LEVELS : GRAPH_AVERAGES;
+    printf("Graph: %s\n", graph_quantity == GRAPH_LEVELS ? "levels" : "averages");
+    if (!encoder_active || collecting_data || view_mode != VIEW_GRAPH) return;
+    lcd_segment_clear();
+    display_graph(graph_averages);
+    prev_encoder_slice_index = -1;
+    encoder_update_needed = true;
 }
 
 /**
  * Відображає інформацію про поточний пік на LCD-дисплеї у рядку 0.
- * Спочатку очищає область у позиції (0, 8) пробілами, щоб видалити попередній текст,
+ * Спочатку очищає область у позиції (0, 8) пробілами (clear_graph_label), щоб видалити попередній текст,
  * потім викликає display_slice_info() для виведення номера слайсу піку (з додаванням 1)
  * та його тривалості у форматі "Slice X:Yms" у позицію (0, 0).
  */
 void display_peak_info() {
-    lcd_setCursor(0, 8);
-    lcd_print("        ");
+    clear_graph_label();
+    if (current_peak_index < 0 || current_peak_index >= peak_count) return;
     display_slice_info(peak_slices[current_peak_index]+1,
                        peak_durations[current_peak_index]);
 }
 
 /**
- * Обчислює тривалість піку в мілісекундах на основі сирих даних АЦП (adc_values).
- * Пошук меж піку розпочинається з меж заданого слайсу (slice_start, slice_end) і 
- * розширюється ліворуч і праворуч, доки значення не впадуть нижче порогу PEAK_THRESHOLD.
- * Якщо тривалість менша за MIN_PEAK_DURATION, повертається мінімальне значення.
- *
- * @param slice_start Початковий індекс слайсу в масиві adc_values.
- * @param slice_end Кінцевий індекс слайсу в масиві adc_values.
- * @return Тривалість піку в мілісекундах (1 запис = 1 мс при частоті 1000 Гц).
+ * Параметри детектора піків у кодах АЦП і зразках. Пороги задано для
+ * рівня тиші ADC_NOISE і зсуваються разом із його оцінкою level.
  */
-int calculate_peak_duration(int slice_start, int slice_end) {
-    const float PEAK_THRESHOLD = 2.50f; // Поріг значущості піку в вольтах
-
-    int peak_start = slice_start;
-    int peak_end = slice_end;
-
-    // Розширюємо межі піку ліворуч
-    while (peak_start > 0 &&
-           adc_to_volt(adc_values[peak_start - 1]) > PEAK_THRESHOLD) {
-        peak_start--;
-    }
-
-    // Розширюємо межі піку праворуч
-    while (peak_end < SAMPLE_ARRAY_SIZE - 1 &&
-           adc_to_volt(adc_values[peak_end + 1]) > PEAK_THRESHOLD) {
-        peak_end++;
-    }
-
-    // Обчислюємо тривалість у записах і переводимо в мілісекунди
-    int duration = peak_end - peak_start + 1;
-    int duration_ms = duration;
-    if (duration_ms < MIN_PEAK_DURATION) duration_ms = MIN_PEAK_DURATION;
+peak_config_t peak_detector_config_for(uint16_t level) {
+    int drift = (int)level - ADC_NOISE;
+    peak_config_t config = {
+        .enter = (uint16_t)(MV_TO_ADC(PEAK_ENTER_MV) + drift),
+        .exit = (uint16_t)(MV_TO_ADC(PEAK_EXIT_MV) + drift),
+        .baseline = level,
+        .merge_gap = (int)(PEAK_MERGE_GAP_MS * capture_sample_rate() / 1000),
+        .min_duration = (int)(MIN_PEAK_DURATION * capture_sample_rate() / 1000),
+    };
+    return config;
+}
 
-    return duration_ms;
+// Параметри для поточного рівня тиші запису (noise_level)
+peak_config_t peak_detector_config() {
+    return peak_detector_config_for(noise_level);
 }
 
 /**
- * Аналізує масив середніх значень слайсів (saved_slices_averages) для пошуку піків,
- * які перевищують поріг PEAK_THRESHOLD (2.50 В). Зберігає індекси піків у peak_slices,
- * їхню кількість у peak_count, а тривалості у peak_durations, викликаючи 
- * calculate_peak_duration(). Пропускає слайси, які входять у тривалість попереднього піку.
+ * Шукає піки в сирих зразках запису за один цілочисельний прохід
+ * (peaks_detect) і заповнює з отриманих подій peak_slices — слайс, у якому
+ * пік почався, — та peak_durations у мілісекундах (за позначками часу
+ * зразків, якщо вони записуються). Пороги входу й виходу
+ * переводяться у коди АЦП і зсуваються за рівнем тиші (peak_detector_config).
  *
+ * @param span Зразки запису від початку (кільце потоку або упакований запис).
  * @param slice_length Кількість записів у кожному слайсі (наприклад, 50).
  */
-void analyze_peaks(int slice_length) {
-    peak_count = 0;
-    const float PEAK_THRESHOLD = 2.50f; // Поріг значущості піку
-
-    for (int i = 0; i < TOTAL_SLICES; i++) {
-      float avg_volt = adc_to_volt(saved_slices_averages[i]);
-
-        if (avg_volt > PEAK_THRESHOLD) {
-            if (peak_count < TOTAL_SLICES) {
-                peak_slices[peak_count] = i;
-
-                // Визначаємо межі слайсу для обчислення тривалості
-                int slice_start = i * slice_length;
-                int slice_end = (i + 1) * slice_length - 1;
-                if (slice_end >= SAMPLE_ARRAY_SIZE) slice_end = SAMPLE_ARRAY_SIZE - 1;
-
-                // Обчислюємо тривалість піку
-                peak_durations[peak_count] = calculate_peak_duration(slice_start, slice_end);
-
-                printf("Peak at slice %d: %.3f V, duration %d ms\n", 
-                       i, avg_volt, peak_durations[peak_count]);
-
-                peak_count++;
-
-                // Пропускаємо слайси, які входять у тривалість піку
-                int next_slice = (slice_end + 1) / slice_length;
-                if (next_slice > i) i = next_slice - 1;
-            }
-        }
+void analyze_peaks(sample_span_t *span, int slice_length) {
+    const peak_config_t config = peak_detector_config();
+    peak_detector_t detector;
+    TRACE_BEGIN(TRACE_PEAKS);
+    peaks_begin(&detector, &config, peak_events, TOTAL_SLICES);
+    while (sample_span_next(span)) peaks_feed(&detector, span->samples, span->count);
+    int count = peaks_end(&detector);
+    TRACE_END(TRACE_PEAKS);
+    for (int j = 0; j < count; j++) {
+        const peak_event_t *event = &peak_events[j];
+        int slice = event->start / slice_length;
+        peak_slices[j] = slice < TOTAL_SLICES ? slice : TOTAL_SLICES - 1;
+        // Тривалість за реальним часом зразків, а не за їх кількістю
+        peak_durations[j] = capture_elapsed_us(event->start, event->end - event->start + 1) / 1000;
+        printf("Peak at slice %d: max %u mV, area %u, duration %d ms\n", peak_slices[j],
+               (unsigned)ADC_TO_MV(event->max), (unsigned)event->area, peak_durations[j]);
     }
+    peak_count = count;
 
     printf("Found %d peaks: ", peak_count);
     for (int j = 0; j < peak_count; j++) {
@@ -665,38 +2536,308 @@ void init_next_peak_pin() {
     gpio_set_irq_enabled_with_callback(NEXT_PEAK_PIN, GPIO_IRQ_EDGE_FALL, true, &gpio_interrupt_handler);
 }
 
+/**
+ * Переводить вказівник на наступний пік (подія кнопки NEXT_PEAK_PIN).
+ */
 void move_to_next_peak() {
-    if (peak_count == 0) return;
+    if (peak_count == 0 || !encoder_active) return;
     current_peak_index = (current_peak_index + 1) % peak_count;
     encoder_slice_index = peak_slices[current_peak_index];
     int duration = peak_durations[current_peak_index];
+    if (zoom_level > 0) {
+        // Наближене вікно центрується на початку піку (apply_zoom)
+        zoom_center = peak_events[current_peak_index].start;
+        zoom_target = zoom_level;
+    }
     encoder_update_needed = true;
     printf("Moved to peak at slice %d, value %d\n", encoder_slice_index, duration);
 }
 
+#if SND_BENCH
+static volatile uint32_t bench_sink; // Не дає компілятору викинути результат
+static uint16_t *bench_output;       // Вихід дециматора: буфер ШПФ на Pico, окремий буфер на хості
+static int bench_max_samples = RECORDING_MAX_SAMPLES; // Найдовший запис, який вміщає recording
+
+static int bench_slice_length(int count) {
+    return count / TOTAL_SLICES < 1 ? 1 : count / TOTAL_SLICES;
+}
+
+// Функції над записом читають recording: вікно спершу пакується в нього
+static void bench_pack_recording(const uint16_t *window, int count) {
+    sample_store_reset(&recording);
+    sample_store_append(&recording, window, count);
+    sample_store_finish(&recording);
+}
+
+static void bench_calculate_average(const uint16_t *window, int count) {
+    bench_sink = calculate_average(0, count);
+}
+
+static void bench_slice_averages(const uint16_t *window, int count) {
+    uint32_t slices_averages[TOTAL_SLICES];
+    calculate_slice_averages(count, bench_slice_length(count), slices_averages, saved_slices_averages);
+}
+
+static void bench_slice_stats(const uint16_t *window, int count) {
+    slice_stats_reset(noise_gate);
+    slice_stats_feed(window, count);
+    slice_stats_compute(&recording, count, bench_slice_length(count), TOTAL_SLICES,
+                        saved_slices_averages, saved_slices_maximums);
+}
+
+static void bench_peaks(const uint16_t *window, int count) {
+    sample_span_t span;
+    sample_span_store(&span, &recording, 0, count);
+    analyze_peaks(&span, bench_slice_length(count));
+}
+
+static void bench_scale_adc_value(const uint16_t *window, int count) {
+    uint32_t sum = 0;
+    for (int i = 0; i < count; i++) sum += scale_adc_value(window[i]);
+    bench_sink = sum;
+}
+
+static void bench_adc_code_to_mv(const uint16_t *window, int count) {
+    uint32_t sum = 0;
+    for (int i = 0; i < count; i++) sum += adc_code_to_mv(window[i]);
+    bench_sink = sum;
+}
+
+// Рядок енкодера "XX/Y.ZZZ/W.QQQ" на кожен зразок, як в update_encoder_display()
+static void bench_format_volts(const uint16_t *window, int count) {
+    char buffer[16];
+    for (int i = 0; i < count; i++) {
+        char *end = format_uint(buffer, i % TOTAL_SLICES + 1, 2);
+        *end++ = '/';
+        end = format_fixed(end, adc_code_to_mv(window[i]), 3);
+        *end++ = '/';
+        format_fixed(end, adc_code_to_mv(window[i] >> 1), 3);
+    }
+    bench_sink = (uint8_t)buffer[3];
+}
+
+static void bench_trigger(const uint16_t *window, int count) {
+    // Тригер, що не спрацьовує, переглядає кожен зразок вікна
+    trigger_config_t config = { .mode = TRIGGER_RISING, .level = UINT16_MAX, .hysteresis = 0 };
+    trigger_begin(&trigger, &config, 0);
+    bench_sink = (uint32_t)trigger_feed(&trigger, window, count);
+}
+
+// Вимірювач на найвищій частоті аналізу, без зважування і з A-зважуванням
+static meter_t bench_meter;
+
+static void bench_prepare_meter_z(const uint16_t *window, int count) {
+    meter_init(&bench_meter, 16000, METER_Z_WEIGHTING);
+    meter_reset(&bench_meter, ADC_NOISE);
+}
+
+static void bench_prepare_meter_a(const uint16_t *window, int count) {
+    meter_init(&bench_meter, 16000, METER_A_WEIGHTING);
+    meter_reset(&bench_meter, ADC_NOISE);
+}
+
+static void bench_meter_slices(const uint16_t *window, int count) {
+    meter_reading_t reading;
+    int slice_length = bench_slice_length(count);
+    for (int start = 0; start < count; start += slice_length) {
+        meter_feed(&bench_meter, window + start, count - start < slice_length ? count - start : slice_length);
+        meter_end_slice(&bench_meter, &reading);
+    }
+    bench_sink = (uint16_t)reading.rms_db10;
+}
+
+static void bench_prepare_graph(const uint16_t *window, int count) {
+    uint32_t slices_averages[TOTAL_SLICES];
+    bench_pack_recording(window, count);
+    calculate_slice_averages(count, bench_slice_length(count), slices_averages, saved_slices_averages);
+    lcd_clear();
+}
+
+static void bench_display_graph(const uint16_t *window, int count) {
+    display_graph(saved_slices_averages);
+}
+
+static void bench_fft(const uint16_t *window, int count) {
+    fft_load_q15(fft_buffer, window, count, FFT_SIZE);
+    fft_real_q15(fft_buffer, FFT_SIZE);
+    fft_magnitude_q15(fft_buffer, FFT_SIZE);
+}
+
+// Усі кадри спектрограми запису; час — на зразок запису
+static void bench_prepare_stft(const uint16_t *window, int count) {
+    bench_pack_recording(window, count);
+    stft_begin(&stft, &recording, count, TOTAL_SLICES);
+}
+
+static void bench_stft(const uint16_t *window, int count) {
+    uint8_t column[STFT_BANDS];
+    for (int frame = 0; frame < stft.frames; frame++) stft_frame(&stft, frame, fft_buffer, column);
+    bench_sink = column[0];
+}
+
+static void bench_noise_floor(const uint16_t *window, int count) {
+    noise_floor_feed(&noise_floor, window, count);
+    bench_sink = noise_floor_gate(&noise_floor, ADC_NOISE_THRESHOLD);
+}
+
+// Кожне вікно — окремий сирий запис для дециматора; час — на сирий зразок
+static decimator_t bench_decimator;
+
+static void bench_prepare_decimate_16(const uint16_t *window, int count) {
+    decimator_init(&bench_decimator, 16);
+}
+
+static void bench_prepare_decimate_500(const uint16_t *window, int count) {
+    decimator_init(&bench_decimator, 500);
+}
+
+static void bench_decimate(const uint16_t *window, int count) {
+    bench_sink = decimator_process(&bench_decimator, window, count, bench_output);
+}
+
+// Пакування і розпакування запису; час — на зразок, порівнювати з частотою дискретизації
+static void bench_prepare_store_raw(const uint16_t *window, int count) {
+    sample_store_init(&recording, recording_memory, recording_bytes, bench_max_samples, false);
+    bench_pack_recording(window, count);
+}
+
+static void bench_prepare_store_delta(const uint16_t *window, int count) {
+    sample_store_init(&recording, recording_memory, recording_bytes, bench_max_samples, true);
+    bench_pack_recording(window, count);
+}
+
+static void bench_store_unpack(const uint16_t *window, int count) {
+    sample_span_t span;
+    uint32_t sum = 0;
+    sample_span_store(&span, &recording, 0, count);
+    while (sample_span_next(&span)) sum += span.samples[span.count - 1];
+    bench_sink = sum;
+}
+
+// Піраміда не скидається між вікнами, доки не досягне bench_max_samples:
+// записи 64k і 1M вимірюють її на довгому записі разом зі злиттям вузлів
+static void bench_pyramid_feed(const uint16_t *window, int count) {
+    if (pyramid_samples(&pyramid) + count > bench_max_samples) pyramid_reset(&pyramid, noise_gate);
+    pyramid_feed(&pyramid, window, count);
+}
+
+static void bench_pyramid_build(const uint16_t *window, int count) {
+    bench_pyramid_feed(window, count);
+    pyramid_finish(&pyramid);
+}
+
+// Вікна всіх рівнів наближення біля кінця запису; час — на виклик
+static void bench_pyramid_query(const uint16_t *window, int count) {
+    int samples = pyramid_samples(&pyramid);
+    for (int level = 0; level <= pyramid_max_zoom(&pyramid, TOTAL_SLICES); level++) {
+        int width = samples >> level;
+        pyramid_columns(&pyramid, samples - width, samples, TOTAL_SLICES, zoom_averages, zoom_maximums);
+    }
+    bench_sink = zoom_averages[0];
+}
+
 /**
- * Конвертує значення АЦП у вольти, використовуючи коефіцієнт перетворення CONVERSION_FACTOR.
- * Призначена для переведення сирих даних АЦП (uint16_t) у фізичну величину напруги.
- *
- * @param adc_value Значення АЦП (0–4095 для 12-бітного АЦП).
- * @return Значення напруги у вольтах.
+ * Режим вимірювання (SND_BENCH): проганяє гарячі шляхи аналізу над
+ * синтетичними записами і виводить час на зразок та приріст купи.
+ * На Pico функції отримують вікна по SAMPLE_ARRAY_SIZE, на хості
+ * (snd_bench) — увесь запис до BENCH_HOST_SAMPLES одним буфером, і запис
+ * теж вміщає його повністю. Ті, що читають запис, отримують вікно,
+ * упаковане в recording.
  */
-float adc_to_volt(uint16_t adc_value) {
-  return adc_value * CONVERSION_FACTOR;
+void run_benchmarks() {
+    static const bench_case_t cases[] = {
+        { "calculate_average", bench_pack_recording, bench_calculate_average },
+        { "calculate_slice_averages", bench_pack_recording, bench_slice_averages },
+        { "slice_stats", bench_pack_recording, bench_slice_stats },
+        { "analyze_peaks", bench_pack_recording, bench_peaks },
+        { "noise_floor", NULL, bench_noise_floor },
+        { "scale_adc_value", NULL, bench_scale_adc_value },
+        { "trigger_rising", NULL, bench_trigger },
+        { "adc_code_to_mv", NULL, bench_adc_code_to_mv },
+        { "format_volts", NULL, bench_format_volts },
+        { "meter_z", bench_prepare_meter_z, bench_meter_slices },
+        { "meter_a", bench_prepare_meter_a, bench_meter_slices },
+        { "display_graph", bench_prepare_graph, bench_display_graph },
+        { "fft", NULL, bench_fft },
+        { "stft", bench_prepare_stft, bench_stft },
+        { "decimate_x16", bench_prepare_decimate_16, bench_decimate },
+        { "decimate_x500", bench_prepare_decimate_500, bench_decimate },
+        { "store_pack_raw", bench_prepare_store_raw, bench_pack_recording },
+        { "store_pack_delta", bench_prepare_store_delta, bench_pack_recording },
+        { "store_unpack_raw", bench_prepare_store_raw, bench_store_unpack },
+        { "store_unpack_delta", bench_prepare_store_delta, bench_store_unpack },
+        { "pyramid_build", NULL, bench_pyramid_build },
+        { "pyramid_query", bench_pyramid_build, bench_pyramid_query },
+    };
+#if PICO_ON_DEVICE
+    sleep_ms(3000); // Час на підключення терміналу до USB
+#endif
+    borrow_fft_buffer(); // ШПФ і вихід дециматора, на весь час вимірювань
+#if PICO_ON_DEVICE
+    bench_output = (uint16_t *)fft_buffer;
+    bench_run(cases, sizeof(cases) / sizeof(cases[0]), adc_values, SAMPLE_ARRAY_SIZE, SND_BENCH_JSON);
+#else
+    // Буфери виділяються до bench_run, тому в приріст купи не входять
+    bench_max_samples = BENCH_HOST_SAMPLES;
+    uint16_t *window = malloc(BENCH_HOST_SAMPLES * sizeof(uint16_t));
+    bench_output = malloc(BENCH_HOST_SAMPLES * sizeof(uint16_t));
+    recording_bytes = (size_t)BENCH_HOST_SAMPLES * 2 + 64 * 1024; // Таблиця блоків і сирі 12 біт
+    recording_memory = malloc(recording_bytes);
+    if (!window || !bench_output || !recording_memory ||
+        !sample_store_init(&recording, recording_memory, recording_bytes, bench_max_samples,
+                           RECORDING_DELTA_ENCODING)) {
+        printf("Not enough memory for host benchmarks\n");
+        return;
+    }
+    adc_values = window; // Функції над кільцем потоку бачать увесь запис
+    bench_run(cases, sizeof(cases) / sizeof(cases[0]), window, BENCH_HOST_SAMPLES, SND_BENCH_JSON);
+#endif
 }
+#endif
 
 int main() {
     init_system();
+#if SND_BENCH
+    run_benchmarks();
+    return 0;
+#endif
     lcd_hello();
     while (1) {
+        event_t batch[EVENT_BATCH];
+        int batch_count = event_take(&input_events, batch, EVENT_BATCH);
+        handle_events(batch, batch_count);
+        int captured = capture_poll();
+        if (collecting_data && !capture_streaming()) {
+            feed_slice_stats(captured); // Статистика слайсів рахується під час запису
+        }
+        if (trigger_armed) {
+            process_trigger_blocks();
+        } else if (capture_streaming()) {
+            process_stream_blocks();
+        }
+        handle_analysis_results();
         if (data_collection_complete) {
             encoder_active = false;
             print_data();
         }
+        if (zoom_target >= 0 && encoder_active && view_mode == VIEW_GRAPH) {
+            apply_zoom();
+        }
+        if (spectrogram_target >= 0 && view_mode == VIEW_SPECTROGRAM) {
+            request_spectrogram_window();
+        }
         if (should_update_encoder_display()) {
+            TRACE_BEGIN(TRACE_ENCODER_DISPLAY);
             update_encoder_display();
+            TRACE_END(TRACE_ENCODER_DISPLAY);
         }
-        sleep_ms(10);
+        TRACE_BEGIN(TRACE_LCD_FLUSH);
+        lcd_flush(); // Запускає фонове надсилання змінених клітинок і символів, не чекає на I2C
+        TRACE_END(TRACE_LCD_FLUSH);
+        record_display_latency(batch, batch_count);
+        service_flash_log();
+        handle_terminal_commands(); // f — частота; b — кадри; a, g — тригер; e — події; m, w, k — рівень; p — спектрограма; l, d — збережені записи; t, s, r — траса
+        if (main_loop_idle()) event_wait(&input_events, EVENT_IDLE_US);
     }
     return 0;
 }
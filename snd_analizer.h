@@ -3,95 +3,322 @@
 #define SND_ANALIZER_H
 
 #include <stdio.h>
+#include <stddef.h>
 #include <string.h>
 #include "pico/stdlib.h"
 #include "hardware/adc.h"
 #include "hardware/gpio.h"
 #include "hardware/timer.h"
 #include "i2c-display-lib.h"
+#include "arena.h"
+#include "sample_store.h"
+#include "flash_log.h"
+#include "frame.h"
+#include "capture.h"
+#include "slice_stats.h"
+#include "pyramid.h"
+#include "encoder.h"
+#include "adc_scale.h"
+#include "meter.h"
+#include "events.h"
+#include "fft.h"
+#include "stft.h"
+#include "pipeline.h"
+#include "peaks.h"
+#include "trigger.h"
+#include "bench.h"
+#include "trace.h"
+#include "decimate.h"
+#include "noise_floor.h"
 
 // Константи
 #define ADC_PIN 26             // Використовуємо GPIO 26 для АЦП
 #define MEASURE_PIN 21          // Кнопка підключена до GPIO 21
-#define SAMPLE_ARRAY_SIZE 4000 // Кількість зразків для зберігання
+#define SAMPLE_ARRAY_SIZE 4000 // Кільце потокового режиму і вікно вимірювань
+#define ARENA_BYTES (140 * 1024)            // Арена: кільце потоку, запис і регіон аналізу
+#define ANALYSIS_SCRATCH_BYTES (24 * 1024)  // Резерв регіону аналізу; решта арени йде на запис
+#define PYRAMID_NODES 1024                  // Вузли піраміди масштабування (12 байтів кожен)
+#define RECORDING_MAX_SAMPLES (128 * 1024)  // Межа довжини запису (розмір таблиці блоків)
+#define RECORDING_DELTA_ENCODING 1          // Дельта-кодування тихих блоків запису
+#define FLASH_LOG_BYTES (1024 * 1024)       // Журнал записів у кінці флешу
+#define FLASH_LOG_SLICE_US 5000             // Скільки займати флеш за один прохід основного циклу
+#define RECORDING_SUMMARY_VERSION 1
 #define GRAPH_LENGTH 8
 #define GRAPH_SLICE_LENGTH 5
+#define GRAPH_WIDE_CELLS 16    // Символів у широкому графіку: увесь рядок 0
 #define TOTAL_SLICES (GRAPH_LENGTH * GRAPH_SLICE_LENGTH) // Загальна кількість слайсів
 #define SAMPLE_INTERVAL_MS 1   // Інтервал вибірки, 1 мс
-#define ADC_NOISE_THRESHOLD 50 // Мінімальне відхилення від шуму
+#define ADC_NOISE_THRESHOLD 50 // Мінімальне відхилення від рівня тиші
+#define ADC_GRAPH_SPAN (3200 - 2080) // Верх графіка над рівнем тиші
+#define NOISE_FLOOR_TAU_MS 1000 // Стала часу оцінки рівня тиші
 #define BUTTON_DEBOUNCE_US 100000 // 100 мс
 #define LCD_SDA_PIN 16
 #define LCD_SCL_PIN 17
 #define ENCODER_DT_PIN 4       // DT енкодера на GPIO 4
 #define ENCODER_CLK_PIN 5      // CLK енкодера на GPIO 5
+#define ENCODER_SW_PIN 6       // Кнопка енкодера на GPIO 6: графік / спектр, довге натискання — масштаб
+#define ENCODER_LONG_PRESS_US 500000 // Натискання кнопки енкодера від 0.5 с — довге
+#define EVENT_IDLE_US 100000 // Найдовший сон основного циклу без подій
 #define POINTER_POSITION 7     // 7 = нижній піксель, 0 = верхній піксель
 
 #define SAMPLE_INTERVAL_MS 1 // 1 мс = 1000 Гц
-#define MIN_PEAK_DURATION 10 // 0.01 с = 10 записів при 1000 Гц
+#define SAMPLE_RATE_HZ (1000 / SAMPLE_INTERVAL_MS) // Частота аналізу після старту; змінюється командою f
+#define MIN_PEAK_DURATION 10 // 0.01 с = 10 записів при 1000 Гц; коротші піки відкидаються
+#define PEAK_ENTER_MV 2500     // Пік починається вище 2.50 В
+#define PEAK_EXIT_MV 2400      // і закінчується нижче 2.40 В (гістерезис)
+#define PEAK_MERGE_GAP_MS 20   // Коротші провали (півперіоди звуку) не розривають пік
+#define ADC_REF_MV 3270        // Опорна напруга АЦП; з неї tools/adc_tables.py будує adc_mv_table
+#define MV_TO_ADC(mv) ((uint16_t)((uint32_t)(mv) * (1 << 12) / ADC_REF_MV))
+#define ADC_TO_MV(adc) ((uint32_t)(adc) * ADC_REF_MV / (1 << 12))
 #define NEXT_PEAK_PIN 3 // GPIO3 для навігації по максимумах
 
+#define STREAM_BLOCK_COUNT TOTAL_SLICES // Потоковий режим: один блок кільця = один слайс
+#define STREAM_BLOCK_SIZE (SAMPLE_ARRAY_SIZE / STREAM_BLOCK_COUNT) // 100 зразків = 100 мс
+#define STREAM_TAP_US 300000 // Натискання коротше 300 мс вмикає потоковий режим
+#define TRIGGER_PRE_SAMPLES 1000   // Зразків перед спрацюванням тригера у вікні запису
+#define TRIGGER_POST_SAMPLES 2500  // і після нього (разом з передісторією — не більше кільця без 4 блоків)
+#define TRIGGER_LEVEL_MV 2500      // Поріг TRIGGER_LEVEL і TRIGGER_RISING
+#define TRIGGER_HYSTERESIS_MV 100  // TRIGGER_RISING готовий, коли сигнал нижче порогу на стільки
+#define TRIGGER_SLOPE_MV 150       // TRIGGER_SLOPE: приріст за один зразок
+#define METER_WEIGHTING METER_A_WEIGHTING // Зважування рівня після старту (від 4 кГц); змінюється командою w
+#define METER_CALIBRATION_DB10 1200 // дБ·10 на 0 dBFS до калібрування командою k
+#define METER_CALIBRATOR_DB10 940  // Рівень калібратора для команди k (94 дБ)
+#define METER_GRAPH_FLOOR_DB10 (-560) // Низ графіка рівня; стовпчик на кожні 8 дБ до 0 dBFS
+#define STFT_MIN_AMPLITUDE 8       // Кадр спектрограми, тихіший за стільки кодів АЦП у кожній смузі, — тиша
+#ifndef SND_BENCH
+#define SND_BENCH 0 // 1 — замість аналізатора виміряти гарячі шляхи (задається з CMake)
+#endif
+#ifndef SND_BENCH_JSON
+#define SND_BENCH_JSON 0 // 1 — результати вимірювань у форматі JSON
+#endif
+// #define SAMPLE_TIMESTAMPS // Записувати за таймером із позначкою часу кожного зразка і звітом про джитер
+// #define SLICE_STATS_VERIFY // Звіряти онлайн-статистику слайсів із пакетним розрахунком
+
+// Режими відображення графіка
+typedef enum {
+    VIEW_GRAPH,       // Середні значення слайсів
+    VIEW_SPECTRUM,    // Спектр запису (ШПФ)
+    VIEW_SPECTROGRAM  // Найгучніша смуга кожного кадру спектрограми (stft.c)
+} view_mode_t;
+
+// Що показують стовпчики графіка слайсів
+typedef enum {
+    GRAPH_AVERAGES, // Середнє значень, що не є шумом
+    GRAPH_LEVELS    // Середньоквадратичний рівень (meter.c)
+} graph_quantity_t;
+
+// Завдання конвеєра аналізу (ядро 1) і етапи статистики пропускної здатності
+typedef enum {
+    ANALYSIS_FEED,       // Накопичення статистики слайсів під час запису
+    ANALYSIS_BLOCK,      // Слайс і піки для блоку потоку
+    ANALYSIS_RECORDING,  // Слайси і піки завершеного запису
+    ANALYSIS_SPECTRUM,   // ШПФ запису
+    ANALYSIS_SPECTROGRAM, // Вікно кадрів спектрограми
+    ANALYSIS_LCD,        // Виведення результату на дисплей (ядро 0)
+    ANALYSIS_STAGES
+} analysis_job_type_t;
+
+#define STREAM_BLOCK_MAX_PEAKS 4 // Піків, що можуть закінчитися в одному блоці потоку
+
+/**
+ * Результат аналізу блоку потоку (ANALYSIS_BLOCK) у payload дескриптора.
+ * Ядро 1 пише лише сюди, а в масиви графіка, рівень тиші й список піків
+ * його переносить ядро 0 (apply_stream_block).
+ */
+typedef struct stream_block_result {
+    int first;              // Перший зразок блоку від початку потоку (заповнює ядро 0)
+    uint32_t average;       // Середнє й максимум значень, що не є шумом
+    uint32_t maximum;
+    meter_reading_t level;  // Рівні слайсу (meter.c)
+    uint16_t noise_level;   // Оцінка noise_floor після блоку
+    uint16_t noise_gate;
+    int peak_count;         // Піки, що закінчилися в цьому блоці; лишні відкидаються
+    peak_event_t peaks[STREAM_BLOCK_MAX_PEAKS]; // Межі — від початку потоку
+} stream_block_result_t;
+
+_Static_assert(sizeof(stream_block_result_t) <= PIPELINE_PAYLOAD_BYTES,
+               "stream_block_result_t must fit the pipeline payload");
+
+/**
+ * Запис у журналі флешу: підсумок, за ним sample_store_packed() запису
+ * (packed_bytes байтів). Формат — little-endian, як у пам'яті RP2040.
+ */
+typedef struct recording_summary {
+    uint32_t version;       // RECORDING_SUMMARY_VERSION
+    uint32_t sample_rate;
+    uint32_t sample_count;
+    uint32_t slice_length;
+    uint16_t noise_level;
+    uint16_t noise_gate;
+    uint32_t peak_count;
+    uint32_t packed_bytes;
+    uint32_t averages[TOTAL_SLICES];
+    uint32_t maximums[TOTAL_SLICES];
+    peak_event_t peaks[TOTAL_SLICES]; // Дійсні перші peak_count
+} recording_summary_t;
+
 // Статичні константи
 extern const uint16_t ADC_NOISE;
+extern noise_floor_t noise_floor;
+extern uint16_t noise_level;
+extern uint16_t noise_gate;
 extern const int SAMPLE_SLICE;
-extern const float CONVERSION_FACTOR;
-extern uint32_t saved_slices_maximums[TOTAL_SLICES];
+extern uint32_t *saved_slices_maximums;
 
 // Глобальні змінні
-extern uint16_t adc_values[SAMPLE_ARRAY_SIZE];
+extern arena_t arena;
+extern uint16_t *adc_values;
+#ifdef SAMPLE_TIMESTAMPS
+extern uint16_t *adc_deltas;
+#endif
+extern sample_store_t recording;
 extern int sample_index;
 extern bool collecting_data;
 extern bool data_collection_complete;
-extern struct repeating_timer timer;
-extern uint32_t saved_slices_averages[TOTAL_SLICES];
+extern uint32_t *saved_slices_averages;
+extern meter_reading_t *slice_levels;
+extern meter_t meter;
+extern peak_detector_t stream_peaks;
+extern graph_quantity_t graph_quantity;
+extern encoder_t encoder;
+extern event_queue_t input_events;
 extern int encoder_slice_index;
 extern bool encoder_active;
 extern bool encoder_update_needed;
 extern uint8_t lcd_segment[8];
-extern int peak_slices[TOTAL_SLICES];
+extern int *peak_slices;
 extern int peak_count;
 extern int current_peak_index;
+extern view_mode_t view_mode;
+extern bool graph_wide;
+extern pyramid_t pyramid;
+extern int zoom_level;
+extern int zoom_first;
 
 // Прототипи функцій
 void timer_start(void);
 void timer_stop(void);
 void lcd_set_cursor(int, int);
+int recording_slice_length(void);
+void analyze_recording(int effective_samples, int slice_length);
 void draw_graph_on_lcd(void);
 void init_encoder(void);
+void init_encoder_switch(void);
+bool is_encoder_switch_event(uint gpio, uint32_t events);
 void gpio_interrupt_handler(uint gpio, uint32_t events);
 int scale_adc_value(uint32_t average);
 int is_noise(uint32_t value);
-bool repeating_timer_callback(struct repeating_timer *t);
-void measure_pin_pressed(void);
-void measure_pin_released(void);
+void update_noise_gate();
+void print_noise_floor();
+void init_memory_layout(void);
+void begin_analysis_region(void);
+bool borrow_fft_buffer(void);
+void return_fft_buffer(void);
+void print_arena_usage(void);
+void save_recording(void);
+void read_saved_recording(uint32_t offset, uint8_t *out, uint32_t bytes);
+void service_flash_log(void);
+void list_saved_recordings(void);
+void write_raw(const uint8_t *data, uint32_t bytes);
+bool write_frame(const uint8_t *data, uint32_t bytes);
+void toggle_binary_output(void);
+void send_recording_frames(void);
+void print_frame_stats(void);
+void dump_saved_recording(int index);
+void capture_complete_handler(int sample_count);
+void handle_capture_complete(int sample_count);
+void measure_pin_pressed(uint32_t time_us);
+void measure_pin_released(uint32_t time_us);
 void clear_adc_array(void);
 void print_data(void);
+void stream_start(void);
+void stream_stop(void);
+void rotate_adc_values(int shift);
+void process_stream_blocks(void);
+trigger_config_t trigger_detector_config(void);
+void trigger_arm(void);
+void trigger_disarm(void);
+void process_trigger_blocks(void);
+void trigger_freeze(void);
+void display_trigger_armed(void);
+void analyze_stream_block(pipeline_job_t *job);
+void apply_stream_block(pipeline_job_t *job);
+void draw_stream_block(const pipeline_job_t *job);
+void feed_slice_stats(int captured);
+void feed_recording(int start, int end);
+void run_analysis_job(pipeline_job_t *job);
+void handle_analysis_results(void);
 void init_adc(void);
 void measure_pin_init(void);
 bool debounce_check(uint64_t current_time, uint64_t* last_event_time, uint32_t debounce_us);
 bool is_encoder_event(uint gpio);
-bool is_encoder_rotation_right(bool clk_state, bool dt_state);
-void handle_encoder_rotation(uint32_t events);
+uint8_t encoder_pins(void);
+int view_columns(void);
+void handle_encoder_steps(int steps);
+void handle_encoder_switch(const event_t *event);
 bool is_measure_pin_event(uint gpio);
-void handle_measure_pin_event(uint64_t current_time, uint64_t* last_event_time, uint32_t events);
+void handle_measure_pin_event(const event_t *event);
+void handle_events(const event_t *batch, int count);
+void record_display_latency(const event_t *batch, int count);
+bool main_loop_idle(void);
 void init_system(void);
 void lcd_segment_clear(void);
 void handle_pointer_pixel(int bit_position, int value);
 void set_lcd_segment_row(int pos, int value, bool disable_bottom);
 void lcd_segment_write(int cursor_position);
+int graph_cells(void);
+void build_graph_cell(int cell, int cells, const uint32_t *slices_averages, int pointer_slice);
+bool clear_graph_label(void);
+void draw_slice_cells(int slice, int pointer_slice);
 uint32_t calculate_average(int from, int to);
 void print_slices_averages(uint32_t slices_averages[], int slices_count);
 void display_slice_info(int sample_count, int slice_length);
+void span_average_max(sample_span_t *span, uint16_t gate, uint32_t *average, uint32_t *maximum);
+void calculate_slice_stats(int slice, sample_span_t *span);
 void calculate_slice_averages(int effective_samples, int slice_length, 
                               uint32_t* slices_averages, uint32_t* saved_slices_averages);
+void verify_slice_stats(int effective_samples, int slice_length);
+void calculate_slice_levels(int effective_samples, int slice_length);
+void print_slice_levels(void);
+int level_height(int16_t db10);
+char *format_db10(char *out, int32_t db10);
+void select_meter_weighting(uint8_t weighting);
+void calibrate_meter(void);
+void toggle_graph_quantity(void);
+int graph_column_height(const uint32_t *slices_averages, int slice);
 void display_graph(uint32_t* slices_averages);
 void lcd_hello(void);
+int column_height(int slice);
+void update_slice_column(int slice_index, int prev_slice_index);
 bool should_update_encoder_display(void);
 void update_encoder_display(void);
+int zoom_width(int level);
+void load_zoom_columns(void);
+void apply_zoom(void);
+void pan_zoom(int steps);
+void display_zoom_info(void);
 void init_next_peak_pin();
 void move_to_next_peak();
-int calculate_peak_duration(int slice_start, int slice_end);
-void analyze_peaks(int slice_length);
+peak_config_t peak_detector_config_for(uint16_t level);
+peak_config_t peak_detector_config();
+void analyze_peaks(sample_span_t *span, int slice_length);
 void display_peak_info();
-float adc_to_volt(uint16_t adc_value);
+int bin_to_hz(int bin);
+bool select_sample_rate(int preset);
+void handle_terminal_commands();
+void calculate_spectrum(void);
+void display_spectrum(void);
+void update_spectrum_display(void);
+void toggle_view(void);
+int spectrogram_band_hz(int band);
+uint32_t spectrogram_frame_ms(int frame);
+int spectrogram_height(int column);
+void calculate_spectrogram_window(pipeline_job_t *job);
+void request_spectrogram_window(void);
+void print_spectrogram_rate(const pipeline_job_t *job);
+void display_spectrogram(void);
+void update_spectrogram_display(void);
+void scroll_spectrogram(int steps);
+void print_spectrogram(void);
 
 #endif // SND_ANALIZER_H
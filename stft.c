@@ -0,0 +1,89 @@
+#include "stft.h"
+#include "fft.h"
+
+/*
+ * Спектрограма запису. Кадр — STFT_SIZE зразків із вікном Ганна (те саме
+ * ШПФ Q15, що й для спектра всього запису, меншого розміру); сусідні
+ * кадри перекриваються. Біни кадру зводяться до STFT_BANDS смуг
+ * (максимум модуля), а рівень смуги квантується логарифмічно в один байт,
+ * тож стовпчик матриці — STFT_BANDS послідовних байтів, і його читання
+ * не стрибає пам'яттю. Уся матриця довгого запису не вміщується в
+ * пам'ять, тому кадри рахуються потоком, вікно за вікном.
+ */
+
+/**
+ * Вибирає крок між кадрами: для короткого запису перекриття більше, щоб
+ * кадрів вистачило на columns стовпчиків, довгий запис іде з перекриттям
+ * 50% і прокручується.
+ *
+ * @param stft Стан перетворення.
+ * @param store Запис.
+ * @param samples Кількість записаних зразків.
+ * @param columns Стовпчиків на екрані.
+ */
+void stft_begin(stft_t *stft, const sample_store_t *store, int samples, int columns) {
+    int hop = columns > 1 ? (samples - STFT_SIZE) / (columns - 1) : STFT_MAX_HOP;
+    if (hop < STFT_MIN_HOP) hop = STFT_MIN_HOP;
+    if (hop > STFT_MAX_HOP) hop = STFT_MAX_HOP;
+    stft->store = store;
+    stft->samples = samples;
+    stft->hop = hop;
+    if (samples <= 0) stft->frames = 0;
+    else if (samples <= STFT_SIZE) stft->frames = 1; // Один кадр, доповнений нулями
+    else stft->frames = (samples - STFT_SIZE) / hop + 1;
+}
+
+int stft_frame_start(const stft_t *stft, int frame) {
+    return frame * stft->hop;
+}
+
+/**
+ * Рівень модуля в кроках по чверті октави (1.5 дБ): 4·log2 за старшим
+ * бітом і двома наступними, 0 — нульовий модуль.
+ */
+uint8_t stft_level(uint32_t magnitude) {
+    if (magnitude == 0) return 0;
+    int exponent = 31 - __builtin_clz(magnitude);
+    uint32_t fraction = exponent >= 2 ? magnitude >> (exponent - 2) : magnitude << (2 - exponent);
+    return (uint8_t)(1 + 4 * exponent + (fraction & 3));
+}
+
+/**
+ * Обчислює один кадр у стовпчик матриці.
+ *
+ * @param frame Номер кадру (0..frames-1).
+ * @param buffer Робочий буфер ШПФ на STFT_SIZE значень.
+ * @param column Вихід: STFT_BANDS рівнів (stft_level) від низьких частот.
+ */
+void stft_frame(const stft_t *stft, int frame, int16_t *buffer, uint8_t *column) {
+    // Зразки розпаковуються просто в буфер, fft_load_q15 перетворює їх на місці
+    int count = sample_store_read(stft->store, stft_frame_start(stft, frame), (uint16_t *)buffer, STFT_SIZE);
+    fft_load_q15(buffer, (const uint16_t *)buffer, count, STFT_SIZE);
+    fft_real_q15(buffer, STFT_SIZE);
+    fft_magnitude_q15(buffer, STFT_SIZE);
+
+    const uint16_t *magnitudes = (const uint16_t *)buffer;
+    for (int band = 0; band < STFT_BANDS; band++) {
+        int first_bin = band == 0 ? 1 : band * STFT_BINS_PER_BAND; // Бін 0 — постійна складова
+        uint16_t loudest = 0;
+        for (int bin = first_bin; bin < (band + 1) * STFT_BINS_PER_BAND; bin++) {
+            if (magnitudes[bin] > loudest) loudest = magnitudes[bin];
+        }
+        column[band] = stft_level(loudest);
+    }
+}
+
+/**
+ * Найгучніша смуга стовпчика.
+ *
+ * @param min_level Рівень (stft_level), нижче якого кадр вважається тишею.
+ * @return int Номер смуги або -1, якщо всі смуги тихіші за min_level.
+ */
+int stft_dominant_band(const uint8_t *column, uint8_t min_level) {
+    int dominant = -1;
+    for (int band = 0; band < STFT_BANDS; band++) {
+        if (column[band] < min_level) continue;
+        if (dominant < 0 || column[band] > column[dominant]) dominant = band;
+    }
+    return dominant;
+}
@@ -0,0 +1,34 @@
+// stft.h
+#ifndef STFT_H
+#define STFT_H
+
+#include "pico/stdlib.h"
+#include "sample_store.h"
+
+#define STFT_LOG2_SIZE 8                   // 256 точок у кадрі
+#define STFT_SIZE (1 << STFT_LOG2_SIZE)
+#define STFT_BINS (STFT_SIZE / 2)
+#define STFT_BANDS 16                      // Смуг у стовпчику матриці
+#define STFT_BINS_PER_BAND (STFT_BINS / STFT_BANDS)
+#define STFT_MAX_HOP (STFT_SIZE / 2)       // Крок між кадрами: перекриття не менше 50%
+#define STFT_MIN_HOP (STFT_SIZE / 8)       // і не більше 87.5% (короткі записи)
+
+/**
+ * Короткочасне перетворення Фур'є запису: кадри по STFT_SIZE зразків із
+ * кроком hop. Матриця не зберігається: кожен кадр обчислюється на вимогу
+ * в стовпчик із STFT_BANDS квантованих рівнів (stft_frame).
+ */
+typedef struct stft {
+    const sample_store_t *store;
+    int samples;  // Довжина запису
+    int hop;      // Крок між початками кадрів, зразків
+    int frames;   // Кількість кадрів
+} stft_t;
+
+void stft_begin(stft_t *stft, const sample_store_t *store, int samples, int columns);
+int stft_frame_start(const stft_t *stft, int frame);
+void stft_frame(const stft_t *stft, int frame, int16_t *buffer, uint8_t *column);
+uint8_t stft_level(uint32_t magnitude);
+int stft_dominant_band(const uint8_t *column, uint8_t min_level);
+
+#endif // STFT_H
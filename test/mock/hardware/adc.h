@@ -0,0 +1,12 @@
+// hardware/adc.h — заглушка: на хості зразки дає capture_sim_source (capture.c)
+#ifndef MOCK_HARDWARE_ADC_H
+#define MOCK_HARDWARE_ADC_H
+
+#include "pico/stdlib.h"
+
+void adc_init(void);
+void adc_gpio_init(uint gpio);
+void adc_select_input(uint input);
+uint16_t adc_read(void);
+
+#endif // MOCK_HARDWARE_ADC_H
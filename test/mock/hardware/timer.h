@@ -0,0 +1,7 @@
+// hardware/timer.h — заглушка: час оголошено в pico/stdlib.h
+#ifndef MOCK_HARDWARE_TIMER_H
+#define MOCK_HARDWARE_TIMER_H
+
+#include "pico/stdlib.h"
+
+#endif // MOCK_HARDWARE_TIMER_H
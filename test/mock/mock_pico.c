@@ -0,0 +1,423 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "pico/stdlib.h"
+#include "pico/stdio_usb.h"
+#include "hardware/adc.h"
+#include "hardware/dma.h"
+#include "hardware/i2c.h"
+#include "hardware/irq.h"
+#include "mock_pico.h"
+
+/*
+ * Реалізації заглушок Pico SDK для хоста. Час — монотонний годинник
+ * хоста плюс усе, що «проспали» sleep_us(): затримки драйверів не
+ * гальмують тести, але видні в time_us_64(). Периферія не робить
+ * нічого, крім запам'ятовування налаштувань, окрім шини I2C0 з дисплеєм,
+ * яку тести рухають через mock_advance_us() (mock_pico.h).
+ */
+
+static uint64_t slept_us = 0;
+
+uint64_t time_us_64(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000u + (uint64_t)now.tv_nsec / 1000u + slept_us;
+}
+
+uint32_t time_us_32(void) {
+    return (uint32_t)time_us_64();
+}
+
+void sleep_us(uint64_t us) {
+    slept_us += us;
+}
+
+void sleep_ms(uint32_t ms) {
+    sleep_us((uint64_t)ms * 1000u);
+}
+
+void busy_wait_us(uint64_t us) {
+    sleep_us(us);
+}
+
+absolute_time_t make_timeout_time_us(uint64_t us) {
+    return time_us_64() + us;
+}
+
+bool best_effort_wfe_or_timeout(absolute_time_t timeout) {
+    return time_us_64() >= timeout;
+}
+
+bool stdio_init_all(void) {
+    return true;
+}
+
+void stdio_flush(void) {
+    fflush(stdout);
+}
+
+int getchar_timeout_us(uint32_t timeout_us) {
+    return PICO_ERROR_TIMEOUT;
+}
+
+bool stdio_usb_connected(void) {
+    return true;
+}
+
+void gpio_init(uint gpio) {}
+void gpio_set_dir(uint gpio, bool out) {}
+void gpio_pull_up(uint gpio) {}
+void gpio_set_function(uint gpio, enum gpio_function fn) {}
+void gpio_set_irq_enabled(uint gpio, uint32_t event_mask, bool enabled) {}
+void gpio_set_irq_enabled_with_callback(uint gpio, uint32_t event_mask, bool enabled,
+                                        gpio_irq_callback_t callback) {}
+void gpio_put(uint gpio, bool value) {}
+
+bool gpio_get(uint gpio) {
+    return true;
+}
+
+uint32_t gpio_get_all(void) {
+    return 0xFFFFFFFFu;
+}
+
+void adc_init(void) {}
+void adc_gpio_init(uint gpio) {}
+void adc_select_input(uint input) {}
+
+uint16_t adc_read(void) {
+    return 0;
+}
+
+// Шина I2C0 з дисплеєм: контролер, DMA, переривання і панель (mock_pico.h)
+
+#define MOCK_IRQ_COUNT 32
+#define MOCK_IRQ_HANDLERS 4
+#define MOCK_LCD_ADDR 0x27
+
+static irq_handler_t irq_handlers[MOCK_IRQ_COUNT][MOCK_IRQ_HANDLERS];
+static bool irq_enabled[MOCK_IRQ_COUNT];
+static bool irq_running = false;
+
+static i2c_hw_t i2c0_hw;
+i2c_inst_t i2c0_inst = { &i2c0_hw, false };
+static uint32_t i2c_baud = 100 * 1000;
+static uint32_t i2c_fifo[MOCK_I2C_FIFO_DEPTH];
+static int i2c_fifo_head = 0;
+static int i2c_fifo_count = 0;
+static uint64_t i2c_credit_us = 0; // Час шини, ще не витрачений на байти
+static mock_i2c_stats_t i2c_stats;
+static uint32_t i2c_bus_bytes = 0;      // Усі байти, передані на шину
+static int64_t i2c_abort_byte = -1;     // Номер байта, на якому буде NACK
+
+typedef struct mock_dma_channel {
+    volatile void *write_addr;
+    const volatile uint32_t *read_addr;
+    uint32_t count;
+    bool busy;
+    bool irq1_enabled;
+    bool irq1_status;
+} mock_dma_channel_t;
+
+static uint32_t dma_claimed = 0;
+static mock_dma_channel_t dma_channels[NUM_DMA_CHANNELS];
+
+// HD44780 за PCF8574: DDRAM, CGRAM, лічильник адреси й напівбайт 4-бітного режиму
+static uint8_t lcd_ddram[0x80];
+static uint8_t lcd_cgram_mem[64];
+static uint8_t lcd_address = 0;
+static bool lcd_in_cgram = false;
+static bool lcd_four_bit = false;
+static bool lcd_low_nibble = false;
+static uint8_t lcd_high_nibble = 0;
+static uint8_t lcd_expander = 0;
+
+static void lcd_execute(bool data, uint8_t value) {
+    if (data) {
+        if (lcd_in_cgram) lcd_cgram_mem[lcd_address & 0x3F] = value;
+        else lcd_ddram[lcd_address & 0x7F] = value;
+        lcd_address++;
+    } else if (value & 0x80) {
+        lcd_in_cgram = false;
+        lcd_address = value & 0x7F;
+    } else if (value & 0x40) {
+        lcd_in_cgram = true;
+        lcd_address = value & 0x3F;
+    } else if ((value & 0xE0) == 0x20) {
+        lcd_four_bit = !(value & 0x10);
+        lcd_low_nibble = false;
+    } else if (value == 0x01) {
+        memset(lcd_ddram, ' ', sizeof(lcd_ddram));
+        lcd_in_cgram = false;
+        lcd_address = 0;
+    } else if ((value & 0xFE) == 0x02) {
+        lcd_in_cgram = false;
+        lcd_address = 0;
+    }
+}
+
+// Байт на виводах PCF8574: D4–D7 — старші біти, E — біт 2, RS — біт 0
+static void lcd_expander_write(uint8_t value) {
+    bool falling = (lcd_expander & 0x04) && !(value & 0x04);
+    uint8_t nibble = lcd_expander >> 4;
+    bool data = lcd_expander & 0x01;
+    lcd_expander = value;
+    if (!falling) return;
+    if (!lcd_four_bit) {
+        lcd_execute(data, (uint8_t)(nibble << 4));
+    } else if (!lcd_low_nibble) {
+        lcd_high_nibble = nibble;
+        lcd_low_nibble = true;
+    } else {
+        lcd_low_nibble = false;
+        lcd_execute(data, (uint8_t)(lcd_high_nibble << 4 | nibble));
+    }
+}
+
+static bool irq_asserted(uint num) {
+    if (num == I2C0_IRQ) return (i2c0_hw.raw_intr_stat & i2c0_hw.intr_mask) != 0;
+    if (num != DMA_IRQ_1) return false;
+    for (int channel = 0; channel < NUM_DMA_CHANNELS; channel++) {
+        if (dma_channels[channel].irq1_enabled && dma_channels[channel].irq1_status) return true;
+    }
+    return false;
+}
+
+// Викликає обробники ввімкнених переривань, поки їхні лінії активні. Не
+// вкладається: переривання, що виникли в обробнику, обробляються після нього
+static void irq_dispatch(void) {
+    static const uint lines[] = { DMA_IRQ_1, I2C0_IRQ };
+    if (irq_running) return;
+    irq_running = true;
+    for (int pass = 0, again = 1; again; pass++) {
+        again = 0;
+        for (unsigned i = 0; i < sizeof(lines) / sizeof(lines[0]); i++) {
+            uint num = lines[i];
+            if (!irq_enabled[num] || !irq_asserted(num)) continue;
+            if (pass == 1000) {
+                printf("mock: IRQ %u is never cleared\n", num);
+                irq_running = false;
+                return;
+            }
+            for (int h = 0; h < MOCK_IRQ_HANDLERS && irq_handlers[num][h]; h++) irq_handlers[num][h]();
+            again = 1;
+        }
+    }
+    irq_running = false;
+}
+
+// Канали DMA, що пишуть у IC_DATA_CMD, переносять слова в TX FIFO, поки в ньому є місце
+static void dma_pump(void) {
+    for (int channel = 0; channel < NUM_DMA_CHANNELS; channel++) {
+        mock_dma_channel_t *dma = &dma_channels[channel];
+        if (!dma->busy || dma->write_addr != &i2c0_hw.data_cmd) continue;
+        while (dma->count > 0 && i2c_fifo_count < MOCK_I2C_FIFO_DEPTH) {
+            uint32_t word = *dma->read_addr++;
+            dma->count--;
+            if (i2c0_hw.raw_intr_stat & I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS) {
+                i2c_stats.discarded++; // FIFO тримається порожнім до скидання TX_ABRT
+                continue;
+            }
+            i2c_fifo[(i2c_fifo_head + i2c_fifo_count++) % MOCK_I2C_FIFO_DEPTH] = word;
+        }
+        if (dma->count == 0) {
+            dma->busy = false;
+            dma->irq1_status = true;
+        }
+    }
+}
+
+// Передає на шину один байт із TX FIFO; STOP у слові завершує транзакцію
+static void i2c_step(void) {
+    uint32_t word = i2c_fifo[i2c_fifo_head];
+    i2c_fifo_head = (i2c_fifo_head + 1) % MOCK_I2C_FIFO_DEPTH;
+    i2c_fifo_count--;
+    if (i2c_bus_bytes++ == i2c_abort_byte) {
+        // NACK: майстер шле STOP, решта FIFO пропадає
+        i2c_abort_byte = -1;
+        i2c_stats.aborts++;
+        i2c_stats.discarded += i2c_fifo_count;
+        i2c_fifo_count = 0;
+        i2c0_hw.tx_abrt_source = 1;
+        i2c0_hw.raw_intr_stat |= I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS | I2C_IC_RAW_INTR_STAT_STOP_DET_BITS;
+        return;
+    }
+    if (i2c0_hw.tar == MOCK_LCD_ADDR) {
+        lcd_expander_write((uint8_t)word);
+        i2c_stats.bytes++;
+    }
+    if (word & I2C_IC_DATA_CMD_STOP_BITS) {
+        if (i2c0_hw.tar == MOCK_LCD_ADDR) i2c_stats.transactions++;
+        i2c0_hw.raw_intr_stat |= I2C_IC_RAW_INTR_STAT_STOP_DET_BITS;
+    }
+}
+
+/**
+ * Просуває час на us мікросекунд: шина передає байти з TX FIFO, DMA
+ * доливає його, а переривання обробляються після кожного байта.
+ */
+void mock_advance_us(uint64_t us) {
+    slept_us += us;
+    i2c_credit_us += us;
+    uint32_t byte_us = mock_i2c_byte_us();
+    dma_pump();
+    irq_dispatch();
+    while (i2c_credit_us >= byte_us) {
+        i2c_credit_us -= byte_us;
+        if (i2c_fifo_count == 0) continue;
+        i2c_step();
+        dma_pump();
+        irq_dispatch();
+    }
+}
+
+// TX FIFO порожній і жоден канал DMA не пише в нього
+bool mock_i2c_idle(void) {
+    if (i2c_fifo_count > 0) return false;
+    for (int channel = 0; channel < NUM_DMA_CHANNELS; channel++) {
+        if (dma_channels[channel].busy && dma_channels[channel].write_addr == &i2c0_hw.data_cmd) return false;
+    }
+    return true;
+}
+
+mock_i2c_stats_t mock_i2c_stats(void) {
+    return i2c_stats;
+}
+
+void mock_i2c_reset_stats(void) {
+    i2c_stats = (mock_i2c_stats_t){ 0 };
+}
+
+// Байт на шині: 8 бітів даних і ACK
+uint32_t mock_i2c_byte_us(void) {
+    return (9 * 1000000u + i2c_baud - 1) / i2c_baud;
+}
+
+// Байт номер bytes, рахуючи від наступного (0), не буде підтверджено
+void mock_i2c_abort_after(uint32_t bytes) {
+    i2c_abort_byte = (int64_t)i2c_bus_bytes + bytes;
+}
+
+// Читання регістра IC_CLR_*: скидає відповідний біт IC_RAW_INTR_STAT
+void mock_i2c_read_clear(volatile uint32_t *reg) {
+    if (reg == &i2c0_hw.clr_tx_abrt) {
+        i2c0_hw.raw_intr_stat &= ~I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS;
+        i2c0_hw.tx_abrt_source = 0;
+    } else if (reg == &i2c0_hw.clr_stop_det) {
+        i2c0_hw.raw_intr_stat &= ~I2C_IC_RAW_INTR_STAT_STOP_DET_BITS;
+    }
+}
+
+uint8_t mock_lcd_char(int line, int col) {
+    return lcd_ddram[(line ? 0x40 : 0x00) + col];
+}
+
+const uint8_t *mock_lcd_cgram(int slot) {
+    return &lcd_cgram_mem[(slot & 7) * 8];
+}
+
+uint i2c_init(i2c_inst_t *i2c, uint baudrate) {
+    i2c_baud = baudrate;
+    return baudrate;
+}
+
+// Окрема транзакція без DMA і FIFO; час шини додається до годинника
+int i2c_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop) {
+    if (addr != MOCK_LCD_ADDR) return PICO_ERROR_GENERIC;
+    for (size_t i = 0; i < len; i++) lcd_expander_write(src[i]);
+    i2c_stats.bytes += (uint32_t)len;
+    if (!nostop) i2c_stats.transactions++;
+    slept_us += (len + 1) * mock_i2c_byte_us(); // Разом з адресою
+    return (int)len;
+}
+
+i2c_hw_t *i2c_get_hw(i2c_inst_t *i2c) {
+    return i2c->hw;
+}
+
+uint i2c_get_dreq(i2c_inst_t *i2c, bool is_tx) {
+    return DREQ_I2C0_TX;
+}
+
+int dma_claim_unused_channel(bool required) {
+    for (int channel = 0; channel < NUM_DMA_CHANNELS; channel++) {
+        if (!(dma_claimed & (1u << channel))) {
+            dma_claimed |= 1u << channel;
+            return channel;
+        }
+    }
+    return -1;
+}
+
+dma_channel_config dma_channel_get_default_config(uint channel) {
+    return (dma_channel_config){ 0 };
+}
+
+void channel_config_set_transfer_data_size(dma_channel_config *c, enum dma_channel_transfer_size size) {}
+void channel_config_set_read_increment(dma_channel_config *c, bool incr) {}
+void channel_config_set_write_increment(dma_channel_config *c, bool incr) {}
+void channel_config_set_dreq(dma_channel_config *c, uint dreq) {}
+
+static void dma_start(uint channel) {
+    dma_channels[channel].busy = dma_channels[channel].count > 0;
+    dma_pump();
+}
+
+void dma_channel_configure(uint channel, const dma_channel_config *config, volatile void *write_addr,
+                           const volatile void *read_addr, uint transfer_count, bool trigger) {
+    dma_channels[channel].write_addr = write_addr;
+    dma_channels[channel].read_addr = read_addr;
+    dma_channels[channel].count = transfer_count;
+    if (trigger) dma_start(channel);
+}
+
+void dma_channel_set_read_addr(uint channel, const volatile void *read_addr, bool trigger) {
+    dma_channels[channel].read_addr = read_addr;
+    if (trigger) dma_start(channel);
+}
+
+void dma_channel_set_trans_count(uint channel, uint32_t trans_count, bool trigger) {
+    dma_channels[channel].count = trans_count;
+    if (trigger) dma_start(channel);
+}
+
+void dma_channel_abort(uint channel) {
+    dma_channels[channel].busy = false;
+    dma_channels[channel].count = 0;
+}
+
+void dma_channel_set_irq1_enabled(uint channel, bool enabled) {
+    dma_channels[channel].irq1_enabled = enabled;
+}
+
+void dma_channel_acknowledge_irq1(uint channel) {
+    dma_channels[channel].irq1_status = false;
+}
+
+bool dma_channel_is_busy(uint channel) {
+    return dma_channels[channel].busy;
+}
+
+bool dma_channel_get_irq1_status(uint channel) {
+    return dma_channels[channel].irq1_status;
+}
+
+void irq_set_exclusive_handler(uint num, irq_handler_t handler) {
+    memset(irq_handlers[num], 0, sizeof(irq_handlers[num]));
+    irq_handlers[num][0] = handler;
+}
+
+void irq_add_shared_handler(uint num, irq_handler_t handler, uint8_t order_priority) {
+    for (int h = 0; h < MOCK_IRQ_HANDLERS; h++) {
+        if (irq_handlers[num][h]) continue;
+        irq_handlers[num][h] = handler;
+        return;
+    }
+}
+
+// Увімкнення переривання з активною лінією одразу викликає обробник
+void irq_set_enabled(uint num, bool enabled) {
+    irq_enabled[num] = enabled;
+    if (enabled) irq_dispatch();
+}
@@ -0,0 +1,42 @@
+// mock_pico.h — керування симуляцією заглушок SDK із хостових тестів
+#ifndef MOCK_PICO_H
+#define MOCK_PICO_H
+
+#include "pico/stdlib.h"
+
+/*
+ * Шина I2C0 з дисплеєм: контролер із TX FIFO на MOCK_I2C_FIFO_DEPTH слів,
+ * канали DMA, що пишуть у IC_DATA_CMD за DREQ, і панель HD44780 за
+ * розширювачем PCF8574 (тетради по спаду E, RS — біт 0). Шина рухається
+ * лише в mock_advance_us(): один байт за 9 тактів частоти з i2c_init(),
+ * переривання DMA_IRQ_1 і I2C0_IRQ викликаються тоді ж, за рівнем, якщо
+ * вони ввімкнені.
+ *
+ * mock_i2c_abort_after() імітує NACK: байт не доходить до панелі,
+ * контролер ставить TX_ABRT і STOP_DET, очищує FIFO і відкидає нові
+ * записи, доки TX_ABRT не скинуто читанням IC_CLR_TX_ABRT. Читання
+ * регістрів IC_CLR_* драйвер робить через mock_i2c_read_clear() (тест
+ * підміняє ним LCD_I2C_CLEAR), бо звичайне читання пам'яті не видно.
+ */
+
+#define MOCK_I2C_FIFO_DEPTH 16
+
+typedef struct mock_i2c_stats {
+    uint32_t transactions; // Завершені транзакції (STOP) до адреси дисплея
+    uint32_t bytes;        // Байти, що дійшли до розширювача
+    uint32_t aborts;       // Транзакції, перервані mock_i2c_abort_after()
+    uint32_t discarded;    // Слова, відкинуті контролером після переривання
+} mock_i2c_stats_t;
+
+void mock_advance_us(uint64_t us);
+bool mock_i2c_idle(void);
+mock_i2c_stats_t mock_i2c_stats(void);
+void mock_i2c_reset_stats(void);
+uint32_t mock_i2c_byte_us(void);
+void mock_i2c_abort_after(uint32_t bytes);
+void mock_i2c_read_clear(volatile uint32_t *reg);
+
+uint8_t mock_lcd_char(int line, int col);
+const uint8_t *mock_lcd_cgram(int slot);
+
+#endif // MOCK_PICO_H
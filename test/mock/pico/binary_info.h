@@ -0,0 +1,7 @@
+// pico/binary_info.h — заглушка: метадані для picotool на хості не потрібні
+#ifndef MOCK_PICO_BINARY_INFO_H
+#define MOCK_PICO_BINARY_INFO_H
+
+#define bi_decl(...)
+
+#endif // MOCK_PICO_BINARY_INFO_H
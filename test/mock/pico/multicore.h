@@ -0,0 +1,7 @@
+// pico/multicore.h — заглушка: на хості ядро 1 замінює потік pthread (pipeline.c)
+#ifndef MOCK_PICO_MULTICORE_H
+#define MOCK_PICO_MULTICORE_H
+
+#include "pico/stdlib.h"
+
+#endif // MOCK_PICO_MULTICORE_H
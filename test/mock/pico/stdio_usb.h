@@ -0,0 +1,9 @@
+// pico/stdio_usb.h — заглушка: на хості термінал завжди підключений
+#ifndef MOCK_PICO_STDIO_USB_H
+#define MOCK_PICO_STDIO_USB_H
+
+#include "pico/stdlib.h"
+
+bool stdio_usb_connected(void);
+
+#endif // MOCK_PICO_STDIO_USB_H
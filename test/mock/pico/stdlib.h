@@ -0,0 +1,43 @@
+// pico/stdlib.h — заглушка Pico SDK для збирання на Linux-хості
+#ifndef MOCK_PICO_STDLIB_H
+#define MOCK_PICO_STDLIB_H
+
+/*
+ * Каталог test/mock підміняє заголовки Pico SDK, коли прошивка збирається
+ * без SDK (SND_HOST у CMakeLists.txt): бенчмарки й тести модулів
+ * працюють на хості, де PICO_ON_DEVICE дорівнює 0 і код вибирає
+ * свої хостові гілки. Оголошено лише те, що використовує код аналізатора;
+ * реалізації — у mock_pico.c.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define PICO_ON_DEVICE 0
+#define PICO_ERROR_TIMEOUT (-1)
+#define PICO_ERROR_GENERIC (-2)
+
+#define __not_in_flash_func(name) name
+#define __time_critical_func(name) name
+
+typedef unsigned int uint;
+typedef uint64_t absolute_time_t;
+
+uint64_t time_us_64(void);
+uint32_t time_us_32(void);
+void sleep_us(uint64_t us);
+void sleep_ms(uint32_t ms);
+void busy_wait_us(uint64_t us);
+static inline void tight_loop_contents(void) {}
+
+absolute_time_t make_timeout_time_us(uint64_t us);
+bool best_effort_wfe_or_timeout(absolute_time_t timeout);
+
+bool stdio_init_all(void);
+void stdio_flush(void);
+int getchar_timeout_us(uint32_t timeout_us);
+
+#include "hardware/gpio.h"
+
+#endif // MOCK_PICO_STDLIB_H
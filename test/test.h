@@ -0,0 +1,48 @@
+// test.h
+#ifndef TEST_H
+#define TEST_H
+
+#include <stdio.h>
+#include "bench.h"
+
+/*
+ * Спільне для хостових тестів: перевірка, що не зупиняє тест, і підсумок,
+ * який стає кодом виходу програми для ctest.
+ */
+
+static int test_failures = 0;
+
+#define CHECK(condition, ...)                                           \
+    do {                                                                \
+        if (!(condition)) {                                             \
+            test_failures++;                                            \
+            printf("FAIL %s:%d: ", __FILE__, __LINE__);                 \
+            printf(__VA_ARGS__);                                        \
+            printf("\n");                                               \
+        }                                                               \
+    } while (0)
+
+// Відтворюваний ряд псевдовипадкових чисел (bench_random), test_seed() починає його заново
+static uint32_t test_random_state = 1;
+
+static inline void test_seed(uint32_t seed) {
+    test_random_state = seed;
+}
+
+static inline uint32_t test_random(void) {
+    return bench_random(&test_random_state);
+}
+
+// Значення сигналу, округлене до коду 12-бітного АЦП
+static inline uint16_t test_clamp_adc(double value) {
+    if (value < 0) return 0;
+    if (value > 4095) return 4095;
+    return (uint16_t)(value + 0.5);
+}
+
+static inline int test_report(const char *name) {
+    printf("%s: %s\n", name, test_failures ? "FAILED" : "ok");
+    return test_failures ? 1 : 0;
+}
+
+#endif // TEST_H
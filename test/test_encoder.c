@@ -0,0 +1,199 @@
+#include <stdlib.h>
+#include "test.h"
+#include "encoder.h"
+
+/*
+ * Декодер енкодера (encoder.c) на записаних послідовностях станів пінів:
+ * повільні й швидкі оберти в обидва боки, дребезг контактів на кожному
+ * фронті, пропущені переривання (змінилися обидва піни), поворот на пів
+ * клацання й назад і прискорення за інтервалом між клацаннями. Друкується
+ * також час обробки одного фронту.
+ */
+
+#define RANDOM_DETENTS 5000
+#define TIME_MIN_US 20000
+
+// Стан пінів CLK << 1 | DT на цикл клацання від фіксованого положення
+static const uint8_t right_cycle[4] = { 1, 0, 2, 3 };
+static const uint8_t left_cycle[4] = { 2, 0, 1, 3 };
+
+typedef struct edge {
+    uint32_t time_us;
+    uint8_t pins;
+} edge_t;
+
+#define MAX_EDGES 200000
+static edge_t trace[MAX_EDGES];
+static int trace_length;
+
+static void add_edge(uint32_t time_us, uint8_t pins) {
+    if (trace_length < MAX_EDGES) trace[trace_length++] = (edge_t){ time_us, pins };
+}
+
+/*
+ * Додає клацання в напрямку direction, що починається в start_us і триває
+ * length_us. bounces — скільки разів пін тремтить на кожному фронті перед
+ * тим, як устоятися (кожне тремтіння — два фронти).
+ */
+static void add_detent(int direction, uint32_t start_us, uint32_t length_us, int bounces) {
+    const uint8_t *cycle = direction > 0 ? right_cycle : left_cycle;
+    uint8_t previous = ENCODER_REST_STATE;
+    for (int i = 0; i < 4; i++) {
+        uint32_t time_us = start_us + length_us * i / 4;
+        for (int b = 0; b < bounces; b++) {
+            add_edge(time_us++, cycle[i]);
+            add_edge(time_us++, previous);
+        }
+        add_edge(time_us, cycle[i]);
+        previous = cycle[i];
+    }
+}
+
+/*
+ * Проганяє запис через декодер. Повертає суму кроків; у clicks — кількість
+ * ненульових результатів, у last — останній.
+ */
+static int run_trace(encoder_t *encoder, int *clicks, int *last) {
+    int total = 0;
+    *clicks = 0;
+    for (int i = 0; i < trace_length; i++) {
+        int steps = encoder_feed(encoder, trace[i].pins, trace[i].time_us);
+        if (steps) {
+            total += steps;
+            (*clicks)++;
+            if (last) *last = steps;
+        }
+    }
+    return total;
+}
+
+static void check_slow_turns(void) {
+    encoder_t encoder;
+    encoder_init(&encoder, ENCODER_REST_STATE);
+    trace_length = 0;
+    for (int i = 0; i < 10; i++) add_detent(1, i * 200000, 20000, 0);
+    for (int i = 10; i < 25; i++) add_detent(-1, i * 200000, 20000, 0);
+    int clicks, total = run_trace(&encoder, &clicks, NULL);
+    CHECK(total == 10 - 15 && clicks == 25, "slow turns: %d steps in %d clicks, expected -5 in 25", total, clicks);
+    CHECK(encoder.detents == 25 && encoder.invalid == 0, "slow turns: %u detents, %u invalid",
+          (unsigned)encoder.detents, (unsigned)encoder.invalid);
+}
+
+// Дребезг: пін повертається назад до 3 разів на кожному фронті, а після
+// клацання ще тремтить у фіксованому положенні — кроків рівно стільки, скільки клацань
+static void check_bounce(void) {
+    encoder_t encoder;
+    encoder_init(&encoder, ENCODER_REST_STATE);
+    trace_length = 0;
+    int expected = 0;
+    uint32_t time_us = 0;
+    for (int i = 0; i < RANDOM_DETENTS; i++) {
+        int direction = test_random() & 1 ? 1 : -1;
+        expected += direction;
+        add_detent(direction, time_us, 4000 + test_random() % 20000, (int)(test_random() % 4));
+        time_us += ENCODER_ACCEL_US + test_random() % 100000; // Без прискорення
+        if (test_random() % 4 == 0) {
+            uint8_t shaken = direction > 0 ? 2 : 1; // Відходить до останнього стану циклу і назад
+            add_edge(time_us - 1000, shaken);
+            add_edge(time_us - 999, ENCODER_REST_STATE);
+        }
+    }
+    int clicks, total = run_trace(&encoder, &clicks, NULL);
+    printf("bounce: %d detents in %d edges, %d steps, %u invalid\n", RANDOM_DETENTS, trace_length, total,
+           (unsigned)encoder.invalid);
+    CHECK(total == expected && clicks == RANDOM_DETENTS, "bounce: %d steps in %d clicks, expected %d in %d",
+          total, clicks, expected, RANDOM_DETENTS);
+    CHECK(encoder.invalid == 0, "bounce: %u invalid transitions", (unsigned)encoder.invalid);
+}
+
+// Пропущене переривання: два піни змінилися разом
+static void check_invalid(void) {
+    encoder_t encoder;
+    encoder_init(&encoder, ENCODER_REST_STATE);
+    // Один пропущений фронт: пів циклу однаково пройдено, клацання зараховано
+    static const uint8_t one_missed[] = { 1, 2, 3 };
+    int steps = 0;
+    for (int i = 0; i < 3; i++) steps += encoder_feed(&encoder, one_missed[i], 100000 + i * 1000);
+    CHECK(steps == 1 && encoder.invalid == 1, "one missed edge: %d steps, %u invalid", steps,
+          (unsigned)encoder.invalid);
+    // Два пропущені: напрямок невідомий, кроку немає
+    static const uint8_t two_missed[] = { 0, 3 };
+    steps = 0;
+    for (int i = 0; i < 2; i++) steps += encoder_feed(&encoder, two_missed[i], 300000 + i * 1000);
+    CHECK(steps == 0 && encoder.invalid == 3, "two missed edges: %d steps, %u invalid", steps,
+          (unsigned)encoder.invalid);
+    // Пів клацання вправо й назад
+    static const uint8_t half_back[] = { 1, 0, 1, 3 };
+    steps = 0;
+    for (int i = 0; i < 4; i++) steps += encoder_feed(&encoder, half_back[i], 500000 + i * 1000);
+    CHECK(steps == 0 && encoder.invalid == 3, "half a detent and back: %d steps", steps);
+    // Той самий стан ще раз (повторне переривання) нічого не змінює
+    CHECK(encoder_feed(&encoder, ENCODER_REST_STATE, 600000) == 0 && encoder.quarter == 0,
+          "repeated state changed the decoder");
+    // Наступне чисте клацання після збоїв
+    steps = 0;
+    for (int i = 0; i < 4; i++) steps += encoder_feed(&encoder, left_cycle[i], 700000 + i * 1000);
+    CHECK(steps == -1 && encoder.detents == 2, "detent after errors: %d steps", steps);
+}
+
+/*
+ * Прискорення: клацання з інтервалами, що зменшуються, — кроків
+ * ENCODER_ACCEL_US / інтервал, від 1 до ENCODER_ACCEL_MAX; перше клацання
+ * завжди один крок.
+ */
+static void check_acceleration(void) {
+    static const uint32_t intervals[] = { 500000, 60000, 59999, 30000, 20000, 10000, 7500, 7499, 2000, 100000 };
+    static const int expected[] = { 1, 1, 1, 2, 3, 6, 8, 8, 8, 1 };
+    int count = (int)(sizeof(intervals) / sizeof(intervals[0]));
+    encoder_t encoder;
+    encoder_init(&encoder, ENCODER_REST_STATE);
+    uint32_t detent_us = 1000000;
+    int steps = 0;
+    for (int i = 0; i < 4; i++) steps = encoder_feed(&encoder, right_cycle[i], detent_us - 300 + i * 100);
+    CHECK(steps == 1, "first detent: %d steps", steps);
+    for (int n = 0; n < count; n++) {
+        detent_us += intervals[n];
+        int direction = n % 2 ? -1 : 1;
+        trace_length = 0;
+        add_detent(direction, detent_us - 400, 400, n % 3);
+        int clicks;
+        run_trace(&encoder, &clicks, &steps);
+        CHECK(clicks == 1 && steps == direction * expected[n], "interval %u us: %d steps, expected %d",
+              (unsigned)intervals[n], steps, direction * expected[n]);
+    }
+
+    // Швидкий оберт: 100 клацань за 0.3 с проходять довгий запис
+    trace_length = 0;
+    detent_us += 1000000;
+    for (int i = 0; i < 100; i++) add_detent(1, detent_us + i * 3000, 2000, 1);
+    int clicks, total = run_trace(&encoder, &clicks, NULL);
+    printf("fast spin: 100 detents in 0.3 s -> %d steps\n", total);
+    CHECK(clicks == 100 && total == 1 + 99 * ENCODER_ACCEL_MAX, "fast spin: %d steps in %d clicks", total, clicks);
+}
+
+static void time_feed(void) {
+    encoder_t encoder;
+    encoder_init(&encoder, ENCODER_REST_STATE);
+    trace_length = 0;
+    for (int i = 0; i < 10000; i++) add_detent(i & 1 ? 1 : -1, i * 5000, 4000, 1);
+    uint64_t elapsed_us = 0;
+    uint32_t passes = 0;
+    volatile int sink = 0;
+    while (elapsed_us < TIME_MIN_US) {
+        uint64_t start = time_us_64();
+        int clicks;
+        sink += run_trace(&encoder, &clicks, NULL);
+        elapsed_us += time_us_64() - start;
+        passes++;
+    }
+    printf("encoder_feed: %.2f ns per edge\n", elapsed_us * 1000.0 / ((double)passes * trace_length));
+}
+
+int main(void) {
+    check_slow_turns();
+    check_bounce();
+    check_invalid();
+    check_acceleration();
+    time_feed();
+    return test_report("encoder");
+}
@@ -0,0 +1,213 @@
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include "test.h"
+#include "events.h"
+
+/*
+ * Черга подій (events.c) з потоком-виробником замість переривань:
+ * порядок і відсутність втрат, коли споживач встигає; точний облік
+ * відкинутих подій, коли виробник його заливає; пробудження з
+ * event_wait() і гістограма затримки від події до обробки. Друкується
+ * також час проходу однієї події через чергу.
+ */
+
+#define EVENT_COUNT 200000
+#define PACED_BURST (EVENT_QUEUE_SIZE / 2)
+
+static event_queue_t queue;
+
+typedef struct producer {
+    int count;
+    bool paced;       // Чекати, доки споживач розбере пачку
+    int rejected;     // Скільки разів event_post повернув false
+} producer_t;
+
+static uint32_t now_us(void) {
+    return (uint32_t)time_us_64();
+}
+
+// Виробник — як переривання: номер події у value, відкинуту не повторює
+static void *produce(void *arg) {
+    producer_t *producer = arg;
+    for (int i = 0; i < producer->count; i++) {
+        if (!event_post(&queue, EVENT_ENCODER_STEPS, i, now_us())) producer->rejected++;
+        if (producer->paced && i % PACED_BURST == PACED_BURST - 1) {
+            while (event_pending(&queue)) sched_yield();
+        }
+    }
+    return NULL;
+}
+
+typedef struct consumed {
+    int received;
+    int out_of_order;
+    int batches;
+} consumed_t;
+
+/*
+ * Основний цикл: чекає подію, розбирає пачками по EVENT_BATCH і рахує
+ * затримку. slow — імітація довгого виведення на дисплей після пачки.
+ */
+static consumed_t consume(int expected, bool slow) {
+    consumed_t consumed = { 0 };
+    int32_t previous = -1;
+    uint64_t give_up_us = time_us_64() + 10000000;
+    while (consumed.received + (int)__atomic_load_n(&queue.dropped, __ATOMIC_RELAXED) < expected &&
+           time_us_64() < give_up_us) {
+        event_wait(&queue, 1000);
+        event_t batch[EVENT_BATCH];
+        int count = event_take(&queue, batch, EVENT_BATCH);
+        if (count == 0) continue;
+        for (int i = 0; i < count; i++) {
+            if (batch[i].type != EVENT_ENCODER_STEPS || batch[i].value <= previous) consumed.out_of_order++;
+            previous = batch[i].value;
+        }
+        if (slow && consumed.batches % 64 == 0) {
+            uint64_t until = time_us_64() + 200;
+            while (time_us_64() < until) {}
+        }
+        event_record_latency(&queue, batch, count, now_us());
+        consumed.received += count;
+        consumed.batches++;
+    }
+    return consumed;
+}
+
+static uint32_t histogram_total(void) {
+    uint32_t total = 0;
+    for (int bucket = 0; bucket < EVENT_LATENCY_BUCKETS; bucket++) total += queue.latency_histogram[bucket];
+    return total;
+}
+
+static consumed_t run(producer_t *producer, bool slow) {
+    event_queue_init(&queue);
+    pthread_t thread;
+    pthread_create(&thread, NULL, produce, producer);
+    consumed_t consumed = consume(producer->count, slow);
+    pthread_join(thread, NULL);
+    return consumed;
+}
+
+// Споживач встигає: усі події в порядку, жодної не відкинуто
+static void check_paced(void) {
+    producer_t producer = { .count = EVENT_COUNT, .paced = true };
+    consumed_t consumed = run(&producer, false);
+    printf("paced: ");
+    event_print_stats(&queue);
+    CHECK(consumed.received == EVENT_COUNT && queue.dropped == 0 && producer.rejected == 0,
+          "paced: received %d of %d, %u dropped", consumed.received, EVENT_COUNT, (unsigned)queue.dropped);
+    CHECK(consumed.out_of_order == 0, "paced: %d events out of order", consumed.out_of_order);
+    CHECK(queue.posted == EVENT_COUNT && queue.handled == EVENT_COUNT && histogram_total() == EVENT_COUNT,
+          "paced: posted %u, handled %u, %u in the histogram", (unsigned)queue.posted, (unsigned)queue.handled,
+          (unsigned)histogram_total());
+    CHECK(queue.max_batch >= 1 && queue.max_batch <= EVENT_BATCH, "paced: max batch %u",
+          (unsigned)queue.max_batch);
+}
+
+// Виробник заливає повільного споживача: відкинуті точно пораховані, решта в порядку
+static void check_flood(void) {
+    producer_t producer = { .count = EVENT_COUNT, .paced = false };
+    consumed_t consumed = run(&producer, true);
+    printf("flood: ");
+    event_print_stats(&queue);
+    CHECK(queue.dropped == (uint32_t)producer.rejected, "flood: %u dropped, producer saw %d rejected",
+          (unsigned)queue.dropped, producer.rejected);
+    CHECK(consumed.received + (int)queue.dropped == EVENT_COUNT, "flood: %d received + %u dropped != %d",
+          consumed.received, (unsigned)queue.dropped, EVENT_COUNT);
+    CHECK(queue.posted == (uint32_t)consumed.received && queue.handled == (uint32_t)consumed.received,
+          "flood: posted %u, handled %u, received %d", (unsigned)queue.posted, (unsigned)queue.handled,
+          consumed.received);
+    CHECK(consumed.out_of_order == 0, "flood: %d events out of order", consumed.out_of_order);
+}
+
+// Переповнення в одному потоці: рівно EVENT_QUEUE_SIZE подій, далі відкидаються
+static void check_overflow(void) {
+    event_queue_init(&queue);
+    int accepted = 0;
+    for (int i = 0; i < EVENT_QUEUE_SIZE + 10; i++) accepted += event_post(&queue, EVENT_NEXT_PEAK, i, 0);
+    CHECK(accepted == EVENT_QUEUE_SIZE && queue.dropped == 10, "overflow: %d accepted, %u dropped", accepted,
+          (unsigned)queue.dropped);
+    event_t batch[EVENT_QUEUE_SIZE];
+    int count = event_take(&queue, batch, 5);
+    CHECK(count == 5 && batch[0].value == 0 && batch[4].value == 4, "overflow: first batch");
+    CHECK(event_post(&queue, EVENT_CAPTURE_COMPLETE, 1000, 0), "overflow: no room after a take");
+    count = event_take(&queue, batch, EVENT_QUEUE_SIZE);
+    CHECK(count == EVENT_QUEUE_SIZE - 4 && batch[0].value == 5 && batch[count - 1].value == 1000 &&
+          batch[count - 1].type == EVENT_CAPTURE_COMPLETE, "overflow: second batch of %d", count);
+    CHECK(!event_pending(&queue) && event_take(&queue, batch, 1) == 0, "overflow: queue not empty");
+    CHECK(queue.max_batch == (uint32_t)(EVENT_QUEUE_SIZE - 4), "overflow: max batch %u", (unsigned)queue.max_batch);
+}
+
+// Кошик k: затримка менше 2^k мкс, останній — усе більше
+static void check_histogram(void) {
+    event_queue_init(&queue);
+    static const uint32_t latencies[] = { 0, 1, 2, 3, 4, 1000, 1023, 1024, 40000, 4000000000u };
+    static const int buckets[] = { 0, 1, 2, 2, 3, 10, 10, 11, 15, 15 };
+    int count = (int)(sizeof(latencies) / sizeof(latencies[0]));
+    event_t events[10];
+    uint32_t now = 5000;
+    for (int i = 0; i < count; i++) events[i] = (event_t){ EVENT_MEASURE_PRESS, 0, now - latencies[i] };
+    event_record_latency(&queue, events, count, now);
+    uint32_t expected[EVENT_LATENCY_BUCKETS] = { 0 };
+    for (int i = 0; i < count; i++) expected[buckets[i]]++;
+    CHECK(memcmp(expected, queue.latency_histogram, sizeof(expected)) == 0, "histogram buckets differ");
+    CHECK(queue.max_latency_us == 4000000000u && queue.handled == (uint32_t)count,
+          "histogram: max latency %u, handled %u", (unsigned)queue.max_latency_us, (unsigned)queue.handled);
+}
+
+static void *post_later(void *arg) {
+    (void)arg;
+    uint64_t until = time_us_64() + 20000;
+    while (time_us_64() < until) sched_yield();
+    event_post(&queue, EVENT_MEASURE_RELEASE, 0, now_us());
+    return NULL;
+}
+
+// event_wait: без подій чекає до кінця, подія з іншого потоку будить одразу
+static void check_wait(void) {
+    event_queue_init(&queue);
+    uint64_t start = time_us_64();
+    event_wait(&queue, 30000);
+    uint64_t idle_us = time_us_64() - start;
+    CHECK(idle_us >= 25000 && idle_us < 500000, "wait without events took %u us", (unsigned)idle_us);
+
+    pthread_t thread;
+    start = time_us_64();
+    pthread_create(&thread, NULL, post_later, NULL);
+    event_wait(&queue, 2000000);
+    uint64_t woken_us = time_us_64() - start;
+    pthread_join(thread, NULL);
+    printf("wait: idle %u us, woken after %u us\n", (unsigned)idle_us, (unsigned)woken_us);
+    CHECK(event_pending(&queue) && woken_us < 1000000, "event did not wake the consumer (%u us)",
+          (unsigned)woken_us);
+
+    // Подія до сну: event_wait повертається одразу
+    start = time_us_64();
+    event_wait(&queue, 2000000);
+    CHECK(time_us_64() - start < 100000, "wait with a pending event slept");
+}
+
+// Один потік: post і take по черзі, як переривання й основний цикл на одному ядрі
+static void time_post_take(void) {
+    event_queue_init(&queue);
+    event_t batch[EVENT_BATCH];
+    uint64_t start = time_us_64();
+    for (int i = 0; i < EVENT_COUNT; i += EVENT_BATCH) {
+        for (int j = 0; j < EVENT_BATCH; j++) event_post(&queue, EVENT_ENCODER_STEPS, i + j, 0);
+        event_take(&queue, batch, EVENT_BATCH);
+    }
+    uint64_t elapsed_us = time_us_64() - start;
+    printf("event_post + event_take: %.1f ns per event (host semaphore included)\n",
+           elapsed_us * 1000.0 / EVENT_COUNT);
+}
+
+int main(void) {
+    check_overflow();
+    check_histogram();
+    check_wait();
+    check_paced();
+    check_flood();
+    time_post_take();
+    return test_report("events");
+}
@@ -0,0 +1,122 @@
+#include <math.h>
+#include <string.h>
+#include "test.h"
+#include "fft.h"
+
+/*
+ * ШПФ у Q15 (fft.c) проти прямого ДПФ у подвійній точності над тим самим
+ * входом Q15: відношення сигнал/похибка, найбільша похибка біна в одиницях
+ * Q15 і похибка модуля після fft_magnitude_q15(). Для кожного розміру
+ * друкується також час одного перетворення (завантаження, ШПФ і модулі),
+ * щоб порівнювати з бюджетом кадру спектрограми.
+ */
+
+// Кожен етап ділить результат на 2 і округлює, тож похибка біна — кілька
+// молодших розрядів незалежно від розміру, а сигнал зменшується в size разів:
+// відношення сигнал/похибка падає приблизно на 3 дБ з кожним подвоєнням
+// розміру і найнижче для шуму, спектр якого розмазаний по всіх бінах
+#define MAX_ERROR_Q15 4.0
+#define MIN_SNR_DB 20.0
+#define TIME_MIN_US 20000
+
+static int16_t buffer[FFT_SIZE];
+static uint16_t samples[FFT_SIZE];
+static double dft_re[FFT_BINS], dft_im[FFT_BINS];
+static double cos_table[FFT_SIZE], sin_table[FFT_SIZE];
+
+// Тон на частоті bin (у бінах перетворення size), шум або тон із перевантаженням
+static void make_signal(int kind, int size, double bin) {
+    for (int i = 0; i < size; i++) {
+        double phase = 2.0 * M_PI * bin * i / size;
+        switch (kind) {
+        case 0: samples[i] = test_clamp_adc(2080 + 1500 * sin(phase)); break;
+        case 1: samples[i] = test_clamp_adc(2080 + (double)(test_random() % 1201) - 600); break;
+        default: samples[i] = test_clamp_adc(2080 + 3000 * sin(phase) + 200 * sin(7.3 * phase)); break;
+        }
+    }
+}
+
+// Пряме ДПФ входу Q15 з тим самим масштабом 1/size і розкладкою бінів, що в fft_real_q15()
+static void reference_dft(const int16_t *input, int size) {
+    int step = FFT_SIZE / size;
+    for (int k = 0; k < size / 2; k++) {
+        double re = 0, im = 0;
+        for (int n = 0; n < size; n++) {
+            int index = (int)(((int64_t)k * n % size) * step);
+            re += input[n] * cos_table[index];
+            im -= input[n] * sin_table[index];
+        }
+        dft_re[k] = re / size;
+        dft_im[k] = im / size;
+    }
+    // Бін 0: постійна складова, на місці уявної частини — бін Найквіста
+    double nyquist = 0;
+    for (int n = 0; n < size; n++) nyquist += (n & 1) ? -input[n] : input[n];
+    dft_im[0] = nyquist / size;
+}
+
+static void check_accuracy(int kind, int size, double bin) {
+    int16_t input[FFT_SIZE];
+    make_signal(kind, size, bin);
+    fft_load_q15(buffer, samples, size, size);
+    memcpy(input, buffer, size * sizeof(int16_t));
+    reference_dft(input, size);
+    fft_real_q15(buffer, size);
+
+    double signal = 0, noise = 0, max_error = 0;
+    for (int k = 0; k < size / 2; k++) {
+        double error_re = buffer[2 * k] - dft_re[k];
+        double error_im = buffer[2 * k + 1] - dft_im[k];
+        signal += dft_re[k] * dft_re[k] + dft_im[k] * dft_im[k];
+        noise += error_re * error_re + error_im * error_im;
+        if (fabs(error_re) > max_error) max_error = fabs(error_re);
+        if (fabs(error_im) > max_error) max_error = fabs(error_im);
+    }
+    double snr = 10.0 * log10(signal / (noise > 0 ? noise : 1e-12));
+
+    fft_magnitude_q15(buffer, size);
+    const uint16_t *magnitudes = (const uint16_t *)buffer;
+    double max_magnitude_error = 0;
+    for (int k = 1; k < size / 2; k++) {
+        double error = fabs(magnitudes[k] - hypot(dft_re[k], dft_im[k]));
+        if (error > max_magnitude_error) max_magnitude_error = error;
+    }
+
+    printf("size %4d signal %d bin %7.2f: SNR %5.1f dB, max error %4.1f, magnitude error %4.1f\n",
+           size, kind, bin, snr, max_error, max_magnitude_error);
+    CHECK(snr >= MIN_SNR_DB, "size %d signal %d: SNR %.1f dB", size, kind, snr);
+    CHECK(max_error <= MAX_ERROR_Q15, "size %d signal %d: max error %.1f", size, kind, max_error);
+    CHECK(max_magnitude_error <= MAX_ERROR_Q15 + 1, "size %d signal %d: magnitude error %.1f",
+          size, kind, max_magnitude_error);
+}
+
+static void time_transform(int size) {
+    uint64_t elapsed_us = 0;
+    uint32_t transforms = 0;
+    make_signal(2, size, size / 10.0);
+    while (elapsed_us < TIME_MIN_US) {
+        uint64_t start = time_us_64();
+        fft_load_q15(buffer, samples, size, size);
+        fft_real_q15(buffer, size);
+        fft_magnitude_q15(buffer, size);
+        elapsed_us += time_us_64() - start;
+        transforms++;
+    }
+    printf("size %4d: %.0f ns per transform\n", size, elapsed_us * 1000.0 / transforms);
+}
+
+int main(void) {
+    for (int i = 0; i < FFT_SIZE; i++) {
+        cos_table[i] = cos(2.0 * M_PI * i / FFT_SIZE);
+        sin_table[i] = sin(2.0 * M_PI * i / FFT_SIZE);
+    }
+    for (int size = 8; size <= FFT_SIZE; size *= 2) {
+        // Тон точно на біні, між бінами, шум і тон із гармоніками та перевантаженням
+        check_accuracy(0, size, size / 8);
+        check_accuracy(0, size, size / 5.0 + 0.37);
+        check_accuracy(1, size, 0);
+        check_accuracy(2, size, size / 16.0 + 0.5);
+    }
+    for (int size = 64; size <= FFT_SIZE; size *= 2) time_transform(size);
+    return test_report("fft");
+}
@@ -0,0 +1,281 @@
+#include <stdlib.h>
+#include <string.h>
+#include "test.h"
+#include "flash_log.h"
+#include "crc.h"
+
+/*
+ * Журнал записів (flash_log.c) на симульованому флеші теста: стирання лише
+ * цілими секторами, програмування лише цілими сторінками і лише стертих
+ * бітів, лічильник стирань кожного сектора і «вимкнення живлення» на
+ * заданій операції — сторінка програмується частково, а сектор стирається
+ * лише наполовину. Перевіряються вміст записів, оберти кільця з
+ * рівномірним зношуванням, переповнення індексу і відновлення індексу
+ * після перемонтування, зокрема після вимкнення посеред запису.
+ */
+
+#define FLASH_SIZE (512 * 1024)
+#define SECTOR_SIZE 4096
+#define PAGE_SIZE 256
+#define LOG_BASE (64 * 1024)
+#define LOG_SIZE (256 * 1024) // 64 сектори: малих записів більше, ніж вміщує індекс
+#define LOG_SECTORS (LOG_SIZE / SECTOR_SIZE)
+#define MAX_WRITES 2000
+
+static uint8_t flash[FLASH_SIZE];
+static uint32_t sector_erases[FLASH_SIZE / SECTOR_SIZE];
+static int violations;
+static int power_budget = -1; // Операцій до вимкнення; -1 — живлення не вимикається
+static bool powered = true;
+
+// Чи переживе живлення ще одну операцію
+static bool power_left(void) {
+    if (!powered) return false;
+    if (power_budget < 0) return true;
+    if (power_budget == 0) {
+        powered = false;
+        return false;
+    }
+    power_budget--;
+    return true;
+}
+
+static bool test_flash_init(void) {
+    return true; // Вміст лишається між монтуваннями, як у справжнього флешу
+}
+
+static bool test_flash_erase(uint32_t offset, uint32_t bytes) {
+    if (offset % SECTOR_SIZE || bytes % SECTOR_SIZE || offset + bytes > FLASH_SIZE) {
+        violations++;
+        return false;
+    }
+    if (!power_left()) {
+        // Перерване стирання: друга половина вже стерта, заголовок на початку лишився
+        memset(flash + offset + bytes / 2, 0xFF, bytes / 2);
+        return false;
+    }
+    memset(flash + offset, 0xFF, bytes);
+    for (uint32_t sector = offset / SECTOR_SIZE; sector < (offset + bytes) / SECTOR_SIZE; sector++) {
+        sector_erases[sector]++;
+    }
+    return true;
+}
+
+static bool test_flash_program(uint32_t offset, const uint8_t *data, uint32_t bytes) {
+    if (offset % PAGE_SIZE || bytes % PAGE_SIZE || offset + bytes > FLASH_SIZE) {
+        violations++;
+        return false;
+    }
+    for (uint32_t i = 0; i < bytes; i++) {
+        if (data[i] & ~flash[offset + i]) {
+            violations++;
+            return false;
+        }
+    }
+    // Перерване програмування доходить лише до випадкової частини сторінки
+    uint32_t done = power_left() ? bytes : test_random() % bytes;
+    for (uint32_t i = 0; i < done; i++) flash[offset + i] &= data[i];
+    return done == bytes;
+}
+
+static const uint8_t *test_flash_map(uint32_t offset) {
+    return flash + offset;
+}
+
+static const flash_device_t test_flash = {
+    .name = "flash-test",
+    .size = FLASH_SIZE,
+    .sector_size = SECTOR_SIZE,
+    .page_size = PAGE_SIZE,
+    .init = test_flash_init,
+    .erase = test_flash_erase,
+    .program = test_flash_program,
+    .map = test_flash_map,
+};
+
+static flash_log_t log;
+static uint32_t lengths[MAX_WRITES]; // Довжина запису за номером
+static uint32_t writing_sequence;
+
+static uint8_t content_byte(uint32_t sequence, uint32_t offset) {
+    uint32_t x = sequence * 2654435761u ^ offset * 40503u;
+    return (uint8_t)(x ^ x >> 13);
+}
+
+static void record_source(uint32_t offset, uint8_t *out, uint32_t bytes) {
+    for (uint32_t i = 0; i < bytes; i++) out[i] = content_byte(writing_sequence, offset + i);
+}
+
+static uint32_t span_of(uint32_t length) {
+    return (PAGE_SIZE + length + SECTOR_SIZE - 1) / SECTOR_SIZE * SECTOR_SIZE;
+}
+
+// Пише запис до кінця; false — якщо флеш відмовив (вимкнення живлення)
+static bool write_record(uint32_t length) {
+    writing_sequence = log.sequence;
+    if (!flash_log_begin(&log, length, record_source)) return false;
+    lengths[writing_sequence] = length;
+    while (flash_log_busy(&log)) {
+        if (!flash_log_step(&log)) return false;
+    }
+    return true;
+}
+
+// Вміст кожного запису в індексі — через flash_log_read і через flash_log_chunk
+static void check_contents(const char *what) {
+    static uint8_t buffer[LOG_SIZE];
+    for (int i = 0; i < flash_log_count(&log); i++) {
+        const flash_log_record_t *record = flash_log_record(&log, i);
+        CHECK(record->length == lengths[record->sequence], "%s: record %u length %u, written %u", what,
+              (unsigned)record->sequence, (unsigned)record->length, (unsigned)lengths[record->sequence]);
+        uint32_t offset = (uint32_t)(test_random() % (record->length + 1));
+        uint32_t read = flash_log_read(&log, i, offset, buffer, sizeof(buffer));
+        CHECK(read == record->length - offset, "%s: record %u read %u bytes from %u", what,
+              (unsigned)record->sequence, (unsigned)read, (unsigned)offset);
+        int bad = -1;
+        for (uint32_t j = 0; j < read && bad < 0; j++) {
+            if (buffer[j] != content_byte(record->sequence, offset + j)) bad = (int)(offset + j);
+        }
+        CHECK(bad < 0, "%s: record %u differs at byte %d", what, (unsigned)record->sequence, bad);
+
+        uint32_t crc = 0, total = 0, bytes;
+        const uint8_t *chunk;
+        while ((chunk = flash_log_chunk(&log, i, total, &bytes)) != NULL && bytes > 0) {
+            crc = crc32_update(crc, chunk, bytes);
+            total += bytes;
+        }
+        CHECK(total == record->length && crc == record->crc, "%s: record %u chunks %u bytes, crc %08x/%08x",
+              what, (unsigned)record->sequence, (unsigned)total, (unsigned)crc, (unsigned)record->crc);
+    }
+}
+
+static bool same_index(const flash_log_t *a, const flash_log_t *b) {
+    if (a->count != b->count || a->head != b->head || a->sequence != b->sequence) return false;
+    return memcmp(a->records, b->records, a->count * sizeof(flash_log_record_t)) == 0;
+}
+
+// Індекс b містить усі записи a як найновіші; старіші за них — ті, що
+// випали з повного індексу, але ще цілі у флеші
+static bool index_ends_with(const flash_log_t *a, const flash_log_t *b) {
+    if (b->count < a->count || a->head != b->head || a->sequence != b->sequence) return false;
+    return memcmp(a->records, b->records + b->count - a->count, a->count * sizeof(flash_log_record_t)) == 0;
+}
+
+static void remount(const char *what) {
+    flash_log_t before = log;
+    CHECK(flash_log_mount(&log, &test_flash, LOG_BASE, LOG_SIZE), "%s: remount failed", what);
+    CHECK(same_index(&before, &log), "%s: remount found %d records, head %u, next %u; had %d, %u, %u", what,
+          log.count, (unsigned)log.head, (unsigned)log.sequence, before.count, (unsigned)before.head,
+          (unsigned)before.sequence);
+}
+
+// Скільки найновіших записів уміщується в кільці підряд (і в індексі)
+static int expected_count(void) {
+    uint32_t used = 0;
+    int count = 0;
+    for (int sequence = (int)log.sequence - 1; sequence >= 0 && count < FLASH_LOG_MAX_RECORDS; sequence--) {
+        used += span_of(lengths[sequence]);
+        if (used > LOG_SIZE) break;
+        count++;
+    }
+    return count;
+}
+
+// Записи різної довжини, кілька обертів кільця, перемонтування після кожного
+static void check_wrap(void) {
+    memset(sector_erases, 0, sizeof(sector_erases));
+    uint32_t erases = 0, programs = 0;
+    for (int i = 0; i < 150; i++) {
+        CHECK(write_record(1 + test_random() % 20000), "wrap: write %d failed", i);
+        CHECK(flash_log_count(&log) == expected_count(), "wrap: %d records after write %d, expected %d",
+              flash_log_count(&log), i, expected_count());
+        erases += log.erases;
+        programs += log.programs;
+        check_contents("wrap");
+        remount("wrap");
+    }
+    // Сектори стираються по колу, тож за будь-яку кількість обертів різниця — одне стирання
+    uint32_t min = UINT32_MAX, max = 0;
+    for (int sector = 0; sector < LOG_SECTORS; sector++) {
+        uint32_t erases = sector_erases[LOG_BASE / SECTOR_SIZE + sector];
+        if (erases < min) min = erases;
+        if (erases > max) max = erases;
+    }
+    printf("wrap: %u records, %u erases, %u page programs, sector erases %u..%u\n", (unsigned)log.sequence,
+           (unsigned)erases, (unsigned)programs, (unsigned)min, (unsigned)max);
+    CHECK(min >= 3 && max - min <= 1, "wrap: sector erases %u..%u", (unsigned)min, (unsigned)max);
+    uint32_t outside = 0;
+    for (uint32_t sector = 0; sector < FLASH_SIZE / SECTOR_SIZE; sector++) {
+        if (sector < LOG_BASE / SECTOR_SIZE || sector >= (LOG_BASE + LOG_SIZE) / SECTOR_SIZE) {
+            outside += sector_erases[sector];
+        }
+    }
+    CHECK(outside == 0, "wrap: %u erases outside the log", (unsigned)outside);
+}
+
+// Малих записів більше, ніж вміщує індекс: лишаються найновіші
+static void check_index_overflow(void) {
+    for (int i = 0; i < FLASH_LOG_MAX_RECORDS + 8; i++) write_record(1 + test_random() % 300);
+    CHECK(flash_log_count(&log) == expected_count(), "index overflow: %d records, expected %d",
+          flash_log_count(&log), expected_count());
+    remount("index overflow");
+    check_contents("index overflow");
+}
+
+// Живлення зникає на випадковій операції запису: після перемонтування
+// лишаються рівно ті записи, які запис не почав перезаписувати. Якщо
+// живлення зникло, коли заголовок уже дійшов до флешу, запис цілий і
+// з'являється найновішим
+static void check_power_cut(void) {
+    int cuts = 0, survived = 0;
+    for (int round = 0; round < 200; round++) {
+        uint32_t length = 1 + test_random() % 20000;
+        powered = true;
+        power_budget = (int)(test_random() % (span_of(length) / PAGE_SIZE + 2));
+        if (write_record(length)) {
+            power_budget = -1;
+            continue;
+        }
+        cuts++;
+        flash_log_t kept = log; // Індекс, який лишив flash_log_begin(): записи поза секторами нового
+        power_budget = -1;
+        powered = true;
+        flash_log_mount(&log, &test_flash, LOG_BASE, LOG_SIZE);
+        flash_log_t found = log;
+        if (found.sequence == kept.sequence + 1 && found.count > 0) {
+            survived++;
+            found.count--;
+            found.sequence--;
+            found.head = kept.head;
+            if (kept.count == FLASH_LOG_MAX_RECORDS) { // Найновіший витіснив з індексу найстаріший
+                memmove(kept.records, kept.records + 1, (kept.count - 1) * sizeof(flash_log_record_t));
+                kept.count--;
+            }
+        }
+        CHECK(index_ends_with(&kept, &found), "power cut %d: %d records, next %u after remount; expected %d, %u",
+              round, log.count, (unsigned)log.sequence, kept.count, (unsigned)kept.sequence);
+        check_contents("power cut");
+    }
+    CHECK(write_record(12345), "write after power cuts failed");
+    check_contents("after power cuts");
+    remount("after power cuts");
+    printf("power cut: %d of 200 writes interrupted, %d complete after the header, %d records kept\n", cuts,
+           survived, flash_log_count(&log));
+    CHECK(cuts > 100, "only %d writes interrupted", cuts);
+}
+
+int main(void) {
+    memset(flash, 0xFF, sizeof(flash));
+    // Журнал за межами пристрою або не кратний сектору не монтується
+    CHECK(!flash_log_mount(&log, &test_flash, LOG_BASE + 100, LOG_SIZE), "unaligned log mounted");
+    CHECK(!flash_log_mount(&log, &test_flash, FLASH_SIZE - SECTOR_SIZE, LOG_SIZE), "oversized log mounted");
+    CHECK(flash_log_mount(&log, &test_flash, LOG_BASE, LOG_SIZE) && flash_log_count(&log) == 0,
+          "empty log did not mount");
+    CHECK(!flash_log_begin(&log, LOG_SIZE, record_source), "record larger than the log accepted");
+
+    check_wrap();
+    check_index_overflow();
+    check_power_cut();
+    CHECK(violations == 0, "%d erase/program rule violations", violations);
+    return test_report("flash_log");
+}
@@ -0,0 +1,393 @@
+#include <stdlib.h>
+#include <string.h>
+#include "test.h"
+#include "frame.h"
+#include "crc.h"
+
+/*
+ * Двійковий протокол (frame.c): COBS туди й назад на випадкових даних,
+ * зокрема з довгими ділянками без нулів, і кожен тип повідомлення через
+ * декодер у тесті — тип, номер, CRC і поля. Потім увесь потік кадрів із
+ * текстом printf між ними, невідправленим і пошкодженим кадром і
+ * пропуском у зразках пишеться у файл і декодується
+ * tools/frame_decode.py: текст, WAV і підсумки мають збігтися з тим, що
+ * розібрав тест. Друкується також час кадрування зразків.
+ */
+
+#define STREAM_BYTES (256 * 1024)
+#define RANDOM_ROUNDS 2000
+#define TIME_MIN_US 20000
+#define STREAM_FILE "test_frame.bin"
+#define TEXT_FILE "test_frame.txt"
+#define WAV_FILE "test_frame.wav"
+#define SUMMARY_FILE "test_frame.summary"
+
+static uint8_t stream[STREAM_BYTES];
+static int stream_length;
+static bool writer_online = true;
+
+static bool test_writer(const uint8_t *data, uint32_t bytes) {
+    if (!writer_online || stream_length + (int)bytes > STREAM_BYTES) return false;
+    memcpy(stream + stream_length, data, bytes);
+    stream_length += (int)bytes;
+    return true;
+}
+
+// Текст printf, що йде тим самим каналом між кадрами
+static void write_text(const char *text) {
+    int length = (int)strlen(text);
+    memcpy(stream + stream_length, text, length);
+    stream_length += length;
+}
+
+static void check_cobs(void) {
+    static uint8_t data[FRAME_MAX_PACKET], encoded[FRAME_MAX_ENCODED], decoded[FRAME_MAX_PACKET];
+    // Спершу межі блоків COBS: 254 і 255 байтів без нулів, потім випадкові
+    static const int edges[] = { 0, 1, 253, 254, 255, 508, 509, FRAME_MAX_PACKET };
+    int edge_count = (int)(sizeof(edges) / sizeof(edges[0]));
+    for (int round = 0; round < RANDOM_ROUNDS; round++) {
+        int length = round < edge_count ? edges[round] : (int)(test_random() % (FRAME_MAX_PACKET + 1));
+        int zeros = round < edge_count ? 3 : (int)(test_random() % 4); // Від самих нулів до даних без нулів
+        for (int i = 0; i < length; i++) {
+            uint8_t value = (uint8_t)test_random();
+            data[i] = zeros == 0 ? 0 : zeros == 3 ? (uint8_t)(value | 1) : value % (zeros * 8);
+        }
+        int encoded_length = cobs_encode(data, length, encoded);
+        CHECK(encoded_length <= length + length / 254 + 1, "COBS of %d bytes took %d", length, encoded_length);
+        CHECK(memchr(encoded, 0, encoded_length) == NULL, "COBS of %d bytes has a zero", length);
+        int decoded_length = cobs_decode(encoded, encoded_length, decoded);
+        CHECK(decoded_length == length && memcmp(decoded, data, length) == 0,
+              "COBS round trip of %d bytes (zeros %d) gave %d", length, zeros, decoded_length);
+    }
+    static const uint8_t zero_code[] = { 2, 7, 0, 3 };
+    static const uint8_t overrun[] = { 5, 1, 2 };
+    CHECK(cobs_decode(zero_code, sizeof(zero_code), decoded) < 0, "COBS with a zero code decoded");
+    CHECK(cobs_decode(overrun, sizeof(overrun), decoded) < 0, "COBS past the end decoded");
+}
+
+static uint16_t get_u16(const uint8_t *in) {
+    return (uint16_t)(in[0] | in[1] << 8);
+}
+
+static uint32_t get_u32(const uint8_t *in) {
+    return in[0] | in[1] << 8 | in[2] << 16 | (uint32_t)in[3] << 24;
+}
+
+typedef struct packet {
+    uint8_t type;
+    uint16_t sequence;
+    const uint8_t *payload;
+    int bytes;
+} packet_t;
+
+typedef void (*packet_handler_t)(const packet_t *packet);
+
+// Розбирає потік, як frame_decode.py: кадри між нулями з правильною CRC
+static void parse_stream(const uint8_t *data, int length, packet_handler_t handler, int *junk) {
+    static uint8_t decoded[FRAME_MAX_ENCODED];
+    int start = 0;
+    for (int i = 0; i <= length; i++) {
+        if (i < length && data[i] != 0) continue;
+        int part = i - start;
+        if (part > 0) {
+            int bytes = part <= FRAME_MAX_ENCODED ? cobs_decode(data + start, part, decoded) : -1;
+            if (bytes >= 7 && i < length &&
+                crc32_update(0, decoded, bytes - 4) == get_u32(decoded + bytes - 4)) {
+                packet_t packet = { decoded[0], get_u16(decoded + 1), decoded + 3, bytes - 7 };
+                handler(&packet);
+            } else if (junk) {
+                *junk += part;
+            }
+        }
+        start = i + 1;
+    }
+}
+
+static packet_t last;
+static int last_count;
+
+static void keep_last(const packet_t *packet) {
+    last = *packet;
+    last_count++;
+}
+
+// Розбирає кадри, надіслані після from; true, якщо їх рівно count
+static bool take_frames(int from, int count) {
+    last_count = 0;
+    parse_stream(stream + from, stream_length - from, keep_last, NULL);
+    return last_count == count;
+}
+
+static void check_messages(void) {
+    stream_length = 0;
+    frame_init(test_writer);
+    uint16_t sequence = 0;
+
+    int from = stream_length;
+    CHECK(frame_send_info(16000, 31, 500) && take_frames(from, 1), "info frame not decoded");
+    CHECK(last.type == FRAME_INFO && last.sequence == sequence++ && last.bytes == 9 &&
+          get_u32(last.payload) == 16000 && get_u16(last.payload + 4) == 31 && get_u16(last.payload + 6) == 500 &&
+          last.payload[8] == FRAME_VERSION, "info frame fields");
+
+    // Зразки одного кадру, найгірші для COBS: нульові байти і жодного нуля
+    static uint16_t samples[FRAME_MAX_SAMPLES * 3];
+    for (int i = 0; i < FRAME_MAX_SAMPLES * 3; i++) samples[i] = (uint16_t)(i % 3 == 0 ? 0 : 0x0101 + i % 4000);
+    from = stream_length;
+    CHECK(frame_send_samples(1000, samples, FRAME_MAX_SAMPLES * 2 + 7) && take_frames(from, 3),
+          "long sample range is not 3 frames");
+    CHECK(last.type == FRAME_SAMPLES && last.sequence == (uint16_t)(sequence + 2) && last.bytes == 4 + 7 * 2 &&
+          get_u32(last.payload) == 1000 + FRAME_MAX_SAMPLES * 2, "last sample frame fields");
+    for (int i = 0; i < 7; i++) {
+        CHECK(get_u16(last.payload + 4 + 2 * i) == samples[FRAME_MAX_SAMPLES * 2 + i], "sample %d differs", i);
+    }
+    sequence += 3;
+
+    uint32_t averages[40], maximums[40];
+    for (int i = 0; i < 40; i++) {
+        averages[i] = 2080 + test_random() % 1000;
+        maximums[i] = averages[i] + test_random() % 1000;
+    }
+    from = stream_length;
+    CHECK(frame_send_slices(averages, maximums, 40, 2617) && take_frames(from, 1), "slices frame not decoded");
+    CHECK(last.type == FRAME_SLICES && last.sequence == sequence++ && get_u16(last.payload) == 40 &&
+          get_u32(last.payload + 2) == 2617, "slices frame fields");
+    for (int i = 0; i < 40; i++) {
+        CHECK(get_u32(last.payload + 6 + 8 * i) == averages[i] && get_u32(last.payload + 10 + 8 * i) == maximums[i],
+              "slice %d differs", i);
+    }
+
+    // 100 подій — кілька кадрів; нуль подій — один порожній кадр
+    peak_event_t events[100];
+    for (int i = 0; i < 100; i++) {
+        events[i] = (peak_event_t){ .start = i * 1000, .end = i * 1000 + 400, .max = (uint16_t)(3000 + i),
+                                    .area = test_random() * 7919u };
+    }
+    int per_frame = (FRAME_MAX_PAYLOAD - 2) / 14;
+    from = stream_length;
+    CHECK(frame_send_peaks(events, 100) && take_frames(from, (100 + per_frame - 1) / per_frame),
+          "100 peaks are not %d frames", (100 + per_frame - 1) / per_frame);
+    int tail = 100 % per_frame;
+    CHECK(last.type == FRAME_PEAKS && get_u16(last.payload) == tail && last.bytes == 2 + 14 * tail,
+          "last peaks frame fields");
+    const uint8_t *event = last.payload + 2 + 14 * (tail - 1);
+    CHECK(get_u32(event) == 99000 && get_u32(event + 4) == 99400 && get_u16(event + 8) == 3099 &&
+          get_u32(event + 10) == events[99].area, "last peak differs");
+    sequence += (uint16_t)((100 + per_frame - 1) / per_frame);
+    from = stream_length;
+    CHECK(frame_send_peaks(events, 0) && take_frames(from, 1) && last.bytes == 2 && get_u16(last.payload) == 0,
+          "no peaks is not one empty frame");
+    sequence++;
+
+    trace_record_t records[3] = { { 100, 20, 1, 0 }, { 130, 5000, 4, 1 }, { 0xFFFFFFF0u, 77, 7, 0 } };
+    from = stream_length;
+    CHECK(frame_send_trace(records, 3) && take_frames(from, 1), "trace frame not decoded");
+    CHECK(last.type == FRAME_TRACE && last.sequence == sequence++ && get_u16(last.payload) == 3 &&
+          last.payload[2 + 20] == 7 && get_u32(last.payload + 2 + 20 + 2) == 0xFFFFFFF0u &&
+          get_u32(last.payload + 2 + 20 + 6) == 77, "trace frame fields");
+
+    // Невідправлений кадр рахується втраченим, але номер займає
+    writer_online = false;
+    CHECK(!frame_send_stats(0), "frame sent while the writer is offline");
+    writer_online = true;
+    sequence++;
+    from = stream_length;
+    CHECK(frame_send_stats(3) && take_frames(from, 1), "stats frame not decoded");
+    const frame_stats_t *stats = frame_stats();
+    CHECK(last.type == FRAME_STATS && last.sequence == sequence && get_u32(last.payload + 16) == 1 &&
+          get_u32(last.payload + 20) == 3 && stats->dropped == 1, "stats frame fields");
+    CHECK(stats->frames == sequence && stats->bytes == (uint32_t)stream_length,
+          "%u frames, %u bytes counted; %u, %d sent", (unsigned)stats->frames, (unsigned)stats->bytes,
+          (unsigned)sequence, stream_length);
+
+    uint8_t payload[FRAME_MAX_PAYLOAD + 1] = { 0 };
+    CHECK(!frame_send(FRAME_INFO, payload, FRAME_MAX_PAYLOAD + 1), "oversized payload sent");
+}
+
+// Очікуваний вивід frame_decode.py для кадрів, які розібрав тест
+static FILE *expected_text;
+static FILE *expected_wav;
+static int expected_frames, expected_lost, expected_samples, expected_gaps;
+static int next_sequence = -1;
+static long next_sample = -1;
+
+static void put_wav_sample(int16_t value) {
+    fputc(value & 0xFF, expected_wav);
+    fputc((value >> 8) & 0xFF, expected_wav);
+}
+
+static void describe(const packet_t *packet) {
+    const uint8_t *in = packet->payload;
+    if (next_sequence >= 0) expected_lost += (packet->sequence - next_sequence) & 0xFFFF;
+    next_sequence = (packet->sequence + 1) & 0xFFFF;
+    expected_frames++;
+    switch (packet->type) {
+    case FRAME_INFO:
+        fprintf(expected_text, "INFO rate=%u decimation=%u block=%u version=%u\n", (unsigned)get_u32(in),
+                get_u16(in + 4), get_u16(in + 6), in[8]);
+        next_sample = 0;
+        break;
+    case FRAME_SAMPLES: {
+        long first = get_u32(in);
+        int count = (packet->bytes - 4) / 2;
+        if (next_sample >= 0 && first != next_sample) {
+            fprintf(expected_text, "GAP samples %ld..%ld\n", next_sample, first);
+            expected_gaps++;
+            for (long i = next_sample; i < first; i++) put_wav_sample(0);
+        }
+        next_sample = first + count;
+        expected_samples += count;
+        for (int i = 0; i < count; i++) put_wav_sample((int16_t)((get_u16(in + 4 + 2 * i) - 2048) * 16));
+        break;
+    }
+    case FRAME_SLICES:
+        fprintf(expected_text, "SLICES %u length=%u\n", get_u16(in), (unsigned)get_u32(in + 2));
+        for (int i = 0; i < get_u16(in); i++) {
+            fprintf(expected_text, "  %2d avg=%u max=%u\n", i, (unsigned)get_u32(in + 6 + 8 * i),
+                    (unsigned)get_u32(in + 10 + 8 * i));
+        }
+        break;
+    case FRAME_PEAKS:
+        fprintf(expected_text, "PEAKS %u\n", get_u16(in));
+        for (int i = 0; i < get_u16(in); i++) {
+            const uint8_t *event = in + 2 + 14 * i;
+            fprintf(expected_text, "  %u..%u max=%u area=%u\n", (unsigned)get_u32(event),
+                    (unsigned)get_u32(event + 4), get_u16(event + 8), (unsigned)get_u32(event + 10));
+        }
+        break;
+    case FRAME_TRACE:
+        for (int i = 0; i < get_u16(in); i++) {
+            const uint8_t *record = in + 2 + 10 * i;
+            fprintf(expected_text, "#TR %u %u %u %u\n", record[0], record[1], (unsigned)get_u32(record + 2),
+                    (unsigned)get_u32(record + 6));
+        }
+        break;
+    case FRAME_STATS:
+        fprintf(expected_text, "STATS frames=%u bytes=%u busy=%uus elapsed=%uus dropped=%u overruns=%u\n",
+                (unsigned)get_u32(in), (unsigned)get_u32(in + 4), (unsigned)get_u32(in + 8),
+                (unsigned)get_u32(in + 12), (unsigned)get_u32(in + 16), (unsigned)get_u32(in + 20));
+        break;
+    }
+}
+
+static char *read_file(const char *path, long *length) {
+    FILE *file = fopen(path, "rb");
+    if (!file) return NULL;
+    fseek(file, 0, SEEK_END);
+    *length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char *data = malloc(*length + 1);
+    if (data && fread(data, 1, *length, file) != (size_t)*length) *length = -1;
+    if (data) data[*length > 0 ? *length : 0] = '\0';
+    fclose(file);
+    return data;
+}
+
+// Потік з усім, що трапляється в каналі, через tools/frame_decode.py
+static void check_decoder(void) {
+    static uint16_t samples[3000];
+    for (int i = 0; i < 3000; i++) samples[i] = (uint16_t)(2048 + 1500 * ((i / 7) % 3 - 1) + i % 50);
+    uint32_t averages[40] = { 2100 }, maximums[40] = { 3100 };
+    peak_event_t events[2] = { { 10, 300, 3500, 123456 }, { 900, 1450, 2900, 777 } };
+    trace_record_t records[2] = { { 1000, 250, 2, 0 }, { 1300, 40, 3, 1 } };
+
+    stream_length = 0;
+    frame_init(test_writer);
+    write_text("Data collection started.\n");
+    frame_send_info(4000, 16, 500);
+    frame_send_samples(0, samples, 1200);
+    write_text("Timer stopped.\n");
+    frame_send_samples(1300, samples + 1300, 1700); // 100 зразків пропущено
+    int corrupt_from = stream_length;
+    frame_send_slices(averages, maximums, 40, 75);
+    stream[corrupt_from + 20] ^= 0x5A; // Байт усередині кадру: CRC не зійдеться
+    if (stream[corrupt_from + 20] == 0) stream[corrupt_from + 20] = 0x33;
+    int corrupt_bytes = stream_length - corrupt_from - 2;
+    writer_online = false;
+    frame_send_peaks(events, 2); // Не надіслано
+    writer_online = true;
+    frame_send_peaks(events, 2);
+    frame_send_trace(records, 2);
+    frame_send_stats(5);
+    int junk_text = (int)strlen("Data collection started.\n") + (int)strlen("Timer stopped.\n");
+
+    FILE *file = fopen(STREAM_FILE, "wb");
+    CHECK(file && fwrite(stream, 1, stream_length, file) == (size_t)stream_length, "cannot write %s", STREAM_FILE);
+    if (file) fclose(file);
+
+    expected_text = fopen(TEXT_FILE ".expected", "w");
+    expected_wav = tmpfile();
+    if (!expected_text || !expected_wav) return;
+    int junk = 0;
+    parse_stream(stream, stream_length, describe, &junk);
+    fclose(expected_text);
+    CHECK(junk == junk_text + corrupt_bytes, "test parser: %d junk bytes, expected %d", junk,
+          junk_text + corrupt_bytes);
+    CHECK(expected_lost == 2 && expected_gaps == 1 && expected_samples == 2900,
+          "test parser: %d lost, %d gaps, %d samples", expected_lost, expected_gaps, expected_samples);
+
+    char command[1024];
+    snprintf(command, sizeof(command), "%s %s %s --wav %s --out %s 2> %s", PYTHON, FRAME_DECODE_PY, STREAM_FILE,
+             WAV_FILE, TEXT_FILE, SUMMARY_FILE);
+    CHECK(system(command) == 0, "%s failed", command);
+
+    long text_length, expected_length, summary_length, wav_length;
+    char *text = read_file(TEXT_FILE, &text_length);
+    char *expected = read_file(TEXT_FILE ".expected", &expected_length);
+    CHECK(text && expected && text_length == expected_length && memcmp(text, expected, text_length) == 0,
+          "%s differs from %s.expected", TEXT_FILE, TEXT_FILE);
+
+    char *summary = read_file(SUMMARY_FILE, &summary_length);
+    int frames = -1, lost = -1, junk_bytes = -1, sample_count = -1, gaps = -1;
+    if (summary) {
+        sscanf(summary, "%d frames, %d lost, %d junk bytes, %d samples, %d sample gaps", &frames, &lost,
+               &junk_bytes, &sample_count, &gaps);
+    }
+    CHECK(frames == expected_frames && lost == expected_lost && junk_bytes == junk &&
+          sample_count == expected_samples && gaps == expected_gaps,
+          "decoder summary: %d frames, %d lost, %d junk, %d samples, %d gaps; expected %d, %d, %d, %d, %d",
+          frames, lost, junk_bytes, sample_count, gaps, expected_frames, expected_lost, junk,
+          expected_samples, expected_gaps);
+
+    // WAV: 44 байти заголовка, далі зразки, а на місці пропуску — тиша
+    char *wav = read_file(WAV_FILE, &wav_length);
+    long pcm_length = ftell(expected_wav);
+    char *pcm = malloc(pcm_length > 0 ? pcm_length : 1);
+    rewind(expected_wav);
+    CHECK(pcm && fread(pcm, 1, pcm_length, expected_wav) == (size_t)pcm_length, "cannot read the expected PCM");
+    CHECK(wav && pcm && wav_length == 44 + pcm_length && memcmp(wav + 44, pcm, pcm_length) == 0 &&
+          get_u32((const uint8_t *)wav + 24) == 4000,
+          "%s: %ld bytes, expected %ld", WAV_FILE, wav_length, 44 + pcm_length);
+    fclose(expected_wav);
+    free(text);
+    free(expected);
+    free(summary);
+    free(wav);
+    free(pcm);
+}
+
+// Скільки коштує кадрування зразків порівняно з їх надходженням
+static void time_samples(void) {
+    static uint16_t samples[FRAME_MAX_SAMPLES];
+    for (int i = 0; i < FRAME_MAX_SAMPLES; i++) samples[i] = (uint16_t)(2048 + test_random() % 2048);
+    frame_init(test_writer);
+    uint64_t elapsed_us = 0;
+    uint32_t frames = 0;
+    while (elapsed_us < TIME_MIN_US) {
+        stream_length = 0;
+        uint64_t start = time_us_64();
+        for (int i = 0; i < 100; i++) frame_send_samples(i * FRAME_MAX_SAMPLES, samples, FRAME_MAX_SAMPLES);
+        elapsed_us += time_us_64() - start;
+        frames += 100;
+    }
+    double ns_per_sample = elapsed_us * 1000.0 / ((double)frames * FRAME_MAX_SAMPLES);
+    printf("frame_send_samples: %.1f ns per sample, %.2f bytes per sample on the link\n", ns_per_sample,
+           (double)stream_length / (100.0 * FRAME_MAX_SAMPLES));
+}
+
+int main(void) {
+    check_cobs();
+    check_messages();
+    check_decoder();
+    time_samples();
+    return test_report("frame");
+}
@@ -0,0 +1,270 @@
+#include "test.h"
+#include "mock_pico.h"
+#define LCD_I2C_CLEAR(hw, reg) mock_i2c_read_clear(&(hw)->reg) // Читання, яке бачить симуляція
+#include "i2c-display-lib.h"
+
+/*
+ * Драйвер дисплея (include/i2c-display-lib.h) на симульованій шині I2C0
+ * з панеллю HD44780 (mock_pico.c): скільки транзакцій і байтів коштують
+ * перемальовування рядка й завантаження 8 символів CGRAM через тіньовий
+ * буфер і DMA проти старого драйвера, що слав кожен запис PCF8574
+ * окремою транзакцією lcd_send_byte(), і чи збігається панель із тінню
+ * після випадкових оновлень посеред передачі. Переривання транзакції
+ * (NACK) на останньому байті великої транзакції, за якою чекає мала, і
+ * посеред завантаження CGRAM має закінчуватися перемальовуванням;
+ * лічильники черги — найбільша черга і замінені оновлення — перевіряються
+ * на оновленнях, що надходять, поки шина зайнята. Дев'ятий різний символ на
+ * екрані лишається порожньою клітинкою і не змінює вже показаних. Кінець
+ * передавання (lcd_idle_time_us) — час останнього STOP на шині.
+ */
+
+#define ROW_TEXT "0123456789ABCDEF"
+
+static uint64_t bus_us;
+
+// Рухає шину, доки драйвер не передасть усі оновлення і вони не вийдуть із FIFO
+static void settle(void) {
+    for (int i = 0; (lcd_busy() || !mock_i2c_idle()) && i < 100000; i++) {
+        mock_advance_us(mock_i2c_byte_us());
+        bus_us += mock_i2c_byte_us();
+    }
+    CHECK(!lcd_busy(), "transfer never finished");
+}
+
+static void check_row(int line, const char *text, const char *what) {
+    for (int col = 0; col < LCD_COLS; col++) {
+        CHECK(mock_lcd_char(line, col) == (uint8_t)text[col], "%s: row %d col %d shows 0x%02x, expected 0x%02x",
+              what, line, col, mock_lcd_char(line, col), (uint8_t)text[col]);
+    }
+}
+
+static void check_panel(const char *what) {
+    for (int line = 0; line < LCD_ROWS; line++) check_row(line, (const char *)lcd_fb[line], what);
+    for (int slot = 0; slot < LCD_CGRAM_SLOTS; slot++) {
+        if (!lcd_cgram_defined[slot]) continue;
+        CHECK(memcmp(mock_lcd_cgram(slot), lcd_cgram[slot], 8) == 0, "%s: CGRAM slot %d differs", what, slot);
+    }
+}
+
+static void make_glyph(uint8_t bitmap[8], int seed) {
+    for (int i = 0; i < 8; i++) bitmap[i] = (uint8_t)((seed * 7 + i * 3 + 1) & 0x1F);
+}
+
+static void report(const char *what, mock_i2c_stats_t stats, uint64_t us) {
+    printf("%-20s %4u transactions %4u bytes %6u us\n", what, (unsigned)stats.transactions,
+           (unsigned)stats.bytes, (unsigned)us);
+}
+
+// Рядок через тінь: одна транзакція з адресою і 16 символами по 6 байтів
+static void row_redraw(void) {
+    lcd_setCursor(0, 0);
+    lcd_print(ROW_TEXT);
+    mock_i2c_reset_stats();
+    bus_us = 0;
+    uint32_t start_us = time_us_32();
+    lcd_flush();
+    settle();
+    mock_i2c_stats_t stats = mock_i2c_stats();
+    report("row, DMA", stats, bus_us);
+    CHECK(stats.transactions == 1 && stats.bytes == 17 * LCD_TX_BYTES_PER_CHAR,
+          "row redraw: %u transactions, %u bytes", (unsigned)stats.transactions, (unsigned)stats.bytes);
+    // Кінець передавання — останній STOP, а не повернення з lcd_flush()
+    uint32_t idle_us = lcd_idle_time_us() - start_us;
+    CHECK(idle_us >= stats.bytes * mock_i2c_byte_us() && idle_us <= time_us_32() - start_us,
+          "row redraw: idle %u us after the flush, %u bytes on the bus", (unsigned)idle_us, (unsigned)stats.bytes);
+    check_row(0, ROW_TEXT, "row redraw");
+}
+
+// NACK на останньому байті великої транзакції, поки за нею чекає мала: малу не
+// можна ставити в FIFO, доки не відомо, чи велика дійшла, інакше контролер
+// відкине обидві, а тінь вважатиме малу переданою
+static void abort_at_end(void) {
+    uint32_t errors = lcd_i2c_errors;
+    lcd_setCursor(0, 0);
+    lcd_print("abort at the end");
+    mock_i2c_reset_stats();
+    mock_i2c_abort_after(17 * LCD_TX_BYTES_PER_CHAR - 1);
+    lcd_flush();
+    mock_advance_us(40 * mock_i2c_byte_us());
+    lcd_setCursor(1, 3);
+    lcd_write('#');
+    lcd_flush();
+    settle();
+    mock_i2c_stats_t stats = mock_i2c_stats();
+    CHECK(stats.aborts == 1 && lcd_i2c_errors == errors + 1, "abort at the end: %u aborts, %u errors",
+          (unsigned)stats.aborts, (unsigned)(lcd_i2c_errors - errors));
+    CHECK(stats.discarded == 0, "abort at the end: %u words of the next transaction discarded",
+          (unsigned)stats.discarded);
+    CHECK(lcd_flush() == 0, "abort at the end: updates left");
+    check_panel("abort at the end");
+}
+
+// 8 символів поспіль: одна транзакція з адресою CGRAM і 64 рядками бітмапів
+static void cgram_upload(void) {
+    uint8_t bitmap[8];
+    for (int slot = 0; slot < LCD_CGRAM_SLOTS; slot++) {
+        make_glyph(bitmap, slot);
+        lcd_createChar((uint8_t)slot, bitmap);
+    }
+    mock_i2c_reset_stats();
+    bus_us = 0;
+    lcd_flush();
+    settle();
+    mock_i2c_stats_t stats = mock_i2c_stats();
+    report("8 glyphs, DMA", stats, bus_us);
+    CHECK(stats.transactions == 1 && stats.bytes == 65 * LCD_TX_BYTES_PER_CHAR,
+          "CGRAM upload: %u transactions, %u bytes", (unsigned)stats.transactions, (unsigned)stats.bytes);
+    check_panel("CGRAM upload");
+}
+
+// NACK посеред завантаження CGRAM: DMA ще пише решту транзакції
+static void abort_mid_cgram(void) {
+    uint8_t bitmap[8];
+    uint32_t errors = lcd_i2c_errors;
+    for (int slot = 0; slot < LCD_CGRAM_SLOTS; slot++) {
+        make_glyph(bitmap, slot + 50);
+        lcd_createChar((uint8_t)slot, bitmap);
+    }
+    mock_i2c_reset_stats();
+    mock_i2c_abort_after(100);
+    lcd_flush();
+    settle();
+    mock_i2c_stats_t stats = mock_i2c_stats();
+    CHECK(stats.aborts == 1 && lcd_i2c_errors == errors + 1, "abort mid CGRAM: %u aborts, %u errors",
+          (unsigned)stats.aborts, (unsigned)(lcd_i2c_errors - errors));
+    check_panel("abort mid CGRAM");
+}
+
+// Найбільша черга і замінені оновлення, коли нові записи приходять під час передачі
+static void queue_counters(void) {
+    uint8_t bitmap[8];
+    lcd_queue_high_water = 0;
+    lcd_updates_superseded = 0;
+
+    lcd_setCursor(0, 0);
+    lcd_print("ABCDEFGHIJKLMNOP");
+    CHECK(lcd_flush() == 16, "16 cells should be pending");
+    mock_advance_us(10 * mock_i2c_byte_us()); // Рядок 0 уже на шині
+
+    lcd_setCursor(1, 0);
+    lcd_print("vwxyz");
+    lcd_setCursor(1, 1);
+    lcd_write('W'); // Замінює 'w', що ще не відправлено
+    lcd_setCursor(1, 1);
+    lcd_write('W'); // Те саме значення нічого не замінює
+    lcd_setCursor(0, 2);
+    lcd_write('c'); // 'C' уже в транзакції: це нове оновлення
+    make_glyph(bitmap, 60);
+    lcd_createChar(0, bitmap);
+    make_glyph(bitmap, 61);
+    lcd_createChar(0, bitmap); // Замінює символ, що ще не завантажено
+    int pending = lcd_flush();
+    CHECK(pending == 7, "%d updates pending behind the busy bus, expected 7", pending);
+    settle();
+    lcd_flush();
+    settle();
+
+    CHECK(lcd_queue_high_water == 16, "high water %u, expected 16", (unsigned)lcd_queue_high_water);
+    CHECK(lcd_updates_superseded == 2, "%u superseded updates, expected 2", (unsigned)lcd_updates_superseded);
+    CHECK(lcd_flush() == 0, "queue counters: updates left");
+    check_panel("queue counters");
+}
+
+// 9 різних символів у 9 клітинках: для дев'ятого немає слота, який не показує
+// інша клітинка, тож він лишається порожнім, а перші 8 не змінюються
+static void glyph_overflow(void) {
+    uint8_t bitmap[8];
+    uint8_t codes[9];
+    lcd_clear();
+    for (int col = 0; col < 9; col++) {
+        make_glyph(bitmap, 70 + col);
+        lcd_setCursor(1, (uint8_t)col);
+        lcd_write_glyph(bitmap);
+        codes[col] = lcd_fb[1][col];
+    }
+    CHECK(codes[8] == ' ', "9th distinct glyph shows 0x%02x, expected a blank", codes[8]);
+    lcd_flush();
+    settle();
+    for (int col = 0; col < 8; col++) {
+        make_glyph(bitmap, 70 + col);
+        CHECK(codes[col] < LCD_CGRAM_SLOTS && memcmp(mock_lcd_cgram(codes[col]), bitmap, 8) == 0,
+              "glyph overflow: cell %d lost its glyph", col);
+    }
+    check_panel("glyph overflow");
+}
+
+// Випадкові записи клітинок і символів, у тому числі поки передача триває,
+// і зрідка NACK на випадковому байті
+static void random_updates(void) {
+    uint8_t bitmap[8];
+    uint32_t errors = lcd_i2c_errors;
+    test_seed(1);
+    mock_i2c_reset_stats();
+    for (int round = 0; round < 2000; round++) {
+        if (test_random() % 50 == 0) mock_i2c_abort_after((uint32_t)(test_random() % 200));
+        int writes = test_random() % 6;
+        for (int i = 0; i < writes; i++) {
+            lcd_setCursor((uint8_t)(test_random() % LCD_ROWS), (uint8_t)(test_random() % LCD_COLS));
+            if (test_random() % 4 == 0) {
+                make_glyph(bitmap, test_random() % 40);
+                lcd_write_glyph(bitmap);
+            } else {
+                lcd_write((char)('a' + test_random() % 26));
+            }
+        }
+        lcd_flush();
+        mock_advance_us((uint64_t)(test_random() % 40) * mock_i2c_byte_us());
+    }
+    mock_i2c_abort_after(UINT32_MAX); // Не спрацює
+    settle();
+    lcd_flush();
+    settle();
+    CHECK(lcd_i2c_errors - errors == mock_i2c_stats().aborts && mock_i2c_stats().aborts > 0,
+          "random updates: %u errors, %u aborts", (unsigned)(lcd_i2c_errors - errors),
+          (unsigned)mock_i2c_stats().aborts);
+    check_panel("random updates");
+}
+
+// Старий драйвер: кожен запис PCF8574 — окрема транзакція i2c_write_blocking()
+static void old_driver(void) {
+    uint8_t bitmap[8];
+    mock_i2c_reset_stats();
+    uint64_t start = time_us_64();
+    lcd_send_byte(LCD_SETDDRAMADDR, LCD_COMMAND, 1);
+    for (int col = 0; col < LCD_COLS; col++) lcd_send_byte("fedcba9876543210"[col], LCD_CHARACTER, 1);
+    mock_i2c_stats_t stats = mock_i2c_stats();
+    report("row, per nibble", stats, time_us_64() - start);
+    CHECK(stats.transactions == 17 * LCD_TX_BYTES_PER_CHAR && stats.bytes == 17 * LCD_TX_BYTES_PER_CHAR,
+          "old row redraw: %u transactions, %u bytes", (unsigned)stats.transactions, (unsigned)stats.bytes);
+    check_row(0, "fedcba9876543210", "old row redraw");
+
+    mock_i2c_reset_stats();
+    start = time_us_64();
+    for (int slot = 0; slot < LCD_CGRAM_SLOTS; slot++) {
+        make_glyph(bitmap, slot + 100);
+        lcd_send_byte(LCD_SETCGRAMADDR | (slot << 3), LCD_COMMAND, 1);
+        for (int i = 0; i < 8; i++) lcd_send_byte(bitmap[i], LCD_CHARACTER, 1);
+        CHECK(memcmp(mock_lcd_cgram(slot), bitmap, 8) == 0, "old CGRAM upload: slot %d differs", slot);
+    }
+    stats = mock_i2c_stats();
+    report("8 glyphs, per nibble", stats, time_us_64() - start);
+    CHECK(stats.transactions == 72 * LCD_TX_BYTES_PER_CHAR && stats.bytes == 72 * LCD_TX_BYTES_PER_CHAR,
+          "old CGRAM upload: %u transactions, %u bytes", (unsigned)stats.transactions, (unsigned)stats.bytes);
+}
+
+int main(void) {
+    lcd_init(4, 5);
+    check_row(0, "                ", "init");
+    check_row(1, "                ", "init");
+
+    row_redraw();
+    abort_at_end();
+    cgram_upload();
+    abort_mid_cgram();
+    queue_counters();
+    glyph_overflow();
+    random_updates();
+    old_driver(); // Пише в панель мимо тіні, тому останнім
+    lcd_print_stats();
+    return test_report("lcd");
+}
@@ -0,0 +1,201 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "test.h"
+#include "meter.h"
+
+/*
+ * Вимірювач рівня (meter.c) на еталонних синусах: рівень у dBFS для
+ * різних амплітуд і зміщень, пік, A-зважування на 100 Гц, 1 кГц і 4 кГц
+ * проти таблиці IEC 61672 (-19.1, 0 і +1.0 дБ), наростання FAST і SLOW
+ * після вмикання тону, утримання піку і тиша. Друкується також час
+ * обробки зразка без зважування і з A-зважуванням.
+ */
+
+#define SAMPLE_RATE 16000
+#define SETTLE_SAMPLES (SAMPLE_RATE / 2)  // Перехідний процес фільтрів перед вимірюванням
+#define MEASURE_SAMPLES SAMPLE_RATE
+#define TIME_MIN_US 20000
+
+static uint16_t samples[4 * SAMPLE_RATE];
+
+// Синус із заданим рівнем: 0 dBFS — амплітуда 2048 кодів
+static void make_sine(uint16_t *out, int count, double frequency, double level_db, double bias) {
+    double amplitude = 2048.0 * pow(10.0, level_db / 20.0);
+    for (int i = 0; i < count; i++) out[i] = test_clamp_adc(bias + amplitude * sin(2.0 * M_PI * frequency * i / SAMPLE_RATE));
+}
+
+// Рівень синуса після перехідного процесу, десяті дБ
+static meter_reading_t measure(meter_t *meter, double frequency, double level_db, double bias) {
+    meter_reset(meter, (uint16_t)lround(bias));
+    make_sine(samples, SETTLE_SAMPLES + MEASURE_SAMPLES, frequency, level_db, bias);
+    meter_reading_t reading;
+    meter_feed(meter, samples, SETTLE_SAMPLES);
+    meter_end_slice(meter, &reading);
+    meter_feed(meter, samples + SETTLE_SAMPLES, MEASURE_SAMPLES);
+    meter_end_slice(meter, &reading);
+    return reading;
+}
+
+static void check_levels(void) {
+    static const double levels[] = { -0.1, -6, -10, -20, -40 };
+    static const double tolerances[] = { 0.1, 0.1, 0.1, 0.2, 0.5 };
+    meter_t meter;
+    meter_init(&meter, SAMPLE_RATE, METER_Z_WEIGHTING);
+    for (int i = 0; i < (int)(sizeof(levels) / sizeof(levels[0])); i++) {
+        meter_reading_t reading = measure(&meter, 1000, levels[i], 2048);
+        printf("Z 1 kHz %.1f dBFS: rms %.1f, peak %.1f\n", levels[i], reading.rms_db10 / 10.0,
+               reading.peak_db10 / 10.0);
+        CHECK(fabs(reading.rms_db10 / 10.0 - levels[i]) <= tolerances[i], "%.1f dBFS sine measured %.1f",
+              levels[i], reading.rms_db10 / 10.0);
+        CHECK(fabs(reading.peak_db10 / 10.0 - levels[i]) <= tolerances[i] + 0.1, "%.1f dBFS sine peak %.1f",
+              levels[i], reading.peak_db10 / 10.0);
+        // SLOW за 1.5 с ще не дійшов: очікуване — з наростання від нуля після meter_reset
+        double slow = levels[i] + 10.0 * log10(1.0 - exp(-(double)(SETTLE_SAMPLES + MEASURE_SAMPLES) /
+                                                          (1 << meter.slow_shift)));
+        CHECK(abs(reading.fast_db10 - reading.rms_db10) <= 2 && fabs(reading.slow_db10 / 10.0 - slow) <= 0.2,
+              "%.1f dBFS: fast %.1f, slow %.1f (expected %.1f), rms %.1f", levels[i], reading.fast_db10 / 10.0,
+              reading.slow_db10 / 10.0, slow, reading.rms_db10 / 10.0);
+    }
+
+    // Інше зміщення і частота: постійна складова знімається, рівень той самий
+    meter_reading_t low = measure(&meter, 100, -20, 1500);
+    meter_reading_t high = measure(&meter, 5000, -20, 2600);
+    CHECK(abs(low.rms_db10 + 200) <= 2 && abs(high.rms_db10 + 200) <= 2,
+          "Z -20 dBFS: %d at 100 Hz on bias 1500, %d at 5 kHz on bias 2600", low.rms_db10, high.rms_db10);
+    // Неправильний початковий рівень тиші псує лише перехідний процес
+    meter_reset(&meter, 1000);
+    make_sine(samples, SETTLE_SAMPLES + MEASURE_SAMPLES, 1000, -20, 2048);
+    meter_reading_t reading;
+    meter_feed(&meter, samples, SETTLE_SAMPLES + MEASURE_SAMPLES / 2);
+    meter_end_slice(&meter, &reading);
+    meter_feed(&meter, samples + SETTLE_SAMPLES + MEASURE_SAMPLES / 2, MEASURE_SAMPLES / 2);
+    meter_end_slice(&meter, &reading);
+    CHECK(abs(reading.rms_db10 + 200) <= 2, "Z -20 dBFS after a wrong DC start: %d", reading.rms_db10);
+}
+
+/*
+ * A-зважування проти таблиці IEC 61672-1 з допусками класу 1: на 100 Гц
+ * -19.1 дБ (±1.0), на 1 кГц 0 (±0.1 — точніше за клас 1, бо посилення
+ * нормується саме там), на 4 кГц +1.0 (±1.0). На 16 кГц полюс 12.2 кГц
+ * лежить за Найквістом, і білінійне перетворення дає на 4 кГц близько
+ * +0.5 дБ — у межах класу 1.
+ */
+static void check_a_weighting(void) {
+    static const double frequencies[] = { 100, 1000, 4000 };
+    static const double expected[] = { -19.1, 0.0, 1.0 };
+    static const double tolerances[] = { 1.0, 0.1, 1.0 };
+    meter_t meter;
+    meter_init(&meter, SAMPLE_RATE, METER_A_WEIGHTING);
+    CHECK(meter.weighting == METER_A_WEIGHTING, "A-weighting off at %d Hz", SAMPLE_RATE);
+    for (int i = 0; i < 3; i++) {
+        meter_reading_t reading = measure(&meter, frequencies[i], -20, 2048);
+        double gain = reading.rms_db10 / 10.0 + 20;
+        printf("A %g Hz: %+.1f dB (IEC %+.1f)\n", frequencies[i], gain, expected[i]);
+        CHECK(fabs(gain - expected[i]) <= tolerances[i], "A-weighting at %g Hz: %+.1f dB, expected %+.1f",
+              frequencies[i], gain, expected[i]);
+    }
+    CHECK(strcmp(meter_weighting_name(meter.weighting), "A") == 0, "weighting name %s",
+          meter_weighting_name(meter.weighting));
+
+    // Нижче METER_A_WEIGHTING_MIN_HZ зважування вимикається
+    meter_init(&meter, METER_A_WEIGHTING_MIN_HZ / 2, METER_A_WEIGHTING);
+    CHECK(meter.weighting == METER_Z_WEIGHTING, "A-weighting kept at %d Hz", METER_A_WEIGHTING_MIN_HZ / 2);
+}
+
+// Рівень n-го зразка після вмикання тону: 1 - e^(-n / τ) від сталого
+static double rise_db(int samples_on, int shift) {
+    return 10.0 * log10(1.0 - exp(-(double)samples_on / (1 << shift)));
+}
+
+/*
+ * Тон -20 dBFS вмикається після тиші: через 125 мс FAST на 2 дБ нижче
+ * сталого рівня, SLOW — на 9 дБ; після двох секунд обидва на місці.
+ * Сталі часу округлюються до степеня двійки, тож очікуване рахується з
+ * фактичних.
+ */
+static void check_time_constants(void) {
+    meter_t meter;
+    meter_init(&meter, SAMPLE_RATE, METER_Z_WEIGHTING);
+    meter_reset(&meter, 2048);
+    int slice = SAMPLE_RATE * METER_FAST_MS / 1000;
+    for (int i = 0; i < SAMPLE_RATE; i++) samples[i] = 2048;
+    make_sine(samples + SAMPLE_RATE, 3 * SAMPLE_RATE, 1000, -20, 2048);
+    meter_reading_t reading;
+    meter_feed(&meter, samples, SAMPLE_RATE);
+    meter_end_slice(&meter, &reading);
+    CHECK(reading.rms_db10 == METER_SILENCE_DB10 && reading.peak_db10 == METER_SILENCE_DB10,
+          "silence measured %d, peak %d", reading.rms_db10, reading.peak_db10);
+
+    meter_feed(&meter, samples + SAMPLE_RATE, slice);
+    meter_end_slice(&meter, &reading);
+    double fast = -20 + rise_db(slice, meter.fast_shift), slow = -20 + rise_db(slice, meter.slow_shift);
+    printf("after %d ms: fast %.1f (expected %.1f), slow %.1f (expected %.1f)\n", METER_FAST_MS,
+           reading.fast_db10 / 10.0, fast, reading.slow_db10 / 10.0, slow);
+    CHECK(fabs(reading.fast_db10 / 10.0 - fast) <= 0.3, "fast after %d ms: %.1f, expected %.1f", METER_FAST_MS,
+          reading.fast_db10 / 10.0, fast);
+    CHECK(fabs(reading.slow_db10 / 10.0 - slow) <= 0.3, "slow after %d ms: %.1f, expected %.1f", METER_FAST_MS,
+          reading.slow_db10 / 10.0, slow);
+
+    meter_feed(&meter, samples + SAMPLE_RATE + slice, 2 * SAMPLE_RATE);
+    meter_end_slice(&meter, &reading);
+    slow = -20 + rise_db(slice + 2 * SAMPLE_RATE, meter.slow_shift);
+    CHECK(abs(reading.fast_db10 + 200) <= 2 && fabs(reading.slow_db10 / 10.0 - slow) <= 0.3,
+          "after 2 s: fast %d, slow %d (expected %.1f)", reading.fast_db10, reading.slow_db10, slow);
+    // Leq за весь запис: 1 с тиші і 2.125 с тону
+    double leq = -20 + 10.0 * log10((slice + 2.0 * SAMPLE_RATE) / (SAMPLE_RATE + slice + 2.0 * SAMPLE_RATE));
+    CHECK(fabs(meter_leq_db10(&meter) / 10.0 - leq) <= 0.2, "Leq %.1f, expected %.1f",
+          meter_leq_db10(&meter) / 10.0, leq);
+}
+
+// Утримання піку: короткий гучний сплеск лишається в meter_hold_db10, поки не meter_reset
+static void check_peak_hold(void) {
+    meter_t meter;
+    meter_init(&meter, SAMPLE_RATE, METER_Z_WEIGHTING);
+    meter_reset(&meter, 2048);
+    int slice = SAMPLE_RATE / 10;
+    make_sine(samples, SAMPLE_RATE, 1000, -30, 2048);
+    make_sine(samples + SAMPLE_RATE, SAMPLE_RATE / 2, 1000, -6, 2048); // 0.5 с: FAST майже доходить
+    make_sine(samples + SAMPLE_RATE * 3 / 2, SAMPLE_RATE * 5 / 2, 1000, -30, 2048);
+    int16_t burst_fast = METER_SILENCE_DB10, last_fast = 0;
+    for (int i = 0; i < 4 * SAMPLE_RATE; i += slice) {
+        meter_reading_t reading;
+        meter_feed(&meter, samples + i, slice);
+        meter_end_slice(&meter, &reading);
+        if (reading.fast_db10 > burst_fast) burst_fast = reading.fast_db10;
+        last_fast = reading.fast_db10;
+    }
+    int16_t hold = meter_hold_db10(&meter);
+    printf("peak hold: %.1f after the burst, fast now %.1f\n", hold / 10.0, last_fast / 10.0);
+    CHECK(hold == burst_fast && abs(hold + 60) <= 3, "hold %d, loudest fast %d", hold, burst_fast);
+    CHECK(abs(last_fast + 300) <= 2, "fast %d after the burst", last_fast);
+    meter_reset(&meter, 2048);
+    CHECK(meter_hold_db10(&meter) == METER_SILENCE_DB10, "hold %d after reset", meter_hold_db10(&meter));
+}
+
+static void time_feed(meter_weighting_t weighting) {
+    meter_t meter;
+    meter_init(&meter, SAMPLE_RATE, weighting);
+    meter_reset(&meter, 2048);
+    make_sine(samples, 4 * SAMPLE_RATE, 1000, -20, 2048);
+    uint64_t elapsed_us = 0;
+    uint32_t passes = 0;
+    while (elapsed_us < TIME_MIN_US) {
+        uint64_t start = time_us_64();
+        meter_feed(&meter, samples, 4 * SAMPLE_RATE);
+        elapsed_us += time_us_64() - start;
+        passes++;
+    }
+    printf("meter_feed %s: %.2f ns per sample\n", meter_weighting_name(meter.weighting),
+           elapsed_us * 1000.0 / ((double)passes * 4 * SAMPLE_RATE));
+}
+
+int main(void) {
+    check_levels();
+    check_a_weighting();
+    check_time_constants();
+    check_peak_hold();
+    time_feed(METER_Z_WEIGHTING);
+    time_feed(METER_A_WEIGHTING);
+    return test_report("meter");
+}
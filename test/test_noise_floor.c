@@ -0,0 +1,143 @@
+#include <math.h>
+#include <stdlib.h>
+#include "test.h"
+#include "noise_floor.h"
+
+/*
+ * Оцінювач рівня тиші (noise_floor.c) на синтетичних записах, зміщення
+ * яких пливе: повільний дрейф зі сплесками тону, стрибок зміщення і шум,
+ * що посилюється. Рівень має йти за справжнім зміщенням, відхилення — за
+ * розмахом шуму, а сплески не повинні піднімати поріг шуму. Друкується
+ * також час оновлення на зразок.
+ */
+
+#define TIME_CONSTANT 1000 // Як у прошивці: 1 с на 1 кГц, округлюється до 512 зразків
+#define SAMPLE_COUNT 200000
+#define TIME_MIN_US 20000
+
+static uint16_t samples[SAMPLE_COUNT];
+static double bias[SAMPLE_COUNT];
+
+// Рівномірний шум ±amplitude: середнє відхилення від зміщення amplitude / 2
+static double noise(int amplitude) {
+    return (double)(test_random() % (2 * amplitude + 1)) - amplitude;
+}
+
+static bool in_burst(int i) {
+    return i % 4000 < 300;
+}
+
+// Зміщення пливе з 2000 до 2150 кодів, шум ±20, кожні 4 с — сплеск тону 0.3 с
+static void make_drift(void) {
+    for (int i = 0; i < SAMPLE_COUNT; i++) {
+        bias[i] = 2000 + 150.0 * i / SAMPLE_COUNT;
+        double value = bias[i] + noise(20);
+        if (in_burst(i)) value += 1200 * sin(2.0 * M_PI * i / 20.0);
+        samples[i] = test_clamp_adc(value);
+    }
+}
+
+static void check_drift(void) {
+    noise_floor_t floor;
+    noise_floor_init(&floor, 2080, 10, TIME_CONSTANT);
+    make_drift();
+
+    double max_error = 0;
+    int min_deviation = 4095, max_deviation = 0, gated_noise = 0, gate_checks = 0;
+    int burst_deviation = 0; // Найбільше відхилення одразу після сплеску
+    for (int i = 0; i < SAMPLE_COUNT; i++) {
+        noise_floor_feed(&floor, samples + i, 1);
+        if (i % 4000 == 300 && noise_floor_deviation(&floor) > burst_deviation) {
+            burst_deviation = noise_floor_deviation(&floor);
+        }
+        // Після сплеску оцінка ще кілька сталих часу повертається на місце
+        if (i < 5000 || i % 4000 < 300 + 4 * 512) continue;
+        double error = fabs(noise_floor_level(&floor) - bias[i]);
+        if (error > max_error) max_error = error;
+        int deviation = noise_floor_deviation(&floor);
+        if (deviation < min_deviation) min_deviation = deviation;
+        if (deviation > max_deviation) max_deviation = deviation;
+        gate_checks++;
+        if (samples[i] >= noise_floor_gate(&floor, 0)) gated_noise++;
+    }
+    printf("drift: max level error %.1f, deviation %d..%d (%d after a burst), "
+           "%d of %d noise samples above the gate\n",
+           max_error, min_deviation, max_deviation, burst_deviation, gated_noise, gate_checks);
+    CHECK(max_error <= 3, "drift: level is %.1f codes off the bias", max_error);
+    CHECK(min_deviation >= 7 && max_deviation <= 14, "drift: deviation %d..%d, expected about 10",
+          min_deviation, max_deviation);
+    CHECK(burst_deviation <= 20, "drift: a burst raised the deviation to %d", burst_deviation);
+    CHECK(gated_noise == 0, "drift: %d noise samples above the gate", gated_noise);
+}
+
+// Стрибок зміщення на 100 кодів: усі зразки поза вікном, але рівень однаково
+// має дійти до нового зміщення за кілька сталих часу
+static void check_step(void) {
+    noise_floor_t floor;
+    noise_floor_init(&floor, 2080, 10, TIME_CONSTANT);
+    for (int i = 0; i < 10000; i++) samples[i] = test_clamp_adc((i < 5000 ? 2080 : 2180) + noise(20));
+    noise_floor_feed(&floor, samples, 5000);
+    int settled = -1;
+    for (int i = 5000; i < 10000; i++) {
+        noise_floor_feed(&floor, samples + i, 1);
+        if (settled < 0 && abs(noise_floor_level(&floor) - 2180) <= 2) settled = i - 5000;
+    }
+    printf("step: level within 2 codes after %d samples, deviation %d\n", settled,
+           noise_floor_deviation(&floor));
+    CHECK(settled >= 0 && settled <= 6 * 512, "step: level settled after %d samples", settled);
+    CHECK(abs(noise_floor_level(&floor) - 2180) <= 1, "step: level %u", noise_floor_level(&floor));
+    CHECK(noise_floor_deviation(&floor) <= 14, "step: deviation %u after the step",
+          noise_floor_deviation(&floor));
+}
+
+// Шум посилюється вчетверо: відхилення росте повільно, але доходить до нового
+static void check_louder_noise(void) {
+    noise_floor_t floor;
+    noise_floor_init(&floor, 2080, 10, TIME_CONSTANT);
+    for (int i = 0; i < SAMPLE_COUNT; i++) samples[i] = test_clamp_adc(2080 + noise(i < 5000 ? 20 : 80));
+    noise_floor_feed(&floor, samples, 5000);
+    int before = noise_floor_deviation(&floor);
+    noise_floor_feed(&floor, samples + 5000, SAMPLE_COUNT - 5000);
+    int after = noise_floor_deviation(&floor);
+    printf("louder noise: deviation %d -> %d, level %u\n", before, after, noise_floor_level(&floor));
+    CHECK(before >= 8 && before <= 12, "louder noise: deviation %d before", before);
+    CHECK(after >= 34 && after <= 46, "louder noise: deviation %d, expected about 40", after);
+    CHECK(abs(noise_floor_level(&floor) - 2080) <= 3, "louder noise: level %u", noise_floor_level(&floor));
+}
+
+// Інша частота запису: стала часу змінюється, накопичена оцінка лишається
+static void check_time_constant(void) {
+    noise_floor_t floor;
+    noise_floor_init(&floor, 2080, 10, TIME_CONSTANT);
+    CHECK(floor.shift == 9, "time constant %d rounds to 2^%d", TIME_CONSTANT, floor.shift);
+    noise_floor_set_time_constant(&floor, 16000);
+    CHECK(floor.shift == 13, "time constant 16000 rounds to 2^%d", floor.shift);
+    CHECK(noise_floor_level(&floor) == 2080 && noise_floor_deviation(&floor) == 10,
+          "time constant change moved the estimate");
+    noise_floor_set_time_constant(&floor, 1);
+    CHECK(floor.shift == 1, "time constant 1 rounds to 2^%d", floor.shift);
+}
+
+static void time_feed(void) {
+    noise_floor_t floor;
+    noise_floor_init(&floor, 2080, 10, TIME_CONSTANT);
+    make_drift();
+    uint64_t elapsed_us = 0;
+    uint32_t passes = 0;
+    while (elapsed_us < TIME_MIN_US) {
+        uint64_t start = time_us_64();
+        noise_floor_feed(&floor, samples, SAMPLE_COUNT);
+        elapsed_us += time_us_64() - start;
+        passes++;
+    }
+    printf("noise_floor_feed: %.2f ns per sample\n", elapsed_us * 1000.0 / ((double)passes * SAMPLE_COUNT));
+}
+
+int main(void) {
+    check_drift();
+    check_step();
+    check_louder_noise();
+    check_time_constant();
+    time_feed();
+    return test_report("noise_floor");
+}
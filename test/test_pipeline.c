@@ -0,0 +1,169 @@
+#include <math.h>
+#include <pthread.h>
+#include <string.h>
+#include "test.h"
+#include "pipeline.h"
+#include "peaks.h"
+
+/*
+ * Конвеєр аналізу з потоком-виконавцем, як у потоковому режимі прошивки:
+ * основний потік подає блоки довгого сигналу, виконавець веде один
+ * детектор піків через усі блоки (peaks_continue/peaks_skip/peaks_feed)
+ * і повертає події блоку в payload. Результати мають приходити в порядку
+ * подання з іншого потоку, а події всіх блоків разом — збігатися з
+ * peaks_detect() над кожним безперервним відрізком сигналу, зокрема там,
+ * де блоки пропущено через переповнення.
+ */
+
+#define BLOCK_SIZE 500
+#define BLOCK_COUNT 400
+#define SAMPLE_COUNT (BLOCK_SIZE * BLOCK_COUNT)
+#define BLOCK_MAX_PEAKS 4
+#define MAX_EVENTS 2000
+
+enum { JOB_BLOCK, JOB_END };
+
+// Вміст payload: first задає основний потік, решту — виконавець
+typedef struct block_result {
+    int first;
+    int peak_count;
+    peak_event_t peaks[BLOCK_MAX_PEAKS];
+} block_result_t;
+
+_Static_assert(sizeof(block_result_t) <= PIPELINE_PAYLOAD_BYTES, "block result must fit the payload");
+
+static const peak_config_t config = {
+    .enter = 2300, .exit = 2200, .baseline = 2080, .merge_gap = 30, .min_duration = 40,
+};
+
+static uint16_t samples[SAMPLE_COUNT];
+static peak_detector_t detector; // Належить виконавцю
+static pthread_t main_thread;
+static volatile int foreign_jobs;
+
+// Сплески тону через тишу: провали між півперіодами коротші за merge_gap,
+// а сплеск із паузою довші за 160 зразків, тож у блоці не більше 4 подій
+static void make_signal(void) {
+    int i = 0;
+    while (i < SAMPLE_COUNT) {
+        int silence = 100 + (int)(test_random() % 1500);
+        for (int j = 0; j < silence && i < SAMPLE_COUNT; j++, i++) {
+            samples[i] = (uint16_t)(2080 + test_random() % 31 - 15);
+        }
+        int burst = 60 + (int)(test_random() % 3000);
+        double amplitude = 400 + test_random() % 1500;
+        for (int j = 0; j < burst && i < SAMPLE_COUNT; j++, i++) {
+            double value = 2080 + amplitude * fabs(sin(M_PI * j / 20.0));
+            samples[i] = (uint16_t)(value > 4095 ? 4095 : value);
+        }
+    }
+}
+
+static void handle_job(pipeline_job_t *job) {
+    if (!pthread_equal(pthread_self(), main_thread)) foreign_jobs++;
+    block_result_t result;
+    memcpy(&result, job->payload, sizeof(result));
+    peaks_continue(&detector, &config, result.peaks, BLOCK_MAX_PEAKS);
+    if (job->type == JOB_END) {
+        result.peak_count = peaks_end(&detector);
+    } else {
+        peaks_skip(&detector, result.first);
+        peaks_feed(&detector, samples + job->start, job->end - job->start);
+        result.peak_count = detector.found;
+    }
+    job->result = job->slice;
+    memcpy(job->payload, &result, sizeof(result));
+}
+
+static bool skipped(int block) {
+    return block == 37 || block == 38 || block == 90 || block == 251;
+}
+
+// Очікувані події: peaks_detect() над кожним відрізком між пропущеними блоками
+static int reference_events(peak_event_t *events) {
+    int count = 0;
+    int first = 0;
+    for (int block = 0; block <= BLOCK_COUNT; block++) {
+        if (block < BLOCK_COUNT && !skipped(block)) continue;
+        int end = block * BLOCK_SIZE;
+        if (end > first) {
+            int found = peaks_detect(&config, samples + first, end - first, events + count,
+                                     MAX_EVENTS - count);
+            for (int j = count; j < count + found; j++) {
+                events[j].start += first;
+                events[j].end += first;
+            }
+            count += found;
+        }
+        first = end + BLOCK_SIZE;
+    }
+    return count;
+}
+
+static int submitted, taken;
+static peak_event_t events[MAX_EVENTS];
+static int event_count;
+
+static void take_results(void) {
+    pipeline_job_t job;
+    while (pipeline_take_result(&job)) {
+        block_result_t result;
+        memcpy(&result, job.payload, sizeof(result));
+        CHECK(job.slice == taken, "result %d came back as job %d", taken, job.slice);
+        CHECK(job.result == job.slice, "job %d: result %d", job.slice, job.result);
+        CHECK(job.type == JOB_END || result.first == job.start,
+              "job %d: payload first %d, start %d", job.slice, result.first, job.start);
+        CHECK(result.peak_count < BLOCK_MAX_PEAKS, "job %d: %d peaks may be truncated",
+              job.slice, result.peak_count);
+        for (int j = 0; j < result.peak_count && event_count < MAX_EVENTS; j++) {
+            events[event_count++] = result.peaks[j];
+        }
+        taken++;
+    }
+}
+
+static void submit(int type, int start) {
+    pipeline_job_t job = {
+        .type = (uint8_t)type,
+        .slice = submitted,
+        .start = start,
+        .end = start + BLOCK_SIZE,
+        .slice_length = BLOCK_SIZE,
+    };
+    const block_result_t input = { .first = start };
+    memcpy(job.payload, &input, sizeof(input));
+    while (!pipeline_submit(&job)) take_results();
+    submitted++;
+}
+
+int main(void) {
+    static const char *const stage_names[] = { "block", "end" };
+    static peak_event_t expected[MAX_EVENTS];
+
+    main_thread = pthread_self();
+    make_signal();
+    peaks_begin(&detector, &config, NULL, 0);
+    pipeline_init(handle_job, stage_names, 2);
+
+    for (int block = 0; block < BLOCK_COUNT; block++) {
+        if (!skipped(block)) submit(JOB_BLOCK, block * BLOCK_SIZE);
+    }
+    submit(JOB_END, SAMPLE_COUNT);
+    while (pipeline_busy()) take_results();
+
+    CHECK(taken == submitted, "%d of %d results taken", taken, submitted);
+    CHECK(foreign_jobs == submitted, "%d of %d jobs ran on the worker thread", foreign_jobs, submitted);
+
+    int expected_count = reference_events(expected);
+    printf("%d blocks, %d peaks\n", submitted - 1, expected_count);
+    CHECK(expected_count > 50, "only %d peaks in the signal", expected_count);
+    CHECK(event_count == expected_count, "%d peaks, expected %d", event_count, expected_count);
+    for (int j = 0; j < event_count && j < expected_count; j++) {
+        CHECK(events[j].start == expected[j].start && events[j].end == expected[j].end &&
+              events[j].max == expected[j].max && events[j].area == expected[j].area,
+              "peak %d: %d-%d max %u area %u, expected %d-%d max %u area %u", j,
+              events[j].start, events[j].end, events[j].max, (unsigned)events[j].area,
+              expected[j].start, expected[j].end, expected[j].max, (unsigned)expected[j].area);
+    }
+    return test_report("pipeline");
+}
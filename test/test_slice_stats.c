@@ -0,0 +1,127 @@
+#include <math.h>
+#include <stdlib.h>
+#include "test.h"
+#include "slice_stats.h"
+
+/*
+ * Онлайн-накопичувач слайсів (slice_stats.c) проти пакетного підрахунку,
+ * як у calculate_slice_averages(): однакові середні й максимуми для
+ * записів від одного зразка до мільйона, тобто і з укрупненням кошиків,
+ * при будь-якій нарізці шматків feed, неповному feed і різній довжині
+ * слайсу над тими самими кошиками.
+ */
+
+#define MAX_SAMPLES 1048576
+#define BUCKET_COUNT 400 // Як SLICE_BUCKET_COUNT прошивки: 4000 зразків по 10
+#define SLICE_COUNT 40
+#define STORE_BYTES ((size_t)MAX_SAMPLES * 2 + 64 * 1024) // Таблиця блоків і сирі 12 біт
+
+static slice_bucket_t buckets[BUCKET_COUNT];
+static uint16_t *samples;
+static void *store_memory;
+static sample_store_t store;
+
+static void make_signal(int kind, int count) {
+    for (int i = 0; i < count; i++) {
+        int32_t value;
+        switch (kind) {
+        case 0: // Шум навколо рівня тиші
+            value = 2080 + (int32_t)(test_random() % 401) - 200;
+            break;
+        case 1: // Тон із перевантаженням
+            value = 2080 + (int32_t)(3000.0 * sin(2.0 * M_PI * 110 * i / 1000));
+            break;
+        default: // Сплески через тишу
+            value = i % 500 < 200 ? 2080 + (int32_t)(1500.0 * sin(2.0 * M_PI * 50 * i / 1000))
+                                  : 2080 + (int32_t)(test_random() & 15);
+            break;
+        }
+        samples[i] = (uint16_t)(value < 0 ? 0 : value > 4095 ? 4095 : value);
+    }
+}
+
+// Пакетний підрахунок за зразками запису, як calculate_slice_stats()
+static void batch_slices(int effective_samples, int slice_length, uint16_t gate,
+                         uint32_t *averages, uint32_t *maximums) {
+    for (int i = 0; i < SLICE_COUNT; i++) {
+        int start = i * slice_length;
+        int end = (i + 1) * slice_length;
+        if (end > effective_samples) end = effective_samples;
+        uint32_t sum = 0, max = 0, count = 0;
+        sample_span_t span;
+        sample_span_store(&span, &store, start, end);
+        while (sample_span_next(&span)) {
+            for (int j = 0; j < span.count; j++) {
+                uint16_t value = span.samples[j];
+                if (value < gate) continue;
+                sum += value;
+                count++;
+                if (value > max) max = value;
+            }
+        }
+        averages[i] = count > 0 ? sum / count : 0;
+        maximums[i] = max;
+    }
+}
+
+// Подає перші fed зразків шматками: chunk > 0 — сталими, 0 — випадкової довжини
+static void feed_chunks(int fed, int chunk) {
+    for (int first = 0; first < fed;) {
+        int count = chunk > 0 ? chunk : 1 + (int)(test_random() % 300);
+        if (count > fed - first) count = fed - first;
+        slice_stats_feed(samples + first, count);
+        first += count;
+    }
+}
+
+static void check_case(int count, int kind, uint16_t gate, int chunk, int fed, bool delta) {
+    uint32_t online_averages[SLICE_COUNT], online_maximums[SLICE_COUNT];
+    uint32_t batch_averages[SLICE_COUNT], batch_maximums[SLICE_COUNT];
+
+    make_signal(kind, count);
+    sample_store_init(&store, store_memory, STORE_BYTES, MAX_SAMPLES, delta);
+    sample_store_append(&store, samples, count);
+    sample_store_finish(&store);
+
+    slice_stats_reset(gate);
+    feed_chunks(fed, chunk);
+
+    // Довжина слайсу прошивки, а потім інші над тими самими кошиками
+    int slice_lengths[] = { count / SLICE_COUNT > 0 ? count / SLICE_COUNT : 1, 1,
+                            count / SLICE_COUNT + 7, count / 13 + 1 };
+    for (unsigned s = 0; s < sizeof(slice_lengths) / sizeof(slice_lengths[0]); s++) {
+        int slice_length = slice_lengths[s];
+        slice_stats_compute(&store, count, slice_length, SLICE_COUNT, online_averages, online_maximums);
+        batch_slices(count, slice_length, gate, batch_averages, batch_maximums);
+        for (int i = 0; i < SLICE_COUNT; i++) {
+            CHECK(online_averages[i] == batch_averages[i] && online_maximums[i] == batch_maximums[i],
+                  "count %d signal %d gate %u chunk %d fed %d delta %d slice_length %d slice %d: "
+                  "online %u/%u, batch %u/%u", count, kind, gate, chunk, fed, delta, slice_length, i,
+                  online_averages[i], online_maximums[i], batch_averages[i], batch_maximums[i]);
+        }
+    }
+}
+
+int main(void) {
+    static const int counts[] = { 1, 39, 40, 4000, 4007, 8000, 65536, 100003, MAX_SAMPLES };
+    static const uint16_t gates[] = { 0, 2130, 4096 };
+
+    samples = malloc(MAX_SAMPLES * sizeof(uint16_t));
+    store_memory = malloc(STORE_BYTES);
+    if (!samples || !store_memory) return 1;
+    slice_stats_init(buckets, BUCKET_COUNT);
+
+    for (unsigned c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+        int count = counts[c];
+        for (int kind = 0; kind < 3; kind++) {
+            for (unsigned g = 0; g < sizeof(gates) / sizeof(gates[0]); g++) {
+                check_case(count, kind, gates[g], 100, count, kind == 2);
+                check_case(count, kind, gates[g], 0, count, kind != 2);
+            }
+            // Запис зупинено до того, як накопичувач отримав усі зразки
+            check_case(count, kind, 2130, 0, count / 2, false);
+            check_case(count, kind, 2130, 100, 0, true);
+        }
+    }
+    return test_report("slice_stats");
+}
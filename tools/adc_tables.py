@@ -0,0 +1,62 @@
+#!/usr/bin/env python3
+"""Генерує таблиці перетворення кодів АЦП для adc_scale.c.
+
+Константи беруться з snd_analizer.h (ADC_REF_MV, ADC_GRAPH_SPAN), тож
+таблиці завжди відповідають прошивці. Викликається збіркою CMake і
+пише заголовок у каталог збірки:
+
+    tools/adc_tables.py snd_analizer.h build/generated/adc_tables.h
+
+adc_height_table — висота стовпчика графіка (1, 2, ...) за відстанню
+значення від рівня тиші, з тим самим округленням, що й колишнє ділення
+в scale_adc_value(); adc_mv_table — код АЦП у мілівольтах з округленням
+до найближчого, як колишній вивід "%.3f" у вольтах.
+"""
+
+import argparse
+import re
+import sys
+
+ADC_CODES = 4096
+
+
+def read_define(header, name):
+    match = re.search(r"^#define\s+%s\s+([0-9()+\-*/ ]+?)\s*(//.*)?$" % name, header, re.M)
+    if not match:
+        sys.exit("%s: #define %s not found" % (sys.argv[1], name))
+    return int(eval(match.group(1), {"__builtins__": {}}))
+
+
+def c_array(ctype, name, values, per_line):
+    lines = ["static const %s %s[%d] = {" % (ctype, name, len(values))]
+    for start in range(0, len(values), per_line):
+        lines.append("    " + ", ".join(str(value) for value in values[start:start + per_line]) + ",")
+    lines.append("};")
+    return "\n".join(lines)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("header", help="snd_analizer.h")
+    parser.add_argument("output", help="adc_tables.h, що генерується")
+    args = parser.parse_args()
+
+    with open(args.header, encoding="utf-8") as file:
+        header = file.read()
+    ref_mv = read_define(header, "ADC_REF_MV")
+    graph_span = read_define(header, "ADC_GRAPH_SPAN")
+
+    heights = [min(255, (delta * 7 + graph_span // 2) // graph_span + 1) for delta in range(ADC_CODES)]
+    millivolts = [(code * ref_mv + ADC_CODES // 2) // ADC_CODES for code in range(ADC_CODES)]
+
+    with open(args.output, "w", encoding="utf-8") as file:
+        file.write("// adc_tables.h: згенеровано tools/adc_tables.py, не редагувати\n")
+        file.write("#ifndef ADC_TABLES_H\n#define ADC_TABLES_H\n\n")
+        file.write("#define ADC_TABLES_REF_MV %d\n#define ADC_TABLES_GRAPH_SPAN %d\n\n" % (ref_mv, graph_span))
+        file.write(c_array("uint8_t", "adc_height_table", heights, 32) + "\n\n")
+        file.write(c_array("uint16_t", "adc_mv_table", millivolts, 16) + "\n\n")
+        file.write("#endif // ADC_TABLES_H\n")
+
+
+if __name__ == "__main__":
+    main()
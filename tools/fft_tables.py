@@ -0,0 +1,59 @@
+#!/usr/bin/env python3
+"""Генерує таблицю чверті періоду синуса для fft.c.
+
+Розмір береться з fft.h (FFT_LOG2_SIZE), тож таблиця завжди відповідає
+прошивці. Викликається збіркою CMake і пише заголовок у каталог збірки:
+
+    tools/fft_tables.py fft.h build/generated/fft_tables.h
+
+fft_sine_table[i] = sin(2πi/FFT_SIZE) у Q15 для i = 0..FFT_SIZE/4,
+округлений до найближчого (1.0 обмежується до 32767). Раніше таблицю
+заповнював fft_init() через sinf — програмну плаваючу крапку на RP2040
+і 2 КБ RAM; тепер вона константна і лежить у флеші.
+"""
+
+import argparse
+import math
+import re
+import sys
+
+
+def read_define(header, name):
+    match = re.search(r"^#define\s+%s\s+([0-9()+\-*/ ]+?)\s*(//.*)?$" % name, header, re.M)
+    if not match:
+        sys.exit("%s: #define %s not found" % (sys.argv[1], name))
+    return int(eval(match.group(1), {"__builtins__": {}}))
+
+
+def c_array(ctype, name, values, per_line):
+    lines = ["static const %s %s[%d] = {" % (ctype, name, len(values))]
+    for start in range(0, len(values), per_line):
+        lines.append("    " + ", ".join(str(value) for value in values[start:start + per_line]) + ",")
+    lines.append("};")
+    return "\n".join(lines)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("header", help="fft.h")
+    parser.add_argument("output", help="fft_tables.h, що генерується")
+    args = parser.parse_args()
+
+    with open(args.header, encoding="utf-8") as file:
+        header = file.read()
+    log2_size = read_define(header, "FFT_LOG2_SIZE")
+    size = 1 << log2_size
+
+    sines = [min(32767, math.floor(32768.0 * math.sin(2.0 * math.pi * i / size) + 0.5))
+             for i in range(size // 4 + 1)]
+
+    with open(args.output, "w", encoding="utf-8") as file:
+        file.write("// fft_tables.h: згенеровано tools/fft_tables.py, не редагувати\n")
+        file.write("#ifndef FFT_TABLES_H\n#define FFT_TABLES_H\n\n")
+        file.write("#define FFT_TABLES_LOG2_SIZE %d\n\n" % log2_size)
+        file.write(c_array("int16_t", "fft_sine_table", sines, 16) + "\n\n")
+        file.write("#endif // FFT_TABLES_H\n")
+
+
+if __name__ == "__main__":
+    main()
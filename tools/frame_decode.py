@@ -0,0 +1,171 @@
+#!/usr/bin/env python3
+"""Декодер двійкового виводу snd_analizer (кадри frame.c).
+
+Читає сирий потік із USB (файл, пристрій /dev/ttyACM0 або stdin), ділить
+його на кадри за нульовими байтами, декодує COBS і перевіряє CRC-32.
+Текст printf між кадрами не проходить перевірку і рахується як сміття.
+Зразки пишуться у WAV (12 біт АЦП, центровані на 2048, розтягнуті до
+16 біт), інші повідомлення — текстом. Наприкінці друкуються підсумки:
+кадри, пошкоджені кадри, пропуски в номерах і запас каналу з FRAME_STATS.
+
+    stty -F /dev/ttyACM0 raw
+    cat /dev/ttyACM0 > capture.bin   # натиснути 'b', потім кнопку або 'S'
+    tools/frame_decode.py capture.bin --wav capture.wav --out capture.txt
+"""
+
+import argparse
+import struct
+import sys
+import wave
+import zlib
+
+FRAME_INFO, FRAME_SAMPLES, FRAME_SLICES, FRAME_PEAKS, FRAME_TRACE, FRAME_STATS = range(1, 7)
+
+
+def cobs_decode(data):
+    out = bytearray()
+    index = 0
+    while index < len(data):
+        code = data[index]
+        index += 1
+        if code == 0 or index + code - 1 > len(data):
+            return None
+        out += data[index:index + code - 1]
+        index += code - 1
+        if code < 0xFF and index < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def packets(stream, totals):
+    """Повертає (тип, номер, вміст) для кожного кадру з правильною CRC."""
+    pending = b""
+    while True:
+        chunk = stream.read(4096)
+        if not chunk:
+            break
+        parts = (pending + chunk).split(b"\0")
+        pending = parts.pop()
+        for part in parts:
+            if not part:
+                continue
+            packet = cobs_decode(part)
+            if packet is None or len(packet) < 7 or \
+                    zlib.crc32(packet[:-4]) != struct.unpack_from("<I", packet, len(packet) - 4)[0]:
+                totals["junk"] += len(part)
+                continue
+            yield packet[0], struct.unpack_from("<H", packet, 1)[0], packet[3:-4]
+    if pending:
+        totals["junk"] += len(pending)
+
+
+class Writer:
+    def __init__(self, wav_path, log):
+        self.wav_path = wav_path
+        self.wav = None
+        self.log = log
+        self.rate = None
+        self.next_sample = None
+        self.samples = 0
+        self.gaps = 0
+
+    def info(self, payload):
+        rate, decimation, block, version = struct.unpack_from("<IHHB", payload)
+        self.log.write("INFO rate=%d decimation=%d block=%d version=%d\n" % (rate, decimation, block, version))
+        if self.wav_path and self.wav is None:
+            self.wav = wave.open(self.wav_path, "wb")
+            self.wav.setnchannels(1)
+            self.wav.setsampwidth(2)
+            self.wav.setframerate(rate)
+        self.rate = rate
+        self.next_sample = 0
+
+    def samples_frame(self, payload):
+        first = struct.unpack_from("<I", payload)[0]
+        values = struct.unpack_from("<%dH" % ((len(payload) - 4) // 2), payload, 4)
+        if self.next_sample is not None and first != self.next_sample:
+            self.log.write("GAP samples %d..%d\n" % (self.next_sample, first))
+            self.gaps += 1
+            if first > self.next_sample and self.wav:
+                self.wav.writeframes(b"\0\0" * (first - self.next_sample))  # Тиша замість втрачених
+        self.next_sample = first + len(values)
+        self.samples += len(values)
+        if self.wav:
+            self.wav.writeframes(struct.pack("<%dh" % len(values),
+                                             *((value - 2048) * 16 for value in values)))
+
+    def close(self):
+        if self.wav:
+            self.wav.close()
+
+
+def describe(kind, payload, writer, totals):
+    log = writer.log
+    if kind == FRAME_INFO:
+        writer.info(payload)
+    elif kind == FRAME_SAMPLES:
+        writer.samples_frame(payload)
+    elif kind == FRAME_SLICES:
+        count, slice_length = struct.unpack_from("<HI", payload)
+        log.write("SLICES %d length=%d\n" % (count, slice_length))
+        for index in range(count):
+            average, maximum = struct.unpack_from("<II", payload, 6 + 8 * index)
+            log.write("  %2d avg=%d max=%d\n" % (index, average, maximum))
+    elif kind == FRAME_PEAKS:
+        count = struct.unpack_from("<H", payload)[0]
+        log.write("PEAKS %d\n" % count)
+        for index in range(count):
+            start, end, maximum, area = struct.unpack_from("<IIHI", payload, 2 + 14 * index)
+            log.write("  %d..%d max=%d area=%d\n" % (start, end, maximum, area))
+    elif kind == FRAME_TRACE:
+        count = struct.unpack_from("<H", payload)[0]
+        for index in range(count):
+            stage, core, start_us, duration_us = struct.unpack_from("<BBII", payload, 2 + 10 * index)
+            log.write("#TR %d %d %d %d\n" % (stage, core, start_us, duration_us))  # Як у trace_report.py
+    elif kind == FRAME_STATS:
+        frames, sent, busy_us, elapsed_us, dropped, overruns = struct.unpack_from("<6I", payload)
+        log.write("STATS frames=%d bytes=%d busy=%dus elapsed=%dus dropped=%d overruns=%d\n"
+                  % (frames, sent, busy_us, elapsed_us, dropped, overruns))
+        totals["stats"] = (busy_us, elapsed_us, dropped, overruns)
+    else:
+        log.write("UNKNOWN type=%d bytes=%d\n" % (kind, len(payload)))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("input", nargs="?", help="сирий вивід USB (типово stdin)")
+    parser.add_argument("--wav", help="куди записати зразки")
+    parser.add_argument("--out", help="куди записати інші повідомлення (типово stdout)")
+    args = parser.parse_args()
+
+    totals = {"frames": 0, "lost": 0, "junk": 0, "stats": None}
+    log = open(args.out, "w") if args.out else sys.stdout
+    writer = Writer(args.wav, log)
+    expected = None
+    with (open(args.input, "rb") if args.input else sys.stdin.buffer) as stream:
+        for kind, sequence, payload in packets(stream, totals):
+            if expected is not None and sequence != expected:
+                totals["lost"] += (sequence - expected) & 0xFFFF
+            expected = (sequence + 1) & 0xFFFF
+            totals["frames"] += 1
+            try:
+                describe(kind, payload, writer, totals)
+            except struct.error:
+                log.write("SHORT type=%d bytes=%d\n" % (kind, len(payload)))
+    writer.close()
+    if args.out:
+        log.close()
+
+    print("%d frames, %d lost, %d junk bytes, %d samples, %d sample gaps"
+          % (totals["frames"], totals["lost"], totals["junk"], writer.samples, writer.gaps),
+          file=sys.stderr)
+    if totals["stats"]:
+        busy_us, elapsed_us, dropped, overruns = totals["stats"]
+        headroom = 100.0 * (1 - busy_us / elapsed_us) if elapsed_us else 0.0
+        print("link busy %d of %d us, headroom %.1f%%, dropped %d, overruns %d"
+              % (busy_us, elapsed_us, headroom, dropped, overruns), file=sys.stderr)
+    return 0 if totals["frames"] else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,77 @@
+#!/usr/bin/env python3
+"""Звіт про затримки етапів із траси snd_analizer.
+
+Читає вивід терміналу (файл або stdin), у якому є дамп траси, надісланий
+командою 't' (рядки "#TS" і "#TR", див. trace.c), і друкує для кожного
+етапу кількість, мінімум, перцентилі, максимум і гістограму тривалостей.
+Інші рядки терміналу ігноруються, однакові записи з кількох дампів
+враховуються один раз.
+
+    minicom -C trace.log ...   # натиснути 't' у терміналі
+    tools/trace_report.py trace.log
+"""
+
+import argparse
+import sys
+
+
+def parse(lines):
+    names = {}
+    records = set()
+    for line in lines:
+        fields = line.split()
+        if not fields:
+            continue
+        if fields[0] == "#TS" and len(fields) == 3:
+            names[int(fields[1])] = fields[2]
+        elif fields[0] == "#TR" and len(fields) == 5:
+            stage, core, start_us, duration_us = (int(value) for value in fields[1:])
+            records.add((stage, core, start_us, duration_us))
+    return names, records
+
+
+def percentile(values, fraction):
+    index = min(len(values) - 1, int(round(fraction * (len(values) - 1))))
+    return values[index]
+
+
+def histogram(values, width=40):
+    buckets = {}
+    for value in values:
+        bucket = value.bit_length()  # Кошик k: від 2^(k-1) до 2^k мкс, як у trace.c
+        buckets[bucket] = buckets.get(bucket, 0) + 1
+    largest = max(buckets.values())
+    for bucket in sorted(buckets):
+        label = "<%d" % (1 << bucket)
+        bar = "#" * max(1, buckets[bucket] * width // largest)
+        print("    %8s us %6d %s" % (label, buckets[bucket], bar))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("log", nargs="?", help="вивід терміналу (типово stdin)")
+    parser.add_argument("--histogram", action="store_true", help="друкувати гістограми")
+    args = parser.parse_args()
+
+    with (open(args.log, errors="replace") if args.log else sys.stdin) as source:
+        names, records = parse(source)
+    if not records:
+        print("no trace records found", file=sys.stderr)
+        return 1
+
+    print("%-18s %4s %6s %8s %8s %8s %8s %8s %8s" %
+          ("stage", "core", "n", "min", "avg", "p50", "p95", "p99", "max"))
+    stages = sorted({(stage, core) for stage, core, _, _ in records})
+    for stage, core in stages:
+        durations = sorted(d for s, c, _, d in records if s == stage and c == core)
+        print("%-18s %4d %6d %8d %8d %8d %8d %8d %8d" % (
+            names.get(stage, str(stage)), core, len(durations), durations[0],
+            sum(durations) // len(durations), percentile(durations, 0.5),
+            percentile(durations, 0.95), percentile(durations, 0.99), durations[-1]))
+        if args.histogram:
+            histogram(durations)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
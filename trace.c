@@ -0,0 +1,185 @@
+#include <stdio.h>
+#include "trace.h"
+
+/*
+ * Трасування гарячих шляхів. Кожен завершений відрізок потрапляє в кільце
+ * записів у RAM і в статистику етапу (мінімум, середнє, максимум,
+ * логарифмічна гістограма). Записують обидва ядра, тому запис іде під
+ * спін-блокуванням (на хості — під м'ютексом). Вміст кільця виводиться на
+ * вимогу через USB stdio рядками "#TR", які розбирає tools/trace_report.py.
+ * Без TRACE_ENABLED макроси з trace.h порожні, а цей файл нічого не містить.
+ */
+
+#if TRACE_ENABLED
+
+typedef struct trace_stage_stats {
+    uint32_t count;
+    uint32_t min_us;
+    uint32_t max_us;
+    uint64_t total_us;
+    uint32_t histogram[TRACE_HISTOGRAM_BUCKETS];
+} trace_stage_stats_t;
+
+static const char *const trace_stage_names[TRACE_STAGES] = {
+    "capture", "release_to_graph", "slice_stats", "peaks", "graph", "lcd_flush", "encoder_display"
+};
+
+static trace_record_t trace_ring[TRACE_RING_SIZE];
+static uint32_t trace_written = 0; // Усього записів; індекс у кільці — за модулем
+static trace_stage_stats_t trace_stats[TRACE_STAGES];
+static uint32_t trace_open_us[TRACE_STAGES];
+static bool trace_open[TRACE_STAGES];
+
+#if PICO_ON_DEVICE
+#include "hardware/sync.h"
+
+static spin_lock_t *trace_spin_lock;
+
+#define TRACE_LOCK() uint32_t trace_saved_irq = spin_lock_blocking(trace_spin_lock)
+#define TRACE_UNLOCK() spin_unlock(trace_spin_lock, trace_saved_irq)
+#define TRACE_CORE() ((uint8_t)get_core_num())
+#else
+#include <pthread.h>
+
+static pthread_mutex_t trace_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+#define TRACE_LOCK() pthread_mutex_lock(&trace_mutex)
+#define TRACE_UNLOCK() pthread_mutex_unlock(&trace_mutex)
+#define TRACE_CORE() ((uint8_t)0)
+#endif
+
+void trace_init(void) {
+#if PICO_ON_DEVICE
+    trace_spin_lock = spin_lock_init((uint)spin_lock_claim_unused(true));
+#endif
+    trace_reset();
+}
+
+void trace_reset(void) {
+    TRACE_LOCK();
+    trace_written = 0;
+    for (int stage = 0; stage < TRACE_STAGES; stage++) {
+        trace_stats[stage] = (trace_stage_stats_t){ .min_us = UINT32_MAX };
+    }
+    TRACE_UNLOCK();
+}
+
+static int histogram_bucket(uint32_t duration_us) {
+    int bucket = 0;
+    while (duration_us && bucket < TRACE_HISTOGRAM_BUCKETS - 1) {
+        duration_us >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+/**
+ * Відкриває відрізок етапу. Повторне відкриття переносить його початок.
+ */
+void trace_begin(trace_stage_t stage) {
+    trace_open_us[stage] = time_us_32();
+    trace_open[stage] = true;
+}
+
+/**
+ * Закриває відрізок етапу і записує його. Без відкритого відрізка нічого
+ * не робить.
+ */
+void trace_end(trace_stage_t stage) {
+    if (!trace_open[stage]) return;
+    trace_open[stage] = false;
+    uint32_t start_us = trace_open_us[stage];
+    uint32_t duration_us = time_us_32() - start_us;
+    uint8_t core = TRACE_CORE();
+
+    TRACE_LOCK();
+    trace_ring[trace_written++ % TRACE_RING_SIZE] = (trace_record_t){
+        .start_us = start_us, .duration_us = duration_us, .stage = (uint8_t)stage, .core = core,
+    };
+    trace_stage_stats_t *stats = &trace_stats[stage];
+    stats->count++;
+    stats->total_us += duration_us;
+    if (duration_us < stats->min_us) stats->min_us = duration_us;
+    if (duration_us > stats->max_us) stats->max_us = duration_us;
+    stats->histogram[histogram_bucket(duration_us)]++;
+    TRACE_UNLOCK();
+}
+
+/**
+ * Виводить вміст кільця компактними рядками:
+ * "#TR етап ядро початок_мкс тривалість_мкс". Перед записами — назви етапів
+ * ("#TS номер назва") і кількість записів, що не вмістилися в кільце.
+ */
+void trace_dump(void) {
+    TRACE_LOCK();
+    uint32_t written = trace_written;
+    TRACE_UNLOCK();
+    uint32_t first = written > TRACE_RING_SIZE ? written - TRACE_RING_SIZE : 0;
+
+    printf("#TRACE begin %u %u\n", (unsigned)(written - first), (unsigned)first);
+    for (int stage = 0; stage < TRACE_STAGES; stage++) printf("#TS %d %s\n", stage, trace_stage_names[stage]);
+    for (uint32_t i = first; i < written; i++) {
+        TRACE_LOCK();
+        trace_record_t record = trace_ring[i % TRACE_RING_SIZE];
+        TRACE_UNLOCK();
+        printf("#TR %u %u %u %u\n", record.stage, record.core,
+               (unsigned)record.start_us, (unsigned)record.duration_us);
+    }
+    printf("#TRACE end\n");
+}
+
+/**
+ * Копіює записи, додані після *cursor (ті, що вже витіснені з кільця,
+ * пропускаються), і просуває курсор. Для двійкового виводу (frame.c).
+ *
+ * @return int Кількість скопійованих записів (не більше max).
+ */
+int trace_read(uint32_t *cursor, trace_record_t *out, int max) {
+    TRACE_LOCK();
+    uint32_t written = trace_written;
+    TRACE_UNLOCK();
+    if (*cursor > written) *cursor = 0; // Трасу скинуто
+    if (written - *cursor > TRACE_RING_SIZE) *cursor = written - TRACE_RING_SIZE;
+    int count = 0;
+    for (; *cursor < written && count < max; (*cursor)++) {
+        TRACE_LOCK();
+        out[count++] = trace_ring[*cursor % TRACE_RING_SIZE];
+        TRACE_UNLOCK();
+    }
+    return count;
+}
+
+/**
+ * Виводить статистику етапів: кількість, мінімум, середнє, максимум і
+ * ненульові кошики гістограми ("<2^k:кількість", мкс).
+ */
+void trace_print_stats(void) {
+    printf("Trace stages:\n");
+    for (int stage = 0; stage < TRACE_STAGES; stage++) {
+        TRACE_LOCK();
+        trace_stage_stats_t stats = trace_stats[stage];
+        TRACE_UNLOCK();
+        if (stats.count == 0) continue;
+        printf(" %-16s n %u min %u avg %u max %u us |", trace_stage_names[stage], (unsigned)stats.count,
+               (unsigned)stats.min_us, (unsigned)(stats.total_us / stats.count), (unsigned)stats.max_us);
+        for (int bucket = 0; bucket < TRACE_HISTOGRAM_BUCKETS; bucket++) {
+            if (stats.histogram[bucket] == 0) continue;
+            if (bucket < TRACE_HISTOGRAM_BUCKETS - 1) printf(" <%u:", 1u << bucket);
+            else printf(" >=%u:", 1u << (bucket - 1));
+            printf("%u", (unsigned)stats.histogram[bucket]);
+        }
+        printf("\n");
+    }
+}
+
+/**
+ * Команди траси з терміналу (символ уже прочитано диспетчером команд):
+ * 't' — вивести трасу, 's' — статистику етапів, 'r' — скинути.
+ */
+void trace_command(int command) {
+    if (command == 't') trace_dump();
+    else if (command == 's') trace_print_stats();
+    else if (command == 'r') trace_reset();
+}
+
+#endif // TRACE_ENABLED
@@ -0,0 +1,62 @@
+// trace.h
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "pico/stdlib.h"
+
+#ifndef TRACE_ENABLED
+#define TRACE_ENABLED 0 // 1 — збирати трасу гарячих шляхів (задається з CMake)
+#endif
+#define TRACE_RING_SIZE 256        // Записів у кільці, старші перезаписуються
+#define TRACE_HISTOGRAM_BUCKETS 16 // Кошик k: тривалість від 2^(k-1) до 2^k мкс
+
+/**
+ * Точки трасування. Відрізок починається TRACE_BEGIN і закінчується
+ * TRACE_END з тим самим етапом, тож може охоплювати кілька функцій
+ * (наприклад, від відпускання кнопки до готового графіка).
+ */
+typedef enum {
+    TRACE_CAPTURE,          // Запис: від запуску захоплення до зупинки
+    TRACE_RELEASE_TO_GRAPH, // Від зупинки запису до виведеного графіка
+    TRACE_SLICE_STATS,      // Збирання статистики слайсів (ядро 1)
+    TRACE_PEAKS,            // Пошук піків (ядро 1)
+    TRACE_GRAPH,            // display_graph
+    TRACE_LCD_FLUSH,        // Виклик lcd_flush в основному циклі
+    TRACE_ENCODER_DISPLAY,  // update_encoder_display
+    TRACE_STAGES
+} trace_stage_t;
+
+/**
+ * Запис траси: початок і тривалість відрізка за мікросекундним таймером.
+ */
+typedef struct trace_record {
+    uint32_t start_us;
+    uint32_t duration_us;
+    uint8_t stage;
+    uint8_t core;
+} trace_record_t;
+
+#if TRACE_ENABLED
+void trace_init(void);
+void trace_begin(trace_stage_t stage);
+void trace_end(trace_stage_t stage);
+void trace_command(int command);
+void trace_dump(void);
+void trace_print_stats(void);
+void trace_reset(void);
+int trace_read(uint32_t *cursor, trace_record_t *out, int max);
+
+#define TRACE_INIT() trace_init()
+#define TRACE_BEGIN(stage) trace_begin(stage)
+#define TRACE_END(stage) trace_end(stage)
+#define TRACE_COMMAND(command) trace_command(command)
+#define TRACE_READ(cursor, out, max) trace_read(cursor, out, max)
+#else
+#define TRACE_INIT() ((void)0)
+#define TRACE_BEGIN(stage) ((void)0)
+#define TRACE_END(stage) ((void)0)
+#define TRACE_COMMAND(command) ((void)command)
+#define TRACE_READ(cursor, out, max) ((void)(cursor), (void)(out), (void)(max), 0)
+#endif
+
+#endif // TRACE_H
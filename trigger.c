@@ -0,0 +1,85 @@
+#include "trigger.h"
+
+/*
+ * Тригер запису з передісторією. Перевіряє кожен зразок потоку, тому
+ * цикли для кожної умови окремі і містять лише порівняння: на Pico це
+ * кілька тактів на зразок, що дає запас навіть на найбільшій частоті АЦП.
+ * Після спрацювання тригер більше не переглядає зразки.
+ */
+
+static const char *const trigger_mode_names[TRIGGER_MODES] = { "level", "rising", "slope" };
+
+/**
+ * Готує тригер до нового потоку.
+ *
+ * @param position Номер першого зразка, який буде передано trigger_feed().
+ */
+void trigger_begin(trigger_t *trigger, const trigger_config_t *config, int position) {
+    trigger->config = *config;
+    trigger->position = position;
+    trigger->ready = false;
+    trigger->has_previous = false;
+    trigger->previous = 0;
+    trigger->fired_at = -1;
+}
+
+/**
+ * Пропуск у потоці (блоки, перезаписані до перевірки): фронт і приріст
+ * не рахуються через розрив, тож їх стан скидається.
+ *
+ * @param position Номер наступного зразка після пропуску.
+ */
+void trigger_skip(trigger_t *trigger, int position) {
+    if (position == trigger->position) return;
+    trigger->position = position;
+    trigger->ready = false;
+    trigger->has_previous = false;
+}
+
+/**
+ * Перевіряє наступні зразки потоку.
+ *
+ * @return int Індекс зразка спрацювання в samples або -1. Номер від початку
+ *             потоку зберігається у fired_at.
+ */
+int trigger_feed(trigger_t *trigger, const uint16_t *samples, int sample_count) {
+    if (trigger->fired_at >= 0 || sample_count <= 0) return -1;
+    const trigger_config_t *config = &trigger->config;
+    int i = 0;
+    if (config->mode == TRIGGER_LEVEL) {
+        uint16_t level = config->level;
+        while (i < sample_count && samples[i] < level) i++;
+    } else if (config->mode == TRIGGER_RISING) {
+        uint16_t level = config->level;
+        uint16_t rearm = config->level > config->hysteresis ? config->level - config->hysteresis : 0;
+        bool ready = trigger->ready;
+        for (; i < sample_count; i++) {
+            uint16_t value = samples[i];
+            if (value <= rearm) ready = true;
+            else if (ready && value >= level) break;
+        }
+        trigger->ready = ready;
+    } else {
+        // Приріст як int: спад дає від'ємне значення і не спрацьовує
+        int slope = config->slope;
+        int previous = trigger->has_previous ? trigger->previous : samples[0];
+        for (; i < sample_count; i++) {
+            int value = samples[i];
+            if (value - previous >= slope) break;
+            previous = value;
+        }
+        trigger->previous = (uint16_t)previous;
+        trigger->has_previous = true;
+    }
+    if (i == sample_count) {
+        trigger->position += sample_count;
+        return -1;
+    }
+    trigger->fired_at = trigger->position + i;
+    trigger->position += sample_count;
+    return i;
+}
+
+const char *trigger_mode_name(uint8_t mode) {
+    return mode < TRIGGER_MODES ? trigger_mode_names[mode] : "?";
+}
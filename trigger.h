@@ -0,0 +1,46 @@
+// trigger.h
+#ifndef TRIGGER_H
+#define TRIGGER_H
+
+#include "pico/stdlib.h"
+
+/**
+ * Умова спрацювання тригера.
+ */
+typedef enum {
+    TRIGGER_LEVEL,   // Зразок не нижче level
+    TRIGGER_RISING,  // Перетин level знизу: спершу зразок не вище level - hysteresis
+    TRIGGER_SLOPE,   // Приріст від попереднього зразка не менший за slope
+    TRIGGER_MODES
+} trigger_mode_t;
+
+/**
+ * Параметри тригера. Пороги — у кодах АЦП, крутизна — у кодах на зразок,
+ * тож перевірка зразка — одне-два порівняння цілих.
+ */
+typedef struct trigger_config {
+    uint8_t mode;        // trigger_mode_t
+    uint16_t level;
+    uint16_t hysteresis; // Для TRIGGER_RISING
+    uint16_t slope;      // Для TRIGGER_SLOPE
+} trigger_config_t;
+
+/**
+ * Стан тригера між блоками потоку: позиція, готовність фронту і
+ * попередній зразок переходять через межі блоків.
+ */
+typedef struct trigger {
+    trigger_config_t config;
+    int position;      // Номер наступного зразка від початку потоку
+    bool ready;        // TRIGGER_RISING: сигнал уже був нижче порогу
+    bool has_previous; // TRIGGER_SLOPE: є зразок, від якого рахувати приріст
+    uint16_t previous;
+    int fired_at;      // Номер зразка спрацювання, -1 — ще не спрацював
+} trigger_t;
+
+void trigger_begin(trigger_t *trigger, const trigger_config_t *config, int position);
+void trigger_skip(trigger_t *trigger, int position);
+int trigger_feed(trigger_t *trigger, const uint16_t *samples, int sample_count);
+const char *trigger_mode_name(uint8_t mode);
+
+#endif // TRIGGER_H